@@ -50,7 +50,9 @@
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 #if doxygen
 #include <beast/nudb/readme.md>
@@ -253,6 +255,20 @@ public:
     bool
     fetch (void const* key, handler&& handler);
 
+    /** fetch several values.
+
+        the keys are looked up in key file order, and keys
+        that fall in the same bucket share one read of it.
+        if key i is found, handler will be called as:
+            `(void)()(std::size_t i, void const* data, std::size_t size)`
+
+        @return the number of keys found.
+    */
+    template <class handler>
+    std::size_t
+    fetch_batch (std::vector<void const*> const& keys,
+        handler&& handler);
+
     /** insert a value.
 
         returns:
@@ -263,6 +279,26 @@ public:
     insert (void const* key, void const* data,
         std::size_t bytes);
 
+    /** a value passed to insert_batch. */
+    struct insert_item
+    {
+        void const* key;
+        void const* data;
+        std::size_t size;
+    };
+
+    /** insert several values.
+
+        each value is inserted as by insert, while the insert
+        lock is held once for all of them. the commit thread is
+        woken at most once for the batch.
+
+        returns:
+            the number of keys inserted
+    */
+    std::size_t
+    insert_batch (std::vector<insert_item> const& items);
+
 private:
     void
     rethrow()
@@ -278,6 +314,14 @@ private:
     fetch (std::size_t h, void const* key,
         detail::bucket b, handler&& handler);
 
+    // insert one value, with u_ held. sets notify
+    // if the commit thread should be woken.
+    //
+    bool
+    insert_one (void const* key, void const* data,
+        std::size_t size, detail::buffer& buf,
+            bool& notify);
+
     // returns `true` if the key exists
     // lock is unlocked after the first bucket processed
     //
@@ -459,22 +503,160 @@ next:
     return fetch(h, key, b, handler);
 }
 
+template <class hasher, class codec, class file>
+template <class handler>
+std::size_t
+store<hasher, codec, file>::fetch_batch (
+    std::vector<void const*> const& keys,
+        handler&& handler)
+{
+    using namespace detail;
+    rethrow();
+    // (bucket, hash, key) for every key, in bucket order
+    std::vector<std::tuple<std::size_t,
+        std::size_t, std::size_t>> order;
+    order.reserve(keys.size());
+    {
+        shared_lock_type m (m_);
+        for (std::size_t i = 0; i < keys.size(); ++i)
+        {
+            auto const h = hash<hasher>(
+                keys[i], s_->kh.key_size, s_->kh.salt);
+            order.emplace_back(bucket_index(
+                h, buckets_, modulus_), h, i);
+        }
+    }
+    std::sort(order.begin(), order.end());
+    std::size_t found = 0;
+    // keys whose bucket moved in a split since they were sorted
+    std::vector<std::size_t> moved;
+    std::vector<std::pair<std::size_t, std::size_t>> group;
+    buffer buf (s_->kh.block_size);
+    for (auto first = order.begin(); first != order.end();)
+    {
+        auto const n = std::get<0>(*first);
+        group.clear();
+        shared_lock_type m (m_);
+        for (; first != order.end() &&
+            std::get<0>(*first) == n; ++first)
+        {
+            auto const h = std::get<1>(*first);
+            auto const i = std::get<2>(*first);
+            auto iter = s_->p1.find(keys[i]);
+            bool pooled = iter != s_->p1.end();
+            if (! pooled)
+            {
+                iter = s_->p0.find(keys[i]);
+                pooled = iter != s_->p0.end();
+            }
+            if (pooled)
+            {
+                buffer tmp;
+                auto const result =
+                    s_->codec.decompress(
+                        iter->first.data,
+                            iter->first.size, tmp);
+                handler(i, result.first, result.second);
+                ++found;
+            }
+            else if (bucket_index(h, buckets_, modulus_) != n)
+                moved.push_back(i);
+            else
+                group.emplace_back(h, i);
+        }
+        if (group.empty())
+            continue;
+        auto const fetch_group =
+            [&](bucket const& b)
+            {
+                for (auto const& e : group)
+                    if (fetch(e.first, keys[e.second], b,
+                        [&](void const* data, std::size_t size)
+                        {
+                            handler(e.second, data, size);
+                        }))
+                        ++found;
+            };
+        auto const iter = s_->c1.find(n);
+        if (iter != s_->c1.end())
+        {
+            fetch_group(iter->second);
+            continue;
+        }
+        // vfalco audit for concurrency
+        genlock <gentex> g (g_);
+        m.unlock();
+        bucket b (s_->kh.block_size,
+            buf.get());
+        b.read (s_->kf,
+            (n + 1) * b.block_size());
+        fetch_group(b);
+    }
+    for (auto const i : moved)
+        if (fetch(keys[i],
+            [&](void const* data, std::size_t size)
+            {
+                handler(i, data, size);
+            }))
+            ++found;
+    return found;
+}
+
 template <class hasher, class codec, class file>
 bool
 store<hasher, codec, file>::insert (
     void const* key, void const* data,
         std::size_t size)
 {
-    using namespace detail;
     rethrow();
-    buffer buf;
+    detail::buffer buf;
+    bool notify = false;
+    bool inserted;
+    {
+        std::lock_guard<std::mutex> u (u_);
+        inserted = insert_one (
+            key, data, size, buf, notify);
+    }
+    if (notify)
+        cond_.notify_all();
+    return inserted;
+}
+
+template <class hasher, class codec, class file>
+std::size_t
+store<hasher, codec, file>::insert_batch (
+    std::vector<insert_item> const& items)
+{
+    rethrow();
+    detail::buffer buf;
+    bool notify = false;
+    std::size_t inserted = 0;
+    {
+        std::lock_guard<std::mutex> u (u_);
+        for (auto const& item : items)
+            if (insert_one (item.key, item.data,
+                    item.size, buf, notify))
+                ++inserted;
+    }
+    if (notify)
+        cond_.notify_all();
+    return inserted;
+}
+
+template <class hasher, class codec, class file>
+bool
+store<hasher, codec, file>::insert_one (
+    void const* key, void const* data,
+        std::size_t size, detail::buffer& buf,
+            bool& notify)
+{
+    using namespace detail;
     // data record
     if (size > field<uint48_t>::max)
         throw std::logic_error(
             "nudb: size too large");
     auto const h = hash<hasher>(
         key, s_->kh.key_size, s_->kh.salt);
-    std::lock_guard<std::mutex> u (u_);
     {
         shared_lock_type m (m_);
         if (s_->p1.find(key) != s_->p1.end())
@@ -523,11 +705,8 @@ store<hasher, codec, file>::insert (
                 s_->p1.data_size() <
                     commit_limit_; });
     }
-    bool const notify =
-        s_->p1.data_size() >= s_->pool_thresh;
-    m.unlock();
-    if (notify)
-        cond_.notify_all();
+    if (s_->p1.data_size() >= s_->pool_thresh)
+        notify = true;
     return true;
 }
 
@@ -28,6 +28,7 @@
 #include <memory>
 #include <random>
 #include <utility>
+#include <vector>
 
 namespace beast {
 namespace nudb {
@@ -41,6 +42,11 @@ namespace test {
 class store_test : public unit_test::suite
 {
 public:
+    enum
+    {
+        batch_size = 100
+    };
+
     void
     do_test (std::size_t n,
         std::size_t block_size, float load_factor)
@@ -99,6 +105,66 @@ public:
                 expect (db.insert(&v.key, v.data, v.size),
                     "insert 2");
             }
+            // insert batches
+            for (std::size_t i = 2 * n; i < 3 * n; i += batch_size)
+            {
+                std::vector<key_type> keys;
+                std::vector<std::vector<std::uint8_t>> values;
+                std::vector<test_api::store::insert_item> items;
+                for (std::size_t j = i;
+                        j < std::min<std::size_t>(i + batch_size, 3 * n); ++j)
+                {
+                    auto const v = seq[j];
+                    keys.push_back (v.key);
+                    values.emplace_back (v.data, v.data + v.size);
+                }
+                for (std::size_t j = 0; j < keys.size(); ++j)
+                    items.push_back ({ &keys[j],
+                        values[j].data(), values[j].size() });
+                expect (db.insert_batch(items) == items.size(),
+                    "insert batch");
+                expect (db.insert_batch(items) == 0,
+                    "insert batch duplicate");
+            }
+            for (std::size_t i = 2 * n; i < 3 * n; ++i)
+            {
+                auto const v = seq[i];
+                bool const found = db.fetch (&v.key, s);
+                expect (found, "batch missing");
+                expect (s.size() == v.size, "wrong size");
+                expect (std::memcmp(s.get(),
+                    v.data, v.size) == 0, "wrong data");
+            }
+            // fetch batches, every other key missing
+            for (std::size_t i = 0; i < 4 * n; i += 2 * batch_size)
+            {
+                std::vector<key_type> keys;
+                for (std::size_t j = i;
+                        j < std::min<std::size_t>(i + 2 * batch_size, 4 * n); ++j)
+                    keys.push_back (seq[j].key);
+                std::vector<void const*> pkeys;
+                for (auto const& key : keys)
+                    pkeys.push_back (&key);
+                std::vector<bool> seen (keys.size(), false);
+                auto const found = db.fetch_batch (pkeys,
+                    [&](std::size_t j, void const* data, std::size_t size)
+                    {
+                        auto const v = seq[i + j];
+                        expect (! seen[j], "fetched twice");
+                        seen[j] = true;
+                        expect (size == v.size, "wrong size");
+                        expect (std::memcmp(data,
+                            v.data, v.size) == 0, "wrong data");
+                    });
+                std::size_t present = 0;
+                for (std::size_t j = 0; j < keys.size(); ++j)
+                {
+                    expect (seen[j] == (i + j < 3 * n), "batch fetch");
+                    if (seen[j])
+                        ++present;
+                }
+                expect (found == present, "batch count");
+            }
             db.close();
             //auto const stats = test_api::verify(dp, kp);
             auto const stats = verify<test_api::hash_type>(
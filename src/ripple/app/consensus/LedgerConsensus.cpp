@@ -31,6 +31,7 @@
 #include <ripple/app/misc/ihashrouter.h>
 #include <ripple/app/misc/networkops.h>
 #include <ripple/app/misc/validations.h>
+#include <ripple/app/tx/speculativeapply.h>
 #include <ripple/app/tx/transactionacquire.h>
 #include <ripple/basics/countedobject.h>
 #include <ripple/basics/log.h>
@@ -43,6 +44,9 @@
 #include <ripple/protocol/stvalidation.h>
 #include <ripple/protocol/uinttypes.h>
 #include <ripple/app/misc/dividendvote.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 
 namespace ripple {
 
@@ -1059,15 +1063,23 @@ private:
             newlcl->setclosed ();
 
             int asf = newlcl->peekaccountstatemap ()->flushdirty (
-                hotaccount_node, newlcl->getledgerseq());
+                hotaccount_node, newlcl->getledgerseq(),
+                    getapp().getjobqueue (), jtaccept);
             int tmf = newlcl->peektransactionmap ()->flushdirty (
-                hottransaction_node, newlcl->getledgerseq());
+                hottransaction_node, newlcl->getledgerseq(),
+                    getapp().getjobqueue (), jtaccept);
             writelog (lsdebug, ledgerconsensus) << "flushed " << asf << " account and " <<
                 tmf << "transaction nodes";
 
             // accept ledger
             newlcl->setaccepted (closetime, mcloseresolution, closetimecorrect);
 
+            // the open ledger is rebuilt from the current one, whose
+            // transactions are gathered while the new ledger is announced
+            openledgerrebuild rebuild (newlcl,
+                getapp().getledgermaster().getcurrentledger(),
+                    getapp().getjobqueue ());
+
             // and stash the ledger in the ledger master
             if (getapp().getledgermaster().storeledger (newlcl))
                 writelog (lsdebug, ledgerconsensus)
@@ -1177,22 +1189,14 @@ private:
                     newol, newlcl, retriabletransactions, true);
             }
 
-            {
-                // apply transactions from the old open ledger
-                ledger::pointer oldol = getapp().getledgermaster().getcurrentledger();
-                if (oldol->peektransactionmap()->gethash().isnonzero ())
-                {
-                    writelog (lsdebug, ledgerconsensus)
-                        << "applying transactions from current open ledger";
-                    applytransactions (oldol->peektransactionmap (),
-                        newol, newlcl, retriabletransactions, true);
-                }
-            }
+            // apply transactions from the old open ledger
+            rebuild.apply (getapp().getledgermaster().getcurrentledger(),
+                newol, retriabletransactions);
 
             {
                 // apply local transactions
                 transactionengine engine (newol);
-                m_localtx.apply (engine);
+                m_localtx.apply (engine, rebuild.closed ());
             }
 
             // we have a new last closed ledger and new open ledger
@@ -2063,19 +2067,16 @@ make_ledgerconsensus (ledgerconsensus::clock_type& clock, localtxs& localtx,
         prevlclhash, previousledger, closetime, feevote, dividendvote);
 }
 
-/** apply a transaction to a ledger
+/** the parameters to apply a transaction with
 
-  @param engine       the transaction engine containing the ledger.
   @param txn          the transaction to be applied to ledger.
   @param openledger   true if ledger is open
   @param retryassured true if the transaction should be retried on failure.
-  @return             one of resultsuccess, resultfail or resultretry.
 */
 static
-int applytransaction (transactionengine& engine
-    , sttx::ref txn, bool openledger, bool retryassured)
+transactionengineparams applyparams (sttx const& txn, bool openledger,
+    bool retryassured)
 {
-    // returns false if the transaction has need not be retried.
     transactionengineparams parms = openledger ? tapopen_ledger : tapnone;
 
     if (retryassured)
@@ -2083,12 +2084,97 @@ int applytransaction (transactionengine& engine
         parms = static_cast<transactionengineparams> (parms | tapretry);
     }
 
-    if (getapp().gethashrouter ().setflag (txn->gettransactionid ()
+    if (openledger)
+    {
+        // only a signature that was actually checked, as it arrived or when
+        // it was last applied, is trusted
+        if (getapp().gethashrouter ().getflags (txn.gettransactionid ())
+            & sf_siggood)
+        {
+            parms = static_cast<transactionengineparams>
+                (parms | tapno_check_sign);
+        }
+    }
+    else if (getapp().gethashrouter ().setflag (txn.gettransactionid ()
         , sf_siggood))
     {
         parms = static_cast<transactionengineparams>
             (parms | tapno_check_sign);
     }
+
+    return parms;
+}
+
+/** keep the verdict of a signature checked by an open ledger apply for
+    the next one
+
+  @param txn          the transaction that was applied.
+  @param parms        the parameters it was applied with.
+*/
+static
+void recordsignature (sttx const& txn, transactionengineparams parms)
+{
+    if (parms & tapno_check_sign)
+        return;
+
+    if (txn.isknowngood ())
+        getapp().gethashrouter ().setflag (txn.gettransactionid (), sf_siggood);
+    else if (txn.isknownbad ())
+        getapp().gethashrouter ().setflag (txn.gettransactionid (), sf_bad);
+}
+
+/** classify the result of applying a transaction
+
+  @return             one of resultsuccess, resultfail or resultretry.
+*/
+static
+int applyresult (ter result, bool didapply)
+{
+    if (didapply)
+    {
+        writelog (lsdebug, ledgerconsensus)
+        << "transaction success: " << transhuman (result);
+        return ledgerconsensusimp::resultsuccess;
+    }
+
+    if (isteffailure (result) || istemmalformed (result) ||
+        istellocal (result))
+    {
+        // failure
+        writelog (lsdebug, ledgerconsensus)
+            << "transaction failure: " << transhuman (result);
+        return ledgerconsensusimp::resultfail;
+    }
+
+    writelog (lsdebug, ledgerconsensus)
+        << "transaction retry: " << transhuman (result);
+    return ledgerconsensusimp::resultretry;
+}
+
+/** apply a transaction to a ledger
+
+  @param engine       the transaction engine containing the ledger.
+  @param txn          the transaction to be applied to ledger.
+  @param openledger   true if ledger is open
+  @param retryassured true if the transaction should be retried on failure.
+  @return             one of resultsuccess, resultfail or resultretry.
+*/
+static
+int applytransaction (transactionengine& engine
+    , sttx::ref txn, bool openledger, bool retryassured)
+{
+    // returns false if the transaction has need not be retried.
+    if (openledger && (getapp().gethashrouter ().getflags (
+        txn->gettransactionid ()) & sf_bad))
+    {
+        writelog (lsdebug, ledgerconsensus)
+            << "transaction failure: cached bad";
+        return ledgerconsensusimp::resultfail;
+    }
+
+    transactionengineparams parms = applyparams (*txn, openledger,
+        retryassured);
+
     writelog (lsdebug, ledgerconsensus) << "txn "
         << txn->gettransactionid ()
         << (openledger ? " open" : " closed")
@@ -2100,33 +2186,213 @@ int applytransaction (transactionengine& engine
         bool didapply;
         ter result = engine.applytransaction (*txn, parms, didapply);
 
-        if (didapply)
+        if (openledger)
+            recordsignature (*txn, parms);
+        return applyresult (result, didapply);
+    }
+    catch (...)
+    {
+        writelog (lswarning, ledgerconsensus) << "throws";
+        return ledgerconsensusimp::resultfail;
+    }
+}
+
+/** apply a transaction that was applied ahead to a ledger
+
+  @param engine       the transaction engine containing the ledger.
+  @param speculative  the transactions applied ahead.
+  @param e            the transaction to be applied to ledger.
+  @return             one of resultsuccess, resultfail or resultretry.
+*/
+static
+int applytransaction (transactionengine& engine,
+    speculativeapply& speculative, speculativeapply::entry& e)
+{
+    writelog (lsdebug, ledgerconsensus) << "txn "
+        << e.txn->gettransactionid () << " closed/retry/ahead";
+    writelog (lstrace, ledgerconsensus) << e.txn->getjson (0);
+
+    try
+    {
+        bool didapply;
+        ter result = speculative.apply (engine, e, didapply);
+
+        return applyresult (result, didapply);
+    }
+    catch (...)
+    {
+        writelog (lswarning, ledgerconsensus) << "throws";
+        return ledgerconsensusimp::resultfail;
+    }
+}
+
+// shared with the job, which can run after the rebuild is gone
+struct openledgerrebuild::gathering
+{
+    gathering (ledger::pointer const& lcl_, ledger::pointer const& openledger_)
+        : lcl (lcl_)
+        , openledger (openledger_)
+        , complete (false)
+        , claimed (false)
+        , done (false)
+    {
+    }
+
+    ledger::pointer lcl;
+    ledger::pointer openledger;
+    hash_set<uint256> closed;
+    hash_map<uint256, sttx::pointer> parsed;
+
+    // false if walking either ledger threw, and nothing was kept
+    bool complete;
+
+    std::atomic<bool> claimed;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done;
+
+    // gather, unless the job or the rebuild already claimed it. returns
+    // true if this call gathered.
+    bool run ()
+    {
+        if (claimed.exchange (true))
+            return false;
+
+        gather ();
+
         {
-            writelog (lsdebug, ledgerconsensus)
-            << "transaction success: " << transhuman (result);
-            return ledgerconsensusimp::resultsuccess;
+            std::lock_guard<std::mutex> lock (mutex);
+            done = true;
         }
+        cond.notify_all ();
+        return true;
+    }
 
-        if (isteffailure (result) || istemmalformed (result) ||
-            istellocal (result))
+    void gather ()
+    {
+        // both ledgers are immutable. anything missed here is found by apply.
+        try
         {
-            // failure
-            writelog (lsdebug, ledgerconsensus)
-                << "transaction failure: " << transhuman (result);
-            return ledgerconsensusimp::resultfail;
+            for (auto const& item : *lcl->peektransactionmap ())
+                closed.insert (item->gettag ());
+
+            if (openledger)
+            {
+                for (auto const& item : *openledger->peektransactionmap ())
+                {
+                    if (closed.count (item->gettag ()))
+                        continue;
+
+                    // apply parses it again and reports the failure
+                    try
+                    {
+                        serializeriterator sit (item->peekserializer ());
+                        parsed.emplace (item->gettag (),
+                            std::make_shared<sttx> (sit));
+                    }
+                    catch (...)
+                    {
+                    }
+                }
+            }
+
+            complete = true;
         }
+        catch (...)
+        {
+            writelog (lswarning, ledgerconsensus) <<
+                "gathering open ledger transactions throws";
+            closed.clear ();
+            parsed.clear ();
+        }
+    }
+};
 
-        writelog (lsdebug, ledgerconsensus)
-            << "transaction retry: " << transhuman (result);
-        return ledgerconsensusimp::resultretry;
+openledgerrebuild::openledgerrebuild (ledger::pointer const& lcl,
+        ledger::pointer const& openledger, jobqueue& jobqueue)
+    : gathering_ (std::make_shared<gathering> (lcl, openledger))
+{
+    auto const g = gathering_;
+    jobqueue.addjob (jtparallel, "openledgerrebuild::gather",
+        [g] (job&) { g->run (); });
+}
+
+hash_set<uint256> const& openledgerrebuild::closed ()
+{
+    return wait ().closed;
+}
+
+openledgerrebuild::gathering& openledgerrebuild::wait ()
+{
+    gathering& g = *gathering_;
+
+    // the job may not have started, so the caller gathers rather than wait
+    if (!g.run ())
+    {
+        std::unique_lock<std::mutex> lock (g.mutex);
+        g.cond.wait (lock, [&g] { return g.done; });
     }
-    catch (...)
+
+    return g;
+}
+
+void openledgerrebuild::apply (ledger::ref openledger,
+    ledger::ref applyledger, canonicaltxset& retriabletransactions)
+{
+    gathering& g = wait ();
+
+    if (openledger->peektransactionmap ()->gethash ().isnonzero ())
     {
-        writelog (lswarning, ledgerconsensus) << "throws";
-        return ledgerconsensusimp::resultfail;
+        writelog (lsdebug, ledgerconsensus)
+            << "applying transactions from current open ledger";
+
+        transactionengine engine (applyledger);
+
+        for (auto const& item : *openledger->peektransactionmap ())
+        {
+            // without a complete gathering, probe the closed ledger
+            if (g.complete ? (g.closed.count (item->gettag ()) != 0) :
+                    g.lcl->hastransaction (item->gettag ()))
+                continue;
+
+            try
+            {
+                sttx::pointer txn;
+                auto const it = g.parsed.find (item->gettag ());
+
+                if (it != g.parsed.end ())
+                {
+                    txn = it->second;
+                }
+                else
+                {
+                    serializeriterator sit (item->peekserializer ());
+                    txn = std::make_shared<sttx> (sit);
+                }
+
+                if (applytransaction (engine, txn, true, true) ==
+                        ledgerconsensusimp::resultretry)
+                    retriabletransactions.push_back (txn);
+            }
+            catch (...)
+            {
+                writelog (lswarning, ledgerconsensus) << "  throws";
+            }
+        }
+
+        applytransactions (std::shared_ptr<shamap> (), applyledger, g.lcl,
+            retriabletransactions, true);
     }
 }
 
+static
+bool isdividendapply (sttx const& txn)
+{
+    return (txn.gettxntype () == ttdividend) &&
+        txn.isfieldpresent (sfdividendtype) &&
+        (txn.getfieldu8 (sfdividendtype) == dividendmaster::divtype_apply);
+}
+
 /** apply a set of transactions to a ledger
 
   @param set                   the set of transactions to apply
@@ -2136,17 +2402,93 @@ int applytransaction (transactionengine& engine
                                messages (typically new last closed ledger).
   @param retriabletransactions collect failed transactions in this set
   @param openlgr               true if applyledger is open, else false.
+  @param speculate             true to apply direct payments to a closed
+                               ledger ahead, on several threads.
+  @param batchdividends        true to apply runs of dividend apply
+                               transactions to a closed ledger as a batch.
 */
 void applytransactions (shamap::ref set, ledger::ref applyledger,
     ledger::ref checkledger, canonicaltxset& retriabletransactions,
-    bool openlgr)
+    bool openlgr, bool speculate, bool batchdividends)
+{
+    speculativeapply speculative (
+        speculate ? speculativeapply::defaultthreads () : 0);
+
+    applytransactions (set, applyledger, checkledger, retriabletransactions,
+        openlgr, speculative, batchdividends);
+}
+
+void applytransactions (shamap::ref set, ledger::ref applyledger,
+    ledger::ref checkledger, canonicaltxset& retriabletransactions,
+    bool openlgr, speculativeapply& speculative, bool batchdividends)
 {
     transactionengine engine (applyledger);
 
+    if (set && !openlgr && speculative.enabled ())
+    {
+        // a fee or amendment change can alter what the payments see, and
+        // is rare enough to apply everything one at a time
+        bool change = false;
+        std::vector<sttx::pointer> payments;
+
+        for (auto const& item : *set)
+        {
+            if (checkledger->hastransaction (item->gettag ()))
+                continue;
+
+            try
+            {
+                serializeriterator sit (item->peekserializer ());
+                sttx::pointer txn = std::make_shared<sttx> (sit);
+
+                if ((txn->gettxntype () == ttfee) ||
+                    (txn->gettxntype () == ttamendment))
+                    change = true;
+                else if (speculativeapply::eligible (*txn))
+                    payments.push_back (txn);
+            }
+            catch (...)
+            {
+            }
+        }
+
+        if (!change && speculative.worthwhile (payments.size ()))
+        {
+            for (auto const& txn : payments)
+                speculative.add (txn, applyparams (*txn, openlgr, true));
+
+            speculative.run (engine, getapp().getjobqueue ());
+        }
+    }
+
     if (set)
     {
-        for (shamapitem::pointer item = set->peekfirstitem (); !!item;
-            item = set->peeknextitem (item->gettag ()))
+        // consecutive dividend apply transactions are held back and applied
+        // as one run, which gives the same result as applying them in turn
+        std::vector<sttx::pointer> dividends;
+        std::uint32_t dividendledger = 0;
+        uint256 dividendresulthash;
+
+        auto applydividends = [&] ()
+        {
+            if (dividends.empty ())
+                return;
+
+            // whatever the batch did not deal with is applied in turn, from
+            // where it stopped
+            std::size_t const applied = batchdividends ?
+                engine.applydividends (dividends, tapretry) : 0;
+
+            for (std::size_t i = applied; i < dividends.size (); ++i)
+            {
+                if (applytransaction (engine, dividends[i],
+                          openlgr, true) == ledgerconsensusimp::resultretry)
+                    retriabletransactions.push_back (dividends[i]);
+            }
+            dividends.clear ();
+        };
+
+        for (auto const& item : *set)
         {
             // if the checkledger doesn't have the transaction
             if (!checkledger->hastransaction (item->gettag ()))
@@ -2156,9 +2498,34 @@ void applytransactions (shamap::ref set, ledger::ref applyledger,
                     "processing candidate transaction: " << item->gettag ();
                 try
                 {
+                    auto const ahead = speculative.find (item->gettag ());
+
+                    if (ahead)
+                    {
+                        applydividends ();
+
+                        if (applytransaction (engine, speculative,
+                                *ahead) == ledgerconsensusimp::resultretry)
+                            retriabletransactions.push_back (ahead->txn);
+                        continue;
+                    }
+
                     serializeriterator sit (item->peekserializer ());
                     sttx::pointer txn
                         = std::make_shared<sttx>(sit);
+                    if (!openlgr && isdividendapply (*txn))
+                    {
+                        dividends.push_back (txn);
+                        dividendledger = txn->getfieldu32 (sfdividendledger);
+                        continue;
+                    }
+
+                    applydividends ();
+
+                    if ((txn->gettxntype () == ttdividend) &&
+                        txn->isfieldpresent (sfdividendresulthash))
+                        dividendresulthash = txn->getfieldh256 (sfdividendresulthash);
+
                     if (applytransaction (engine, txn,
                               openlgr, true) == ledgerconsensusimp::resultretry)
                     {
@@ -2173,6 +2540,32 @@ void applytransactions (shamap::ref set, ledger::ref applyledger,
                 }
             }
         }
+
+        applydividends ();
+
+        engine.setwritten (nullptr);
+
+        if (speculative.adopted () || speculative.reapplied ())
+            writelog (lsdebug, ledgerconsensus) << "applied ahead: " <<
+                speculative.adopted () << " adopted, " <<
+                speculative.reapplied () << " applied again";
+
+        // the apply transactions of a dividend hash to the result the
+        // validators voted on, a zero hash was not voted on. the hash this
+        // server computed when it built them is compared, they are not
+        // hashed again here.
+        if (dividendresulthash.isnonzero () && dividendledger != 0)
+        {
+            uint256 const built = getapp().getops ().getdividendmaster ()->
+                getbuiltresulthash (dividendledger);
+
+            if (built.isnonzero () && built != dividendresulthash)
+            {
+                writelog (lswarning, ledgerconsensus) <<
+                    "dividend result " << built <<
+                    " does not match result hash " << dividendresulthash;
+            }
+        }
     }
 
     int changes;
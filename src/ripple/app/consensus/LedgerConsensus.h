@@ -25,6 +25,8 @@
 #include <ripple/app/misc/canonicaltxset.h>
 #include <ripple/app/misc/feevote.h>
 #include <ripple/app/tx/localtxs.h>
+#include <ripple/basics/unorderedcontainers.h>
+#include <ripple/core/jobqueue.h>
 #include <ripple/json/json_value.h>
 #include <ripple/overlay/peer.h>
 #include <ripple/protocol/rippleledgerhash.h>
@@ -100,7 +102,57 @@ make_ledgerconsensus (ledgerconsensus::clock_type& clock, localtxs& localtx,
 void
 applytransactions(shamap::ref set, ledger::ref applyledger,
                   ledger::ref checkledger,
-                  canonicaltxset& retriabletransactions, bool openlgr);
+                  canonicaltxset& retriabletransactions, bool openlgr,
+                  bool speculate = true, bool batchdividends = true);
+
+class speculativeapply;
+
+/** apply a set of transactions to a ledger, applying the direct payments
+    ahead with the given speculative apply, which reports how many were
+    adopted and applied again.
+*/
+void
+applytransactions(shamap::ref set, ledger::ref applyledger,
+                  ledger::ref checkledger,
+                  canonicaltxset& retriabletransactions, bool openlgr,
+                  speculativeapply& speculative, bool batchdividends = true);
+
+/**
+  rebuilds the open ledger from the previous one after a ledger closes.
+
+  the transactions of the new last closed ledger are gathered into a set,
+  and the transactions of the previous open ledger that are not in it are
+  parsed, in a job while the new ledger is announced. if the job has not
+  started by the time they are needed, the caller gathers them instead.
+*/
+class openledgerrebuild
+{
+public:
+    openledgerrebuild (ledger::pointer const& lcl,
+        ledger::pointer const& openledger, jobqueue& jobqueue);
+
+    openledgerrebuild (openledgerrebuild const&) = delete;
+    openledgerrebuild& operator= (openledgerrebuild const&) = delete;
+
+    /** the transactions in the last closed ledger, or none if they could
+        not be gathered.
+    */
+    hash_set<uint256> const& closed ();
+
+    /** apply the transactions of the open ledger that are not in the last
+        closed ledger, then retry the retriable transactions. the open
+        ledger is normally the one gathered from.
+    */
+    void apply (ledger::ref openledger, ledger::ref applyledger,
+        canonicaltxset& retriabletransactions);
+
+private:
+    struct gathering;
+
+    gathering& wait ();
+
+    std::shared_ptr<gathering> gathering_;
+};
 
 } // ripple
 
@@ -0,0 +1,125 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#include <beastconfig.h>
+#include <ripple/app/consensus/ledgerconsensus.h>
+#include <ripple/app/ledger/ledgertestsuite.h>
+#include <ripple/app/main/application.h>
+
+namespace ripple {
+
+// rebuilds an open ledger after a close from the gathered transactions, and
+// by applying the previous open ledger's transaction map, and checks the
+// open ledgers match.
+class openledgerrebuild_test : public ledgertestsuite
+{
+public:
+    // the open ledger following lcl, holding the transactions of the set
+    ledger::pointer
+    open (ledger::ref lcl, shamap::ref set)
+    {
+        canonicaltxset retriabletransactions (set->gethash ());
+        ledger::pointer ol = std::make_shared<ledger> (true, *lcl);
+        applytransactions (set, ol, ol, retriabletransactions, true);
+        return ol;
+    }
+
+    // the open ledger after newlcl as consensus built it before the rebuild
+    ledger::pointer
+    rebuildserial (ledger::ref newlcl, ledger::ref oldol)
+    {
+        canonicaltxset retriabletransactions (newlcl->gethash ());
+        ledger::pointer newol = std::make_shared<ledger> (true, *newlcl);
+        applytransactions (oldol->peektransactionmap (), newol, newlcl,
+            retriabletransactions, true);
+        return newol;
+    }
+
+    ledger::pointer
+    rebuild (ledger::ref newlcl, ledger::ref gatherfrom, ledger::ref oldol)
+    {
+        canonicaltxset retriabletransactions (newlcl->gethash ());
+        ledger::pointer newol = std::make_shared<ledger> (true, *newlcl);
+        openledgerrebuild rebuild (newlcl, gatherfrom,
+            getapp().getjobqueue ());
+
+        std::size_t closed = 0;
+        for (auto const& item : *newlcl->peektransactionmap ())
+        {
+            ++closed;
+            expect (rebuild.closed ().count (item->gettag ()) == 1,
+                "closed transaction not gathered");
+        }
+        expect (rebuild.closed ().size () == closed,
+            "gathered transactions not closed");
+
+        rebuild.apply (oldol, newol, retriabletransactions);
+        return newol;
+    }
+
+    void
+    run ()
+    {
+        testaccount master = createaccount ();
+        std::vector<testaccount> accounts;
+        for (int i = 0; i < 20; ++i)
+            accounts.push_back (createaccount ());
+
+        ledger::pointer lcl = genesis (master);
+
+        {
+            std::vector<sttx::pointer> txns;
+            for (auto const& account : accounts)
+                txns.push_back (payment (master, account, 1000 * xrp));
+            lcl = close (lcl, makeset (lcl, txns));
+        }
+
+        // the open ledger holds payments that make it into the next closed
+        // ledger and payments that do not, two from each sender, so some
+        // are retried when they are applied out of sequence
+        std::vector<sttx::pointer> agreed;
+        std::vector<sttx::pointer> left;
+        for (int i = 0; i < 20; ++i)
+        {
+            auto& txns = (i < 10) ? agreed : left;
+            txns.push_back (payment (accounts[i], accounts[(i + 1) % 20],
+                10 * xrp));
+            txns.push_back (payment (accounts[i], accounts[(i + 2) % 20],
+                20 * xrp));
+        }
+
+        std::vector<sttx::pointer> all (agreed);
+        all.insert (all.end (), left.begin (), left.end ());
+        ledger::pointer oldol = open (lcl, makeset (lcl, all));
+
+        ledger::pointer newlcl = close (lcl, makeset (lcl, agreed));
+        ledger::pointer serial = rebuildserial (newlcl, oldol);
+
+        testcase ("gathered");
+        checksame (serial, rebuild (newlcl, oldol, oldol));
+
+        testcase ("closed only");
+        checksame (serial, rebuild (newlcl, ledger::pointer (), oldol));
+    }
+};
+
+beast_define_testsuite(openledgerrebuild,app,ripple);
+
+} // ripple
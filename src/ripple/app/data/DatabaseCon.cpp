@@ -41,14 +41,136 @@ databasecon::databasecon (setup const& setup,
 
     for (int i = 0; i < initcount; ++i)
         mdatabase->executesql (initstrings[i], true);
+
+    // a temporary database can't be opened again, it only has one
+    // connection. in wal mode readers don't wait for the writer.
+    if (!ppath.empty ())
+    {
+        for (int i = 0; i < setup.readers; ++i)
+        {
+            std::unique_ptr <database> reader (
+                std::make_unique <sqlitedatabase> (ppath.string ().c_str ()));
+            reader->connect ();
+            reader->executesql ("pragma query_only=1;", true);
+            addreader (reader.get ());
+            mreaders.push_back (std::move (reader));
+        }
+    }
 }
 
 databasecon::~databasecon ()
 {
+    for (auto& reader : mreaders)
+        reader->disconnect ();
+    mreaders.clear ();
+
     mdatabase->disconnect ();
     delete mdatabase;
 }
 
+void databasecon::addreader (database* db)
+{
+    std::lock_guard <std::mutex> lock (mreaderlock);
+    mfreereaders.push_back (db);
+    ++mreadercount;
+}
+
+void databasecon::setcollector (
+    beast::insight::collector::ptr const& collector)
+{
+    std::lock_guard <std::mutex> lock (mreaderlock);
+    mcollector = collector;
+    mstats.clear ();
+}
+
+databasecon::readerstats&
+databasecon::getstats (std::string const& name)
+{
+    // called with mreaderlock held
+    auto iter = mstats.find (name);
+
+    if (iter == mstats.end ())
+    {
+        readerstats stats;
+
+        if (mcollector)
+        {
+            stats.wait = mcollector->make_event (name + "_wait");
+            stats.query = mcollector->make_event (name + "_query");
+        }
+
+        iter = mstats.emplace (name, std::move (stats)).first;
+    }
+
+    return iter->second;
+}
+
+databasecon::reader
+databasecon::getreader (std::string const& name)
+{
+    auto const start = clock_type::now ();
+    std::unique_lock <std::mutex> lock (mreaderlock);
+    readerstats& stats = getstats (name);
+
+    if (mreadercount == 0)
+    {
+        lock.unlock ();
+        std::unique_lock <mutex> sl (mlock);
+        stats.wait.notify (clock_type::now () - start);
+        return reader (*this, mdatabase, std::move (sl), stats);
+    }
+
+    mreadercond.wait (lock, [this] { return !mfreereaders.empty (); });
+    database* db = mfreereaders.back ();
+    mfreereaders.pop_back ();
+    lock.unlock ();
+
+    stats.wait.notify (clock_type::now () - start);
+    return reader (*this, db, std::unique_lock <mutex> (), stats);
+}
+
+void databasecon::release (database* db)
+{
+    {
+        std::lock_guard <std::mutex> lock (mreaderlock);
+        mfreereaders.push_back (db);
+    }
+    mreadercond.notify_one ();
+}
+
+//------------------------------------------------------------------------------
+
+databasecon::reader::reader (databasecon& con, database* db,
+        std::unique_lock<mutex> lock, readerstats& stats)
+    : mcon (&con)
+    , mdb (db)
+    , mlock (std::move (lock))
+    , mstats (&stats)
+    , mstart (clock_type::now ())
+{
+}
+
+databasecon::reader::reader (reader&& other)
+    : mcon (other.mcon)
+    , mdb (other.mdb)
+    , mlock (std::move (other.mlock))
+    , mstats (other.mstats)
+    , mstart (other.mstart)
+{
+    other.mdb = nullptr;
+}
+
+databasecon::reader::~reader ()
+{
+    if (mdb == nullptr)
+        return;
+
+    mstats->query.notify (clock_type::now () - mstart);
+
+    if (! mlock.owns_lock ())
+        mcon->release (mdb);
+}
+
 databasecon::setup
 setup_databasecon (config const& c)
 {
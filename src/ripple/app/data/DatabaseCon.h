@@ -22,9 +22,16 @@
 
 #include <ripple/app/data/database.h>
 #include <ripple/core/config.h>
+#include <beast/insight/collector.h>
+#include <beast/insight/event.h>
 #include <boost/filesystem/path.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 namespace ripple {
 
@@ -41,8 +48,14 @@ public:
         config::startuptype startup = config::normal;
         bool standalone = false;
         boost::filesystem::path datadir;
+
+        // connections opened for queries that only read. with none,
+        // queries read through the connection that writes.
+        int readers = 0;
     };
 
+    class reader;
+
     databasecon (setup const& setup,
             std::string const& name,
             const char* initstring[],
@@ -66,12 +79,78 @@ public:
         return mlock;
     }
 
+    /** get a connection for a query that only reads.
+        waits while every read connection is in use. a database without
+        read connections gives its connection that writes, locked.
+        @param name the query, the time spent waiting for the connection
+                    and holding it are reported under this name.
+    */
+    reader getreader (std::string const& name);
+
+    /** report the times of getreader to this collector. */
+    void setcollector (beast::insight::collector::ptr const& collector);
+
 protected:
     databasecon () {}
+
+    // make a connection available to readers. the same connection may be
+    // added more than once if it can serve several threads at a time.
+    void addreader (database* db);
+
     database* mdatabase;
 
 private:
+    typedef std::chrono::steady_clock clock_type;
+
+    struct readerstats
+    {
+        beast::insight::event wait;
+        beast::insight::event query;
+    };
+
+    readerstats& getstats (std::string const& name);
+    void release (database* db);
+
     mutex  mlock;
+
+    std::mutex mreaderlock;
+    std::condition_variable mreadercond;
+    std::vector <std::unique_ptr <database>> mreaders;  // owned read connections
+    std::vector <database*> mfreereaders;
+    std::size_t mreadercount = 0;
+    beast::insight::collector::ptr mcollector;
+    std::map <std::string, readerstats> mstats;
+};
+
+/** a connection from databasecon::getreader, given back when destroyed. */
+class databasecon::reader
+{
+public:
+    reader (reader&& other);
+    reader& operator= (reader const&) = delete;
+    ~reader ();
+
+    database* operator-> () const
+    {
+        return mdb;
+    }
+
+    database* get () const
+    {
+        return mdb;
+    }
+
+private:
+    friend class databasecon;
+
+    reader (databasecon& con, database* db, std::unique_lock<mutex> lock,
+        readerstats& stats);
+
+    databasecon* mcon;
+    database* mdb;
+    std::unique_lock<mutex> mlock;
+    readerstats* mstats;
+    clock_type::time_point mstart;
 };
 
 //------------------------------------------------------------------------------
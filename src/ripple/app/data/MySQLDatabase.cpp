@@ -362,6 +362,13 @@ mysqldatabasecon::mysqldatabasecon(beast::stringpairarray& params, const char* i
     
     for (int i = 0; i < initcount; ++i)
         mdatabase->executesql (initstrings[i], true);
+
+    // each thread queries through a connection of its own
+    int readers = 4;
+    if (params[beast::string("readers")] != beast::string::empty)
+        readers = boost::lexical_cast<int>(params[beast::string("readers")].tostdstring());
+    for (int i = 0; i < readers; ++i)
+        addreader (mdatabase);
 }
 
 } // ripple
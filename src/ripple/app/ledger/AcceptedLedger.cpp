@@ -35,8 +35,7 @@ acceptedledger::acceptedledger (ledger::ref ledger) : mledger (ledger)
 {
     shamap& txset = *ledger->peektransactionmap ();
 
-    for (shamapitem::pointer item = txset.peekfirstitem (); item;
-         item = txset.peeknextitem (item->gettag ()))
+    for (auto const& item : txset)
     {
         serializeriterator sit (item->peekserializer ());
         insert (std::make_shared<acceptedledgertx> (ledger, std::ref (sit)));
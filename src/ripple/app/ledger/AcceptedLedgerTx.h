@@ -94,6 +94,10 @@ public:
         return mmeta ? mmeta->getindex () : 0;
     }
     std::string getescmeta () const;
+    blob const& getrawmeta () const
+    {
+        return mrawmeta;
+    }
     json::value getjson ()
     {
         if (mjson == json::nullvalue)
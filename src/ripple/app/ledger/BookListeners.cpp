@@ -38,7 +38,8 @@ void booklisteners::removesubscriber (std::uint64_t seq)
 
 void booklisteners::publish (json::value const& jvobj)
 {
-    std::string sobj = to_string (jvobj);
+    auto const sobj = std::make_shared <std::string const> (
+        to_string (jvobj));
 
     scopedlocktype sl (mlock);
     networkops::submaptype::const_iterator it = mlisteners.begin ();
@@ -844,6 +844,10 @@ bool inboundledger::taketxnode (const std::list<shamapnodeid>& nodeids,
     std::list< blob >::const_iterator nodedatait = data.begin ();
     transactionstatesf tfilter;
 
+    // nodes below the root are hashed together, the root goes in first
+    std::vector<std::pair<shamapnodeid, blob const*>> known;
+    known.reserve (nodeids.size ());
+
     while (nodeidit != nodeids.end ())
     {
         if (nodeidit->isroot ())
@@ -855,16 +859,20 @@ bool inboundledger::taketxnode (const std::list<shamapnodeid>& nodeids,
         }
         else
         {
-            san +=  mledger->peektransactionmap ()->addknownnode (
-                *nodeidit, *nodedatait, &tfilter);
-            if (!san.isgood())
-                return false;
+            known.emplace_back (*nodeidit, &*nodedatait);
         }
 
         ++nodeidit;
         ++nodedatait;
     }
 
+    if (!known.empty ())
+    {
+        san += mledger->peektransactionmap ()->addknownnodes (known, &tfilter);
+        if (!san.isgood())
+            return false;
+    }
+
     if (!mledger->peektransactionmap ()->issynching ())
     {
         mhavetransactions = true;
@@ -911,6 +919,10 @@ bool inboundledger::takeasnode (const std::list<shamapnodeid>& nodeids,
     std::list< blob >::const_iterator nodedatait = data.begin ();
     accountstatesf tfilter;
 
+    // nodes below the root are hashed together, the root goes in first
+    std::vector<std::pair<shamapnodeid, blob const*>> known;
+    known.reserve (nodeids.size ());
+
     while (nodeidit != nodeids.end ())
     {
         if (nodeidit->isroot ())
@@ -926,20 +938,24 @@ bool inboundledger::takeasnode (const std::list<shamapnodeid>& nodeids,
         }
         else
         {
-            san += mledger->peekaccountstatemap ()->addknownnode (
-                *nodeidit, *nodedatait, &tfilter);
-            if (!san.isgood ())
-            {
-                if (m_journal.warning) m_journal.warning <<
-                    "unable to add as node";
-                return false;
-            }
+            known.emplace_back (*nodeidit, &*nodedatait);
         }
 
         ++nodeidit;
         ++nodedatait;
     }
 
+    if (!known.empty ())
+    {
+        san += mledger->peekaccountstatemap ()->addknownnodes (known, &tfilter);
+        if (!san.isgood ())
+        {
+            if (m_journal.warning) m_journal.warning <<
+                "unable to add as node";
+            return false;
+        }
+    }
+
     if (!mledger->peekaccountstatemap ()->issynching ())
     {
         mhavestate = true;
@@ -246,10 +246,12 @@ public:
     */
     void gotstaledata (std::shared_ptr<protocol::tmledgerdata> packet_ptr)
     {
-        const uint256 uzero;
         serializer s;
         try
         {
+            std::vector<shamaptreenode::pointer> newnodes;
+            newnodes.reserve (packet_ptr->nodes ().size ());
+
             for (int i = 0; i < packet_ptr->nodes ().size (); ++i)
             {
                 auto const& node = packet_ptr->nodes (i);
@@ -257,16 +259,21 @@ public:
                 if (!node.has_nodeid () || !node.has_nodedata ())
                     return;
 
-                shamaptreenode newnode(
+                newnodes.push_back (shamaptreenode::createunhashed (
                     blob (node.nodedata().begin(), node.nodedata().end()),
-                    0, snfwire, uzero, false);
+                    0, snfwire));
+            }
 
+            shamaptreenode::updatehashes (newnodes);
+
+            for (auto const& newnode : newnodes)
+            {
                 s.erase();
-                newnode.addraw(s, snfprefix);
+                newnode->addraw(s, snfprefix);
 
                 auto blob = std::make_shared<blob> (s.begin(), s.end());
 
-                getapp().getops().addfetchpack (newnode.getnodehash(), blob);
+                getapp().getops().addfetchpack (newnode->getnodehash(), blob);
             }
         }
         catch (...)
@@ -25,6 +25,7 @@
 #include <ripple/app/ledger/ledgertiming.h>
 #include <ripple/app/ledger/ledgertojson.h>
 #include <ripple/app/ledger/orderbookdb.h>
+#include <ripple/app/ledger/txnwriter.h>
 #include <ripple/app/data/databasecon.h>
 #include <ripple/app/data/sqlitedatabase.h>
 #include <ripple/app/main/application.h>
@@ -656,6 +657,13 @@ uint256 ledger::gethash ()
     return mhash;
 }
 
+// writes the transactions of saved ledgers, one for the process
+static txnwriter& gettxnwriter ()
+{
+    static txnwriter writer;
+    return writer;
+}
+
 bool ledger::savevalidatedledger (bool current)
 {
     // todo(tom): fix this hard-coded sql!
@@ -664,17 +672,6 @@ bool ledger::savevalidatedledger (bool current)
         << (current ? "" : "fromacquire ") << getledgerseq ();
     static boost::format deleteledger (
         "delete from ledgers where ledgerseq = %u;");
-    static boost::format deletetrans1 (
-        "delete from transactions where ledgerseq = %u;");
-    static boost::format deletetrans2 (
-        "delete from accounttransactions where ledgerseq = %u;");
-    static boost::format deleteaccttrans (
-        "delete from accounttransactions where transid = '%s';");
-    static boost::format transexists (
-        "select status from transactions where transid = '%s';");
-    static boost::format updatetx (
-        "update transactions set ledgerseq = %u, status = '%c', txnmeta = %s "
-        "where transid = '%s';");
     static boost::format addledger (
         "insert or replace into ledgers "
         "(ledgerhash,ledgerseq,prevhash,totalcoins,totalcoinsvbc,closingtime,prevclosingtime,"
@@ -735,79 +732,28 @@ bool ledger::savevalidatedledger (bool current)
     
     if (getapp().gettxndb().getdb()->getdbtype()!=database::type::null)
     {
-        auto db = getapp().gettxndb ().getdb ();
-        auto dblock (getapp().gettxndb ().lock ());
-        db->batchstart();
-        db->begintransaction();
-
-        db->executesql (boost::str (deletetrans1 % getledgerseq ()));
-        db->executesql (boost::str (deletetrans2 % getledgerseq ()));
-
-        std::string const ledgerseq (std::to_string (getledgerseq ()));
-
         for (auto const& vt : aledger->getmap ())
-        {
-            uint256 transactionid = vt.second->gettransactionid ();
-
             getapp().getmastertransaction ().inledger (
-                transactionid, getledgerseq ());
-
-            std::string const txnid (to_string (transactionid));
-            std::string const txnseq (std::to_string (vt.second->gettxnseq ()));
-
-            db->executesql (boost::str (deleteaccttrans % transactionid));
-
-            auto const& accts = vt.second->getaffected ();
+                vt.second->gettransactionid (), getledgerseq ());
 
-            if (!accts.empty ())
+        // stage the rows before the database is locked, they are committed
+        // together with those of any other ledgers saved meanwhile
+        try
+        {
+            gettxnwriter ().write (getapp().gettxndb (),
+                txnwriter::stage (*aledger));
+        }
+        catch (...)
+        {
+            writelog (lswarning, ledger) << "the transactions of ledger "
+                << mledgerseq << " could not be saved";
+            getapp().getledgermaster().failedsave(mledgerseq, mhash);
             {
-                std::string sql ("insert into accounttransactions "
-                                 "(transid, account, ledgerseq, txnseq) values ");
-
-                // try to make an educated guess on how much space we'll need
-                // for our arguments. in argument order we have:
-                // 64 + 34 + 10 + 10 = 118 + 10 extra = 128 bytes
-                sql.reserve (sql.length () + (accts.size () * 128));
-
-                bool first = true;
-                for (auto const& it : accts)
-                {
-                    if (!first)
-                        sql += ", ('";
-                    else
-                    {
-                        sql += "('";
-                        first = false;
-                    }
-
-                    sql += txnid;
-                    sql += "','";
-                    sql += it.humanaccountid ();
-                    sql += "',";
-                    sql += ledgerseq;
-                    sql += ",";
-                    sql += txnseq;
-                    sql += ")";
-                }
-                sql += ";";
-                if (shouldlog (lstrace, ledger))
-                {
-                    writelog (lstrace, ledger) << "acttx: " << sql;
-                }
-                db->executesql (sql);
+                staticscopedlocktype sl (spendingsavelock);
+                spendingsaves.erase(getledgerseq());
             }
-            else
-                writelog (lswarning, ledger)
-                    << "transaction in ledger " << mledgerseq
-                    << " affects no accounts";
-
-            db->executesql (
-                sttx::getmetasqlinsertreplaceheader (db->getdbtype()) +
-                vt.second->gettxn ()->getmetasql (
-                    getledgerseq (), vt.second->getescmeta (), mclosetime) + ";");
+            return false;
         }
-        db->endtransaction();
-        db->batchcommit();
     }
 
     {
@@ -1409,7 +1355,8 @@ static void visithelper (
     function (std::make_shared<sle> (item->peekserializer (), item->gettag ()));
 }
 
-void ledger::visitstateitems (std::function<void (sle::ref)> function) const
+void ledger::visitstateitems (std::function<void (sle::ref)> function,
+    int prefetch) const
 {
     try
     {
@@ -1417,7 +1364,30 @@ void ledger::visitstateitems (std::function<void (sle::ref)> function) const
         {
             maccountstatemap->visitleaves(
                 std::bind(&visithelper, std::ref(function),
-                          std::placeholders::_1));
+                          std::placeholders::_1), prefetch);
+        }
+    }
+    catch (shamapmissingnode&)
+    {
+        if (mhash.isnonzero ())
+        {
+            getapp().getinboundledgers().findcreate(
+                mhash, mledgerseq, inboundledger::fcgeneric);
+        }
+        throw;
+    }
+}
+
+void ledger::visitstatebranch (
+    int branch, std::function<void (sle::ref)> function, int prefetch) const
+{
+    try
+    {
+        if (maccountstatemap)
+        {
+            maccountstatemap->visitbranchleaves(branch,
+                std::bind(&visithelper, std::ref(function),
+                          std::placeholders::_1), prefetch);
         }
     }
     catch (shamapmissingnode&)
@@ -336,7 +336,13 @@ public:
         std::uint64_t const hint,  // hint which page to start at
         unsigned int limit,
         std::function <bool (sle::ref)>) const;
-    void visitstateitems (std::function<void (sle::ref)>) const;
+    // prefetch is passed on to the state map walk, see shamap::visitnodes
+    void visitstateitems (std::function<void (sle::ref)>,
+        int prefetch = 0) const;
+
+    // visit the state items below one of the 16 root branches
+    void visitstatebranch (int branch, std::function<void (sle::ref)>,
+        int prefetch = 0) const;
 
     // database functions (low-level)
     static ledger::pointer loadbyindex (std::uint32_t ledgerindex);
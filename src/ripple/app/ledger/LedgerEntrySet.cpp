@@ -82,8 +82,11 @@ sle::pointer ledgerentryset::getentry (uint256 const& index, ledgerentryaction&
     if (it->second.mseq != mseq)
     {
         assert (it->second.mseq < mseq);
-        it->second.mentry = std::make_shared<stledgerentry> (*it->second.mentry);
-        it->second.mseq = mseq;
+        ledgerentrysetentry& entry = mentries.modify (it);
+        entry.mentry = std::make_shared<stledgerentry> (*entry.mentry);
+        entry.mseq = mseq;
+        action = entry.maction;
+        return entry.mentry;
     }
 
     action = it->second.maction;
@@ -125,7 +128,7 @@ sle::pointer ledgerentryset::entrycache (ledgerentrytype lettype, uint256 const&
 
 ledgerentryaction ledgerentryset::hasentry (uint256 const& index) const
 {
-    std::map<uint256, ledgerentrysetentry>::const_iterator it = mentries.find (index);
+    auto it = mentries.find (index);
 
     if (it == mentries.end ())
         return taanone;
@@ -148,10 +151,13 @@ void ledgerentryset::entrycache (sle::ref sle)
     switch (it->second.maction)
     {
     case taacached:
+    {
         assert (sle == it->second.mentry);
-        it->second.mseq     = mseq;
-        it->second.mentry   = sle;
+        ledgerentrysetentry& entry = mentries.modify (it);
+        entry.mseq     = mseq;
+        entry.mentry   = sle;
         return;
+    }
 
     default:
         throw std::runtime_error ("cache after modify/delete/create");
@@ -174,11 +180,14 @@ void ledgerentryset::entrycreate (sle::ref sle)
     {
 
     case taadelete:
+    {
         writelog (lsdebug, ledgerentryset) << "create after delete = modify";
-        it->second.mentry = sle;
-        it->second.maction = taamodify;
-        it->second.mseq = mseq;
-        break;
+        ledgerentrysetentry& entry = mentries.modify (it);
+        entry.mentry = sle;
+        entry.maction = taamodify;
+        entry.mseq = mseq;
+        return;
+    }
 
     case taamodify:
         throw std::runtime_error ("create after modify");
@@ -192,8 +201,6 @@ void ledgerentryset::entrycreate (sle::ref sle)
     default:
         throw std::runtime_error ("unknown taa");
     }
-
-    assert (it->second.mseq == mseq);
 }
 
 void ledgerentryset::entrymodify (sle::ref sle)
@@ -211,17 +218,19 @@ void ledgerentryset::entrymodify (sle::ref sle)
     assert (it->second.mseq == mseq);
     assert (it->second.mentry == sle);
 
-    switch (it->second.maction)
+    ledgerentrysetentry& entry = mentries.modify (it);
+
+    switch (entry.maction)
     {
     case taacached:
-        it->second.maction  = taamodify;
+        entry.maction  = taamodify;
 
         // fall through
 
     case taacreate:
     case taamodify:
-        it->second.mseq     = mseq;
-        it->second.mentry   = sle;
+        entry.mseq     = mseq;
+        entry.mentry   = sle;
         break;
 
     case taadelete:
@@ -252,10 +261,13 @@ void ledgerentryset::entrydelete (sle::ref sle)
     {
     case taacached:
     case taamodify:
-        it->second.mseq     = mseq;
-        it->second.mentry   = sle;
-        it->second.maction  = taadelete;
+    {
+        ledgerentrysetentry& entry = mentries.modify (it);
+        entry.mseq     = mseq;
+        entry.mentry   = sle;
+        entry.maction  = taadelete;
         break;
+    }
 
     case taacreate:
         mentries.erase (it);
@@ -359,13 +371,20 @@ sle::pointer ledgerentryset::getformod (uint256 const& node, ledger::ref ledger,
             return sle::pointer ();
         }
 
-        if (it->second.maction == taacached)
-            it->second.maction = taamodify;
-
-        if (it->second.mseq != mseq)
+        if ((it->second.maction == taacached) || (it->second.mseq != mseq))
         {
-            it->second.mentry = std::make_shared<stledgerentry> (*it->second.mentry);
-            it->second.mseq = mseq;
+            ledgerentrysetentry& entry = mentries.modify (it);
+
+            if (entry.maction == taacached)
+                entry.maction = taamodify;
+
+            if (entry.mseq != mseq)
+            {
+                entry.mentry = std::make_shared<stledgerentry> (*entry.mentry);
+                entry.mseq = mseq;
+            }
+
+            return entry.mentry;
         }
 
         return it->second.mentry;
@@ -458,7 +477,7 @@ void ledgerentryset::calcrawmeta (serializer& s, ter result, std::uint32_t index
     // entries modified only as a result of building the transaction metadata
     nodetoledgerentry newmod;
 
-    for (auto& it : mentries)
+    for (auto const& it : mentries)
     {
         sfield::ptr type = &sfgeneric;
 
@@ -997,19 +1016,27 @@ bool ledgerentryset::dirnext (
 
 uint256 ledgerentryset::getnextledgerindex (uint256 const& uhash)
 {
-    // find next node in ledger that isn't deleted by les
-    uint256 ledgernext = uhash;
-    std::map<uint256, ledgerentrysetentry>::const_iterator it;
-
-    do
+    // find next node in ledger that isn't deleted by les, stepping
+    // past deleted nodes without descending from the root again
+    uint256 ledgernext;
+    entrymap const& entries = mentries;
+    const_iterator it;
+    shamap& statemap = *mledger->peekaccountstatemap ();
+
+    for (auto item = statemap.upper_bound (uhash);
+         item != statemap.end (); ++item)
     {
-        ledgernext = mledger->getnextledgerindex (ledgernext);
-        it  = mentries.find (ledgernext);
+        it = entries.find ((*item)->gettag ());
+
+        if ((it == entries.end ()) || (it->second.maction != taadelete))
+        {
+            ledgernext = (*item)->gettag ();
+            break;
+        }
     }
-    while ((it != mentries.end ()) && (it->second.maction == taadelete));
 
     // find next node in les that isn't deleted
-    for (it = mentries.upper_bound (uhash); it != mentries.end (); ++it)
+    for (it = entries.upper_bound (uhash); it != entries.end (); ++it)
     {
         // node found in les, node found in ledger, return earliest
         if (it->second.maction != taadelete)
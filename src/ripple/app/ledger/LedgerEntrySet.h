@@ -22,6 +22,7 @@
 
 #include <ripple/app/ledger/ledger.h>
 #include <ripple/basics/countedobject.h>
+#include <ripple/basics/sortedflatmap.h>
 #include <ripple/protocol/stledgerentry.h>
 
 namespace ripple {
@@ -265,9 +266,13 @@ public:
     json::value getjson (int) const;
     void calcrawmeta (serializer&, ter result, std::uint32_t index);
 
+    // entries are kept in index order, which the metadata depends on. a
+    // duplicate shares them until either set changes one.
+    typedef sortedflatmap<uint256, ledgerentrysetentry> entrymap;
+
     // iterator functions
-    typedef std::map<uint256, ledgerentrysetentry>::iterator iterator;
-    typedef std::map<uint256, ledgerentrysetentry>::const_iterator const_iterator;
+    typedef entrymap::iterator iterator;
+    typedef entrymap::const_iterator const_iterator;
 
     bool empty () const
     {
@@ -305,7 +310,7 @@ public:
 
 private:
     ledger::pointer mledger;
-    std::map<uint256, ledgerentrysetentry>  mentries; // cannot be unordered!
+    entrymap mentries; // cannot be unordered!
 
     typedef hash_map<uint256, sle::pointer> nodetoledgerentry;
 
@@ -315,7 +320,7 @@ private:
     bool mimmutable;
 
     ledgerentryset (
-        ledger::ref ledger, const std::map<uint256, ledgerentrysetentry>& e,
+        ledger::ref ledger, entrymap const& e,
         const transactionmetaset & s, int m) :
         mledger (ledger), mentries (e), mset (s), mparams (tapnone), mseq (m),
         mimmutable (false)
@@ -0,0 +1,426 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#include <beastconfig.h>
+#include <ripple/app/ledger/ledgerentryset.h>
+#include <ripple/basics/sortedflatmap.h>
+#include <ripple/protocol/rippleaddress.h>
+#include <beast/random/rngfill.h>
+#include <beast/random/xor_shift_engine.h>
+#include <beast/unit_test/suite.h>
+#include <chrono>
+#include <iomanip>
+#include <map>
+
+namespace ripple {
+
+// replays synthetic transactions through a ledgerentryset the way they are
+// applied: payments that try a few paths from a checkpoint and keep the
+// best, and offers that cross a run of the book one checkpoint at a time.
+// each transaction ends with a walk of the set in index order, as metadata
+// is built. the replay runs through a ledgerentryset, and through copies of
+// its checkpoint logic over std::map and over sortedflatmap, so the maps
+// are timed against each other in one run.
+class ledgerentryset_timing_test : public beast::unit_test::suite
+{
+public:
+    typedef std::chrono::high_resolution_clock clock_type;
+
+    enum
+    {
+        transactions = 20000,
+        keypool = 20000,
+        offerpercent = 40,
+        ripplepercent = 30,
+        maxpaths = 4,
+        maxcrossings = 20
+    };
+
+    struct txn
+    {
+        bool offer;
+        std::vector <uint256> base;
+        std::vector <std::vector <uint256>> steps;
+        uint256 created;
+        bool unfunded;
+    };
+
+    template <class duration>
+    static double
+    seconds (duration const& d)
+    {
+        return std::chrono::duration_cast <
+            std::chrono::duration <double>> (d).count ();
+    }
+
+    static std::vector <txn>
+    maketxns (std::vector <uint256> const& keys)
+    {
+        beast::xor_shift_engine g (1);
+
+        auto pick = [&] ()
+        {
+            return keys [g () % keys.size ()];
+        };
+
+        std::vector <txn> result (transactions);
+        for (auto& t : result)
+        {
+            t.offer = int (g () % 100) < offerpercent;
+            beast::rngfill (t.created.begin (), t.created.size (), g);
+            t.unfunded = (g () % 4) == 0;
+
+            if (t.offer)
+            {
+                // owner, owner directory and the book directory
+                for (int i = 0; i < 3; ++i)
+                    t.base.push_back (pick ());
+
+                // each crossing touches a book page, the offer, its owner
+                // and the two trust lines funds move through
+                int const crossings = g () % (maxcrossings + 1);
+                for (int c = 0; c < crossings; ++c)
+                {
+                    std::vector <uint256> step;
+                    step.push_back (t.base.back ());
+                    for (int i = 0; i < 4; ++i)
+                        step.push_back (pick ());
+                    t.steps.push_back (std::move (step));
+                }
+            }
+            else
+            {
+                // source and destination
+                t.base.push_back (pick ());
+                t.base.push_back (pick ());
+
+                if (int (g () % 100) < ripplepercent)
+                {
+                    int const paths = 1 + g () % maxpaths;
+                    for (int p = 0; p < paths; ++p)
+                    {
+                        std::vector <uint256> step;
+                        int const nodes = 4 + g () % 3;
+                        for (int i = 0; i < nodes; ++i)
+                            step.push_back (pick ());
+                        t.steps.push_back (std::move (step));
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+    typedef std::map <uint256, ledgerentrysetentry> stdentrymap;
+    typedef sortedflatmap <uint256, ledgerentrysetentry> flatentrymap;
+
+    static ledgerentrysetentry&
+    modify (stdentrymap&, stdentrymap::iterator it)
+    {
+        return it->second;
+    }
+
+    static ledgerentrysetentry&
+    modify (flatentrymap& entries, flatentrymap::const_iterator it)
+    {
+        return entries.modify (it);
+    }
+
+    // what the replay uses of a ledgerentryset, the same way, over an entry
+    // map of choice
+    template <class entrymap>
+    class entryset
+    {
+    public:
+        typedef typename entrymap::const_iterator const_iterator;
+
+        void
+        init (ledger::ref ledger, uint256 const&, std::uint32_t,
+            transactionengineparams)
+        {
+            entries_.clear ();
+            ledger_ = ledger;
+            seq_ = 0;
+        }
+
+        entryset
+        duplicate () const
+        {
+            entryset result;
+            result.ledger_ = ledger_;
+            result.entries_ = entries_;
+            result.seq_ = seq_ + 1;
+            return result;
+        }
+
+        void
+        swapwith (entryset& other)
+        {
+            std::swap (ledger_, other.ledger_);
+            entries_.swap (other.entries_);
+            std::swap (seq_, other.seq_);
+        }
+
+        sle::pointer
+        entrycache (ledgerentrytype, uint256 const& index)
+        {
+            auto it = entries_.find (index);
+
+            if (it == entries_.end ())
+            {
+                sle::pointer entry = ledger_->getsle (index);
+                if (entry)
+                    entries_.emplace (index,
+                        ledgerentrysetentry (entry, taacached, seq_));
+                return entry;
+            }
+
+            if (it->second.maction == taadelete)
+                return sle::pointer ();
+
+            // copied the first time it is read at a new checkpoint
+            if (it->second.mseq != seq_)
+            {
+                ledgerentrysetentry& entry = modify (entries_, it);
+                entry.mentry = std::make_shared <sle> (*entry.mentry);
+                entry.mseq = seq_;
+                return entry.mentry;
+            }
+
+            return it->second.mentry;
+        }
+
+        void
+        entrymodify (sle::ref entry)
+        {
+            auto it = entries_.find (entry->getindex ());
+
+            if (it == entries_.end ())
+            {
+                entries_.emplace (entry->getindex (),
+                    ledgerentrysetentry (entry, taamodify, seq_));
+                return;
+            }
+
+            ledgerentrysetentry& e = modify (entries_, it);
+            if (e.maction == taacached)
+                e.maction = taamodify;
+            e.mseq = seq_;
+            e.mentry = entry;
+        }
+
+        sle::pointer
+        entrycreate (ledgerentrytype type, uint256 const& index)
+        {
+            sle::pointer entry = std::make_shared <sle> (type, index);
+            entries_.emplace (index,
+                ledgerentrysetentry (entry, taacreate, seq_));
+            return entry;
+        }
+
+        void
+        entrydelete (sle::ref entry)
+        {
+            auto it = entries_.find (entry->getindex ());
+
+            if (it->second.maction == taacreate)
+            {
+                entries_.erase (it);
+                return;
+            }
+
+            ledgerentrysetentry& e = modify (entries_, it);
+            e.maction = taadelete;
+            e.mseq = seq_;
+        }
+
+        uint256
+        getnextledgerindex (uint256 const& hash) const
+        {
+            uint256 ledgernext;
+            shamap const& statemap = *ledger_->peekaccountstatemap ();
+
+            for (auto item = statemap.upper_bound (hash);
+                 item != statemap.end (); ++item)
+            {
+                auto const it = entries_.find ((*item)->gettag ());
+                if ((it == entries_.end ()) ||
+                        (it->second.maction != taadelete))
+                {
+                    ledgernext = (*item)->gettag ();
+                    break;
+                }
+            }
+
+            for (auto it = entries_.upper_bound (hash);
+                 it != entries_.end (); ++it)
+            {
+                if (it->second.maction != taadelete)
+                    return (ledgernext.isnonzero () &&
+                        (ledgernext < it->first)) ? ledgernext : it->first;
+            }
+
+            return ledgernext;
+        }
+
+        const_iterator
+        begin () const
+        {
+            return entries_.begin ();
+        }
+
+        const_iterator
+        end () const
+        {
+            return entries_.end ();
+        }
+
+    private:
+        ledger::pointer ledger_;
+        entrymap entries_;
+        int seq_ = 0;
+    };
+
+    // reads an entry into the set, copying it the first time it is read at
+    // a new checkpoint, and marks it modified
+    template <class set>
+    static void
+    touch (set& les, uint256 const& index)
+    {
+        sle::pointer entry = les.entrycache (ltdir_node, index);
+        if (entry)
+            les.entrymodify (entry);
+    }
+
+    // returns false if a walk of a set was out of order
+    template <class set>
+    bool
+    replay (ledger::ref ledger, std::vector <txn> const& txns,
+        std::size_t& checksum)
+    {
+        bool ordered = true;
+        set les;
+        uint256 txid;
+
+        for (auto const& t : txns)
+        {
+            ++txid;
+            les.init (ledger, txid, ledger->getledgerseq (), tapnone);
+
+            for (auto const& key : t.base)
+                touch (les, key);
+
+            for (std::size_t s = 0; s < t.steps.size (); ++s)
+            {
+                set checkpoint = les.duplicate ();
+
+                for (auto const& key : t.steps[s])
+                    touch (checkpoint, key);
+
+                // look past the book page for the next one
+                checksum += checkpoint.getnextledgerindex (
+                    t.steps[s].front ()).begin ()[0];
+
+                // offers keep every crossing, payments their last path
+                if (t.offer || s + 1 == t.steps.size ())
+                    les.swapwith (checkpoint);
+            }
+
+            if (t.offer)
+            {
+                sle::pointer offer = les.entrycreate (ltoffer, t.created);
+                if (t.unfunded)
+                    les.entrydelete (offer);
+            }
+
+            set const& view = les;
+            uint256 const* previous = nullptr;
+            for (auto const& e : view)
+            {
+                if (previous && !(*previous < e.first))
+                    ordered = false;
+                previous = &e.first;
+                checksum = checksum * 31 + e.first.begin ()[0] +
+                    e.second.maction;
+            }
+        }
+
+        return ordered;
+    }
+
+    // replays the transactions through a set, returning the checksum
+    template <class set>
+    std::size_t
+    timereplay (std::string const& name, ledger::ref ledger,
+        std::vector <txn> const& txns)
+    {
+        testcase (name);
+
+        std::size_t checksum = 0;
+        auto const start = clock_type::now ();
+        bool const ordered = replay <set> (ledger, txns, checksum);
+        double const elapsed = seconds (clock_type::now () - start);
+
+        expect (ordered, "entries out of order");
+
+        log << name << ": " << txns.size () << " transactions in " <<
+            std::setprecision (3) << elapsed << "s, " <<
+                static_cast <std::size_t> (txns.size () / elapsed) <<
+                    " transactions/s, checksum " << checksum;
+
+        return checksum;
+    }
+
+    void
+    run ()
+    {
+
+        rippleaddress const master = rippleaddress::createaccountpublic (
+            rippleaddress::creategeneratorpublic (
+                rippleaddress::createseedgeneric ("masterpassphrase")), 0);
+        ledger::pointer ledger = std::make_shared <ripple::ledger> (
+            master, 100000000000000ull);
+
+        beast::xor_shift_engine g (2);
+        std::vector <uint256> keys (keypool);
+        for (auto& key : keys)
+        {
+            beast::rngfill (key.begin (), key.size (), g);
+            expect (ledger->addsle (sle (ltdir_node, key)), "bad entry");
+        }
+
+        std::vector <txn> const txns (maketxns (keys));
+
+        std::size_t const baseline = timereplay <entryset <stdentrymap>> (
+            "std::map", ledger, txns);
+        std::size_t const flat = timereplay <entryset <flatentrymap>> (
+            "sortedflatmap", ledger, txns);
+        std::size_t const les = timereplay <ledgerentryset> (
+            "ledgerentryset", ledger, txns);
+
+        expect (flat == baseline, "sortedflatmap walks differ from std::map");
+        expect (les == baseline, "ledgerentryset walks differ from std::map");
+    }
+};
+
+beast_define_testsuite_manual(ledgerentryset_timing,app,ripple);
+
+} // ripple
@@ -0,0 +1,157 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#ifndef rippled_ripple_app_ledger_ledgertestsuite_h
+#define rippled_ripple_app_ledger_ledgertestsuite_h
+
+#include <ripple/app/consensus/ledgerconsensus.h>
+#include <ripple/app/ledger/ledger.h>
+#include <ripple/app/misc/canonicaltxset.h>
+#include <ripple/protocol/rippleaddress.h>
+#include <ripple/protocol/stparsedjson.h>
+#include <ripple/protocol/txflags.h>
+#include <beast/unit_test/suite.h>
+#include <vector>
+
+namespace ripple {
+
+// a suite that signs transactions for accounts from the master passphrase's
+// generator and closes ledgers holding them, for tests that compare the
+// ledgers two ways of applying the same transactions build.
+class ledgertestsuite : public beast::unit_test::suite
+{
+public:
+    struct testaccount
+    {
+        rippleaddress publickey;
+        rippleaddress privatekey;
+        std::uint32_t sequence = 0;
+    };
+
+    static std::uint64_t const xrp = 1000000;
+
+    testaccount
+    createaccount ()
+    {
+        static rippleaddress const seed
+                = rippleaddress::createseedgeneric ("masterpassphrase");
+        static rippleaddress const generator
+                = rippleaddress::creategeneratorpublic (seed);
+
+        testaccount account;
+        account.publickey = rippleaddress::createaccountpublic (
+            generator, nextaccount_);
+        account.privatekey = rippleaddress::createaccountprivate (
+            generator, seed, nextaccount_);
+        ++nextaccount_;
+        return account;
+    }
+
+    sttx::pointer
+    signtransaction (testaccount& account, json::value tx_json)
+    {
+        tx_json["account"] = account.publickey.humanaccountid ();
+        tx_json["fee"] = std::to_string (10);
+        tx_json["sequence"] = ++account.sequence;
+        tx_json["flags"] = tfuniversal;
+
+        stparsedjsonobject parsed ("tx_json", tx_json);
+        expect (parsed.object != nullptr);
+        parsed.object->setfieldvl (sfsigningpubkey,
+            account.publickey.getaccountpublic ());
+
+        auto txn = std::make_shared<sttx> (*parsed.object);
+        txn->sign (account.privatekey);
+        return txn;
+    }
+
+    sttx::pointer
+    payment (testaccount& from, testaccount const& to, std::uint64_t drops)
+    {
+        json::value tx_json;
+        tx_json["transactiontype"] = "payment";
+        tx_json["destination"] = to.publickey.humanaccountid ();
+        tx_json["amount"] = std::to_string (drops);
+        return signtransaction (from, tx_json);
+    }
+
+    // a closed ledger holding only the master account
+    static ledger::pointer
+    genesis (testaccount const& master)
+    {
+        ledger::pointer lcl = std::make_shared<ledger> (master.publickey,
+            100000000 * xrp, 100000000 * xrp);
+        lcl->updatehash ();
+        lcl->setclosed ();
+        return lcl;
+    }
+
+    // a set holding the transactions, in the order of their ids
+    shamap::pointer
+    makeset (ledger::ref lcl, std::vector<sttx::pointer> const& txns)
+    {
+        ledger::pointer scratch = std::make_shared<ledger> (false, *lcl);
+
+        for (auto const& txn : txns)
+        {
+            serializer s;
+            txn->add (s);
+            expect (scratch->addtransaction (txn->gettransactionid (), s),
+                "duplicate transaction");
+        }
+
+        return scratch->peektransactionmap ();
+    }
+
+    // the closed ledger after lcl holding the set, applied the way
+    // applytransactions is told to
+    static ledger::pointer
+    close (ledger::ref lcl, shamap::ref set, bool speculate = true,
+        bool batchdividends = true)
+    {
+        canonicaltxset retriabletransactions (set->gethash ());
+        ledger::pointer newlcl = std::make_shared<ledger> (false, *lcl);
+        applytransactions (set, newlcl, newlcl, retriabletransactions,
+            false, speculate, batchdividends);
+        newlcl->updateskiplist ();
+        newlcl->setclosed ();
+        return newlcl;
+    }
+
+    void
+    checksame (ledger::ref expected, ledger::ref actual)
+    {
+        expect (expected->peekaccountstatemap ()->gethash () ==
+            actual->peekaccountstatemap ()->gethash (), "state differs");
+        expect (expected->peektransactionmap ()->gethash () ==
+            actual->peektransactionmap ()->gethash (), "transactions differ");
+        expect (expected->gettotalcoins () == actual->gettotalcoins (),
+            "coins differ");
+        expect (expected->gettotalcoinsvbc () == actual->gettotalcoinsvbc (),
+            "vbc coins differ");
+    }
+
+private:
+    int nextaccount_ = 0;
+};
+
+} // ripple
+
+#endif
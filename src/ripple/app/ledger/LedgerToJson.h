@@ -120,13 +120,13 @@ void filljson (object& json, ledgerfill const& fill)
     if (transactionmap && (bfull || fill.options & ledger_json_dump_txrp))
     {
         auto&& txns = rpc::addarray (json, jss::transactions);
-        shamaptreenode::tntype type;
-
         rpc::countedyield count (
             fill.yieldstrategy.transactionyieldcount, fill.yield);
-        for (auto item = transactionmap->peekfirstitem (type); item;
-             item = transactionmap->peeknextitem (item->gettag (), type))
+        for (auto it = transactionmap->begin ();
+             it != transactionmap->end (); ++it)
         {
+            shamapitem::ref item = *it;
+            shamaptreenode::tntype const type = it.gettype ();
             count.yield();
             if (bfull || bexpand)
             {
@@ -178,7 +178,7 @@ void filljson (object& json, ledgerfill const& fill)
                 {
                     count.yield();
                     array.append (sle->getjson(0));
-                });
+                }, shamap::walk_prefetch);
         }
         else
         {
@@ -187,7 +187,7 @@ void filljson (object& json, ledgerfill const& fill)
                 {
                     count.yield();
                     array.append (to_string(smi->gettag ()));
-                });
+                }, shamap::walk_prefetch);
         }
     }
 }
@@ -0,0 +1,391 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#include <beastconfig.h>
+#include <ripple/app/ledger/txnwriter.h>
+#include <ripple/app/data/sqlitedatabase.h>
+#include <ripple/basics/log.h>
+#include <ripple/basics/stringutilities.h>
+#include <ripple/protocol/sttx.h>
+#include <ripple/protocol/txformats.h>
+#include <cassert>
+#include <exception>
+#include <map>
+#include <stdexcept>
+
+namespace ripple {
+
+namespace {
+
+// statements that each carry up to a number of rows
+class multirowstatement
+{
+public:
+    multirowstatement (database& db, std::string const& head,
+            std::string const& tail, std::size_t maxrows)
+        : db_ (db)
+        , head_ (head)
+        , tail_ (tail)
+        , maxrows_ (maxrows)
+    {
+    }
+
+    ~multirowstatement ()
+    {
+        // rows are left over only when the commit is failing
+        assert (rows_ == 0 || std::uncaught_exception ());
+    }
+
+    void add (std::string const& row)
+    {
+        if (rows_ == 0)
+            sql_ = head_;
+        else
+            sql_ += ", ";
+
+        sql_ += row;
+
+        if (++rows_ == maxrows_)
+            flush ();
+    }
+
+    void flush ()
+    {
+        if (rows_ == 0)
+            return;
+
+        sql_ += tail_;
+        rows_ = 0;
+        if (!db_.executesql (sql_))
+            throw std::runtime_error ("txnwriter: statement failed");
+    }
+
+private:
+    database& db_;
+    std::string const head_;
+    std::string const tail_;
+    std::size_t const maxrows_;
+    std::string sql_;
+    std::size_t rows_ = 0;
+};
+
+std::string sqlquote (std::string const& s)
+{
+    return "'" + s + "'";
+}
+
+} // namespace
+
+txnwriter::ledgerrows
+txnwriter::stage (acceptedledger const& ledger)
+{
+    ledgerrows rows;
+    rows.ledgerseq = ledger.getledgerseq ();
+    rows.closetime = ledger.getledger ()->getclosetimenc ();
+    rows.txns.reserve (ledger.getmap ().size ());
+
+    for (auto const& vt : ledger.getmap ())
+    {
+        auto const& txn = vt.second->gettxn ();
+        auto const format = txformats::getinstance ().findbytype (
+            txn->gettxntype ());
+        assert (format != nullptr);
+
+        txnrow row;
+        row.transid = to_string (vt.second->gettransactionid ());
+        row.transtype = format->getname ();
+        row.fromacct = txn->getsourceaccount ().humanaccountid ();
+        row.fromseq = txn->getsequence ();
+        row.txnseq = vt.second->gettxnseq ();
+
+        serializer s;
+        txn->add (s);
+        row.rawtxn = std::move (s.moddata ());
+        row.txnmeta = vt.second->getrawmeta ();
+
+        auto const& accts = vt.second->getaffected ();
+        row.accounts.reserve (accts.size ());
+        for (auto const& acct : accts)
+            row.accounts.push_back (acct.humanaccountid ());
+
+        if (row.accounts.empty ())
+            writelog (lswarning, ledger)
+                << "transaction in ledger " << rows.ledgerseq
+                << " affects no accounts";
+
+        rows.txns.push_back (std::move (row));
+    }
+
+    return rows;
+}
+
+void
+txnwriter::write (databasecon& con, ledgerrows rows)
+{
+    std::unique_lock <std::mutex> lock (mutex_);
+    staged_.push_back (std::move (rows));
+    std::uint64_t const ticket = ++stagedcount_;
+
+    while (committedcount_ < ticket)
+    {
+        if (writing_)
+        {
+            cond_.wait (lock);
+            continue;
+        }
+
+        // commit everything staged so far, ours included
+        std::vector <ledgerrows> ledgers;
+        ledgers.swap (staged_);
+        std::uint64_t const first = committedcount_ + 1;
+        std::uint64_t const last = stagedcount_;
+        writing_ = true;
+        lock.unlock ();
+
+        std::exception_ptr error;
+        try
+        {
+            commit (con, ledgers);
+        }
+        catch (...)
+        {
+            error = std::current_exception ();
+        }
+
+        lock.lock ();
+        if (error)
+            failures_.emplace (last, failure {first,
+                static_cast <std::size_t> (last - first + 1), error});
+        writing_ = false;
+        committedcount_ = last;
+        cond_.notify_all ();
+    }
+
+    // the commit that held our rows may have failed
+    auto const found = failures_.lower_bound (ticket);
+    if ((found != failures_.end ()) && (found->second.first <= ticket))
+    {
+        std::exception_ptr const error = found->second.error;
+        if (--found->second.waiters == 0)
+            failures_.erase (found);
+        std::rethrow_exception (error);
+    }
+}
+
+void
+txnwriter::commit (databasecon& con, std::vector <ledgerrows>& ledgers)
+{
+    // a ledger staged twice is written as it was staged last
+    std::vector <ledgerrows> batch;
+    std::map <std::uint32_t, std::size_t> index;
+    batch.reserve (ledgers.size ());
+
+    for (auto& rows : ledgers)
+    {
+        auto const found = index.find (rows.ledgerseq);
+        if (found != index.end ())
+        {
+            batch[found->second] = std::move (rows);
+        }
+        else
+        {
+            index.emplace (rows.ledgerseq, batch.size ());
+            batch.push_back (std::move (rows));
+        }
+    }
+
+    auto db = con.getdb ();
+    auto sl (con.lock ());
+
+    // no batchstart here: in a mysql batch each statement is only queued
+    // and reports success, and the batch may run later on another thread
+    // with its errors ignored
+    if (!db->begintransaction ())
+        throw std::runtime_error ("txnwriter: cannot begin a transaction");
+
+    try
+    {
+#ifndef no_sqlite3_prepare
+        if (db->getsqlitedb ())
+            commitsqlite (*db, batch);
+        else
+#endif
+            commitsql (*db, batch);
+
+        if (!db->endtransaction ())
+            throw std::runtime_error ("txnwriter: commit failed");
+    }
+    catch (...)
+    {
+        writelog (lswarning, ledger) << "txnwriter: rolling back "
+            << batch.size () << " ledgers";
+        db->executesql ("rollback;", true);
+        throw;
+    }
+
+    writelog (lsdebug, ledger) << "txnwriter: committed "
+        << batch.size () << " ledgers";
+}
+
+#ifndef no_sqlite3_prepare
+
+static void stepstatement (sqlitestatement& statement)
+{
+    int const result = statement.step ();
+    statement.reset ();
+
+    if (!statement.isdone (result))
+        throw std::runtime_error ("txnwriter: statement failed with " +
+            std::to_string (result));
+}
+
+void
+txnwriter::commitsqlite (database& db, std::vector <ledgerrows> const& ledgers)
+{
+    sqlitedatabase* sqlite = db.getsqlitedb ();
+
+    sqlitestatement deletetxns (sqlite,
+        "delete from transactions where ledgerseq = ?;");
+    sqlitestatement deleteledgeraccts (sqlite,
+        "delete from accounttransactions where ledgerseq = ?;");
+    sqlitestatement deletetxnaccts (sqlite,
+        "delete from accounttransactions where transid = ?;");
+    sqlitestatement insertacct (sqlite,
+        "insert into accounttransactions "
+        "(transid, account, ledgerseq, txnseq) values (?, ?, ?, ?);");
+    sqlitestatement inserttxn (sqlite,
+        "insert or replace into transactions "
+        "(transid, transtype, fromacct, fromseq, ledgerseq, status, "
+        "closetime, rawtxn, txnmeta) values (?, ?, ?, ?, ?, ?, ?, ?, ?);");
+
+    std::string const status (1, txn_sql_validated);
+
+    for (auto const& rows : ledgers)
+    {
+        deletetxns.bind (1, rows.ledgerseq);
+        stepstatement (deletetxns);
+        deleteledgeraccts.bind (1, rows.ledgerseq);
+        stepstatement (deleteledgeraccts);
+
+        for (auto const& txn : rows.txns)
+        {
+            deletetxnaccts.bindstatic (1, txn.transid);
+            stepstatement (deletetxnaccts);
+
+            for (auto const& account : txn.accounts)
+            {
+                insertacct.bindstatic (1, txn.transid);
+                insertacct.bindstatic (2, account);
+                insertacct.bind (3, rows.ledgerseq);
+                insertacct.bind (4, txn.txnseq);
+                stepstatement (insertacct);
+            }
+
+            inserttxn.bindstatic (1, txn.transid);
+            inserttxn.bindstatic (2, txn.transtype);
+            inserttxn.bindstatic (3, txn.fromacct);
+            inserttxn.bind (4, txn.fromseq);
+            inserttxn.bind (5, rows.ledgerseq);
+            inserttxn.bindstatic (6, status);
+            inserttxn.bind (7, rows.closetime);
+            inserttxn.bind (8, txn.rawtxn.data (),
+                static_cast<int> (txn.rawtxn.size ()));
+            inserttxn.bind (9, txn.txnmeta.data (),
+                static_cast<int> (txn.txnmeta.size ()));
+            stepstatement (inserttxn);
+        }
+    }
+}
+
+#endif
+
+void
+txnwriter::commitsql (database& db, std::vector <ledgerrows> const& ledgers)
+{
+    std::size_t const keysperstatement = 1024;
+    std::size_t const accountsperstatement = 512;
+    std::size_t const txnsperstatement = 64;
+
+    // remove what earlier saves of these ledgers and their transactions
+    // wrote, before anything is inserted
+    {
+        multirowstatement deletetxns (db,
+            "delete from transactions where ledgerseq in (", ");",
+                keysperstatement);
+        multirowstatement deleteledgeraccts (db,
+            "delete from accounttransactions where ledgerseq in (", ");",
+                keysperstatement);
+        multirowstatement deletetxnaccts (db,
+            "delete from accounttransactions where transid in (", ");",
+                keysperstatement);
+
+        for (auto const& rows : ledgers)
+        {
+            std::string const ledgerseq (std::to_string (rows.ledgerseq));
+            deletetxns.add (ledgerseq);
+            deleteledgeraccts.add (ledgerseq);
+
+            for (auto const& txn : rows.txns)
+                deletetxnaccts.add (sqlquote (txn.transid));
+        }
+
+        deletetxns.flush ();
+        deleteledgeraccts.flush ();
+        deletetxnaccts.flush ();
+    }
+
+    multirowstatement insertaccts (db,
+        "insert into accounttransactions "
+        "(transid, account, ledgerseq, txnseq) values ", ";",
+            accountsperstatement);
+    multirowstatement inserttxns (db,
+        sttx::getmetasqlinsertreplaceheader (db.getdbtype ()), ";",
+            txnsperstatement);
+
+    std::string const status (sqlquote (std::string (1, txn_sql_validated)));
+
+    for (auto const& rows : ledgers)
+    {
+        std::string const ledgerseq (std::to_string (rows.ledgerseq));
+        std::string const closetime (std::to_string (rows.closetime));
+
+        for (auto const& txn : rows.txns)
+        {
+            std::string const transid (sqlquote (txn.transid));
+            std::string const txnseq (std::to_string (txn.txnseq));
+
+            for (auto const& account : txn.accounts)
+            {
+                insertaccts.add ("(" + transid + "," + sqlquote (account) +
+                    "," + ledgerseq + "," + txnseq + ")");
+            }
+
+            inserttxns.add ("(" + transid + ", " + sqlquote (txn.transtype) +
+                ", " + sqlquote (txn.fromacct) + ", '" +
+                std::to_string (txn.fromseq) + "', '" + ledgerseq + "', " +
+                status + ", '" + closetime + "', " + sqlescape (txn.rawtxn) +
+                ", " + sqlescape (txn.txnmeta) + ")");
+        }
+    }
+
+    insertaccts.flush ();
+    inserttxns.flush ();
+}
+
+} // ripple
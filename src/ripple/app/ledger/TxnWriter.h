@@ -0,0 +1,105 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#ifndef ripple_txnwriter_h_included
+#define ripple_txnwriter_h_included
+
+#include <ripple/app/data/databasecon.h>
+#include <ripple/app/ledger/acceptedledger.h>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ripple {
+
+/** writes the transactions of validated ledgers to the transaction database.
+
+    the rows of a ledger are staged before the database is locked. a
+    ledger written while another write is in progress waits for it and is
+    then committed in one database transaction with every other ledger
+    staged in the meantime, so a busy stretch of ledgers costs a few
+    commits instead of one per ledger.
+
+    sqlite is written with prepared statements, other databases with
+    statements that insert many rows at once. every statement runs on the
+    calling thread and is checked, mysql's batch mode is not used.
+*/
+class txnwriter
+{
+public:
+    /** a row of the transactions table, with the accounts it affects. */
+    struct txnrow
+    {
+        std::string transid;
+        std::string transtype;
+        std::string fromacct;
+        std::uint32_t fromseq;
+        std::uint32_t txnseq;
+        blob rawtxn;
+        blob txnmeta;
+        std::vector <std::string> accounts;
+    };
+
+    /** the rows a validated ledger adds. */
+    struct ledgerrows
+    {
+        std::uint32_t ledgerseq = 0;
+        std::uint32_t closetime = 0;
+        std::vector <txnrow> txns;
+    };
+
+    /** stage the rows of an accepted ledger. */
+    static ledgerrows stage (acceptedledger const& ledger);
+
+    /** write the rows of a ledger.
+        returns once they are committed, possibly by another thread. if
+        the commit fails it is rolled back and every write whose rows it
+        held throws the error.
+    */
+    void write (databasecon& con, ledgerrows rows);
+
+private:
+    void commit (databasecon& con, std::vector <ledgerrows>& ledgers);
+    void commitsqlite (database& db, std::vector <ledgerrows> const& ledgers);
+    void commitsql (database& db, std::vector <ledgerrows> const& ledgers);
+
+    // a commit that failed, until each of its writes has seen it
+    struct failure
+    {
+        std::uint64_t first;        // the first ledger of the commit
+        std::size_t waiters;        // writes yet to see the error
+        std::exception_ptr error;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::vector <ledgerrows> staged_;
+    std::uint64_t stagedcount_ = 0;     // ledgers ever staged
+    std::uint64_t committedcount_ = 0;  // ledgers ever committed or failed
+    std::map <std::uint64_t, failure> failures_;  // by last ledger
+    bool writing_ = false;
+};
+
+} // ripple
+
+#endif
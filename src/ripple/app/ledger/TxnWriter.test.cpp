@@ -0,0 +1,421 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#include <beastconfig.h>
+#include <ripple/app/ledger/txnwriter.h>
+#include <ripple/app/data/dbinit.h>
+#include <ripple/basics/stringutilities.h>
+#include <ripple/protocol/sttx.h>
+#include <beast/random/rngfill.h>
+#include <beast/random/xor_shift_engine.h>
+#include <beast/unit_test/suite.h>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+namespace ripple {
+
+// replays synthetic ledgers shaped like busy validated ledgers into a
+// transaction database, one statement per row as ledgers used to be
+// saved, through the writer one ledger at a time, and through the writer
+// from several threads so commits are shared.
+class txnwriter_timing_test : public beast::unit_test::suite
+{
+public:
+    typedef std::chrono::high_resolution_clock clock_type;
+
+    enum
+    {
+        ledgers = 200,
+        txnsperledger = 200,
+        accountspertxn = 3,
+        accountpool = 5000,
+        rawtxnsize = 180,
+        metasize = 600,
+        threads = 4
+    };
+
+    template <class duration>
+    static double
+    seconds (duration const& d)
+    {
+        return std::chrono::duration_cast <
+            std::chrono::duration <double>> (d).count ();
+    }
+
+    static std::vector <txnwriter::ledgerrows>
+    makeledgers ()
+    {
+        beast::xor_shift_engine g (1);
+        std::vector <std::string> accounts;
+        for (int i = 0; i < accountpool; ++i)
+        {
+            uint160 id;
+            beast::rngfill (id.begin (), id.size (), g);
+            accounts.push_back (to_string (id));
+        }
+
+        std::vector <txnwriter::ledgerrows> result (ledgers);
+        for (int l = 0; l < ledgers; ++l)
+        {
+            auto& rows = result[l];
+            rows.ledgerseq = 1000 + l;
+            rows.closetime = 10 * l;
+            rows.txns.resize (txnsperledger);
+
+            for (int t = 0; t < txnsperledger; ++t)
+            {
+                auto& txn = rows.txns[t];
+                uint256 id;
+                beast::rngfill (id.begin (), id.size (), g);
+                txn.transid = to_string (id);
+                txn.transtype = "payment";
+                txn.fromacct = accounts[g () % accountpool];
+                txn.fromseq = t;
+                txn.txnseq = t;
+                txn.rawtxn.resize (rawtxnsize);
+                beast::rngfill (txn.rawtxn.data (), txn.rawtxn.size (), g);
+                txn.txnmeta.resize (metasize);
+                beast::rngfill (txn.txnmeta.data (), txn.txnmeta.size (), g);
+                txn.accounts.push_back (txn.fromacct);
+                for (int a = 1; a < accountspertxn; ++a)
+                    txn.accounts.push_back (accounts[g () % accountpool]);
+            }
+        }
+
+        return result;
+    }
+
+    // how ledgers were saved before the writer
+    static void
+    writestatements (databasecon& con, txnwriter::ledgerrows const& rows)
+    {
+        auto db = con.getdb ();
+        auto sl (con.lock ());
+        std::string const ledgerseq (std::to_string (rows.ledgerseq));
+
+        db->batchstart ();
+        db->begintransaction ();
+        db->executesql ("delete from transactions where ledgerseq = " +
+            ledgerseq + ";");
+        db->executesql ("delete from accounttransactions where ledgerseq = " +
+            ledgerseq + ";");
+
+        for (auto const& txn : rows.txns)
+        {
+            std::string const txnseq (std::to_string (txn.txnseq));
+            db->executesql ("delete from accounttransactions where transid = '" +
+                txn.transid + "';");
+
+            std::string sql ("insert into accounttransactions "
+                "(transid, account, ledgerseq, txnseq) values ");
+            bool first = true;
+            for (auto const& account : txn.accounts)
+            {
+                sql += first ? "('" : ", ('";
+                first = false;
+                sql += txn.transid + "','" + account + "'," + ledgerseq +
+                    "," + txnseq + ")";
+            }
+            db->executesql (sql + ";");
+
+            db->executesql (
+                sttx::getmetasqlinsertreplaceheader (db->getdbtype ()) +
+                "('" + txn.transid + "', '" + txn.transtype + "', '" +
+                txn.fromacct + "', '" + std::to_string (txn.fromseq) +
+                "', '" + ledgerseq + "', 'v', '" +
+                std::to_string (rows.closetime) + "', " +
+                sqlescape (txn.rawtxn) + ", " + sqlescape (txn.txnmeta) + ");");
+        }
+
+        db->endtransaction ();
+        db->batchcommit ();
+    }
+
+    int
+    countrows (databasecon& con, std::string const& table)
+    {
+        auto db = con.getdb ();
+        auto sl (con.lock ());
+        int count = -1;
+
+        if (db->executesql ("select count(*) as n from " + table + ";") &&
+            db->startiterrows ())
+        {
+            count = db->getint ("n");
+            db->enditerrows ();
+        }
+
+        return count;
+    }
+
+    void
+    check (databasecon& con, std::string const& name, double elapsed)
+    {
+        log << name << ": " << ledgers << " ledgers in " <<
+            std::setprecision (3) << elapsed << "s, " <<
+                static_cast <std::size_t> (ledgers * txnsperledger / elapsed) <<
+                    " transactions/s";
+
+        expect (countrows (con, "transactions") ==
+            ledgers * txnsperledger, "wrong transaction count");
+        expect (countrows (con, "accounttransactions") ==
+            ledgers * txnsperledger * accountspertxn, "wrong account count");
+    }
+
+    void
+    run ()
+    {
+        databasecon::setup setup;
+        setup.standalone = true;
+        databasecon con (setup, "transaction.db", txndbinit, txndbcount);
+
+        std::vector <txnwriter::ledgerrows> const rows (makeledgers ());
+
+        testcase ("statements");
+        {
+            auto const start = clock_type::now ();
+            for (auto const& ledger : rows)
+                writestatements (con, ledger);
+            check (con, "statements", seconds (clock_type::now () - start));
+        }
+
+        testcase ("writer");
+        {
+            txnwriter writer;
+            auto const start = clock_type::now ();
+            for (auto const& ledger : rows)
+                writer.write (con, ledger);
+            check (con, "writer", seconds (clock_type::now () - start));
+        }
+
+        testcase ("group commit");
+        {
+            txnwriter writer;
+            std::vector <std::thread> workers;
+            auto const start = clock_type::now ();
+            for (int i = 0; i < threads; ++i)
+            {
+                workers.emplace_back ([&writer, &con, &rows, i] ()
+                {
+                    for (std::size_t l = i; l < rows.size (); l += threads)
+                        writer.write (con, rows[l]);
+                });
+            }
+            for (auto& worker : workers)
+                worker.join ();
+            check (con, "group commit", seconds (clock_type::now () - start));
+        }
+    }
+};
+
+beast_define_testsuite_manual(txnwriter_timing,app,ripple);
+
+//------------------------------------------------------------------------------
+
+class txnwriter_test : public beast::unit_test::suite
+{
+public:
+    // a ledger of txns transactions touching two accounts each, the
+    // transaction ids start with prefix
+    static txnwriter::ledgerrows
+    makeledger (std::uint32_t seq, int txns, std::string const& prefix)
+    {
+        txnwriter::ledgerrows rows;
+        rows.ledgerseq = seq;
+        rows.closetime = seq;
+        for (int t = 0; t < txns; ++t)
+        {
+            txnwriter::txnrow txn;
+            txn.transid = prefix + std::to_string (seq) + "-" + std::to_string (t);
+            txn.transtype = "payment";
+            txn.fromacct = "a" + std::to_string (t);
+            txn.fromseq = t;
+            txn.txnseq = t;
+            txn.rawtxn.assign (16, static_cast <unsigned char> (t));
+            txn.txnmeta.assign (32, static_cast <unsigned char> (t));
+            txn.accounts.push_back (txn.fromacct);
+            txn.accounts.push_back ("b" + std::to_string (t));
+            rows.txns.push_back (std::move (txn));
+        }
+        return rows;
+    }
+
+    int
+    countrows (databasecon& con, std::string const& sql)
+    {
+        auto db = con.getdb ();
+        auto sl (con.lock ());
+        int count = -1;
+
+        if (db->executesql ("select count(*) as n " + sql + ";") &&
+            db->startiterrows ())
+        {
+            count = db->getint ("n");
+            db->enditerrows ();
+        }
+
+        return count;
+    }
+
+    void
+    testwrite (databasecon& con)
+    {
+        testcase ("write");
+
+        txnwriter writer;
+        writer.write (con, makeledger (1, 10, "x"));
+        writer.write (con, makeledger (2, 5, "x"));
+        expect (countrows (con, "from transactions") == 15,
+            "wrong transaction count");
+        expect (countrows (con, "from accounttransactions") == 30,
+            "wrong account count");
+
+        // saving a ledger again replaces what it wrote
+        writer.write (con, makeledger (1, 3, "y"));
+        expect (countrows (con, "from transactions where ledgerseq = 1") == 3,
+            "ledger not replaced");
+        expect (countrows (con,
+            "from accounttransactions where ledgerseq = 1") == 6,
+                "ledger accounts not replaced");
+        expect (countrows (con, "from transactions where transid = 'y1-2'") == 1,
+            "replaced transaction missing");
+    }
+
+    void
+    testgroupcommit (databasecon& con)
+    {
+        testcase ("group commit");
+
+        txnwriter writer;
+        std::vector <std::thread> workers;
+        for (int i = 0; i < 4; ++i)
+        {
+            workers.emplace_back ([&writer, &con, i] ()
+            {
+                for (std::uint32_t l = 10 + i; l < 50; l += 4)
+                    writer.write (con, makeledger (l, 4, "g"));
+            });
+        }
+        for (auto& worker : workers)
+            worker.join ();
+
+        expect (countrows (con, "from transactions where ledgerseq >= 10") ==
+            40 * 4, "wrong transaction count");
+    }
+
+    void
+    testfailure (databasecon& con)
+    {
+        testcase ("failure");
+
+        {
+            auto sl (con.lock ());
+            con.getdb ()->executesql ("create trigger failtxn before insert "
+                "on transactions when new.transid like 'bad%' "
+                "begin select raise(abort, 'bad transaction'); end;");
+        }
+
+        int const before = countrows (con, "from transactions");
+
+        txnwriter writer;
+        bool threw = false;
+        try
+        {
+            // the bad row comes after rows that were written, so the
+            // whole commit has to be rolled back
+            auto rows = makeledger (100, 5, "f");
+            rows.txns.push_back (makeledger (100, 1, "bad").txns.front ());
+            writer.write (con, std::move (rows));
+        }
+        catch (std::exception const&)
+        {
+            threw = true;
+        }
+        expect (threw, "failed commit not reported");
+        expect (countrows (con, "from transactions") == before,
+            "failed commit not rolled back");
+        expect (countrows (con,
+            "from accounttransactions where ledgerseq = 100") == 0,
+                "failed commit left accounts");
+
+        // every write of a failed commit sees the error. the first write
+        // commits alone and waits for the database, the next two are
+        // staged meanwhile and committed together.
+        std::atomic <int> failed (0);
+        std::vector <std::thread> workers;
+        {
+            auto sl (con.lock ());
+            workers.emplace_back ([&] ()
+            {
+                writer.write (con, makeledger (101, 2, "f"));
+            });
+            std::this_thread::sleep_for (std::chrono::milliseconds (100));
+            for (std::uint32_t l = 102; l < 104; ++l)
+            {
+                workers.emplace_back ([&, l] ()
+                {
+                    auto rows = makeledger (l, 2, "f");
+                    if (l == 103)
+                        rows.txns.push_back (makeledger (l, 1, "bad").txns.front ());
+                    try
+                    {
+                        writer.write (con, std::move (rows));
+                    }
+                    catch (std::exception const&)
+                    {
+                        ++failed;
+                    }
+                });
+            }
+            std::this_thread::sleep_for (std::chrono::milliseconds (100));
+        }
+        for (auto& worker : workers)
+            worker.join ();
+
+        expect (failed == 2, "not every write of the commit failed");
+        expect (countrows (con, "from transactions where ledgerseq = 101") == 2,
+            "earlier commit lost");
+        expect (countrows (con,
+            "from transactions where ledgerseq > 101 and ledgerseq < 104") == 0,
+                "failed commit not rolled back");
+
+        // the writer and the database are usable afterwards
+        writer.write (con, makeledger (104, 3, "f"));
+        expect (countrows (con, "from transactions where ledgerseq = 104") == 3,
+            "write after a failure lost");
+    }
+
+    void
+    run ()
+    {
+        databasecon::setup setup;
+        setup.standalone = true;
+        databasecon con (setup, "transaction.db", txndbinit, txndbcount);
+
+        testwrite (con);
+        testgroupcommit (con);
+        testfailure (con);
+    }
+};
+
+beast_define_testsuite(txnwriter,app,ripple);
+
+} // ripple
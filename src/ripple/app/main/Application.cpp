@@ -39,6 +39,7 @@
 #include <ripple/app/misc/ihashrouter.h>
 #include <ripple/app/misc/networkops.h>
 #include <ripple/app/misc/shamapstore.h>
+#include <ripple/app/misc/sigverifier.h>
 #include <ripple/app/misc/validations.h>
 #include <ripple/app/paths/findpaths.h>
 #include <ripple/app/paths/pathrequests.h>
@@ -211,6 +212,7 @@ public:
     std::unique_ptr <amendmenttable> m_amendmenttable;
     std::unique_ptr <loadfeetrack> mfeetrack;
     std::unique_ptr <ihashrouter> mhashrouter;
+    std::unique_ptr <sigverifier> m_sigverifier;
     std::unique_ptr <validations> mvalidations;
     std::unique_ptr <loadmanager> m_loadmanager;
     beast::deadlinetimer m_sweeptimer;
@@ -307,6 +309,7 @@ public:
         , m_networkops (make_networkops (get_seconds_clock (),
             getconfig ().run_standalone, getconfig ().network_quorum,
             *m_jobqueue, *m_ledgermaster, *m_jobqueue,
+            m_collectormanager->group ("subscriptions"),
             m_logs.journal("networkops")))
 
         // vfalco note localcredentials starts the deprecated unl service
@@ -328,6 +331,8 @@ public:
 
         , mhashrouter (ihashrouter::new (ihashrouter::getdefaultholdtime ()))
 
+        , m_sigverifier (std::make_unique <sigverifier> (*m_jobqueue, *mhashrouter))
+
         , mvalidations (make_validations ())
 
         , m_loadmanager (make_loadmanager (*this, m_logs.journal("loadmanager")))
@@ -490,6 +495,11 @@ public:
         return *mhashrouter;
     }
 
+    sigverifier& getsigverifier () override
+    {
+        return *m_sigverifier;
+    }
+
     validations& getvalidations ()
     {
         return *mvalidations;
@@ -559,8 +569,14 @@ public:
         mrpcdb = std::make_unique <databasecon> (setup, "rpc.db", rpcdbinit,
                 rpcdbcount);
         if (getconfig().transactiondatabase[beast::string("type")] == beast::string::empty)
-            mtxndb = std::make_unique <databasecon> (setup, "transaction.db",
+        {
+            databasecon::setup txnsetup (setup);
+            txnsetup.readers = 4;
+            if (getconfig().transactiondatabase[beast::string("readers")] != beast::string::empty)
+                txnsetup.readers = getconfig().transactiondatabase[beast::string("readers")].getintvalue();
+            mtxndb = std::make_unique <databasecon> (txnsetup, "transaction.db",
                 txndbinit, txndbcount);
+        }
         else if (getconfig().transactiondatabase[beast::string("type")] == beast::string("mysql"))
         {
 #ifdef  use_mysql
@@ -573,6 +589,8 @@ public:
         else if (getconfig().transactiondatabase[beast::string("type")] == beast::string("none")) {
             mtxndb = std::make_unique <nulldatabasecon> ();
         }
+        if (mtxndb)
+            mtxndb->setcollector (m_collectormanager->group ("txndb"));
         mledgerdb = std::make_unique <databasecon> (setup, "ledger.db",
                 ledgerdbinit, ledgerdbcount);
         mwalletdb = std::make_unique <databasecon> (setup, "wallet.db",
@@ -1219,8 +1237,7 @@ bool applicationimp::loadoldledger (
             cur = std::make_shared <ledger> (*cur, true);
             assert (!cur->isimmutable());
 
-            for (auto it = txns->peekfirstitem(); it != nullptr;
-                 it = txns->peeknextitem(it->gettag()))
+            for (auto const& it : *txns)
             {
                 transaction::pointer txn = replayledger->gettransaction(it->gettag());
                 m_journal.info << txn->getjson(0);
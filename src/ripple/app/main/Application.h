@@ -58,6 +58,7 @@ class validations;
 
 class databasecon;
 class shamapstore;
+class sigverifier;
 
 using nodecache     = taggedcache <uint256, blob>;
 using slecache      = taggedcache <uint256, stledgerentry>;
@@ -103,6 +104,7 @@ public:
     virtual validators::manager&    getvalidators () = 0;
     virtual amendmenttable&         getamendmenttable() = 0;
     virtual ihashrouter&            gethashrouter () = 0;
+    virtual sigverifier&            getsigverifier () = 0;
     virtual loadfeetrack&           getfeetrack () = 0;
     virtual loadmanager&            getloadmanager () = 0;
     virtual overlay&                overlay () = 0;
@@ -0,0 +1,154 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#ifndef ripple_accountsubindex_h_included
+#define ripple_accountsubindex_h_included
+
+#include <ripple/protocol/uinttypes.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace ripple {
+
+/** an immutable index of the accounts that have subscribers.
+
+    most accounts a transaction affects have no subscribers. a bloom filter
+    of about 16 bits per account rules out all but a fraction of a percent
+    of those without touching the table. accounts that pass the filter are
+    found by binary search in a table sorted by account.
+
+    the index is built once from its entries, a change to the subscribers
+    builds a new one.
+*/
+template <class value>
+class accountsubindex
+{
+public:
+    typedef std::pair <account, value> entry;
+
+    accountsubindex () = default;
+
+    explicit
+    accountsubindex (std::vector <entry> entries)
+        : entries_ (std::move (entries))
+    {
+        std::sort (entries_.begin (), entries_.end (),
+            [] (entry const& lhs, entry const& rhs)
+            {
+                return lhs.first < rhs.first;
+            });
+
+        std::size_t bits = 64;
+        while (bits < entries_.size () * bitsperaccount)
+            bits *= 2;
+
+        mask_ = bits - 1;
+        filter_.resize (bits / 64);
+
+        for (auto const& e : entries_)
+        {
+            std::uint64_t h1, h2;
+            hash (e.first, h1, h2);
+
+            for (int i = 0; i < probes; ++i)
+            {
+                std::uint64_t const bit = (h1 + i * h2) & mask_;
+                filter_[bit / 64] |= std::uint64_t (1) << (bit % 64);
+            }
+        }
+    }
+
+    bool
+    empty () const
+    {
+        return entries_.empty ();
+    }
+
+    std::size_t
+    size () const
+    {
+        return entries_.size ();
+    }
+
+    /** returns false if the account certainly has no entry. */
+    bool
+    maycontain (account const& id) const
+    {
+        if (entries_.empty ())
+            return false;
+
+        std::uint64_t h1, h2;
+        hash (id, h1, h2);
+
+        for (int i = 0; i < probes; ++i)
+        {
+            std::uint64_t const bit = (h1 + i * h2) & mask_;
+            if ((filter_[bit / 64] & (std::uint64_t (1) << (bit % 64))) == 0)
+                return false;
+        }
+
+        return true;
+    }
+
+    /** returns the entry of an account, or nullptr if it has none.
+        only the table is searched, callers check maycontain first.
+    */
+    value const*
+    find (account const& id) const
+    {
+        auto const iter = std::lower_bound (entries_.begin (), entries_.end (),
+            id, [] (entry const& e, account const& key)
+            {
+                return e.first < key;
+            });
+
+        if (iter == entries_.end () || iter->first != id)
+            return nullptr;
+
+        return &iter->second;
+    }
+
+private:
+    enum
+    {
+        bitsperaccount = 16,
+        probes = 4
+    };
+
+    // account ids are hashes already, two words of one give the probes
+    static
+    void
+    hash (account const& id, std::uint64_t& h1, std::uint64_t& h2)
+    {
+        std::memcpy (&h1, id.begin (), sizeof (h1));
+        std::memcpy (&h2, id.begin () + sizeof (h1), sizeof (h2));
+        h2 |= 1;
+    }
+
+    std::vector <entry> entries_;
+    std::vector <std::uint64_t> filter_;
+    std::uint64_t mask_ = 0;
+};
+
+} // ripple
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef ripple_app_dividend_index_h_included
+#define ripple_app_dividend_index_h_included
+
+#include <ripple/app/ledger/acceptedledger.h>
+#include <ripple/app/ledger/ledger.h>
+#include <ripple/core/jobqueue.h>
+#include <vector>
+
+namespace ripple {
+
+// one account taking part in a dividend. accounts are kept in flat arrays in
+// the order the spread pass consumes them: reference height desc, then
+// referee desc. vrank is filled when the inputs are collected, vspd and tspd
+// by the spread pass.
+struct dividendaccount
+{
+    account id;
+    account parent;
+    uint32_t height;
+    uint64_t balance;
+    uint32_t vrank;
+    uint64_t vspd;
+    uint64_t tspd;
+};
+
+typedef std::vector<dividendaccount> dividendaccounts;
+
+/** the ranking and spreading inputs of the dividend, kept up to date from
+    the metadata of every published ledger instead of a full state walk.
+
+    the index is seeded once with a walk of a published ledger and then
+    follows the published ledgers one at a time. when a ledger starts a
+    dividend the inputs of its parent, which is the dividend base ledger,
+    are captured so the dividend can be calculated from them later.
+*/
+class dividendindex
+{
+public:
+    virtual ~dividendindex() {}
+
+    /** apply the changes made by a published ledger.
+        ledgers must arrive in order, a gap makes the index reseed itself.
+    */
+    virtual void onledger(acceptedledger::pointer const& ledger) = 0;
+
+    /** the inputs for a dividend based on baseledgerseq.
+        @return false if the index does not hold them.
+    */
+    virtual bool getinputs(uint32_t baseledgerseq, dividendaccounts& accounts, uint64_t& sumvrank) = 0;
+
+    /** forget everything, the next published ledger reseeds the index. */
+    virtual void reset() = 0;
+};
+
+/** the index seeds itself with jobs on the given queue. */
+std::unique_ptr<dividendindex>
+make_dividendindex(beast::journal journal, jobqueue& jobqueue);
+
+}
+
+#endif //ripple_app_dividend_index_h_included
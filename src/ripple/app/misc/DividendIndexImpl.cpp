@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <deque>
+#include <mutex>
+
+#include <ripple/app/main/application.h>
+#include <ripple/app/misc/dividendindex.h>
+#include <ripple/app/misc/dividendinputs.h>
+#include <ripple/basics/log.h>
+#include <ripple/basics/unorderedcontainers.h>
+#include <ripple/core/config.h>
+#include <ripple/core/paralleljobs.h>
+#include <ripple/protocol/indexes.h>
+#include <ripple/protocol/systemparameters.h>
+
+namespace ripple {
+
+class dividendindeximpl : public dividendindex
+{
+    typedef enum { state_empty = 0, state_seeding = 1, state_ready = 2 } indexstate;
+
+public:
+    dividendindeximpl(beast::journal journal, jobqueue& jobqueue)
+        : m_journal(journal),
+        m_jobqueue(jobqueue),
+        m_state(state_empty),
+        m_generation(0),
+        m_seq(0),
+        m_snapshotseq(0),
+        m_snapshotsumvrank(0)
+    {
+    }
+
+    void onledger(acceptedledger::pointer const& ledger) override
+    {
+        if (getconfig().dividend_index == config::dividendindexoff)
+            return;
+
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (m_state == state_empty)
+            startseed(ledger->getledger());
+        else if (m_state == state_seeding)
+            m_pending.push_back(ledger);
+        else
+            apply(ledger);
+    }
+
+    bool getinputs(uint32_t baseledgerseq, dividendaccounts& accounts, uint64_t& sumvrank) override
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (m_snapshotseq != 0 && m_snapshotseq == baseledgerseq) {
+            accounts = m_snapshot;
+            sumvrank = m_snapshotsumvrank;
+            return true;
+        }
+        if (m_state == state_ready && m_seq == baseledgerseq) {
+            m_inputs.getinputs(accounts, sumvrank);
+            return true;
+        }
+        return false;
+    }
+
+    void reset() override
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        clear();
+        m_pending.clear();
+        m_snapshotseq = 0;
+        dividendaccounts().swap(m_snapshot);
+        m_snapshotsumvrank = 0;
+    }
+
+private:
+    void clear()
+    {
+        ++m_generation;
+        m_state = state_empty;
+        m_seq = 0;
+        m_inputs = dividendinputs();
+    }
+
+    // ledgers published while seeding stay queued, the ones the seed
+    // ledger already covers are skipped when they are replayed.
+    void startseed(ledger::ref ledger)
+    {
+        clear();
+        m_state = state_seeding;
+        int generation = m_generation;
+        ledger::pointer seedledger = ledger;
+        m_jobqueue.addjob(jtdividend, "dividendindexseed", [this, seedledger, generation](job&) {
+            seed(seedledger, generation);
+        });
+    }
+
+    // walk the full state of a ledger, then replay what was published since
+    void seed(ledger::pointer ledger, int generation)
+    {
+        if (m_journal.info)
+            m_journal.info << "dividend index seeding from ledger " << ledger->getledgerseq();
+
+        dividendinputs seeded;
+        try
+        {
+            std::vector<std::pair<uint256, dividendinputs::accountinput>> accounts[16];
+            std::vector<uint256> refers[16];
+            runparalleljobs(m_jobqueue, jtparallel, "dividendindexseed", 16, 16, [&accounts, &refers, ledger](std::size_t branch) {
+                ledger->visitstatebranch(branch, [&accounts, &refers, branch](sle::ref sle) {
+                    if (sle->gettype() == ltaccount_root)
+                        accounts[branch].emplace_back(sle->getindex(), dividendinputs::makeinput(sle));
+                    else if (sle->gettype() == ltrefer)
+                        refers[branch].push_back(sle->getindex());
+                }, shamap::walk_prefetch);
+            });
+            // refers first, so accounts are listed as they are added
+            for (int i = 0; i < 16; ++i) {
+                for (auto const& it : refers[i])
+                    seeded.setrefer(it, true);
+            }
+            for (int i = 0; i < 16; ++i) {
+                for (auto const& it : accounts[i])
+                    seeded.putaccount(it.first, it.second);
+                std::vector<std::pair<uint256, dividendinputs::accountinput>>().swap(accounts[i]);
+            }
+        }
+        catch (std::exception const& e)
+        {
+            if (m_journal.warning)
+                m_journal.warning << "dividend index failed to seed from ledger " << ledger->getledgerseq() << ": " << e.what();
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (generation == m_generation) {
+                clear();
+                m_pending.clear();
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (generation != m_generation)
+            return;
+
+        std::swap(m_inputs, seeded);
+        m_seq = ledger->getledgerseq();
+        m_state = state_ready;
+
+        if (m_journal.info)
+            m_journal.info << "dividend index seeded from ledger " << m_seq << " with " << m_inputs.size() << " accounts, replaying " << m_pending.size() << " ledgers";
+
+        while (m_state == state_ready && !m_pending.empty()) {
+            acceptedledger::pointer next = m_pending.front();
+            m_pending.pop_front();
+            apply(next);
+        }
+    }
+
+    void apply(acceptedledger::pointer const& accepted)
+    {
+        ledger::ref ledger = accepted->getledger();
+        uint32_t seq = ledger->getledgerseq();
+
+        if (seq <= m_seq)
+            return;
+
+        if (seq != m_seq + 1) {
+            if (m_journal.warning)
+                m_journal.warning << "dividend index at " << m_seq << " got ledger " << seq << ", reseeding";
+            startseed(ledger);
+            return;
+        }
+
+        // a ledger starting a dividend is based on its parent, which is where
+        // the index stands now. keep those inputs before this ledger moves on.
+        if (ledger->isdividendstarted() && ledger->getdividendbaseledger() == m_seq && m_snapshotseq != m_seq) {
+            m_inputs.getinputs(m_snapshot, m_snapshotsumvrank);
+            m_snapshotseq = m_seq;
+            if (m_journal.info)
+                m_journal.info << "dividend index captured " << m_snapshot.size() << " accounts for base ledger " << m_seq;
+        }
+
+        try
+        {
+            hash_set<uint256> roots;
+            for (auto const& it : accepted->getmap()) {
+                if (!it.second->isapplied())
+                    continue;
+                for (auto const& node : it.second->getmeta()->getnodes()) {
+                    auto const type = node.getfieldu16(sfledgerentrytype);
+                    uint256 const index = node.getfieldh256(sfledgerindex);
+                    if (type == ltaccount_root) {
+                        roots.insert(index);
+                    }
+                    else if (type == ltrefer) {
+                        if (node.getfname() == sfmodifiednode) {
+                            // owning account keeps its refer object
+                            continue;
+                        }
+                        // the owner is in the object created, or in the
+                        // final fields of the one deleted.
+                        sle::pointer sle = ledger->getslei(index);
+                        const stobject* fields = sle.get();
+                        if (!fields)
+                            fields = dynamic_cast<const stobject*>(node.peekatpfield(sffinalfields));
+                        if (!fields || !fields->isfieldpresent(sfaccount)) {
+                            if (m_journal.warning)
+                                m_journal.warning << "dividend index can not find owner of refer " << index << " in ledger " << seq << ", reseeding";
+                            startseed(ledger);
+                            return;
+                        }
+                        m_inputs.setrefer(index, bool(sle));
+                        m_inputs.relist(fields->getfieldaccount(sfaccount).getaccountid());
+                    }
+                }
+            }
+            for (auto const& index : roots)
+                m_inputs.setaccount(index, ledger->getslei(index));
+        }
+        catch (std::exception const& e)
+        {
+            if (m_journal.warning)
+                m_journal.warning << "dividend index failed to apply ledger " << seq << ": " << e.what() << ", reseeding";
+            startseed(ledger);
+            return;
+        }
+
+        m_seq = seq;
+    }
+
+    beast::journal m_journal;
+    jobqueue& m_jobqueue;
+    std::mutex m_lock;
+    indexstate m_state;
+    int m_generation;       // bumped whenever the index is cleared
+    uint32_t m_seq;         // last ledger applied
+    dividendinputs m_inputs;
+    std::deque<acceptedledger::pointer> m_pending;  // published while seeding
+    uint32_t m_snapshotseq; // base ledger of the captured inputs
+    dividendaccounts m_snapshot;
+    uint64_t m_snapshotsumvrank;
+};
+
+std::unique_ptr<dividendindex>
+make_dividendindex(beast::journal journal, jobqueue& jobqueue)
+{
+    return std::make_unique<dividendindeximpl>(journal, jobqueue);
+}
+
+}
@@ -0,0 +1,185 @@
+#ifndef ripple_app_dividend_inputs_h_included
+#define ripple_app_dividend_inputs_h_included
+
+#include <ripple/app/misc/dividendindex.h>
+#include <ripple/basics/unorderedcontainers.h>
+#include <ripple/protocol/indexes.h>
+#include <ripple/protocol/systemparameters.h>
+#include <algorithm>
+#include <map>
+#include <set>
+
+namespace ripple {
+
+/** the dividend inputs of one ledger.
+
+    account roots and refer objects are added, changed and removed one at a
+    time, in any order, and the accounts taking part in the dividend are
+    kept listed in the order the spread pass consumes them.
+*/
+class dividendinputs
+{
+public:
+    // an account root as the dividend sees it
+    struct accountinput
+    {
+        account id;
+        account parent;
+        uint32_t height;
+        uint64_t balance;
+        bool listed;    // takes part in the dividend
+    };
+
+    static accountinput makeinput(sle::ref sle)
+    {
+        accountinput input {sle->getfieldaccount(sfaccount).getaccountid(), account(), 0, sle->getfieldamount(sfbalancevbc).getnvalue(), false};
+        if (sle->isfieldpresent(sfreferee) && sle->isfieldpresent(sfreferenceheight)) {
+            input.height = sle->getfieldu32(sfreferenceheight);
+            input.parent = sle->getfieldaccount(sfreferee).getaccountid();
+        }
+        return input;
+    }
+
+    // sle is null when the account root is gone
+    void setaccount(uint256 const& rootindex, sle::ref sle)
+    {
+        if (sle) {
+            putaccount(rootindex, makeinput(sle));
+            return;
+        }
+        auto it = m_accounts.find(rootindex);
+        if (it != m_accounts.end()) {
+            unlist(rootindex, it->second);
+            m_accounts.erase(it);
+        }
+    }
+
+    void putaccount(uint256 const& rootindex, accountinput const& input)
+    {
+        accountinput& entry = m_accounts[rootindex];
+        unlist(rootindex, entry);
+        entry = input;
+        list(rootindex, entry);
+    }
+
+    void setrefer(uint256 const& referindex, bool exists)
+    {
+        if (exists)
+            m_refers.insert(referindex);
+        else
+            m_refers.erase(referindex);
+    }
+
+    // a refer object of this account appeared or went away
+    void relist(account const& id)
+    {
+        uint256 const rootindex = getaccountrootindex(id);
+        auto it = m_accounts.find(rootindex);
+        if (it != m_accounts.end()) {
+            unlist(rootindex, it->second);
+            list(rootindex, it->second);
+        }
+    }
+
+    void getinputs(dividendaccounts& accounts, uint64_t& sumvrank) const
+    {
+        // rank of a balance is one more than the number of holders
+        // with a smaller balance
+        std::vector<std::pair<uint64_t, uint32_t>> ranks;
+        ranks.reserve(m_balances.size());
+        sumvrank = 0;
+        uint32_t pos = 1;
+        for (auto const& it : m_balances) {
+            ranks.emplace_back(it.first, pos);
+            sumvrank += static_cast<uint64_t>(pos) * it.second;
+            pos += it.second;
+        }
+
+        accounts.clear();
+        accounts.reserve(m_ordered.size());
+        for (auto const& it : m_ordered) {
+            uint32_t vrank = 0;
+            if (it.holder) {
+                vrank = std::lower_bound(ranks.begin(), ranks.end(), std::make_pair(it.balance, uint32_t(0)))->second;
+            }
+            accounts.push_back({it.id, it.parent, it.height, it.balance, vrank, 0, 0});
+        }
+    }
+
+    std::size_t size() const
+    {
+        return m_ordered.size();
+    }
+
+private:
+    // an account taking part in the dividend, ordered the way
+    // collectdividendinputs leaves them: reference height desc, referee
+    // desc, then referrers in state map order before holders by balance.
+    struct orderkey
+    {
+        uint32_t height;
+        account parent;
+        bool holder;
+        uint64_t balance;
+        uint256 rootindex;
+        account id;
+    };
+
+    class orderkey_less {
+    public:
+        bool operator()(const orderkey &x, const orderkey &y) const
+        {
+            if (x.height != y.height)
+                return x.height > y.height;
+            if (x.parent != y.parent)
+                return x.parent > y.parent;
+            if (x.holder != y.holder)
+                return !x.holder;
+            if (x.holder && x.balance != y.balance)
+                return x.balance < y.balance;
+            return x.rootindex < y.rootindex;
+        }
+    };
+
+    static orderkey makekey(uint256 const& rootindex, accountinput const& entry)
+    {
+        return {entry.height, entry.parent, entry.balance >= system_currency_parts_vbc, entry.balance, rootindex, entry.id};
+    }
+
+    void list(uint256 const& rootindex, accountinput& entry)
+    {
+        bool holder = entry.balance >= system_currency_parts_vbc;
+        if (!holder && m_refers.find(getaccountreferindex(entry.id)) == m_refers.end())
+            return;
+        m_ordered.insert(makekey(rootindex, entry));
+        if (holder)
+            ++m_balances[entry.balance];
+        entry.listed = true;
+    }
+
+    void unlist(uint256 const& rootindex, accountinput& entry)
+    {
+        if (!entry.listed)
+            return;
+        m_ordered.erase(makekey(rootindex, entry));
+        if (entry.balance >= system_currency_parts_vbc) {
+            auto it = m_balances.find(entry.balance);
+            if (--it->second == 0)
+                m_balances.erase(it);
+        }
+        entry.listed = false;
+    }
+
+    // account roots by ledger index
+    hash_map<uint256, accountinput> m_accounts;
+    // ledger indexes of refer objects
+    hash_set<uint256> m_refers;
+    // accounts taking part in the dividend
+    std::set<orderkey, orderkey_less> m_ordered;
+    // <balancevbc, count> of holders
+    std::map<uint64_t, uint32_t> m_balances;
+};
+
+}
+
+#endif //ripple_app_dividend_inputs_h_included
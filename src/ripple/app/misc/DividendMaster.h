@@ -2,6 +2,7 @@
 #define ripple_app_dividend_master_h_included
 
 #include <ripple/app/ledger/ledger.h>
+#include <ripple/app/misc/dividendindex.h>
 #include <ripple/shamap/shamap.h>
 
 namespace ripple {
@@ -35,20 +36,28 @@ public:
     virtual bool calcresulthash() = 0;
     virtual uint256 getresulthash() = 0;
     virtual void setresulthash(uint256) = 0;
+    /// hash of the apply transactions this server built for the dividend
+    /// based on dividendledgerseq, zero if it built none.
+    virtual uint256 getbuiltresulthash(uint32_t dividendledgerseq) = 0;
     virtual void filldivready(shamap::pointer preset) = 0;
-    virtual void filldivresult(shamap::pointer preset) = 0;
+    /// adds the apply transactions, may replace preset with a new map.
+    virtual void filldivresult(shamap::pointer& preset) = 0;
     virtual void setledgerseq(uint32_t seq) = 0;
     virtual uint32_t getledgerseq() = 0;
+    virtual dividendindex& getindex() = 0;
     
     static void calcdividend(ledger::ref lastclosedledger);
     
+    /// walk the state of baseledger for the ranking and spreading inputs.
+    static void collectdividendinputs(ledger::ref baseledger, dividendaccounts& accounts, uint64_t& sumvrank);
+    
     
     /// @return true: needs dividend.
     static bool calcdividendfunc(ledger::ref baseledger, uint64_t dividendcoins, uint64_t dividendcoinsvbc, accountsdividend& accountsout, uint64_t& actualtotaldividend, uint64_t& actualtotaldividendvbc, uint64_t& sumvrank, uint64_t& sumvspd);
 };
 
 std::unique_ptr<dividendmaster>
-make_dividendmaster(beast::journal journal);
+make_dividendmaster(beast::journal journal, jobqueue& jobqueue);
 
 }
 
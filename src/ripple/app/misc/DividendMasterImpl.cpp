@@ -5,6 +5,8 @@
 #include <sys/resource.h>
 #endif
 #include <boost/multiprecision/cpp_int.hpp>
+#include <algorithm>
+#include <mutex>
 
 #include <beast/threads/recursivemutex.h>
 
@@ -14,6 +16,8 @@
 #include <ripple/app/misc/dividendmaster.h>
 #include <ripple/app/misc/networkops.h>
 #include <ripple/basics/log.h>
+#include <ripple/core/config.h>
+#include <ripple/core/paralleljobs.h>
 #include <ripple/protocol/systemparameters.h>
 
 namespace ripple {
@@ -35,11 +39,12 @@ static inline uint64_t memused(void) {
 class dividendmasterimpl : public dividendmaster
 {
 public:
-    dividendmasterimpl(beast::journal journal)
+    dividendmasterimpl(beast::journal journal, jobqueue& jobqueue)
         : m_journal(journal),
         m_ready(false),
         m_dividendledgerseq(0),
-        m_running(false)
+        m_running(false),
+        m_index(make_dividendindex(journal, jobqueue))
     {
     }
 
@@ -60,6 +65,8 @@ public:
     void setready(bool ready) override
     {
         m_ready = ready;
+        if (!ready)
+            m_resultmap.reset();
     }
 
     bool isready() override
@@ -127,45 +134,45 @@ public:
 
     bool calcresulthash() override
     {
-#ifdef moorecoin_async_dividend
-        application& app = getapp();
-        shamap::pointer txmap = std::make_shared<shamap>(
-                                        smttransaction,
-                                        app.getfullbelowcache(),
-                                        app.gettreenodecache(),
-                                        app.getnodestore(),
-                                        defaultmissingnodehandler(),
-                                        deprecatedlogs().journal("shamap"));
-        
-        for (const auto& it : m_divresult)
-        {
-            sttx trans(ttdividend);
-            trans.setfieldu8(sfdividendtype, dividendmaster::divtype_apply);
-            trans.setfieldaccount(sfaccount, account());
-            trans.setfieldaccount(sfdestination, std::get<0>(it));
-            trans.setfieldu32(sfdividendledger, m_dividendledgerseq);
-            trans.setfieldu64(sfdividendcoins, std::get<1>(it));
-            trans.setfieldu64(sfdividendcoinsvbc, std::get<2>(it));
-            trans.setfieldu64(sfdividendcoinsvbcrank, std::get<3>(it));
-            trans.setfieldu64(sfdividendcoinsvbcsprd, std::get<4>(it));
-            trans.setfieldu64(sfdividendvrank, std::get<5>(it));
-            trans.setfieldu64(sfdividendvsprd, std::get<6>(it));
-            trans.setfieldu64(sfdividendtsprd, std::get<7>(it));
-
-            uint256 txid = trans.gettransactionid();
-            serializer s;
-            trans.add(s, true);
-            
-            shamapitem::pointer titem = std::make_shared<shamapitem>(txid, s.peekdata());
-            
-            if (!txmap->addgiveitem(titem, true, false))
+        // the apply transactions are serialized in chunks, each split by
+        // the root branch it belongs to. every branch is then added as its
+        // own job from its own lists and grafted into the result map, so
+        // all the hashing below the root runs in parallel. the map is kept
+        // for filldivresult.
+        m_resultmap.reset();
+
+        std::size_t const chunksize = 4096;
+        std::size_t const chunks = (m_divresult.size() + chunksize - 1) / chunksize;
+        std::vector<shamap::branchitems> items(chunks);
+
+        runparalleljobs(getapp().getjobqueue(), jtparallel, "dividendtx", chunks, 16, [this, &items, chunksize](std::size_t chunk) {
+            std::size_t const first = chunk * chunksize;
+            std::size_t const last = std::min(first + chunksize, m_divresult.size());
+            for (std::size_t i = first; i < last; ++i)
             {
-                return false;
+                shamapitem::pointer titem = makeapplyitem(m_divresult[i]);
+                items[chunk][titem->gettag().begin()[0] >> 4].push_back(std::move(titem));
             }
+        });
+
+        shamap::pointer resultmap = makeresultmap();
+        if (!resultmap->addbranchitems(items, true, false, getapp().getjobqueue(), jtparallel))
+            return false;
+        resultmap->setimmutable();
+        m_resultmap = resultmap;
+        {
+            std::lock_guard<std::mutex> lock(m_builtlock);
+            m_builtledgerseq = m_dividendledgerseq;
+            m_builthash = m_resultmap->gethash();
         }
-        m_resulthash = txmap->gethash();
+
+#ifdef moorecoin_async_dividend
+        m_resulthash = m_resultmap->gethash();
 #endif // moorecoin_async_dividend
-        
+
+        if (m_journal.debug)
+            m_journal.debug << "dividend result map " << m_resultmap->gethash() << " with " << m_divresult.size() << " txs";
+
         return true;
     }
     uint256 getresulthash() override
@@ -178,6 +185,14 @@ public:
         m_resulthash = hash;
     }
 
+    uint256 getbuiltresulthash(uint32_t dividendledgerseq) override
+    {
+        std::lock_guard<std::mutex> lock(m_builtlock);
+        if (m_builtledgerseq != dividendledgerseq)
+            return uint256();
+        return m_builthash;
+    }
+
     void filldivready(shamap::pointer initialposition) override
     {
         sttx trans(ttdividend);
@@ -211,37 +226,34 @@ public:
         }
     }
 
-    void filldivresult(shamap::pointer initialposition) override
+    void filldivresult(shamap::pointer& initialposition) override
     {
-        for (const auto& it : m_divresult) {
-            sttx trans(ttdividend);
-            trans.setfieldu8(sfdividendtype, dividendmaster::divtype_apply);
-            trans.setfieldaccount(sfaccount, account());
-            trans.setfieldaccount(sfdestination, std::get<0>(it));
-            trans.setfieldu32(sfdividendledger, m_dividendledgerseq);
-            trans.setfieldu64(sfdividendcoins, std::get<1>(it));
-            trans.setfieldu64(sfdividendcoinsvbc, std::get<2>(it));
-            trans.setfieldu64(sfdividendcoinsvbcrank, std::get<3>(it));
-            trans.setfieldu64(sfdividendcoinsvbcsprd, std::get<4>(it));
-            trans.setfieldu64(sfdividendvrank, std::get<5>(it));
-            trans.setfieldu64(sfdividendvsprd, std::get<6>(it));
-            trans.setfieldu64(sfdividendtsprd, std::get<7>(it));
-
-            uint256 txid = trans.gettransactionid();
-            serializer s;
-            trans.add(s, true);
-
-            shamapitem::pointer titem = std::make_shared<shamapitem>(txid, s.peekdata());
+        if (!m_resultmap && !calcresulthash())
+        {
+            if (m_journal.warning)
+                m_journal.warning << "dividend fail to build result map";
+            return;
+        }
 
-            if (!initialposition->addgiveitem(titem, true, false)) {
-                if (m_journal.warning.active())
-                    m_journal.warning << "ledger already had dividend for " << std::get<0>(it);
-            }
-            else {
-                if (m_journal.trace.active())
-                    m_journal.trace << "dividend add tx " << txid << " for " << std::get<0>(it);
+        // start from the prebuilt result and copy in what the initial
+        // position already holds, which is normally far less. on a clash
+        // the transaction of the initial position is kept.
+        shamap::pointer merged = m_resultmap->snapshot(true);
+        initialposition->visitnodes([this, &merged](shamaptreenode& node) {
+            if (node.isleaf())
+            {
+                if (!merged->addgiveitem(node.peekitem(), true, node.hasmetadata()))
+                {
+                    merged->updategiveitem(node.peekitem(), true, node.hasmetadata());
+                    if (m_journal.warning.active())
+                        m_journal.warning << "ledger already had dividend for " << node.peekitem()->gettag();
+                }
             }
-        }
+            return true;
+        });
+        initialposition = merged;
+        m_resultmap.reset();
+
         if (m_journal.info)
             m_journal.info << "dividend add " << m_divresult.size() << " txs done. mem" << memused();
     }
@@ -256,8 +268,45 @@ public:
         return m_dividendledgerseq;
     }
 
+    dividendindex& getindex() override
+    {
+        return *m_index;
+    }
 
 private:
+    shamap::pointer makeresultmap()
+    {
+        application& app = getapp();
+        return std::make_shared<shamap>(smttransaction,
+                                        app.getfullbelowcache(),
+                                        app.gettreenodecache(),
+                                        app.getnodestore(),
+                                        defaultmissingnodehandler(),
+                                        deprecatedlogs().journal("shamap"));
+    }
+
+    shamapitem::pointer makeapplyitem(accountsdividend::value_type const& it)
+    {
+        sttx trans(ttdividend);
+        trans.setfieldu8(sfdividendtype, dividendmaster::divtype_apply);
+        trans.setfieldaccount(sfaccount, account());
+        trans.setfieldaccount(sfdestination, std::get<0>(it));
+        trans.setfieldu32(sfdividendledger, m_dividendledgerseq);
+        trans.setfieldu64(sfdividendcoins, std::get<1>(it));
+        trans.setfieldu64(sfdividendcoinsvbc, std::get<2>(it));
+        trans.setfieldu64(sfdividendcoinsvbcrank, std::get<3>(it));
+        trans.setfieldu64(sfdividendcoinsvbcsprd, std::get<4>(it));
+        trans.setfieldu64(sfdividendvrank, std::get<5>(it));
+        trans.setfieldu64(sfdividendvsprd, std::get<6>(it));
+        trans.setfieldu64(sfdividendtsprd, std::get<7>(it));
+
+        uint256 txid = trans.gettransactionid();
+        serializer s;
+        trans.add(s, true);
+
+        return std::make_shared<shamapitem>(txid, s.peekdata());
+    }
+
     beast::journal m_journal;
     beast::recursivemutex m_lock;
     bool m_ready;
@@ -268,7 +317,14 @@ private:
     uint64_t m_sumvrank=0;
     uint64_t m_sumvspd=0;
     uint256 m_resulthash;
+    shamap::pointer m_resultmap;
+    // kept after the result map is released, for the ledger close to
+    // compare the voted result hash with
+    std::mutex m_builtlock;
+    uint32_t m_builtledgerseq = 0;
+    uint256 m_builthash;
     bool m_running;
+    std::unique_ptr<dividendindex> m_index;
 };
 
 void dividendmaster::calcdividend(ledger::ref lastclosedledger)
@@ -345,78 +401,150 @@ static inline uint64_t adjust(uint64_t coin)
 
 class accountsbyreference_less {
 public:
-    template <class t>
-    bool operator()(const t &x, const t &y) const
+    bool operator()(const dividendaccount &x, const dividendaccount &y) const
     {
         // accounts by reference height needs to be descending order
-        if (std::get<2>(x) > std::get<2>(y))
+        if (x.height > y.height)
             return true;
-        else if (std::get<2>(x) == std::get<2>(y))
-            return std::get<1>(x) > std::get<1>(y);
+        else if (x.height == y.height)
+            return x.parent > y.parent;
         return false;
     }
 };
 
-bool dividendmaster::calcdividendfunc(ledger::ref baseledger, uint64_t dividendcoins, uint64_t dividendcoinsvbc, accountsdividend& accountsout, uint64_t& actualtotaldividend, uint64_t& actualtotaldividendvbc, uint64_t& sumvrank, uint64_t& sumvspd)
+class accountsbybalance_less {
+public:
+    bool operator()(const dividendaccount &x, const dividendaccount &y) const
+    {
+        return x.balance < y.balance;
+    }
+};
+
+void dividendmaster::collectdividendinputs(ledger::ref baseledger, dividendaccounts& accountsbyreference, uint64_t& sumvrank)
 {
-    writelog(lsinfo, dividendmaster) << "expected dividend: " << dividendcoins << " " << dividendcoinsvbc << " for ledger " << baseledger->getledgerseq() << " mem " << memused();
-    
-    // <balancevbc, <accountid, parentaccoutid, height>>, accounts sorted by balance
-    std::multimap<uint64_t, std::tuple<account, account, uint32_t>> accountsbybalance;
+    // the state map is scanned one root branch per job. holders have enough
+    // vbc to be ranked, referrers only take part through their children.
+    // both keep the order of the state map inside each branch.
+    dividendaccounts holders[16], referrers[16];
     
-    // <<accountid, parentid, height>, <balancevbc, vrank, vspd, tspd>>, accounts sorted by reference height and parent desc
-    std::multimap<std::tuple<account, account, uint32_t>, std::tuple<uint64_t, uint32_t, uint64_t, uint64_t>, accountsbyreference_less> accountsbyreference;
-    
-    // visit account stats to fill accountsbybalance
-    baseledger->visitstateitems([&accountsbybalance, &accountsbyreference, baseledger](sle::ref sle) {
-        if (sle->gettype() == ltaccount_root) {
-            uint64_t bal = sle->getfieldamount(sfbalancevbc).getnvalue();
-            if (bal < system_currency_parts_vbc
-                && !baseledger->hasrefer(sle->getfieldaccount(sfaccount).getaccountid())) {
-                return;
-            }
-            uint32_t height = 0;
-            account addrparent;
-            if (sle->isfieldpresent(sfreferee) && sle->isfieldpresent(sfreferenceheight)) {
-                height = sle->getfieldu32(sfreferenceheight);
-                addrparent = sle->getfieldaccount(sfreferee).getaccountid();
+    runparalleljobs(getapp().getjobqueue(), jtparallel, "dividendscan", 16, 16, [&holders, &referrers, baseledger](std::size_t branch) {
+        baseledger->visitstatebranch(branch, [&holders, &referrers, baseledger, branch](sle::ref sle) {
+            if (sle->gettype() == ltaccount_root) {
+                uint64_t bal = sle->getfieldamount(sfbalancevbc).getnvalue();
+                if (bal < system_currency_parts_vbc
+                    && !baseledger->hasrefer(sle->getfieldaccount(sfaccount).getaccountid())) {
+                    return;
+                }
+                dividendaccount entry {sle->getfieldaccount(sfaccount).getaccountid(), account(), 0, bal, 0, 0, 0};
+                if (sle->isfieldpresent(sfreferee) && sle->isfieldpresent(sfreferenceheight)) {
+                    entry.height = sle->getfieldu32(sfreferenceheight);
+                    entry.parent = sle->getfieldaccount(sfreferee).getaccountid();
+                }
+                if (bal < system_currency_parts_vbc)
+                    referrers[branch].push_back(entry);
+                else
+                    holders[branch].push_back(entry);
             }
-            if (bal < system_currency_parts_vbc)
-                accountsbyreference.emplace(std::piecewise_construct,
-                                            std::forward_as_tuple(sle->getfieldaccount(sfaccount).getaccountid(), addrparent, height),
-                                            std::forward_as_tuple(bal, 0, 0, 0));
-            else
-                accountsbybalance.emplace(std::piecewise_construct,
-                                          std::forward_as_tuple(bal),
-                                          std::forward_as_tuple(sle->getfieldaccount(sfaccount).getaccountid(), addrparent, height));
-        }
+        }, shamap::walk_prefetch);
     });
-    writelog(lsinfo, dividendmaster) << "calcdividend got " << accountsbybalance.size() << " accounts for ranking " << accountsbyreference.size() << " accounts for sprd mem " << memused();
     
-    if (accountsbybalance.empty() && accountsbyreference.empty())
+    // accounts sorted by balance, equal balances stay in state map order
+    dividendaccounts accountsbybalance;
+    
+    // accounts sorted by reference height and parent desc
+    accountsbyreference.clear();
     {
-        accountsout.clear();
-        actualtotaldividend = 0;
-        actualtotaldividendvbc = 0;
-        sumvrank = 0;
-        sumvspd = 0;
-        return true;
+        std::size_t holdercount = 0, referrercount = 0;
+        for (int i = 0; i < 16; ++i) {
+            holdercount += holders[i].size();
+            referrercount += referrers[i].size();
+        }
+        accountsbybalance.reserve(holdercount);
+        accountsbyreference.reserve(holdercount + referrercount);
+        for (int i = 0; i < 16; ++i) {
+            accountsbybalance.insert(accountsbybalance.end(), holders[i].begin(), holders[i].end());
+            dividendaccounts().swap(holders[i]);
+            accountsbyreference.insert(accountsbyreference.end(), referrers[i].begin(), referrers[i].end());
+            dividendaccounts().swap(referrers[i]);
+        }
     }
+    std::stable_sort(accountsbybalance.begin(), accountsbybalance.end(), accountsbybalance_less());
+    writelog(lsinfo, dividendmaster) << "calcdividend got " << accountsbybalance.size() << " accounts for ranking " << accountsbyreference.size() << " accounts for sprd mem " << memused();
     
     // traverse accountsbybalance to caculate v ranking into vrank in accountsbyreference
     sumvrank = 0;
     {
         uint64_t lastbalance = 0;
         uint32_t pos = 1, rank = 1;
-        for (auto it = accountsbybalance.begin(); it != accountsbybalance.end(); ++pos) {
-            if (lastbalance < it->first) {
+        for (auto& it : accountsbybalance) {
+            if (lastbalance < it.balance) {
                 rank = pos;
-                lastbalance = it->first;
+                lastbalance = it.balance;
             }
-            accountsbyreference.emplace(std::piecewise_construct, it->second, std::forward_as_tuple(it->first, rank, 0, 0));
+            it.vrank = rank;
             sumvrank += rank;
-            it = accountsbybalance.erase(it);
+            ++pos;
         }
+        // ranked accounts follow the referrers, as they did when they were
+        // inserted into the reference ordered multimap after the scan.
+        accountsbyreference.insert(accountsbyreference.end(), accountsbybalance.begin(), accountsbybalance.end());
+        dividendaccounts().swap(accountsbybalance);
+    }
+    std::stable_sort(accountsbyreference.begin(), accountsbyreference.end(), accountsbyreference_less());
+}
+
+static bool sameinputs(const dividendaccounts& x, const dividendaccounts& y)
+{
+    return x.size() == y.size() && std::equal(x.begin(), x.end(), y.begin(),
+        [](const dividendaccount& a, const dividendaccount& b) {
+            return a.id == b.id && a.parent == b.parent && a.height == b.height &&
+                a.balance == b.balance && a.vrank == b.vrank;
+        });
+}
+
+bool dividendmaster::calcdividendfunc(ledger::ref baseledger, uint64_t dividendcoins, uint64_t dividendcoinsvbc, accountsdividend& accountsout, uint64_t& actualtotaldividend, uint64_t& actualtotaldividendvbc, uint64_t& sumvrank, uint64_t& sumvspd)
+{
+    writelog(lsinfo, dividendmaster) << "expected dividend: " << dividendcoins << " " << dividendcoinsvbc << " for ledger " << baseledger->getledgerseq() << " mem " << memused();
+    
+    // accounts sorted by reference height and parent desc, with v ranking
+    dividendaccounts accountsbyreference;
+    
+    dividendindex& index = getapp().getops().getdividendmaster()->getindex();
+    if (getconfig().dividend_index == config::dividendindexoff ||
+        !index.getinputs(baseledger->getledgerseq(), accountsbyreference, sumvrank))
+    {
+        collectdividendinputs(baseledger, accountsbyreference, sumvrank);
+    }
+    else
+    {
+        writelog(lsinfo, dividendmaster) << "calcdividend got " << accountsbyreference.size() << " accounts from index mem " << memused();
+        if (getconfig().dividend_index == config::dividendindexverify)
+        {
+            dividendaccounts walked;
+            uint64_t walkedsumvrank = 0;
+            collectdividendinputs(baseledger, walked, walkedsumvrank);
+            if (walkedsumvrank != sumvrank || !sameinputs(walked, accountsbyreference))
+            {
+                writelog(lserror, dividendmaster) << "dividend index does not match ledger " << baseledger->getledgerseq() << ": " << accountsbyreference.size() << " accounts v rank total " << sumvrank << ", walk found " << walked.size() << " accounts v rank total " << walkedsumvrank;
+                index.reset();
+                accountsbyreference.swap(walked);
+                sumvrank = walkedsumvrank;
+            }
+            else
+            {
+                writelog(lsinfo, dividendmaster) << "dividend index verified for ledger " << baseledger->getledgerseq();
+            }
+        }
+    }
+    
+    if (accountsbyreference.empty())
+    {
+        accountsout.clear();
+        actualtotaldividend = 0;
+        actualtotaldividendvbc = 0;
+        sumvrank = 0;
+        sumvspd = 0;
+        return true;
     }
     writelog(lsinfo, dividendmaster) << "calcdividend got v rank total: " << sumvrank << " mem " << memused();
     
@@ -428,7 +556,7 @@ bool dividendmaster::calcdividendfunc(ledger::ref baseledger, uint64_t dividendc
         account lastparent;
         uint64_t totalchildrenvspd = 0, totalchildrenholding = 0, maxholding = 0;
         for (auto& it : accountsbyreference) {
-            const account& accountparent = std::get<1>(it.first);
+            const account& accountparent = it.parent;
             if (lastparent != accountparent) {
                 // no more for lastparent, store it
                 if (totalchildrenvspd != 0) {
@@ -438,7 +566,7 @@ bool dividendmaster::calcdividendfunc(ledger::ref baseledger, uint64_t dividendc
                 lastparent = accountparent;
             }
             
-            const account& account = std::get<0>(it.first);
+            const account& account = it.id;
             
             uint64_t t = 0, v = 0;
             
@@ -450,16 +578,16 @@ bool dividendmaster::calcdividendfunc(ledger::ref baseledger, uint64_t dividendc
                 childrenholdings.erase(itholding);
             }
             
-            uint64_t balance = std::get<0>(it.second);
+            uint64_t balance = it.balance;
             
             // store v spreading
             if (balance >= system_currency_parts_vbc) {
-                std::get<2>(it.second) = v;
+                it.vspd = v;
                 sumvspd += v;
             }
             
             t += balance;
-            std::get<3>(it.second) = t;
+            it.tspd = t;
             
             if (accountparent.iszero())
                 continue;
@@ -483,10 +611,10 @@ bool dividendmaster::calcdividendfunc(ledger::ref baseledger, uint64_t dividendc
         boost::multiprecision::uint128_t divvbcbyrank(0), divvbcbypower(0);
         if (dividendcoinsvbc > 0 && sumvspd > 0 && sumvrank > 0) {
             divvbcbyrank = totaldivvbcbyrank;
-            divvbcbyrank *= std::get<1>(it.second);
+            divvbcbyrank *= it.vrank;
             divvbcbyrank /= sumvrank;
             divvbcbypower = totaldivvbcbypower;
-            divvbcbypower *= std::get<2>(it.second);
+            divvbcbypower *= it.vspd;
             divvbcbypower /= sumvspd;
             divvbc = static_cast<uint64_t>(divvbcbyrank + divvbcbypower);
             if (divvbc < vbc_dividend_min) {
@@ -498,17 +626,17 @@ bool dividendmaster::calcdividendfunc(ledger::ref baseledger, uint64_t dividendc
         }
         uint64_t div = 0;
         if (dividendcoins > 0 && (dividendcoinsvbc == 0 || divvbc >= vbc_dividend_min)) {
-            div = std::get<0>(it.second) * vrp_increase_rate / vrp_increase_rate_parts;
+            div = it.balance * vrp_increase_rate / vrp_increase_rate_parts;
             actualtotaldividend += div;
         }
         
         if (shouldlog(lsinfo, dividendmaster)) {
-            writelog(lsinfo, dividendmaster) << "{\"account\":\"" << rippleaddress::createaccountid(std::get<0>(it.first)).humanaccountid() << "\",\"data\":{\"divvbcbyrank\":\"" << divvbcbyrank << "\",\"divvbcbypower\":\"" << divvbcbypower << "\",\"divvbc\":\"" << divvbc << "\",\"balance\":\"" << std::get<0>(it.second) << "\",\"vrank\":\"" << std::get<1>(it.second) << "\",\"vsprd\":\"" << std::get<2>(it.second) << "\",\"tsprd\":\"" << std::get<3>(it.second) << "\"}}";
+            writelog(lsinfo, dividendmaster) << "{\"account\":\"" << rippleaddress::createaccountid(it.id).humanaccountid() << "\",\"data\":{\"divvbcbyrank\":\"" << divvbcbyrank << "\",\"divvbcbypower\":\"" << divvbcbypower << "\",\"divvbc\":\"" << divvbc << "\",\"balance\":\"" << it.balance << "\",\"vrank\":\"" << it.vrank << "\",\"vsprd\":\"" << it.vspd << "\",\"tsprd\":\"" << it.tspd << "\"}}";
         }
         
-        if (div !=0 || divvbc !=0 || std::get<2>(it.second) > min_vspd_to_get_fee_share)
+        if (div !=0 || divvbc !=0 || it.vspd > min_vspd_to_get_fee_share)
         {
-            accountsout.push_back(std::make_tuple(std::get<0>(it.first), div, divvbc, static_cast<uint64_t>(divvbcbyrank), static_cast<uint64_t>(divvbcbypower), std::get<1>(it.second), std::get<2>(it.second), std::get<3>(it.second)));
+            accountsout.push_back(std::make_tuple(it.id, div, divvbc, static_cast<uint64_t>(divvbcbyrank), static_cast<uint64_t>(divvbcbypower), it.vrank, it.vspd, it.tspd));
         }
     }
     
@@ -534,9 +662,9 @@ bool dividendmaster::calcdividendfunc(ledger::ref baseledger, uint64_t dividendc
 }
 
 std::unique_ptr<dividendmaster>
-make_dividendmaster(beast::journal journal)
+make_dividendmaster(beast::journal journal, jobqueue& jobqueue)
 {
-    return std::make_unique<dividendmasterimpl>(journal);
+    return std::make_unique<dividendmasterimpl>(journal, jobqueue);
 }
 
 }
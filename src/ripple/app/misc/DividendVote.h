@@ -26,7 +26,7 @@ public:
                                     stobject& basevalidation) = 0;
     
     virtual bool doapplyvoting (ledger::ref lastclosedledger,
-                                shamap::ref initialposition) = 0;
+                                shamap::pointer& initialposition) = 0;
 
 };
 
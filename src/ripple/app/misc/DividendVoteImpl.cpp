@@ -184,7 +184,7 @@ public:
         }
     }
     
-    bool doapplyvoting(ledger::ref lastclosedledger, shamap::ref initialposition) override
+    bool doapplyvoting(ledger::ref lastclosedledger, shamap::pointer& initialposition) override
     {
         uint32_t dividendledger = lastclosedledger->getdividendbaseledger();
         
@@ -32,8 +32,10 @@
 #include <ripple/app/ledger/orderbookdb.h>
 #include <ripple/app/main/loadmanager.h>
 #include <ripple/app/main/localcredentials.h>
+#include <ripple/app/misc/accountsubindex.h>
 #include <ripple/app/misc/ihashrouter.h>
 #include <ripple/app/misc/networkops.h>
+#include <ripple/app/misc/shamapstore.h>
 #include <ripple/app/misc/validations.h>
 #include <ripple/app/peers/clusternodestatus.h>
 #include <ripple/app/peers/uniquenodelist.h>
@@ -60,6 +62,7 @@
 #include <beast/module/core/system/systemstats.h>
 #include <beast/cxx14/memory.h> // <memory>
 #include <boost/foreach.hpp>
+#include <mutex>
 #include <tuple>
 
 namespace ripple {
@@ -83,10 +86,12 @@ public:
     networkopsimp (
             clock_type& clock, bool standalone, std::size_t network_quorum,
             jobqueue& job_queue, ledgermaster& ledgermaster, stoppable& parent,
+            beast::insight::collector::ptr const& collector,
             beast::journal journal)
         : networkops (parent)
         , m_clock (clock)
         , m_journal (journal)
+        , m_stats (collector)
         , m_localtx (localtxs::new ())
         , m_feevote (make_feevote (setup_feevote (getconfig().section ("voting")),
             deprecatedlogs().journal("feevote")))
@@ -113,7 +118,8 @@ public:
         , m_network_quorum (network_quorum)
     {
         m_dividendvote = make_dividendvote(deprecatedlogs().journal("dividendvote"));
-        m_dividendmaster = make_dividendmaster(deprecatedlogs().journal("dividendmaster"));
+        m_dividendmaster = make_dividendmaster(deprecatedlogs().journal("dividendmaster"),
+            m_job_queue);
     }
 
     ~networkopsimp()
@@ -427,6 +433,14 @@ public:
         bool descending, std::uint32_t offset, int limit,
         bool binary, bool count, bool badmin);
 
+    //helper function to generate sql query to get a page of transactions
+    //starting at a marker
+    std::string accounttxpagesql (
+        rippleaddress const& account, std::int32_t minledger,
+        std::int32_t maxledger, bool forward, bool resume,
+        std::uint32_t findledger, std::uint32_t findseq,
+        std::string const& txtype, std::uint32_t querylimit);
+
     // client information retrieval functions
     using networkops::accounttxs;
     accounttxs getaccounttxs (
@@ -543,14 +557,45 @@ private:
 private:
     clock_type& m_clock;
 
-    typedef hash_map <account, submaptype> subinfomaptype;
+    // subscribers to a stream. a set is replaced instead of changed, so
+    // publishing walks a snapshot of it without holding any lock.
+    typedef std::shared_ptr <submaptype const> subsnapshot;
+    typedef hash_map <account, subsnapshot> subinfomaptype;
+    typedef accountsubindex <subsnapshot> subindex;
     typedef hash_map<std::string, infosub::pointer> subrpcmaptype;
 
+    // how the accounts of published transactions were looked up
+    struct stats
+    {
+        explicit stats (beast::insight::collector::ptr const& collector)
+            : account_filtered (collector->make_counter (
+                "account_filtered"))
+            , account_missed (collector->make_counter (
+                "account_missed"))
+            , account_found (collector->make_counter (
+                "account_found"))
+        {
+        }
+
+        beast::insight::counter account_filtered;  // ruled out by the filter
+        beast::insight::counter account_missed;    // passed it, not subscribed
+        beast::insight::counter account_found;
+    };
+
+    static std::shared_ptr <subindex const> makesubindex (
+        subinfomaptype const& submap);
+
+    static bool addsub (subsnapshot& subs, infosub::ref isplistener);
+    static bool removesub (subsnapshot& subs, std::uint64_t ulistener);
+    static void sendsubs (subsnapshot const& subs, json::value const& jvobj,
+        infosub::serializedptr const& sobj);
+
     // xxx split into more locks.
     typedef ripplerecursivemutex locktype;
     typedef std::lock_guard <locktype> scopedlocktype;
 
     beast::journal m_journal;
+    stats m_stats;
 
     std::unique_ptr <localtxs> m_localtx;
     std::unique_ptr <feevote> m_feevote;
@@ -591,15 +636,23 @@ private:
     // recent positions taken
     std::map<uint256, std::pair<int, shamap::pointer> > mrecentpositions;
 
+    // guards the subscriptions that transactions are published to, so
+    // publishing doesn't wait for mlock
+    std::mutex msublock;
+
     subinfomaptype msubaccount;
     subinfomaptype msubrtaccount;
 
+    // the same subscriptions, rebuilt when they change, for publishing
+    std::shared_ptr <subindex const> maccountindex;
+    std::shared_ptr <subindex const> mrtaccountindex;
+
     subrpcmaptype mrpcsubmap;
 
     submaptype msubledger;             // accepted ledgers
     submaptype msubserver;             // when server changes connectivity state
-    submaptype msubtransactions;       // all accepted transactions
-    submaptype msubrttransactions;     // all proposed and accepted transactions
+    subsnapshot msubtransactions;      // all accepted transactions
+    subsnapshot msubrttransactions;    // all proposed and accepted transactions
 
     taggedcache<uint256, blob>  mfetchpack;
     std::uint32_t mfetchseq;
@@ -1842,6 +1895,12 @@ void networkopsimp::setmode (operatingmode om)
 }
 
 
+// dividends of the first ledgers carry nothing an account would look up.
+// they are dropped in the query so a page is never short of rows.
+static char const* const olddividendsql =
+    "and (accounttransactions.ledgerseq > 3501 "
+    "or transactions.transtype <> 'dividend') ";
+
 std::string
 networkopsimp::transactionssql (
     std::string selection, rippleaddress const& account,
@@ -1908,7 +1967,7 @@ networkopsimp::transactionssql (
                 "select %s from "
                 "accounttransactions inner join transactions "
                 "on transactions.transid = accounttransactions.transid "
-                "where account = '%s' %s %s "
+                "where account = '%s' %s %s %s"
                 "order by accounttransactions.ledgerseq %s, "
                 "accounttransactions.txnseq %s, accounttransactions.transid %s "
                 "limit %u, %u;")
@@ -1916,6 +1975,7 @@ networkopsimp::transactionssql (
                     % account.humanaccountid ()
                     % maxclause
                     % minclause
+                    % olddividendsql
                     % (descending ? "desc" : "asc")
                     % (descending ? "desc" : "asc")
                     % (descending ? "desc" : "asc")
@@ -1926,6 +1986,67 @@ networkopsimp::transactionssql (
     return sql;
 }
 
+std::string
+networkopsimp::accounttxpagesql (
+    rippleaddress const& account, std::int32_t minledger,
+    std::int32_t maxledger, bool forward, bool resume,
+    std::uint32_t findledger, std::uint32_t findseq,
+    std::string const& txtype, std::uint32_t querylimit)
+{
+    // the page starts at the marker row, found through accttxindex on
+    // (account, ledgerseq, txnseq) rather than by reading the rows before
+    // it. the ledger range seeks to the marker's ledger, the marker
+    // clause only skips rows within that ledger.
+    std::string markerclause = "";
+
+    if (resume)
+    {
+        if (forward)
+            minledger = findledger;
+        else
+            maxledger = findledger;
+
+        markerclause = boost::str (boost::format (
+            "and (accounttransactions.ledgerseq %s '%u' "
+            "or accounttransactions.txnseq %s '%u') ")
+                % (forward ? ">" : "<")
+                % findledger
+                % (forward ? ">=" : "<=")
+                % findseq);
+    }
+
+    //add trans type support
+    std::string txtypesql = "";
+    if (txtype != "")
+    {
+        txtypesql = "and transtype = '" + txtype + "' ";
+    }
+
+    std::string sql = boost::str (boost::format
+        ("select accounttransactions.ledgerseq,accounttransactions.txnseq,"
+         "status,rawtxn,txnmeta "
+         "from accounttransactions inner join transactions "
+         "on transactions.transid = accounttransactions.transid "
+         "where accounttransactions.account = '%s' "
+         "%s%s%s"
+         "and accounttransactions.ledgerseq between '%u' and '%u' "
+         "order by accounttransactions.ledgerseq %s, "
+         "accounttransactions.txnseq %s, accounttransactions.transid %s "
+         "limit %u;")
+             % account.humanaccountid()
+             % txtypesql
+             % olddividendsql
+             % markerclause
+             % minledger
+             % maxledger
+             % (forward ? "asc" : "desc")
+             % (forward ? "asc" : "desc")
+             % (forward ? "asc" : "desc")
+             % querylimit);
+    m_journal.trace << "txsql query: " << sql;
+    return sql;
+}
+
 networkops::accounttxs networkopsimp::getaccounttxs (
     rippleaddress const& account,
     std::int32_t minledger, std::int32_t maxledger, bool descending,
@@ -1939,8 +2060,8 @@ networkops::accounttxs networkopsimp::getaccounttxs (
         minledger, maxledger, descending, offset, limit, false, false, badmin);
 
     {
-        auto db = getapp().gettxndb ().getdb ();
-        auto sl (getapp().gettxndb ().lock ());
+        auto reader (getapp().gettxndb ().getreader ("account_tx"));
+        auto db = reader.get ();
 
         sql_foreach (db, sql)
         {
@@ -1972,8 +2093,6 @@ networkops::accounttxs networkopsimp::getaccounttxs (
                     ledger->pendsavevalidated(false, false);
             }
 
-            // drop useless dividend before 3501
-            if (txn->getledger() > 3501 || txn->getstransaction()->gettxntype() != ttdividend)
             ret.emplace_back (txn, std::make_shared<transactionmetaset> (
                 txn->getid (), txn->getledger (), rawmeta.getdata ()));
         }
@@ -1996,8 +2115,8 @@ std::vector<networkopsimp::txnmetaledgertype> networkopsimp::getaccounttxsb (
         badmin);
 
     {
-        auto db = getapp().gettxndb ().getdb ();
-        auto sl (getapp().gettxndb ().lock ());
+        auto reader (getapp().gettxndb ().getreader ("account_tx"));
+        auto db = reader.get ();
 
         sql_foreach (db, sql)
         {
@@ -2042,9 +2161,8 @@ networkopsimp::accounttxs networkopsimp::gettxsaccount (
     accounttxs ret;
 
     std::uint32_t nonbinary_page_length = 200;
-    std::uint32_t extra_length = 100;
 
-    bool foundresume = token.isnull() || !token.isobject();
+    bool resume = !token.isnull() && token.isobject();
 
     std::uint32_t numberofresults, querylimit;
     if (limit <= 0)
@@ -2053,10 +2171,10 @@ networkopsimp::accounttxs networkopsimp::gettxsaccount (
         numberofresults = nonbinary_page_length;
     else
         numberofresults = limit;
-    querylimit = numberofresults + 1 + (foundresume ? 0 : extra_length);
+    querylimit = numberofresults + 1;
 
     std::uint32_t findledger = 0, findseq = 0;
-    if (!foundresume)
+    if (resume)
     {
         try
         {
@@ -2070,49 +2188,20 @@ networkopsimp::accounttxs networkopsimp::gettxsaccount (
             return ret;
         }
     }
-    
-    //add trans type support
-    std::string txtypesql = "";
-    if (txtype != "")
-    {
-        txtypesql = "and transtype = '" + txtype + "' ";
-    }
 
     // st note we're using the token reference both for passing inputs and
     //         outputs, so we need to clear it in between.
     token = json::nullvalue;
 
-    std::string sql = boost::str (boost::format
-        ("select accounttransactions.ledgerseq,accounttransactions.txnseq,"
-         "status,rawtxn,txnmeta "
-         "from accounttransactions inner join transactions "
-         "on transactions.transid = accounttransactions.transid "
-         "where accounttransactions.account = '%s' "
-         "%s"
-         "and accounttransactions.ledgerseq between '%u' and '%u' "
-         "order by accounttransactions.ledgerseq %s, "
-         "accounttransactions.txnseq %s, accounttransactions.transid %s "
-         "limit %u;")
-             % account.humanaccountid()
-             % txtypesql
-             % ((forward && (findledger != 0)) ? findledger : minledger)
-             % ((!forward && (findledger != 0)) ? findledger: maxledger)
-             % (forward ? "asc" : "desc")
-             % (forward ? "asc" : "desc")
-             % (forward ? "asc" : "desc")
-             % querylimit);
+    std::string sql = accounttxpagesql (account, minledger, maxledger,
+        forward, resume, findledger, findseq, txtype, querylimit);
     {
-        auto db = getapp().gettxndb ().getdb ();
-        auto sl (getapp().gettxndb ().lock ());
+        auto reader (getapp().gettxndb ().getreader ("account_tx"));
+        auto db = reader.get ();
 
         sql_foreach (db, sql)
         {
-            if (!foundresume)
-            {
-                foundresume = (findledger == db->getint("ledgerseq") &&
-                               findseq == db->getint("txnseq"));
-            }
-            else if (numberofresults == 0)
+            if (numberofresults == 0)
             {
                 token = json::objectvalue;
                 token[jss::ledger] = db->getint("ledgerseq");
@@ -2120,45 +2209,40 @@ networkopsimp::accounttxs networkopsimp::gettxsaccount (
                 break;
             }
 
-            if (foundresume)
-            {
-                auto txn = transaction::transactionfromsql (db, validate::no);
+            auto txn = transaction::transactionfromsql (db, validate::no);
 
-                serializer rawmeta;
-                int metasize = 2048;
+            serializer rawmeta;
+            int metasize = 2048;
+            rawmeta.resize (metasize);
+            metasize = db->getbinary (
+                "txnmeta", &*rawmeta.begin (), rawmeta.getlength ());
+
+            if (metasize > rawmeta.getlength ())
+            {
                 rawmeta.resize (metasize);
-                metasize = db->getbinary (
+                db->getbinary (
                     "txnmeta", &*rawmeta.begin (), rawmeta.getlength ());
+            }
+            else
+                rawmeta.resize (metasize);
 
-                if (metasize > rawmeta.getlength ())
-                {
-                    rawmeta.resize (metasize);
-                    db->getbinary (
-                        "txnmeta", &*rawmeta.begin (), rawmeta.getlength ());
-                }
-                else
-                    rawmeta.resize (metasize);
-
-                if (rawmeta.getlength() == 0)
-                {
-                    // work around a bug that could leave the metadata missing
-                    auto seq = static_cast<std::uint32_t>(
-                        db->getbigint("ledgerseq"));
-                    m_journal.warning << "recovering ledger " << seq
-                                      << ", txn " << txn->getid();
-                    ledger::pointer ledger = getledgerbyseq(seq);
-                    if (ledger)
-                        ledger->pendsavevalidated(false, false);
-                }
+            if (rawmeta.getlength() == 0)
+            {
+                // work around a bug that could leave the metadata missing
+                auto seq = static_cast<std::uint32_t>(
+                    db->getbigint("ledgerseq"));
+                m_journal.warning << "recovering ledger " << seq
+                                  << ", txn " << txn->getid();
+                ledger::pointer ledger = getledgerbyseq(seq);
+                if (ledger)
+                    ledger->pendsavevalidated(false, false);
+            }
 
-                --numberofresults;
+            --numberofresults;
 
-                // drop useless dividend before 3501
-                if (txn->getledger() > 3501 || txn->getstransaction()->gettxntype() != ttdividend)
-                ret.emplace_back (std::move (txn),
-                    std::make_shared<transactionmetaset> (
-                        txn->getid (), txn->getledger (), rawmeta.getdata ()));
-            }
+            ret.emplace_back (std::move (txn),
+                std::make_shared<transactionmetaset> (
+                    txn->getid (), txn->getledger (), rawmeta.getdata ()));
         }
     }
 
@@ -2173,9 +2257,8 @@ networkopsimp::metatxslist networkopsimp::gettxsaccountb (
     metatxslist ret;
 
     std::uint32_t binary_page_length = 500;
-    std::uint32_t extra_length = 100;
 
-    bool foundresume = token.isnull() || !token.isobject();
+    bool resume = !token.isnull() && token.isobject();
 
     std::uint32_t numberofresults, querylimit;
     if (limit <= 0)
@@ -2184,10 +2267,10 @@ networkopsimp::metatxslist networkopsimp::gettxsaccountb (
         numberofresults = binary_page_length;
     else
         numberofresults = limit;
-    querylimit = numberofresults + 1 + (foundresume ? 0 : extra_length);
+    querylimit = numberofresults + 1;
 
     std::uint32_t findledger = 0, findseq = 0;
-    if (!foundresume)
+    if (resume)
     {
         try
         {
@@ -2204,47 +2287,15 @@ networkopsimp::metatxslist networkopsimp::gettxsaccountb (
 
     token = json::nullvalue;
 
-    //add trans type support
-    std::string txtypesql = "";
-    if (txtype != "")
-    {
-        txtypesql = "and transtype = '" + txtype + "' ";
-    }
-    
-    std::string sql = boost::str (boost::format
-        ("select accounttransactions.ledgerseq,accounttransactions.txnseq,"
-         "status,rawtxn,txnmeta "
-         "from accounttransactions inner join transactions "
-         "on transactions.transid = accounttransactions.transid "
-         "where accounttransactions.account = '%s' "
-         "%s"
-         "and accounttransactions.ledgerseq between '%u' and '%u' "
-         "order by accounttransactions.ledgerseq %s, "
-         "accounttransactions.txnseq %s, accounttransactions.transid %s "
-         "limit %u;")
-             % account.humanaccountid()
-             % txtypesql
-             % ((forward && (findledger != 0)) ? findledger : minledger)
-             % ((!forward && (findledger != 0)) ? findledger: maxledger)
-             % (forward ? "asc" : "desc")
-             % (forward ? "asc" : "desc")
-             % (forward ? "asc" : "desc")
-             % querylimit);
+    std::string sql = accounttxpagesql (account, minledger, maxledger,
+        forward, resume, findledger, findseq, txtype, querylimit);
     {
-        auto db = getapp().gettxndb ().getdb ();
-        auto sl (getapp().gettxndb ().lock ());
+        auto reader (getapp().gettxndb ().getreader ("account_tx"));
+        auto db = reader.get ();
 
         sql_foreach (db, sql)
         {
-            if (!foundresume)
-            {
-                if (findledger == db->getint("ledgerseq") &&
-                    findseq == db->getint("txnseq"))
-                {
-                    foundresume = true;
-                }
-            }
-            else if (numberofresults == 0)
+            if (numberofresults == 0)
             {
                 token = json::objectvalue;
                 token[jss::ledger] = db->getint("ledgerseq");
@@ -2252,40 +2303,37 @@ networkopsimp::metatxslist networkopsimp::gettxsaccountb (
                 break;
             }
 
-            if (foundresume)
-            {
-                int txnsize = 2048;
-                blob rawtxn (txnsize);
-                txnsize = db->getbinary ("rawtxn", &rawtxn[0], rawtxn.size ());
-
-                if (txnsize > rawtxn.size ())
-                {
-                    rawtxn.resize (txnsize);
-                    db->getbinary ("rawtxn", &*rawtxn.begin (), rawtxn.size ());
-                }
-                else
-                    rawtxn.resize (txnsize);
+            int txnsize = 2048;
+            blob rawtxn (txnsize);
+            txnsize = db->getbinary ("rawtxn", &rawtxn[0], rawtxn.size ());
 
-                int metasize = 2048;
-                blob rawmeta (metasize);
-                metasize = db->getbinary (
-                    "txnmeta", &rawmeta[0], rawmeta.size ());
+            if (txnsize > rawtxn.size ())
+            {
+                rawtxn.resize (txnsize);
+                db->getbinary ("rawtxn", &*rawtxn.begin (), rawtxn.size ());
+            }
+            else
+                rawtxn.resize (txnsize);
 
-                if (metasize > rawmeta.size ())
-                {
-                    rawmeta.resize (metasize);
-                    db->getbinary (
-                        "txnmeta", &*rawmeta.begin (), rawmeta.size ());
-                }
-                else
-                {
-                    rawmeta.resize (metasize);
-                }
+            int metasize = 2048;
+            blob rawmeta (metasize);
+            metasize = db->getbinary (
+                "txnmeta", &rawmeta[0], rawmeta.size ());
 
-                ret.emplace_back (strhex (rawtxn), strhex (rawmeta),
-                                  db->getint ("ledgerseq"));
-                --numberofresults;
+            if (metasize > rawmeta.size ())
+            {
+                rawmeta.resize (metasize);
+                db->getbinary (
+                    "txnmeta", &*rawmeta.begin (), rawmeta.size ());
+            }
+            else
+            {
+                rawmeta.resize (metasize);
             }
+
+            ret.emplace_back (strhex (rawtxn), strhex (rawmeta),
+                              db->getint ("ledgerseq"));
+            --numberofresults;
         }
     }
 
@@ -2405,6 +2453,13 @@ json::value networkopsimp::getserverinfo (bool human, bool admin)
     if (admin)
         info[jss::load] = m_job_queue.getjson ();
 
+    if (admin)
+    {
+        json::value onlinedelete = getapp().getshamapstore ().getinfo ();
+        if (!onlinedelete.isnull ())
+            info["online_delete"] = onlinedelete;
+    }
+
     if (!human)
     {
         info[jss::load_base] = getapp().getfeetrack ().getloadbase ();
@@ -2537,27 +2592,19 @@ json::value networkopsimp::pubbootstrapaccountinfo (
 void networkopsimp::pubproposedtransaction (
     ledger::ref lpcurrent, sttx::ref sttxn, ter terresult)
 {
-    json::value jvobj   = transjson (*sttxn, terresult, false, lpcurrent);
-
+    subsnapshot subs;
     {
-        scopedlocktype sl (mlock);
-
-        auto it = msubrttransactions.begin ();
-        while (it != msubrttransactions.end ())
-        {
-            infosub::pointer p = it->second.lock ();
+        std::lock_guard <std::mutex> sl (msublock);
+        subs = msubrttransactions;
+    }
 
-            if (p)
-            {
-                p->send (jvobj, true);
-                ++it;
-            }
-            else
-            {
-                it = msubrttransactions.erase (it);
-            }
-        }
+    if (subs)
+    {
+        json::value jvobj = transjson (*sttxn, terresult, false, lpcurrent);
+        sendsubs (subs, jvobj,
+            std::make_shared <std::string const> (to_string (jvobj)));
     }
+
     acceptedledgertx alt (lpcurrent, sttxn, terresult);
     if (m_journal.trace.active())
         m_journal.trace << "pubproposed: " << alt.getjson ();
@@ -2572,6 +2619,8 @@ void networkopsimp::publedger (ledger::ref accepted)
     auto alpaccepted = acceptedledger::makeacceptedledger (accepted);
     ledger::ref lpaccepted = alpaccepted->getledger ();
 
+    m_dividendmaster->getindex ().onledger (alpaccepted);
+
     {
         scopedlocktype sl (mlock);
 
@@ -2690,124 +2739,136 @@ json::value networkops_transjson(
     return jvobj;
 }
 
+void networkopsimp::sendsubs (subsnapshot const& subs,
+    json::value const& jvobj, infosub::serializedptr const& sobj)
+{
+    // subscribers that are gone unsubscribe as they are destroyed
+    for (auto const& sub : *subs)
+    {
+        if (infosub::pointer p = sub.second.lock ())
+            p->send (jvobj, sobj, true);
+    }
+}
+
 void networkopsimp::pubvalidatedtransaction (
     ledger::ref alaccepted, const acceptedledgertx& altx)
 {
-    json::value jvobj;
+    subsnapshot subs, rtsubs;
+    {
+        std::lock_guard <std::mutex> sl (msublock);
+        subs = msubtransactions;
+        rtsubs = msubrttransactions;
+    }
+
+    if (subs || rtsubs)
+    {
+        json::value jvobj = transjson (
+            *altx.gettxn (), altx.getresult (), true, alaccepted);
+        jvobj[jss::meta] = altx.getmeta ()->getjson (0);
+        auto const sobj = std::make_shared <std::string const> (
+            to_string (jvobj));
+
+        if (subs)
+            sendsubs (subs, jvobj, sobj);
+
+        if (rtsubs)
+            sendsubs (rtsubs, jvobj, sobj);
+    }
+
+    getapp().getorderbookdb ().processtxn (alaccepted, altx);
+    pubaccounttransaction (alaccepted, altx, true);
+}
+
+void networkopsimp::pubaccounttransaction (
+    ledger::ref lpcurrent, const acceptedledgertx& altx, bool baccepted)
+{
+    std::shared_ptr <subindex const> index, rtindex;
+
+    {
+        std::lock_guard <std::mutex> sl (msublock);
+        rtindex = mrtaccountindex;
+        if (baccepted)
+            index = maccountindex;
+    }
+
+    if (!index && !rtindex)
+        return;
 
-    std::string sobj;
-    bool bsobjinitialized = false;
+    // most affected accounts have no subscribers, the filters of the
+    // indexes rule them out without searching
+    std::vector <subsnapshot> subs, rtsubs;
+    int filtered = 0;
+    int missed = 0;
+    int found = 0;
 
+    // each account is counted once: found if either index has it, missed
+    // if it got past a filter but neither has it, filtered otherwise
+    for (auto const& affectedaccount: altx.getaffected ())
     {
-        scopedlocktype sl (mlock);
+        account const id (affectedaccount.getaccountid ());
+        bool searched = false;
+        bool hassubs = false;
 
-        auto it = msubtransactions.begin ();
-        while (it != msubtransactions.end ())
+        if (rtindex && rtindex->maycontain (id))
         {
-            infosub::pointer p = it->second.lock ();
-
-            if (p)
+            searched = true;
+            if (auto snapshot = rtindex->find (id))
             {
-                if (!bsobjinitialized) {
-                    jvobj = transjson (*altx.gettxn (), altx.getresult (), true, alaccepted);
-                    jvobj[jss::meta] = altx.getmeta ()->getjson (0);
-                    sobj = to_string (jvobj);
-                    bsobjinitialized = true;
-                }
-                p->send (jvobj, sobj, true);
-                ++it;
+                rtsubs.push_back (*snapshot);
+                hassubs = true;
             }
-            else
-                it = msubtransactions.erase (it);
         }
 
-        it = msubrttransactions.begin ();
-
-        while (it != msubrttransactions.end ())
+        if (index && index->maycontain (id))
         {
-            infosub::pointer p = it->second.lock ();
-
-            if (p)
+            searched = true;
+            if (auto snapshot = index->find (id))
             {
-                if (!bsobjinitialized) {
-                    jvobj = transjson (*altx.gettxn (), altx.getresult (), true, alaccepted);
-                    jvobj[jss::meta] = altx.getmeta ()->getjson (0);
-                    sobj = to_string (jvobj);
-                    bsobjinitialized = true;
-                }
-                p->send (jvobj, sobj, true);
-                ++it;
+                subs.push_back (*snapshot);
+                hassubs = true;
             }
-            else
-                it = msubrttransactions.erase (it);
         }
+
+        if (hassubs)
+            ++found;
+        else if (searched)
+            ++missed;
+        else
+            ++filtered;
     }
-    getapp().getorderbookdb ().processtxn (alaccepted, altx);
-    pubaccounttransaction (alaccepted, altx, true);
-}
 
-void networkopsimp::pubaccounttransaction (
-    ledger::ref lpcurrent, const acceptedledgertx& altx, bool baccepted)
-{
+    m_stats.account_filtered.increment (filtered);
+    m_stats.account_missed.increment (missed);
+    m_stats.account_found.increment (found);
+
     hash_set<infosub::pointer>  notify;
     int                             iproposed   = 0;
     int                             iaccepted   = 0;
 
+    for (auto const& snapshot : rtsubs)
     {
-        scopedlocktype sl (mlock);
-
-        if (!baccepted && msubrtaccount.empty ()) return;
-
-        if (!msubaccount.empty () || (!msubrtaccount.empty ()) )
+        for (auto const& sub : *snapshot)
         {
-            for (auto const& affectedaccount: altx.getaffected ())
+            if (infosub::pointer p = sub.second.lock ())
             {
-                auto simiit
-                        = msubrtaccount.find (affectedaccount.getaccountid ());
-                if (simiit != msubrtaccount.end ())
-                {
-                    auto it = simiit->second.begin ();
-
-                    while (it != simiit->second.end ())
-                    {
-                        infosub::pointer p = it->second.lock ();
-
-                        if (p)
-                        {
-                            notify.insert (p);
-                            ++it;
-                            ++iproposed;
-                        }
-                        else
-                            it = simiit->second.erase (it);
-                    }
-                }
-
-                if (baccepted)
-                {
-                    simiit  = msubaccount.find (affectedaccount.getaccountid ());
+                notify.insert (p);
+                ++iproposed;
+            }
+        }
+    }
 
-                    if (simiit != msubaccount.end ())
-                    {
-                        auto it = simiit->second.begin ();
-                        while (it != simiit->second.end ())
-                        {
-                            infosub::pointer p = it->second.lock ();
-
-                            if (p)
-                            {
-                                notify.insert (p);
-                                ++it;
-                                ++iaccepted;
-                            }
-                            else
-                                it = simiit->second.erase (it);
-                        }
-                    }
-                }
+    for (auto const& snapshot : subs)
+    {
+        for (auto const& sub : *snapshot)
+        {
+            if (infosub::pointer p = sub.second.lock ())
+            {
+                notify.insert (p);
+                ++iaccepted;
             }
         }
     }
+
     m_journal.debug << "pubaccounttransaction:" <<
         " iproposed=" << iproposed <<
         " iaccepted=" << iaccepted;
@@ -2820,12 +2881,11 @@ void networkopsimp::pubaccounttransaction (
         if (altx.isapplied ())
             jvobj[jss::meta] = altx.getmeta ()->getjson (0);
 
-        std::string sobj = to_string (jvobj);
+        auto const sobj = std::make_shared <std::string const> (
+            to_string (jvobj));
 
-        boost_foreach (infosub::ref isrlistener, notify)
-        {
+        for (auto const& isrlistener : notify)
             isrlistener->send (jvobj, sobj, true);
-        }
     }
 }
 
@@ -2848,25 +2908,14 @@ void networkopsimp::subaccount (infosub::ref isrlistener,
         isrlistener->insertsubaccountinfo (naaccountid, uledgerindex);
     }
 
-    scopedlocktype sl (mlock);
+    std::lock_guard <std::mutex> sl (msublock);
 
     boost_foreach (const rippleaddress & naaccountid, vnaaccountids)
     {
-        auto simiterator = submap.find (naaccountid.getaccountid ());
-        if (simiterator == submap.end ())
-        {
-            // not found, note that account has a new single listner.
-            submaptype  usiselement;
-            usiselement[isrlistener->getseq ()] = isrlistener;
-            submap.insert (simiterator, make_pair (naaccountid.getaccountid (),
-                                                   usiselement));
-        }
-        else
-        {
-            // found, note that the account has another listener.
-            simiterator->second[isrlistener->getseq ()] = isrlistener;
-        }
+        addsub (submap[naaccountid.getaccountid ()], isrlistener);
     }
+
+    (rt ? mrtaccountindex : maccountindex) = makesubindex (submap);
 }
 
 void networkopsimp::unsubaccount (
@@ -2883,7 +2932,7 @@ void networkopsimp::unsubaccount (
     //  isrlistener->deletesubaccountinfo(naaccountid);
     // }
 
-    scopedlocktype sl (mlock);
+    std::lock_guard <std::mutex> sl (msublock);
 
     for (auto const& naaccountid : vnaaccountids)
     {
@@ -2892,15 +2941,28 @@ void networkopsimp::unsubaccount (
         if (simiterator != submap.end ())
         {
             // found
-            simiterator->second.erase (useq);
+            removesub (simiterator->second, useq);
 
-            if (simiterator->second.empty ())
+            if (!simiterator->second)
             {
                 // don't need hash entry.
                 submap.erase (simiterator);
             }
         }
     }
+
+    (rt ? mrtaccountindex : maccountindex) = makesubindex (submap);
+}
+
+std::shared_ptr <networkopsimp::subindex const>
+networkopsimp::makesubindex (subinfomaptype const& submap)
+{
+    // an index without accounts is left null
+    if (submap.empty ())
+        return nullptr;
+
+    std::vector <subindex::entry> entries (submap.begin (), submap.end ());
+    return std::make_shared <subindex const> (std::move (entries));
 }
 
 bool networkopsimp::subbook (infosub::ref isrlistener, book const& book)
@@ -3016,34 +3078,66 @@ bool networkopsimp::unsubserver (std::uint64_t useq)
     return msubserver.erase (useq);
 }
 
+// <-- bool: true=added, false=already there
+bool networkopsimp::addsub (subsnapshot& subs, infosub::ref isplistener)
+{
+    // called with msublock held
+    if (subs && subs->count (isplistener->getseq ()))
+        return false;
+
+    auto next = subs
+        ? std::make_shared <submaptype> (*subs)
+        : std::make_shared <submaptype> ();
+    next->emplace (isplistener->getseq (), isplistener);
+    subs = std::move (next);
+    return true;
+}
+
+// <-- bool: true=erased, false=was not there
+bool networkopsimp::removesub (subsnapshot& subs, std::uint64_t ulistener)
+{
+    // called with msublock held, an empty set is left null
+    if (!subs || !subs->count (ulistener))
+        return false;
+
+    if (subs->size () == 1)
+    {
+        subs.reset ();
+        return true;
+    }
+
+    auto next = std::make_shared <submaptype> (*subs);
+    next->erase (ulistener);
+    subs = std::move (next);
+    return true;
+}
+
 // <-- bool: true=added, false=already there
 bool networkopsimp::subtransactions (infosub::ref isrlistener)
 {
-    scopedlocktype sl (mlock);
-    return msubtransactions.emplace (
-        isrlistener->getseq (), isrlistener).second;
+    std::lock_guard <std::mutex> sl (msublock);
+    return addsub (msubtransactions, isrlistener);
 }
 
 // <-- bool: true=erased, false=was not there
 bool networkopsimp::unsubtransactions (std::uint64_t useq)
 {
-    scopedlocktype sl (mlock);
-    return msubtransactions.erase (useq);
+    std::lock_guard <std::mutex> sl (msublock);
+    return removesub (msubtransactions, useq);
 }
 
 // <-- bool: true=added, false=already there
 bool networkopsimp::subrttransactions (infosub::ref isrlistener)
 {
-    scopedlocktype sl (mlock);
-    return msubrttransactions.emplace (
-        isrlistener->getseq (), isrlistener).second;
+    std::lock_guard <std::mutex> sl (msublock);
+    return addsub (msubrttransactions, isrlistener);
 }
 
 // <-- bool: true=erased, false=was not there
 bool networkopsimp::unsubrttransactions (std::uint64_t useq)
 {
-    scopedlocktype sl (mlock);
-    return msubrttransactions.erase (useq);
+    std::lock_guard <std::mutex> sl (msublock);
+    return removesub (msubrttransactions, useq);
 }
 
 infosub::pointer networkopsimp::findrpcsub (std::string const& strurl)
@@ -3591,14 +3685,9 @@ bool networkopsimp::getfetchpack (uint256 const& hash, blob& data)
     if (!ret)
         return false;
 
+    // entries are checked against their hashes when they are added
     mfetchpack.del (hash, false);
 
-    if (hash != serializer::getsha512half (data))
-    {
-        m_journal.warning << "bad entry in fetch pack";
-        return false;
-    }
-
     return true;
 }
 
@@ -3660,10 +3749,11 @@ networkops::~networkops ()
 std::unique_ptr<networkops>
 make_networkops (networkops::clock_type& clock, bool standalone,
     std::size_t network_quorum, jobqueue& job_queue, ledgermaster& ledgermaster,
-    beast::stoppable& parent, beast::journal journal)
+    beast::stoppable& parent, beast::insight::collector::ptr const& collector,
+    beast::journal journal)
 {
     return std::make_unique<networkopsimp> (clock, standalone, network_quorum,
-        job_queue, ledgermaster, parent, journal);
+        job_queue, ledgermaster, parent, collector, journal);
 }
 
 } // ripple
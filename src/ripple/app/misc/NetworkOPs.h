@@ -26,6 +26,7 @@
 #include <ripple/app/ledger/ledgerproposal.h>
 #include <ripple/net/infosub.h>
 #include <beast/cxx14/memory.h> // <memory>
+#include <beast/insight/collector.h>
 #include <beast/threads/stoppable.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <tuple>
@@ -236,6 +237,7 @@ public:
 
     virtual bool shouldfetchpack (std::uint32_t seq) = 0;
     virtual void gotfetchpack (bool progress, std::uint32_t seq) = 0;
+    /** adds an object of a fetch pack, data must hash to hash. */
     virtual void addfetchpack (
         uint256 const& hash, std::shared_ptr< blob >& data) = 0;
     virtual bool getfetchpack (uint256 const& hash, blob& data) = 0;
@@ -337,7 +339,8 @@ public:
 std::unique_ptr<networkops>
 make_networkops (networkops::clock_type& clock, bool standalone,
     std::size_t network_quorum, jobqueue& job_queue, ledgermaster& ledgermaster,
-    beast::stoppable& parent, beast::journal journal);
+    beast::stoppable& parent, beast::insight::collector::ptr const& collector,
+    beast::journal journal);
 
 json::value networkops_transjson (
     const sttx& sttxn, ter terresult, bool bvalidated,
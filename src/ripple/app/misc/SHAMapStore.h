@@ -23,6 +23,7 @@
 #include <ripple/app/ledger/ledger.h>
 #include <ripple/app/tx/transactionmaster.h>
 #include <ripple/core/config.h>
+#include <ripple/json/json_value.h>
 #include <ripple/nodestore/manager.h>
 #include <ripple/nodestore/scheduler.h>
 #include <ripple/protocol/errorcodes.h>
@@ -49,6 +50,12 @@ public:
         std::uint32_t deletebatch = 100;
         std::uint32_t backoff = 100;
         std::int32_t agethreshold = 60;
+        // threads that copy branches of the state map during rotation
+        std::uint32_t copythreads = 4;
+        // nodes read and written together during rotation
+        std::uint32_t copybatch = 256;
+        // nodes copied per second during rotation, 0 for no limit
+        std::uint32_t copyrate = 0;
     };
 
     shamapstore (stoppable& parent) : stoppable ("shamapstore", parent) {}
@@ -72,6 +79,9 @@ public:
 
     /** highest ledger that may be deleted. */
     virtual ledgerindex getcandelete() = 0;
+
+    /** the progress of online delete, for server_info. */
+    virtual json::value getinfo() = 0;
 };
 
 //------------------------------------------------------------------------------
@@ -21,8 +21,10 @@
 #include <ripple/app/misc/shamapstoreimp.h>
 #include <ripple/app/ledger/ledgermaster.h>
 #include <ripple/app/main/application.h>
+#include <ripple/core/paralleljobs.h>
 #include <boost/format.hpp>
 #include <beast/cxx14/memory.h> // <memory>
+#include <algorithm>
 
 namespace ripple {
 
@@ -86,6 +88,30 @@ shamapstoreimp::savedstatedb::init (std::string const& databasepath,
                 "insert into candelete values (1, 0);";
         checkerror (error);
     }
+
+    session_.once (error) <<
+            "create table if not exists rotation ("
+            "  key                    integer primary key,"
+            "  ledgerseq              integer,"
+            "  ledgerhash             text,"
+            "  copiedbranches         integer"
+            ");"
+            ;
+    checkerror (error);
+
+    st = (session_.prepare <<
+            "select count(key) from rotation where key = 1;"
+            , beast::sqdb::into (count)
+            );
+    st.execute_and_fetch (error);
+    checkerror (error);
+
+    if (!count)
+    {
+        session_.once (error) <<
+                "insert into rotation values (1, 0, '', 0);";
+        checkerror (error);
+    }
 }
 
 ledgerindex
@@ -182,6 +208,49 @@ shamapstoreimp::savedstatedb::setlastrotated (ledgerindex seq)
     checkerror (error);
 }
 
+shamapstoreimp::savedrotation
+shamapstoreimp::savedstatedb::getrotation()
+{
+    beast::error error;
+    savedrotation rotation;
+
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+
+        session_.once (error) <<
+                "select ledgerseq, ledgerhash, copiedbranches"
+                " from rotation where key = 1;"
+                , beast::sqdb::into (rotation.ledgerseq)
+                , beast::sqdb::into (rotation.ledgerhash)
+                , beast::sqdb::into (rotation.copiedbranches)
+                ;
+    }
+    checkerror (error);
+
+    return rotation;
+}
+
+void
+shamapstoreimp::savedstatedb::setrotation (savedrotation const& rotation)
+{
+    beast::error error;
+
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        session_.once (error) <<
+                "update rotation"
+                " set ledgerseq = ?,"
+                " ledgerhash = ?,"
+                " copiedbranches = ?"
+                " where key = 1;"
+                , beast::sqdb::use (rotation.ledgerseq)
+                , beast::sqdb::use (rotation.ledgerhash)
+                , beast::sqdb::use (rotation.copiedbranches)
+                ;
+    }
+    checkerror (error);
+}
+
 void
 shamapstoreimp::savedstatedb::checkerror (beast::error const& error)
 {
@@ -276,25 +345,175 @@ shamapstoreimp::onledgerclosed (ledger::pointer validatedledger)
     cond_.notify_one();
 }
 
+json::value
+shamapstoreimp::getinfo()
+{
+    if (!setup_.deleteinterval)
+        return json::value();
+
+    static char const* const phases[] = {
+        "idle", "clearing", "copying", "freshening", "rotating" };
+
+    json::value info (json::objectvalue);
+    int const phase = phase_;
+    info["state"] = phases[phase];
+    info["last_rotated"] = lastrotated_.load();
+
+    if (phase == copying)
+    {
+        std::uint32_t const copied = copiedbranches_;
+        int branches = 0;
+        for (std::uint32_t bit = copied; bit; bit &= bit - 1)
+            ++branches;
+
+        json::value copy (json::objectvalue);
+        copy["ledger"] = copyseq_.load();
+        copy["branches"] = branches;
+        copy["nodes_checked"] = static_cast <json::uint> (nodeschecked_);
+        copy["nodes_copied"] = static_cast <json::uint> (nodescopied_);
+        info["copy"] = copy;
+    }
+
+    return info;
+}
+
+void
+shamapstoreimp::ratelimiter::wait (std::size_t count)
+{
+    if (!rate_)
+        return;
+
+    clock_type::time_point when;
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        clock_type::time_point const now = clock_type::now();
+        if (next_ < now)
+            next_ = now;
+        when = next_;
+        next_ += std::chrono::duration_cast <clock_type::duration> (
+                std::chrono::duration <double> (double (count) / rate_));
+    }
+
+    std::this_thread::sleep_until (when);
+}
+
 bool
-shamapstoreimp::copynode (std::uint64_t& nodecount,
-        shamaptreenode const& node)
+shamapstoreimp::copystate (ledger::pointer const& ledger,
+        std::uint32_t copiedbranches)
 {
-    // copy a single record from node to database_
-    database_->fetchnode (node.getnodehash());
-    if (! (++nodecount % checkhealthinterval_))
+    uint256 const roothash = ledger->peekaccountstatemap()->gethash();
+
+    rotation_ = savedrotation {ledger->getledgerseq(),
+            to_string (ledger->gethash()), copiedbranches};
+    state_db_.setrotation (rotation_);
+
+    copyseq_ = rotation_.ledgerseq;
+    copiedbranches_ = copiedbranches;
+    nodeschecked_ = 0;
+    nodescopied_ = 0;
+
+    std::vector <nodeobject::ptr> objects;
+    nodescopied_ += database_->copynodes (
+            std::vector <uint256> (1, roothash), objects);
+    ++nodeschecked_;
+
+    if (!objects[0])
     {
-        if (health())
-            return true;
+        journal_.error << "copying ledger " << copyseq_ << ": missing root";
+        return false;
     }
 
-    return false;
+    shamaptreenode::pointer root = shamaptreenode::createfromraw (
+            objects[0]->getdata(), 0, snfprefix, roothash, true);
+    if (!root->isinner())
+        return false;
+
+    ratelimiter limiter (setup_.copyrate);
+    std::atomic <bool> aborted (false);
+    std::thread::id const rotationthread = std::this_thread::get_id();
+
+    try
+    {
+        runparalleljobs (getapp().getjobqueue(), jtnodecopy, "shamapstore::copy", 16,
+            setup_.copythreads,
+            [&](std::size_t branch)
+            {
+                std::uint32_t const bit = 1 << branch;
+                if (aborted || (copiedbranches_ & bit))
+                    return;
+
+                if (!root->isemptybranch (branch))
+                {
+                    copybranch (root->getchildhash (branch), limiter, aborted,
+                            std::this_thread::get_id() == rotationthread);
+                    if (aborted)
+                        return;
+                }
+
+                std::lock_guard <std::mutex> lock (copymutex_);
+                rotation_.copiedbranches |= bit;
+                copiedbranches_ = rotation_.copiedbranches;
+                state_db_.setrotation (rotation_);
+            });
+    }
+    catch (std::exception const& e)
+    {
+        journal_.error << "copying ledger " << copyseq_ << ": " << e.what();
+        return false;
+    }
+
+    return !aborted && copiedbranches_ == 0xffff;
+}
+
+void
+shamapstoreimp::copybranch (uint256 const& top, ratelimiter& limiter,
+        std::atomic <bool>& aborted, bool checkhealth)
+{
+    // depth first, a batch at a time, so few hashes wait to be copied
+    std::vector <uint256> pending (1, top);
+    std::vector <uint256> hashes;
+    std::vector <nodeobject::ptr> objects;
+
+    while (!pending.empty() && !aborted)
+    {
+        std::size_t const count = std::min <std::size_t> (
+                pending.size(), std::max <std::uint32_t> (setup_.copybatch, 1));
+        hashes.assign (pending.end() - count, pending.end());
+        pending.resize (pending.size() - count);
+
+        limiter.wait (count);
+        nodescopied_ += database_->copynodes (hashes, objects);
+        nodeschecked_ += count;
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (!objects[i])
+                throw std::runtime_error (
+                        "missing node " + to_string (hashes[i]));
+
+            shamaptreenode::pointer node = shamaptreenode::createfromraw (
+                    objects[i]->getdata(), 0, snfprefix, hashes[i], true);
+
+            if (node->isinner())
+            {
+                for (int branch = 0; branch < 16; ++branch)
+                {
+                    if (!node->isemptybranch (branch))
+                        pending.push_back (node->getchildhash (branch));
+                }
+            }
+        }
+
+        if (checkhealth && health() != health::ok)
+            aborted = true;
+    }
 }
 
 void
 shamapstoreimp::run()
 {
     ledgerindex lastrotated = state_db_.getstate().lastrotated;
+    lastrotated_ = lastrotated;
     netops_ = &getapp().getops();
     ledgermaster_ = &getapp().getledgermaster();
     fullbelowcache_ = &getapp().getfullbelowcache();
@@ -305,6 +524,7 @@ shamapstoreimp::run()
     while (1)
     {
         healthy_ = true;
+        phase_ = idle;
         validatedledger_.reset();
 
         std::unique_lock <std::mutex> lock (mutex_);
@@ -324,6 +544,7 @@ shamapstoreimp::run()
         if (!lastrotated)
         {
             lastrotated = validatedseq;
+            lastrotated_ = lastrotated;
             state_db_.setlastrotated (lastrotated);
         }
         ledgerindex candelete = std::numeric_limits <ledgerindex>::max();
@@ -350,6 +571,7 @@ shamapstoreimp::run()
                     ;
             }
 
+            phase_ = clearing;
             clearprior (lastrotated);
             switch (health())
             {
@@ -363,13 +585,32 @@ shamapstoreimp::run()
                     ;
             }
 
-            std::uint64_t nodecount = 0;
-            validatedledger_->peekaccountstatemap()->snapshot (
-                    false)->visitnodes (
-                    std::bind (&shamapstoreimp::copynode, this,
-                    std::ref(nodecount), std::placeholders::_1));
-            journal_.debug << "copied ledger " << validatedseq
-                    << " nodecount " << nodecount;
+            // resume a copy interrupted by a restart or by poor health,
+            // if its ledger is still at hand
+            ledger::pointer copyledger = validatedledger_;
+            std::uint32_t copiedbranches = 0;
+            savedrotation rotation = state_db_.getrotation();
+            if (rotation.ledgerseq > lastrotated &&
+                    rotation.ledgerseq <= validatedseq)
+            {
+                uint256 hash;
+                ledger::pointer resumed;
+                if (hash.sethex (rotation.ledgerhash))
+                    resumed = ledgermaster_->getledgerbyhash (hash);
+                if (resumed && resumed->getledgerseq() == rotation.ledgerseq)
+                {
+                    copyledger = resumed;
+                    copiedbranches = rotation.copiedbranches;
+                    journal_.debug << "resuming copy of ledger "
+                            << rotation.ledgerseq;
+                }
+            }
+
+            phase_ = copying;
+            bool const copied = copystate (copyledger, copiedbranches);
+            journal_.debug << "copied ledger " << copyledger->getledgerseq()
+                    << " nodes checked " << nodeschecked_
+                    << " nodes copied " << nodescopied_;
             switch (health())
             {
                 case health::stopping:
@@ -381,7 +622,10 @@ shamapstoreimp::run()
                 default:
                     ;
             }
+            if (!copied)
+                continue;
 
+            phase_ = freshening;
             freshencaches();
             journal_.debug << validatedseq << " freshened caches";
             switch (health())
@@ -396,6 +640,7 @@ shamapstoreimp::run()
                     ;
             }
 
+            phase_ = rotating;
             std::shared_ptr <nodestore::backend> newbackend =
                     makebackendrotating();
             journal_.debug << validatedseq << " new backend "
@@ -417,16 +662,18 @@ shamapstoreimp::run()
 
             std::string nextarchivedir =
                     database_->getwritablebackend()->getname();
-            lastrotated = validatedseq;
+            lastrotated = copyledger->getledgerseq();
             {
                 std::lock_guard <std::mutex> lock (database_->peekmutex());
 
                 state_db_.setstate (savedstate {newbackend->getname(),
                         nextarchivedir, lastrotated});
+                state_db_.setrotation (savedrotation {0, "", 0});
                 clearcaches (validatedseq);
                 oldbackend = database_->rotatebackends (newbackend);
             }
-            journal_.debug << "finished rotation " << validatedseq;
+            lastrotated_ = lastrotated;
+            journal_.debug << "finished rotation " << lastrotated;
 
             oldbackend->setdeletepath();
         }
@@ -707,6 +954,15 @@ setup_shamapstore (config const& c)
         setup.backoff = c.nodedatabase["backoff"].getintvalue();
     if (c.nodedatabase["age_threshold"].isnotempty())
         setup.agethreshold = c.nodedatabase["age_threshold"].getintvalue();
+    if (c.nodedatabase["copy_threads"].isnotempty())
+        setup.copythreads = std::max (1,
+            c.nodedatabase["copy_threads"].getintvalue());
+    if (c.nodedatabase["copy_batch"].isnotempty())
+        setup.copybatch = std::max (1,
+            c.nodedatabase["copy_batch"].getintvalue());
+    if (c.nodedatabase["copy_rate"].isnotempty())
+        setup.copyrate = std::max (0,
+            c.nodedatabase["copy_rate"].getintvalue());
 
     return setup;
 }
@@ -26,6 +26,8 @@
 #include <ripple/nodestore/databaserotating.h>
 #include <beast/module/sqdb/sqdb.h>
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <condition_variable>
 
@@ -43,6 +45,43 @@ private:
         ledgerindex lastrotated;
     };
 
+    // a rotation whose copy has started, so it can resume after a restart
+    struct savedrotation
+    {
+        ledgerindex ledgerseq;
+        std::string ledgerhash;
+        std::uint32_t copiedbranches;
+    };
+
+    enum phase : int
+    {
+        idle = 0,
+        clearing,
+        copying,
+        freshening,
+        rotating
+    };
+
+    // spaces out the nodes checked by the threads copying a state map
+    class ratelimiter
+    {
+    public:
+        explicit ratelimiter (std::uint32_t rate)
+            : rate_ (rate)
+        {
+        }
+
+        // wait until another count nodes may be checked
+        void wait (std::size_t count);
+
+    private:
+        typedef std::chrono::steady_clock clock_type;
+
+        std::uint32_t const rate_;
+        std::mutex mutex_;
+        clock_type::time_point next_ = clock_type::now();
+    };
+
     enum health : std::uint8_t
     {
         ok = 0,
@@ -69,6 +108,8 @@ private:
         savedstate getstate();
         void setstate (savedstate const& state);
         void setlastrotated (ledgerindex seq);
+        savedrotation getrotation();
+        void setrotation (savedrotation const& rotation);
         void checkerror (beast::error const& error);
     };
 
@@ -89,7 +130,17 @@ private:
     savedstatedb state_db_;
     std::thread thread_;
     bool stop_ = false;
-    bool healthy_ = true;
+    std::atomic <bool> healthy_ {true};
+    // progress of the current rotation, for getinfo
+    std::atomic <int> phase_ {idle};
+    std::atomic <ledgerindex> lastrotated_ {0};
+    std::atomic <ledgerindex> copyseq_ {0};
+    std::atomic <std::uint32_t> copiedbranches_ {0};
+    std::atomic <std::uint64_t> nodeschecked_ {0};
+    std::atomic <std::uint64_t> nodescopied_ {0};
+    // the rotation being copied, guarded by copymutex_
+    std::mutex copymutex_;
+    savedrotation rotation_;
     mutable std::condition_variable cond_;
     mutable std::mutex mutex_;
     ledger::pointer newledger_;
@@ -154,9 +205,25 @@ public:
 
     void onledgerclosed (ledger::pointer validatedledger) override;
 
+    json::value getinfo() override;
+
 private:
-    // callback for visitnodes
-    bool copynode (std::uint64_t& nodecount, shamaptreenode const &node);
+    /** copy the state map of a ledger into the writable backend.
+     *  the branches of the root are walked as parallel jobs, whose
+     *  nodes are checked and copied in batches. branches already copied
+     *  are skipped and each one finished is saved, so a rotation resumes
+     *  where it was after a restart.
+     *
+     *  @return true if every branch was copied.
+     */
+    bool copystate (ledger::pointer const& ledger,
+            std::uint32_t copiedbranches);
+    /** copy the subtree below a node, reading it through copynodes only,
+     *  so nothing is copied as a side effect of walking the tree.
+     *  health is checked after each batch if checkhealth is set.
+     */
+    void copybranch (uint256 const& top, ratelimiter& limiter,
+            std::atomic <bool>& aborted, bool checkhealth);
     void run();
     void dbpaths();
     std::shared_ptr <nodestore::backend> makebackendrotating (
@@ -0,0 +1,97 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#include <beastconfig.h>
+#include <ripple/app/misc/sigverifier.h>
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace ripple {
+
+sigverifier::sigverifier (jobqueue& jobqueue, ihashrouter& router,
+        std::size_t batchsize)
+    : jobqueue_ (jobqueue)
+    , router_ (router)
+    , batchsize_ (batchsize)
+{
+    assert (batchsize_ > 0);
+}
+
+void
+sigverifier::verify (sttx::pointer const& stx, handler h)
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    pending_.push_back ({ stx, std::move (h) });
+
+    // one job for every batch waiting
+    if (pending_.size () > jobs_ * batchsize_)
+        addjob ();
+}
+
+std::size_t
+sigverifier::pending () const
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    return pending_.size ();
+}
+
+void
+sigverifier::addjob ()
+{
+    ++jobs_;
+    jobqueue_.addjob (jttransaction, "sigverifier::dobatch",
+        std::bind (&sigverifier::dobatch, this, std::placeholders::_1));
+}
+
+void
+sigverifier::dobatch (job& job)
+{
+    std::vector <item> batch;
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+        assert (jobs_ > 0);
+        --jobs_;
+
+        std::size_t const n = std::min (batchsize_, pending_.size ());
+        batch.reserve (n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            batch.push_back (std::move (pending_.front ()));
+            pending_.pop_front ();
+        }
+
+        if (pending_.size () > jobs_ * batchsize_)
+            addjob ();
+    }
+
+    // the verdict is kept in the transaction, so the checks the handlers
+    // make do not verify the signature again
+    for (auto const& i : batch)
+    {
+        router_.setflag (i.stx->gettransactionid (),
+            i.stx->checksign () ? sf_siggood : sf_bad);
+    }
+
+    for (auto& i : batch)
+        i.h (job);
+}
+
+}
@@ -0,0 +1,89 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#ifndef ripple_app_sigverifier_h_included
+#define ripple_app_sigverifier_h_included
+
+#include <ripple/app/misc/ihashrouter.h>
+#include <ripple/core/jobqueue.h>
+#include <ripple/protocol/sttx.h>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace ripple {
+
+/** checks the signatures of transactions from peers in batches.
+
+    transactions wait in a queue as they arrive. a transaction job takes
+    a batch of them, checks each signature, records the verdict in the
+    hash router flags and in the transaction, then hands each one on.
+    another job is added whenever a full batch is waiting, so a flood of
+    transactions spreads over the job queue threads a batch at a time
+    instead of a job per transaction.
+*/
+class sigverifier
+{
+public:
+    /** called from the job with the verdict already recorded. */
+    typedef std::function <void (job&)> handler;
+
+    sigverifier (jobqueue& jobqueue, ihashrouter& router,
+        std::size_t batchsize = 64);
+
+    sigverifier (sigverifier const&) = delete;
+    sigverifier& operator= (sigverifier const&) = delete;
+
+    /** queues a transaction whose signature has not been checked. */
+    void
+    verify (sttx::pointer const& stx, handler h);
+
+    /** the transactions waiting for a job. */
+    std::size_t
+    pending () const;
+
+private:
+    struct item
+    {
+        sttx::pointer stx;
+        handler h;
+    };
+
+    void
+    addjob ();
+
+    void
+    dobatch (job& job);
+
+    jobqueue& jobqueue_;
+    ihashrouter& router_;
+    std::size_t const batchsize_;
+
+    std::mutex mutable mutex_;
+    std::deque <item> pending_;
+
+    // jobs added that have not taken their batch yet
+    std::size_t jobs_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,103 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#include <beastconfig.h>
+#include <ripple/app/misc/accountsubindex.h>
+#include <beast/random/rngfill.h>
+#include <beast/random/xor_shift_engine.h>
+#include <beast/unit_test/suite.h>
+
+namespace ripple {
+
+class accountsubindex_test : public beast::unit_test::suite
+{
+public:
+    typedef accountsubindex <int> index_type;
+
+    static account
+    randomaccount (beast::xor_shift_engine& g)
+    {
+        account id;
+        beast::rngfill (id.begin (), id.size (), g);
+        return id;
+    }
+
+    void
+    testempty ()
+    {
+        testcase ("empty");
+
+        beast::xor_shift_engine g (1);
+        index_type index;
+        expect (index.empty ());
+        expect (!index.maycontain (randomaccount (g)));
+
+        index_type built ((std::vector <index_type::entry> ()));
+        expect (built.empty ());
+        expect (!built.maycontain (randomaccount (g)));
+    }
+
+    void
+    testlookup ()
+    {
+        testcase ("lookup");
+
+        beast::xor_shift_engine g (2);
+        std::vector <index_type::entry> entries;
+        for (int i = 0; i < 1000; ++i)
+            entries.emplace_back (randomaccount (g), i);
+
+        index_type const index (entries);
+        expect (index.size () == entries.size ());
+
+        for (auto const& e : entries)
+        {
+            expect (index.maycontain (e.first), "filter missed an account");
+            auto const found = index.find (e.first);
+            expect (found && *found == e.second, "wrong entry");
+        }
+
+        int passed = 0;
+        int const tries = 100000;
+        for (int i = 0; i < tries; ++i)
+        {
+            account const id (randomaccount (g));
+            if (index.maycontain (id))
+            {
+                ++passed;
+                expect (index.find (id) == nullptr, "found a missing account");
+            }
+        }
+
+        // about one in four hundred should get past the filter
+        log << passed << " of " << tries << " missing accounts passed";
+        expect (passed < tries / 100, "filter passes too many accounts");
+    }
+
+    void
+    run ()
+    {
+        testempty ();
+        testlookup ();
+    }
+};
+
+beast_define_testsuite(accountsubindex,ripple_app,ripple);
+
+} // ripple
@@ -0,0 +1,233 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#include <beastconfig.h>
+#include <ripple/app/misc/dividendindex.h>
+#include <ripple/app/misc/dividendmaster.h>
+#include <ripple/app/ledger/ledgertestsuite.h>
+#include <ripple/core/jobqueue.h>
+#include <ripple/protocol/systemparameters.h>
+#include <beast/insight/nullcollector.h>
+#include <beast/threads/stoppable.h>
+#include <chrono>
+#include <thread>
+
+namespace ripple {
+
+// follows ledgers built from payments and referee chains with the dividend
+// index, and checks it holds the inputs a walk of each ledger collects.
+class dividendindex_test : public ledgertestsuite
+{
+public:
+    static std::uint64_t const vbc = system_currency_parts_vbc;
+
+    sttx::pointer
+    paymentvbc (testaccount& from, testaccount const& to,
+        std::uint64_t drops)
+    {
+        json::value tx_json;
+        tx_json["transactiontype"] = "payment";
+        tx_json["destination"] = to.publickey.humanaccountid ();
+        json::value& amount = tx_json["amount"];
+        amount["value"] = std::to_string (drops);
+        amount["currency"] = "vbc";
+        return signtransaction (from, tx_json);
+    }
+
+    sttx::pointer
+    addreferee (testaccount& reference, testaccount const& referee)
+    {
+        json::value tx_json;
+        tx_json["transactiontype"] = "addreferee";
+        tx_json["destination"] = referee.publickey.humanaccountid ();
+        return signtransaction (reference, tx_json);
+    }
+
+    static bool
+    same (dividendaccounts const& lhs, dividendaccounts const& rhs)
+    {
+        if (lhs.size () != rhs.size ())
+            return false;
+
+        for (std::size_t i = 0; i < lhs.size (); ++i)
+        {
+            if (lhs[i].id != rhs[i].id || lhs[i].parent != rhs[i].parent ||
+                lhs[i].height != rhs[i].height ||
+                lhs[i].balance != rhs[i].balance ||
+                lhs[i].vrank != rhs[i].vrank)
+                return false;
+        }
+
+        return true;
+    }
+
+    // the index seeds itself in a job, so its inputs can take a while
+    static bool
+    waitinputs (dividendindex& index, std::uint32_t seq,
+        dividendaccounts& accounts, std::uint64_t& sumvrank)
+    {
+        for (int i = 0; i < 3000; ++i)
+        {
+            if (index.getinputs (seq, accounts, sumvrank))
+                return true;
+            std::this_thread::sleep_for (std::chrono::milliseconds (10));
+        }
+        return false;
+    }
+
+    void
+    check (dividendindex& index, ledger::ref ledger)
+    {
+        std::string const seq = std::to_string (ledger->getledgerseq ());
+
+        dividendaccounts indexed;
+        std::uint64_t indexedsum = 0;
+        if (!expect (waitinputs (index, ledger->getledgerseq (), indexed,
+                indexedsum), "no inputs for ledger " + seq))
+            return;
+
+        dividendaccounts collected;
+        std::uint64_t collectedsum = 0;
+        dividendmaster::collectdividendinputs (ledger, collected,
+            collectedsum);
+
+        expect (same (indexed, collected), "inputs differ at ledger " + seq);
+        expect (indexedsum == collectedsum,
+            "rank sum differs at ledger " + seq);
+    }
+
+    void
+    run ()
+    {
+        beast::journal const j;
+        beast::rootstoppable stoppable ("dividendindex_test");
+        auto jobqueue = make_jobqueue (beast::insight::nullcollector::new (),
+            stoppable, j);
+        jobqueue->setthreadcount (2, false);
+
+        testaccount master = createaccount ();
+        std::vector<testaccount> accounts;
+        for (int i = 0; i < 40; ++i)
+            accounts.push_back (createaccount ());
+
+        std::vector<ledger::pointer> ledgers;
+        ledgers.push_back (genesis (master));
+
+        auto next = [&] (std::vector<sttx::pointer> const& txns)
+        {
+            ledger::pointer const& lcl = ledgers.back ();
+            ledgers.push_back (close (lcl, makeset (lcl, txns)));
+        };
+
+        {
+            std::vector<sttx::pointer> txns;
+            for (auto& account : accounts)
+                txns.push_back (payment (master, account, 1000 * xrp));
+            next (txns);
+        }
+
+        {
+            // holders on both sides of the threshold, and the first
+            // references
+            std::vector<sttx::pointer> txns;
+            for (int i = 0; i < 40; ++i)
+            {
+                if (i % 5 != 0)
+                    txns.push_back (paymentvbc (master, accounts[i],
+                        (i % 5) * vbc / 2));
+            }
+            for (int i = 1; i < 8; ++i)
+                txns.push_back (addreferee (accounts[i], accounts[0]));
+            for (int i = 8; i < 12; ++i)
+                txns.push_back (addreferee (accounts[i], accounts[20]));
+            next (txns);
+        }
+
+        {
+            // references of references, and balances moving between
+            // accounts
+            std::vector<sttx::pointer> txns;
+            for (int i = 12; i < 20; ++i)
+                txns.push_back (addreferee (accounts[i],
+                    accounts[1 + (i - 12) % 7]));
+            txns.push_back (paymentvbc (accounts[1], accounts[25], vbc / 4));
+            txns.push_back (paymentvbc (accounts[4], accounts[30], vbc / 2));
+            next (txns);
+        }
+
+        {
+            // a third level, and holders dropping below the threshold
+            std::vector<sttx::pointer> txns;
+            for (int i = 21; i < 25; ++i)
+                txns.push_back (addreferee (accounts[i],
+                    accounts[12 + (i - 21)]));
+            txns.push_back (paymentvbc (accounts[3], master, vbc));
+            txns.push_back (paymentvbc (accounts[9], master, vbc));
+            txns.push_back (paymentvbc (accounts[2], accounts[35], vbc / 2));
+            next (txns);
+        }
+
+        {
+            testcase ("follow");
+
+            auto index = make_dividendindex (j, *jobqueue);
+            for (auto const& ledger : ledgers)
+            {
+                index->onledger (acceptedledger::makeacceptedledger (ledger));
+                check (*index, ledger);
+            }
+
+            dividendaccounts collected;
+            std::uint64_t sum = 0;
+            dividendmaster::collectdividendinputs (ledgers.back (),
+                collected, sum);
+            expect (collected.size () > 20, "too few accounts listed");
+
+            testcase ("reset");
+
+            index->reset ();
+            index->onledger (acceptedledger::makeacceptedledger (
+                ledgers.back ()));
+            check (*index, ledgers.back ());
+
+            testcase ("gap");
+
+            auto gapped = make_dividendindex (j, *jobqueue);
+            gapped->onledger (acceptedledger::makeacceptedledger (
+                ledgers[1]));
+            check (*gapped, ledgers[1]);
+            gapped->onledger (acceptedledger::makeacceptedledger (
+                ledgers[3]));
+            check (*gapped, ledgers[3]);
+            gapped->onledger (acceptedledger::makeacceptedledger (
+                ledgers[4]));
+            check (*gapped, ledgers[4]);
+
+            // seeding jobs hold the indexes until they return
+            while (jobqueue->getjobcounttotal (jtdividend) > 0 ||
+                    jobqueue->getjobcounttotal (jtparallel) > 0)
+                std::this_thread::sleep_for (std::chrono::milliseconds (1));
+        }
+    }
+};
+
+beast_define_testsuite(dividendindex,ripple_app,ripple);
+
+} // ripple
@@ -0,0 +1,181 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#include <beastconfig.h>
+#include <ripple/app/misc/dividendinputs.h>
+#include <beast/random/rngfill.h>
+#include <beast/random/xor_shift_engine.h>
+#include <beast/unit_test/suite.h>
+#include <map>
+#include <set>
+
+namespace ripple {
+
+class dividendinputs_test : public beast::unit_test::suite
+{
+public:
+    typedef dividendinputs::accountinput input;
+
+    static account
+    randomaccount (beast::xor_shift_engine& g)
+    {
+        account id;
+        beast::rngfill (id.begin (), id.size (), g);
+        return id;
+    }
+
+    static bool
+    same (dividendaccounts const& lhs, dividendaccounts const& rhs)
+    {
+        if (lhs.size () != rhs.size ())
+            return false;
+
+        for (std::size_t i = 0; i < lhs.size (); ++i)
+        {
+            if (lhs[i].id != rhs[i].id || lhs[i].parent != rhs[i].parent ||
+                lhs[i].height != rhs[i].height ||
+                lhs[i].balance != rhs[i].balance ||
+                lhs[i].vrank != rhs[i].vrank)
+                return false;
+        }
+
+        return true;
+    }
+
+    void
+    testrank ()
+    {
+        testcase ("rank");
+
+        beast::xor_shift_engine g (1);
+        account const referrer (randomaccount (g));
+        account const small (randomaccount (g));
+        account const large (randomaccount (g));
+        account const idle (randomaccount (g));
+
+        dividendinputs inputs;
+        inputs.putaccount (getaccountrootindex (large),
+            {large, account (), 0, 5 * system_currency_parts_vbc, false});
+        inputs.putaccount (getaccountrootindex (referrer),
+            {referrer, account (), 0, 0, false});
+        inputs.putaccount (getaccountrootindex (small),
+            {small, account (), 0, 2 * system_currency_parts_vbc, false});
+        inputs.putaccount (getaccountrootindex (idle),
+            {idle, account (), 0, 0, false});
+        inputs.setrefer (getaccountreferindex (referrer), true);
+        inputs.relist (referrer);
+
+        dividendaccounts accounts;
+        std::uint64_t sumvrank = 0;
+        inputs.getinputs (accounts, sumvrank);
+
+        // the referrer ahead of the holders, holders by balance
+        expect (accounts.size () == 3, "wrong accounts");
+        expect (sumvrank == 3, "wrong rank sum");
+        if (accounts.size () == 3)
+        {
+            expect (accounts[0].id == referrer && accounts[0].vrank == 0,
+                "wrong referrer");
+            expect (accounts[1].id == small && accounts[1].vrank == 1,
+                "wrong holder");
+            expect (accounts[2].id == large && accounts[2].vrank == 2,
+                "wrong holder");
+        }
+    }
+
+    // changes applied one at a time must leave the inputs a seed of the
+    // final state would build
+    void
+    testincremental ()
+    {
+        testcase ("incremental");
+
+        beast::xor_shift_engine g (2);
+        std::vector <account> ids;
+        for (int i = 0; i < 300; ++i)
+            ids.push_back (randomaccount (g));
+
+        std::map <account, input> state;
+        std::set <account> refers;
+        dividendinputs incremental;
+
+        for (int step = 0; step < 20000; ++step)
+        {
+            account const& id = ids [g () % ids.size ()];
+
+            switch (g () % 4)
+            {
+            case 0:
+                state.erase (id);
+                incremental.setaccount (getaccountrootindex (id), sle::pointer ());
+                break;
+
+            case 1:
+            {
+                bool const exists = refers.count (id) == 0;
+                if (exists)
+                    refers.insert (id);
+                else
+                    refers.erase (id);
+                incremental.setrefer (getaccountreferindex (id), exists);
+                incremental.relist (id);
+                break;
+            }
+
+            default:
+            {
+                // few distinct balances, heights and referees so ties are
+                // common
+                input const in {id, ids [g () % 8], std::uint32_t (g () % 3),
+                    (g () % 6) * system_currency_parts_vbc / 2, false};
+                state[id] = in;
+                incremental.putaccount (getaccountrootindex (id), in);
+                break;
+            }
+            }
+        }
+
+        // refers first, as a seed adds them
+        dividendinputs seeded;
+        for (auto const& id : refers)
+            seeded.setrefer (getaccountreferindex (id), true);
+        for (auto const& it : state)
+            seeded.putaccount (getaccountrootindex (it.first), it.second);
+
+        dividendaccounts expected, actual;
+        std::uint64_t expectedsum = 0, actualsum = 0;
+        seeded.getinputs (expected, expectedsum);
+        incremental.getinputs (actual, actualsum);
+
+        expect (!expected.empty (), "no accounts listed");
+        expect (same (expected, actual), "incremental inputs differ");
+        expect (expectedsum == actualsum, "incremental rank sum differs");
+    }
+
+    void
+    run ()
+    {
+        testrank ();
+        testincremental ();
+    }
+};
+
+beast_define_testsuite(dividendinputs,ripple_app,ripple);
+
+} // ripple
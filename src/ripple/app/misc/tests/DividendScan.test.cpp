@@ -0,0 +1,192 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#include <beastconfig.h>
+#include <ripple/app/misc/dividendmaster.h>
+#include <ripple/protocol/indexes.h>
+#include <ripple/protocol/rippleaddress.h>
+#include <beast/random/rngfill.h>
+#include <beast/random/xor_shift_engine.h>
+#include <beast/unit_test/suite.h>
+#include <map>
+#include <tuple>
+
+namespace ripple {
+
+// collects the dividend inputs of a ledger with a scan split by state map
+// branch and with the single walk into ordered multimaps it replaced, and
+// checks they match field for field.
+class dividendscan_test : public beast::unit_test::suite
+{
+public:
+    static account
+    randomaccount (beast::xor_shift_engine& g)
+    {
+        account id;
+        beast::rngfill (id.begin (), id.size (), g);
+        return id;
+    }
+
+    class reference_less
+    {
+    public:
+        bool
+        operator() (std::tuple<account, account, std::uint32_t> const& x,
+            std::tuple<account, account, std::uint32_t> const& y) const
+        {
+            if (std::get<2> (x) != std::get<2> (y))
+                return std::get<2> (x) > std::get<2> (y);
+            return std::get<1> (x) > std::get<1> (y);
+        }
+    };
+
+    // the inputs as one walk of the state map collected them
+    static void
+    serialscan (ledger::ref ledger, dividendaccounts& accounts,
+        std::uint64_t& sumvrank)
+    {
+        typedef std::tuple<account, account, std::uint32_t> key;
+        std::multimap<std::uint64_t, key> bybalance;
+        std::multimap<key, std::pair<std::uint64_t, std::uint32_t>,
+            reference_less> byreference;
+
+        ledger->visitstateitems ([&] (sle::ref sle)
+        {
+            if (sle->gettype () != ltaccount_root)
+                return;
+            account const id = sle->getfieldaccount (sfaccount).getaccountid ();
+            std::uint64_t const bal =
+                sle->getfieldamount (sfbalancevbc).getnvalue ();
+            if (bal < system_currency_parts_vbc && !ledger->hasrefer (id))
+                return;
+            std::uint32_t height = 0;
+            account parent;
+            if (sle->isfieldpresent (sfreferee) &&
+                sle->isfieldpresent (sfreferenceheight))
+            {
+                height = sle->getfieldu32 (sfreferenceheight);
+                parent = sle->getfieldaccount (sfreferee).getaccountid ();
+            }
+            if (bal < system_currency_parts_vbc)
+                byreference.emplace (key (id, parent, height),
+                    std::make_pair (bal, std::uint32_t (0)));
+            else
+                bybalance.emplace (bal, key (id, parent, height));
+        });
+
+        sumvrank = 0;
+        std::uint64_t lastbalance = 0;
+        std::uint32_t pos = 1, rank = 1;
+        for (auto const& it : bybalance)
+        {
+            if (lastbalance < it.first)
+            {
+                rank = pos;
+                lastbalance = it.first;
+            }
+            byreference.emplace (it.second, std::make_pair (it.first, rank));
+            sumvrank += rank;
+            ++pos;
+        }
+
+        accounts.clear ();
+        for (auto const& it : byreference)
+            accounts.push_back ({std::get<0> (it.first),
+                std::get<1> (it.first), std::get<2> (it.first),
+                    it.second.first, it.second.second, 0, 0});
+    }
+
+    static bool
+    same (dividendaccounts const& lhs, dividendaccounts const& rhs)
+    {
+        if (lhs.size () != rhs.size ())
+            return false;
+
+        for (std::size_t i = 0; i < lhs.size (); ++i)
+        {
+            if (lhs[i].id != rhs[i].id || lhs[i].parent != rhs[i].parent ||
+                lhs[i].height != rhs[i].height ||
+                lhs[i].balance != rhs[i].balance ||
+                lhs[i].vrank != rhs[i].vrank)
+                return false;
+        }
+
+        return true;
+    }
+
+    void
+    run ()
+    {
+        testcase ("branches");
+
+        rippleaddress const master = rippleaddress::createaccountpublic (
+            rippleaddress::creategeneratorpublic (
+                rippleaddress::createseedgeneric ("masterpassphrase")), 0);
+        ledger::pointer ledger = std::make_shared <ripple::ledger> (
+            master, 100000000000000ull, 100000000000000ull);
+
+        // accounts in every branch of the state map. few distinct
+        // balances, heights and referees so ties are common, and some
+        // accounts below the holding threshold with refer objects.
+        beast::xor_shift_engine g (3);
+        std::vector <account> referees;
+        for (int i = 0; i < 8; ++i)
+            referees.push_back (randomaccount (g));
+
+        for (int i = 0; i < 3000; ++i)
+        {
+            account const id = randomaccount (g);
+            sle root (ltaccount_root, getaccountrootindex (id));
+            root.setfieldaccount (sfaccount, id);
+            root.setfieldu32 (sfsequence, 1);
+            root.setfieldamount (sfbalance, std::uint64_t (0));
+            root.setfieldamount (sfbalancevbc,
+                (g () % 6) * system_currency_parts_vbc / 2);
+            if (g () % 3 != 0)
+            {
+                root.setfieldaccount (sfreferee,
+                    referees [g () % referees.size ()]);
+                root.setfieldu32 (sfreferenceheight,
+                    std::uint32_t (1 + g () % 3));
+            }
+            expect (ledger->addsle (root), "bad account");
+
+            if (g () % 3 == 0)
+            {
+                sle refer (ltrefer, getaccountreferindex (id));
+                refer.setfieldaccount (sfaccount, id);
+                expect (ledger->addsle (refer), "bad refer");
+            }
+        }
+
+        dividendaccounts serial, parallel;
+        std::uint64_t serialsum = 0, parallelsum = 0;
+        serialscan (ledger, serial, serialsum);
+        dividendmaster::collectdividendinputs (ledger, parallel, parallelsum);
+
+        expect (serial.size () > 1000, "too few accounts listed");
+        expect (same (serial, parallel), "branch scan inputs differ");
+        expect (serialsum == parallelsum, "branch scan rank sum differs");
+    }
+};
+
+beast_define_testsuite(dividendscan,ripple_app,ripple);
+
+} // ripple
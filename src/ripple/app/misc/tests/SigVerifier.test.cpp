@@ -0,0 +1,137 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#include <beastconfig.h>
+#include <ripple/app/misc/sigverifier.h>
+#include <ripple/app/ledger/ledgertestsuite.h>
+#include <ripple/core/jobqueue.h>
+#include <beast/insight/nullcollector.h>
+#include <beast/threads/stoppable.h>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ripple {
+
+// queues several batches of transactions with good and bad signatures and
+// checks that every handler runs once, after the verdict is recorded.
+class sigverifier_test : public ledgertestsuite
+{
+public:
+    enum
+    {
+        batchsize = 4,
+
+        // enough for several batches, the last one short
+        transactioncount = 21
+    };
+
+    void
+    run ()
+    {
+        testcase ("batches");
+
+        beast::journal const j;
+        beast::rootstoppable stoppable ("sigverifier_test");
+        auto jobqueue = make_jobqueue (beast::insight::nullcollector::new (),
+            stoppable, j);
+        jobqueue->setthreadcount (2, false);
+
+        std::unique_ptr <ihashrouter> router (ihashrouter::new (
+            ihashrouter::getdefaultholdtime ()));
+
+        testaccount from = createaccount ();
+        testaccount to = createaccount ();
+        testaccount other = createaccount ();
+
+        // every fourth signature is made with a key other than the signing
+        // key, so it is bad
+        std::vector <sttx::pointer> txns;
+        std::vector <bool> good;
+        for (int i = 0; i < transactioncount; ++i)
+        {
+            sttx::pointer txn = payment (from, to, (i + 1) * xrp);
+            bool const isgood = (i % 4) != 1;
+            if (!isgood)
+                txn->sign (other.privatekey);
+            txns.push_back (txn);
+            good.push_back (isgood);
+        }
+
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::vector <int> calls (txns.size (), 0);
+        std::vector <int> flags (txns.size (), 0);
+        std::size_t done = 0;
+
+        {
+            sigverifier verifier (*jobqueue, *router, batchsize);
+
+            for (std::size_t i = 0; i < txns.size (); ++i)
+            {
+                uint256 const txid = txns[i]->gettransactionid ();
+                verifier.verify (txns[i],
+                    [&, i, txid] (job&)
+                    {
+                        int const f = router->getflags (txid);
+                        std::lock_guard <std::mutex> lock (mutex);
+                        ++calls[i];
+                        flags[i] = f;
+                        ++done;
+                        cond.notify_all ();
+                    });
+            }
+
+            {
+                std::unique_lock <std::mutex> lock (mutex);
+                expect (cond.wait_for (lock, std::chrono::seconds (30),
+                    [&] { return done == txns.size (); }),
+                    "handlers did not run");
+            }
+            expect (verifier.pending () == 0, "transactions left waiting");
+
+            // a job can find its batch taken by another, and still holds
+            // the verifier until it returns
+            while (jobqueue->getjobcounttotal (jttransaction) > 0)
+                std::this_thread::sleep_for (std::chrono::milliseconds (1));
+        }
+
+        for (std::size_t i = 0; i < txns.size (); ++i)
+        {
+            expect (calls[i] == 1, "handler ran " +
+                std::to_string (calls[i]) + " times");
+
+            int const verdict = good[i] ? sf_siggood : sf_bad;
+            int const wrong = good[i] ? sf_bad : sf_siggood;
+            expect ((flags[i] & verdict) && !(flags[i] & wrong),
+                good[i] ? "good signature not marked good" :
+                    "bad signature not marked bad");
+            expect (txns[i]->checksign () == good[i],
+                "verdict not kept in the transaction");
+        }
+    }
+};
+
+beast_define_testsuite(sigverifier,app,ripple);
+
+} // ripple
@@ -22,6 +22,8 @@
 #include <ripple/app/data/databasecon.h>
 #include <ripple/app/data/sqlitedatabase.h>
 #include <ripple/core/config.h>
+#include <algorithm>
+#include <cstring>
 #include <type_traits>
 #include <beast/cxx14/memory.h> // <memory>
 
@@ -85,14 +87,20 @@ public:
     //--------------------------------------------------------------------------
 
     nodestore::status fetch (void const* key, nodeobject::ptr* pobject)
+    {
+        auto sl (m_db->lock());
+
+        return fetchlocked (key, pobject);
+    }
+
+    // the caller holds the database lock
+    nodestore::status fetchlocked (void const* key, nodeobject::ptr* pobject)
     {
         nodestore::status result = nodestore::ok;
 
         pobject->reset ();
 
         {
-            auto sl (m_db->lock());
-
             uint256 const hash (uint256::fromvoid (key));
 
             static sqlitestatement pst (m_db->getdb()->getsqlitedb(),
@@ -121,6 +129,30 @@ public:
         return result;
     }
 
+    std::vector <nodestore::status> fetchbatch (std::vector <void const*> const& keys,
+        std::vector <nodeobject::ptr>* pobjects)
+    {
+        std::vector <nodestore::status> results (keys.size ());
+        pobjects->resize (keys.size ());
+
+        // take the lock once and walk the hash index in order
+        std::vector <std::size_t> order (keys.size ());
+        for (std::size_t i = 0; i < order.size (); ++i)
+            order[i] = i;
+        std::sort (order.begin (), order.end (),
+            [&keys] (std::size_t lhs, std::size_t rhs)
+            {
+                return std::memcmp (keys[lhs], keys[rhs], uint256::bytes) < 0;
+            });
+
+        auto sl (m_db->lock());
+
+        for (auto i : order)
+            results[i] = fetchlocked (keys[i], &(*pobjects)[i]);
+
+        return results;
+    }
+
     void store (nodeobject::ref object)
     {
         nodestore::batch batch;
@@ -132,6 +164,7 @@ public:
 
     void storebatch (nodestore::batch const& batch)
     {
+        // the database lock serializes concurrent batches
         auto sl (m_db->lock());
 
         static sqlitestatement pstb (m_db->getdb()->getsqlitedb(), "begin transaction;");
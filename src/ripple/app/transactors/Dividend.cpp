@@ -363,4 +363,15 @@ namespace ripple {
     {
 	    return dividend (txn, params, engine).apply();
     }
+
+    // only the credit of an apply transaction, for a run already checked by
+    // transactionengine::applydividends
+    ter
+    transact_dividendapply(
+        sttx const& txn,
+        transactionengineparams params,
+        transactionengine* engine)
+    {
+        return dividend (txn, params, engine).applytx();
+    }
 }
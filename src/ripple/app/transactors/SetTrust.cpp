@@ -316,6 +316,8 @@ public:
                 uint256 assetstateindex = getqualityindex(baseindex);
                 uint256 assetstateend = getqualitynext(assetstateindex);
                 bool bisassetstateempty = true;
+                auto& statemap = *mengine->getledger()->peekaccountstatemap();
+                auto next = statemap.upper_bound(assetstateindex);
                 for(;;)
                 {
                     // check assetstate is totally empty
@@ -325,10 +327,10 @@ public:
                         bisassetstateempty = false;
                         break;
                     }
-                    uint256 nextassetstateindex = mengine->getledger()->getnextledgerindex(assetstateindex, assetstateend);
-                    if (nextassetstateindex.iszero())
+                    if (next == statemap.end() || (*next)->gettag() > assetstateend)
                         break;
-                    assetstateindex = nextassetstateindex;
+                    assetstateindex = (*next)->gettag();
+                    ++next;
                 }
                 
                 if (bisassetstateempty)
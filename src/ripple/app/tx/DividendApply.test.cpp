@@ -0,0 +1,120 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#include <beastconfig.h>
+#include <ripple/app/ledger/ledgertestsuite.h>
+#include <ripple/app/misc/dividendmaster.h>
+
+namespace ripple {
+
+// applies sets holding runs of dividend apply transactions to a closed
+// ledger one transaction at a time and as a batch, and checks the ledgers
+// match.
+class dividendapply_test : public ledgertestsuite
+{
+public:
+    static sttx::pointer
+    dividendstart (std::uint32_t dividendledger)
+    {
+        auto txn = std::make_shared<sttx> (ttdividend);
+        txn->setfieldu8 (sfdividendtype, dividendmaster::divtype_start);
+        txn->setfieldaccount (sfaccount, account ());
+        txn->setfieldu32 (sfdividendledger, dividendledger);
+        txn->setfieldu64 (sfdividendcoins, 1000 * xrp);
+        txn->setfieldu64 (sfdividendcoinsvbc, 1000 * xrp);
+        return txn;
+    }
+
+    static sttx::pointer
+    dividendapply (std::uint32_t dividendledger, testaccount const& to,
+        std::uint64_t coins)
+    {
+        auto txn = std::make_shared<sttx> (ttdividend);
+        txn->setfieldu8 (sfdividendtype, dividendmaster::divtype_apply);
+        txn->setfieldaccount (sfaccount, account ());
+        txn->setfieldaccount (sfdestination,
+            to.publickey.getaccountid ());
+        txn->setfieldu32 (sfdividendledger, dividendledger);
+        txn->setfieldu64 (sfdividendcoins, coins);
+        txn->setfieldu64 (sfdividendcoinsvbc, 2 * coins);
+        txn->setfieldu64 (sfdividendcoinsvbcrank, coins);
+        txn->setfieldu64 (sfdividendcoinsvbcsprd, coins);
+        txn->setfieldu64 (sfdividendvrank, coins / 10);
+        txn->setfieldu64 (sfdividendvsprd, coins / 100);
+        txn->setfieldu64 (sfdividendtsprd, coins / 1000);
+        return txn;
+    }
+
+    void
+    run ()
+    {
+        testcase ("batch");
+
+        testaccount master = createaccount ();
+        std::vector<testaccount> accounts;
+        for (int i = 0; i < 80; ++i)
+            accounts.push_back (createaccount ());
+
+        ledger::pointer lcl = genesis (master);
+
+        {
+            std::vector<sttx::pointer> txns;
+            for (auto const& account : accounts)
+                txns.push_back (payment (master, account, 1000 * xrp));
+            lcl = close (lcl, makeset (lcl, txns), false, false);
+        }
+
+        std::uint32_t const dividendledger = lcl->getledgerseq ();
+        lcl = close (lcl, makeset (lcl, {dividendstart (dividendledger)}),
+            false, false);
+        expect (lcl->getdividendobject () != nullptr, "no dividend object");
+
+        // apply transactions to funded accounts and to accounts that do not
+        // exist, with payments splitting the set into runs
+        std::vector<sttx::pointer> txns;
+        for (int i = 0; i < 80; ++i)
+        {
+            txns.push_back (dividendapply (dividendledger, accounts[i],
+                (i + 1) * xrp));
+            if (i % 8 == 0)
+                txns.push_back (dividendapply (dividendledger,
+                    createaccount (), xrp));
+            if (i % 30 == 0)
+                txns.push_back (payment (master, accounts[i], xrp));
+        }
+
+        shamap::pointer set = makeset (lcl, txns);
+        ledger::pointer serial = close (lcl, set, false, false);
+        checksame (serial, close (lcl, set, false, true));
+        expect (serial->gettotalcoins () != lcl->gettotalcoins (),
+            "no dividend applied");
+
+        testcase ("fallback");
+
+        // an account credited twice makes the runs go one at a time
+        txns.push_back (dividendapply (dividendledger, accounts[0], 7 * xrp));
+        set = makeset (lcl, txns);
+        checksame (close (lcl, set, false, false),
+            close (lcl, set, false, true));
+    }
+};
+
+beast_define_testsuite(dividendapply,app,ripple);
+
+} // ripple
@@ -138,7 +138,8 @@ public:
         return false;
     }
 
-    void apply (transactionengine& engine) override
+    void apply (transactionengine& engine,
+        hash_set<uint256> const& closed) override
     {
 
         canonicaltxset tset (uint256 {});
@@ -149,7 +150,10 @@ public:
             std::lock_guard <std::mutex> lock (m_lock);
 
             for (auto& it : m_txns)
-                tset.push_back (it.gettx());
+            {
+                if (closed.count (it.getid ()) == 0)
+                    tset.push_back (it.gettx());
+            }
         }
 
         for (auto it : tset)
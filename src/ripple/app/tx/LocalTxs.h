@@ -40,8 +40,10 @@ public:
     // add a new local transaction
     virtual void push_back (ledgerindex index, sttx::ref txn) = 0;
 
-    // apply local transactions to a new open ledger
-    virtual void apply (transactionengine&) = 0;
+    // apply local transactions to a new open ledger, except those in the
+    // last closed ledger
+    virtual void apply (transactionengine&,
+        hash_set<uint256> const& closed) = 0;
 
     // remove obsolete transactions based on a new fully-valid ledger
     virtual void sweep (ledger::ref validledger) = 0;
@@ -0,0 +1,226 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#include <beastconfig.h>
+#include <ripple/app/tx/speculativeapply.h>
+#include <ripple/basics/log.h>
+#include <ripple/core/paralleljobs.h>
+#include <ripple/protocol/indexes.h>
+#include <ripple/protocol/txformats.h>
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+namespace ripple {
+
+bool
+speculativeapply::eligible (sttx const& txn)
+{
+    // a direct payment of the native currency touches nothing but the
+    // account roots of its source and destination. a payment naming a
+    // previous transaction of its source reads the threading of the root,
+    // which the views do not write.
+    return (txn.gettxntype () == ttpayment) &&
+        !txn.isfieldpresent (sfpaths) &&
+        !txn.isfieldpresent (sfsendmax) &&
+        !txn.isfieldpresent (sfprevioustxnid) &&
+        txn.isfieldpresent (sfdestination) &&
+        txn.getfieldamount (sfamount).isnative ();
+}
+
+std::size_t
+speculativeapply::defaultthreads ()
+{
+    return std::min<std::size_t> (maximumthreads,
+        std::thread::hardware_concurrency ());
+}
+
+speculativeapply::speculativeapply (std::size_t threads)
+    : threads_ (threads)
+{
+}
+
+void
+speculativeapply::add (sttx::pointer const& txn,
+    transactionengineparams params)
+{
+    assert (eligible (*txn));
+    assert (params & tapretry);
+
+    index_[txn->gettransactionid ()] = entries_.size ();
+    entries_.emplace_back ();
+
+    entry& e = entries_.back ();
+    e.txn = txn;
+    e.params = params;
+    e.source = getaccountrootindex (txn->getsourceaccount ().getaccountid ());
+    e.destination = getaccountrootindex (txn->getfieldaccount160 (sfdestination));
+}
+
+bool
+speculativeapply::worthwhile (std::size_t count) const
+{
+    return enabled () && (count >= minimumtransactions);
+}
+
+void
+speculativeapply::makegroups ()
+{
+    // payments that share an account root are in the same group
+    std::vector<std::size_t> parent;
+    hash_map<uint256, std::size_t> roots;
+
+    auto const rootof = [&parent] (std::size_t i)
+    {
+        while (parent[i] != i)
+            i = parent[i] = parent[parent[i]];
+        return i;
+    };
+
+    auto const node = [&parent, &roots] (uint256 const& root)
+    {
+        auto const result = roots.emplace (root, parent.size ());
+        if (result.second)
+            parent.push_back (parent.size ());
+        return result.first->second;
+    };
+
+    for (auto const& e : entries_)
+    {
+        std::size_t const source = rootof (node (e.source));
+        std::size_t const destination = rootof (node (e.destination));
+        parent[std::max (source, destination)] = std::min (source, destination);
+    }
+
+    // groups are numbered by their first payment, whose order they keep
+    hash_map<std::size_t, std::size_t> groupof;
+
+    for (auto& e : entries_)
+    {
+        auto const result = groupof.emplace (
+            rootof (roots[e.source]), groups_.size ());
+
+        if (result.second)
+            groups_.emplace_back ();
+
+        e.group = result.first->second;
+        groups_[e.group].push_back (&e);
+    }
+
+    broken_.assign (groups_.size (), false);
+}
+
+void
+speculativeapply::run (transactionengine& engine, jobqueue& jobqueue)
+{
+    makegroups ();
+
+    ledger::pointer snapshot =
+        std::make_shared<ledger> (*engine.getledger (), false);
+
+    // the calling thread applies groups too
+    runparalleljobs (jobqueue, jtaccept, "speculativeapply::run", groups_.size (),
+        threads_,
+        [this, &snapshot] (std::size_t group)
+        {
+            applygroup (snapshot, groups_[group]);
+        });
+
+    engine.setwritten (&written_);
+
+    writelog (lsdebug, speculativeapply) << entries_.size () <<
+        " payments in " << groups_.size () << " groups applied ahead";
+}
+
+void
+speculativeapply::applygroup (ledger::ref snapshot,
+    std::vector<entry*> const& group)
+{
+    // the groups touch different entries, but a payment that failed to
+    // stay within its account roots could have written anything
+    ledger::pointer view = std::make_shared<ledger> (*snapshot, true);
+    transactionengine engine (view);
+
+    for (auto e : group)
+    {
+        try
+        {
+            e->result = engine.preapply (*e->txn, e->params, e->nodes);
+        }
+        catch (...)
+        {
+            writelog (lswarning, speculativeapply) <<
+                "payment " << e->txn->gettransactionid () << " throws";
+            return;
+        }
+
+        for (auto const& it : e->nodes)
+        {
+            if ((it.first != e->source) && (it.first != e->destination))
+            {
+                writelog (lswarning, speculativeapply) <<
+                    "payment " << e->txn->gettransactionid () <<
+                    " touched " << it.first;
+                return;
+            }
+        }
+
+        e->done = true;
+    }
+}
+
+speculativeapply::entry*
+speculativeapply::find (uint256 const& txid)
+{
+    auto const it = index_.find (txid);
+
+    if (it == index_.end ())
+        return nullptr;
+
+    return &entries_[it->second];
+}
+
+ter
+speculativeapply::apply (transactionengine& engine, entry& e, bool& didapply)
+{
+    if (e.done && !broken_[e.group] &&
+        (written_.count (e.source) == 0) &&
+        (written_.count (e.destination) == 0))
+    {
+        try
+        {
+            ter const result = engine.commitpreapplied (
+                *e.txn, e.params, e.result, e.nodes, didapply);
+            ++adopted_;
+            return result;
+        }
+        catch (...)
+        {
+            broken_[e.group] = true;
+            throw;
+        }
+    }
+
+    // what the rest of the group saw may be wrong from here on
+    broken_[e.group] = true;
+    ++reapplied_;
+    return engine.applytransaction (*e.txn, e.params, didapply);
+}
+
+} // ripple
@@ -0,0 +1,137 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#ifndef ripple_speculativeapply_h_included
+#define ripple_speculativeapply_h_included
+
+#include <ripple/app/tx/transactionengine.h>
+#include <ripple/basics/unorderedcontainers.h>
+#include <ripple/core/jobqueue.h>
+#include <cstddef>
+#include <vector>
+
+namespace ripple {
+
+/** applies the direct native payments of a transaction set ahead of the
+    serial apply, on several threads.
+
+    the payments are grouped by the account roots they touch. each group
+    is applied in the order of the set, which is the order of the
+    transaction ids, by one job, to its own view of a snapshot of the
+    ledger. the serial apply walks the set in the same order and adopts
+    the results. a payment whose entries were written by anything
+    outside its group since the snapshot, and every later payment of its
+    group, is applied again instead, so the ledger is the one applying the
+    set one transaction at a time would have built.
+
+    other transactions can read entries without going through their entry
+    set, so only the payments are applied ahead.
+*/
+class speculativeapply
+{
+public:
+    /** a payment applied ahead. */
+    struct entry
+    {
+        sttx::pointer txn;
+        transactionengineparams params;
+        std::size_t group = 0;
+        uint256 source;         // account root of the source
+        uint256 destination;    // account root of the destination
+        ledgerentryset nodes;
+        ter result = tefinternal;
+        bool done = false;
+    };
+
+    /** returns true if the transaction can be applied ahead. */
+    static bool eligible (sttx const& txn);
+
+    /** the number of groups to apply at once on this machine. */
+    static std::size_t defaultthreads ();
+
+    /** no transactions are applied ahead unless two groups can be
+        applied at once.
+    */
+    explicit speculativeapply (std::size_t threads);
+
+    speculativeapply (speculativeapply const&) = delete;
+    speculativeapply& operator= (speculativeapply const&) = delete;
+
+    /** returns true if two groups can be applied at once. */
+    bool enabled () const
+    {
+        return threads_ > 1;
+    }
+
+    /** returns true if applying a number of payments ahead is worth it. */
+    bool worthwhile (std::size_t count) const;
+
+    /** add an eligible transaction, in the order of the set. */
+    void add (sttx::pointer const& txn, transactionengineparams params);
+
+    /** apply the transactions added to views of a snapshot of the ledger,
+        as jobs on the job queue. the engine records what it writes from
+        now on.
+    */
+    void run (transactionengine& engine, jobqueue& jobqueue);
+
+    /** returns the transaction if it was added, or nullptr. */
+    entry* find (uint256 const& txid);
+
+    /** apply a transaction that was added through the engine, adopting
+        its result if nothing it touched was written by others.
+    */
+    ter apply (transactionengine& engine, entry& e, bool& didapply);
+
+    /** the number of transactions adopted and applied again. */
+    std::size_t adopted () const
+    {
+        return adopted_;
+    }
+
+    std::size_t reapplied () const
+    {
+        return reapplied_;
+    }
+
+private:
+    enum
+    {
+        // fewer payments are applied one at a time
+        minimumtransactions = 64,
+
+        maximumthreads = 4
+    };
+
+    void makegroups ();
+    void applygroup (ledger::ref snapshot, std::vector<entry*> const& group);
+
+    std::size_t const threads_;
+    std::vector<entry> entries_;
+    hash_map<uint256, std::size_t> index_;
+    std::vector<std::vector<entry*>> groups_;
+    std::vector<bool> broken_;
+    hash_set<uint256> written_;
+    std::size_t adopted_ = 0;
+    std::size_t reapplied_ = 0;
+};
+
+} // ripple
+
+#endif
@@ -0,0 +1,272 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#include <beastconfig.h>
+#include <ripple/app/tx/speculativeapply.h>
+#include <ripple/app/ledger/ledgertestsuite.h>
+#include <chrono>
+#include <iomanip>
+
+namespace ripple {
+
+// applies the same transaction sets to a closed ledger one transaction at
+// a time and with payments applied ahead, and checks the ledgers match.
+class speculativeapply_test : public ledgertestsuite
+{
+public:
+    typedef std::chrono::high_resolution_clock clock_type;
+
+    sttx::pointer
+    accountset (testaccount& account)
+    {
+        json::value tx_json;
+        tx_json["transactiontype"] = "accountset";
+        tx_json["setflag"] = asfrequiredest;
+        return signtransaction (account, tx_json);
+    }
+
+    // a closed ledger with the master and the accounts funded
+    ledger::pointer
+    fund (testaccount& master, std::vector<testaccount>& accounts,
+        std::uint64_t drops)
+    {
+        ledger::pointer lcl = genesis (master);
+
+        std::vector<sttx::pointer> txns;
+        for (auto const& account : accounts)
+            txns.push_back (payment (master, account, drops));
+
+        return close (lcl, makeset (lcl, txns), false);
+    }
+
+    using ledgertestsuite::close;
+
+    // the closed ledger after lcl holding the set, with the payments
+    // applied ahead by the given speculative apply
+    static ledger::pointer
+    close (ledger::ref lcl, shamap::ref set, speculativeapply& speculative)
+    {
+        canonicaltxset retriabletransactions (set->gethash ());
+        ledger::pointer newlcl = std::make_shared<ledger> (false, *lcl);
+        applytransactions (set, newlcl, newlcl, retriabletransactions,
+            false, speculative);
+        newlcl->updateskiplist ();
+        newlcl->setclosed ();
+        return newlcl;
+    }
+
+    void
+    testmixed ()
+    {
+        testcase ("mixed");
+
+        testaccount master = createaccount ();
+        std::vector<testaccount> accounts;
+        for (int i = 0; i < 60; ++i)
+            accounts.push_back (createaccount ());
+
+        // each payer pays its target, which also sets a flag
+        std::vector<testaccount> payers;
+        std::vector<testaccount> targets;
+        for (int i = 0; i < 8; ++i)
+        {
+            payers.push_back (createaccount ());
+            targets.push_back (createaccount ());
+        }
+
+        std::vector<testaccount> funded (accounts);
+        funded.insert (funded.end (), payers.begin (), payers.end ());
+        funded.insert (funded.end (), targets.begin (), targets.end ());
+        ledger::pointer lcl = fund (master, funded, 1000 * xrp);
+
+        std::vector<testaccount> created;
+        for (int i = 0; i < 60; ++i)
+            created.push_back (createaccount ());
+
+        std::vector<sttx::pointer> txns;
+        std::size_t payments = 0;
+        for (int i = 0; i < 60; ++i)
+        {
+            // creates an account, then pays it again
+            txns.push_back (payment (accounts[i], created[i], 300 * xrp));
+            txns.push_back (payment (accounts[i], created[i], 1 * xrp));
+            payments += 2;
+
+            // joins groups
+            if (i % 10 == 0)
+            {
+                txns.push_back (payment (accounts[i], accounts[i + 1],
+                    2 * xrp));
+                ++payments;
+            }
+
+            // fails for want of funds
+            if (i % 15 == 0)
+            {
+                txns.push_back (payment (accounts[i], accounts[i + 2],
+                    100000 * xrp));
+                ++payments;
+            }
+        }
+
+        // touches an account root without a payment
+        std::vector<std::pair<uint256, uint256>> touched;
+        for (int i = 0; i < 8; ++i)
+        {
+            txns.push_back (payment (payers[i], targets[i], 1 * xrp));
+            txns.push_back (accountset (targets[i]));
+            ++payments;
+            touched.emplace_back (txns[txns.size () - 1]->gettransactionid (),
+                txns[txns.size () - 2]->gettransactionid ());
+        }
+
+        shamap::pointer set = makeset (lcl, txns);
+
+        // the set's order follows the signatures, so whether a target's
+        // flag is set before it is paid differs from run to run. a payment
+        // to a target set first is applied again, every other payment is
+        // in a group nothing else writes and is adopted.
+        hash_map<uint256, std::size_t> position;
+        for (auto const& item : *set)
+            position.emplace (item->gettag (), position.size ());
+
+        std::size_t again = 0;
+        for (auto const& t : touched)
+        {
+            if (position[t.first] < position[t.second])
+                ++again;
+        }
+
+        // two threads, whatever this machine has
+        speculativeapply speculative (2);
+        expect (speculative.worthwhile (payments), "too few payments");
+
+        checksame (close (lcl, set, false), close (lcl, set, speculative));
+        expect (speculative.adopted () > 0, "nothing adopted");
+        expect (speculative.adopted () == payments - again,
+            "adopted " + std::to_string (speculative.adopted ()) +
+            ", expected " + std::to_string (payments - again));
+        expect (speculative.reapplied () == again,
+            "applied again " + std::to_string (speculative.reapplied ()) +
+            ", expected " + std::to_string (again));
+    }
+
+    void
+    run ()
+    {
+        testmixed ();
+    }
+};
+
+// floods of payments between funded accounts, closed one transaction at a
+// time and with payments applied ahead.
+class speculativeapply_timing_test : public speculativeapply_test
+{
+public:
+    enum
+    {
+        accountcount = 4000,
+        paymentcount = 4000
+    };
+
+    template <class duration>
+    static double
+    seconds (duration const& d)
+    {
+        return std::chrono::duration_cast <
+            std::chrono::duration <double>> (d).count ();
+    }
+
+    void
+    flood (std::string const& name, ledger::ref lcl, shamap::ref set)
+    {
+        testcase (name);
+
+        // the first close marks the signatures as checked
+        close (lcl, set, false);
+
+        auto start = clock_type::now ();
+        ledger::pointer serial = close (lcl, set, false);
+        double const serialtime = seconds (clock_type::now () - start);
+
+        start = clock_type::now ();
+        ledger::pointer ahead = close (lcl, set, true);
+        double const aheadtime = seconds (clock_type::now () - start);
+
+        checksame (serial, ahead);
+
+        log << name << ": " << paymentcount << " payments, " <<
+            std::setprecision (3) << "serial " << serialtime << "s, " <<
+            "ahead " << aheadtime << "s with " <<
+            speculativeapply::defaultthreads () << " threads";
+    }
+
+    void
+    run ()
+    {
+        testaccount master = createaccount ();
+        std::vector<testaccount> accounts;
+        for (int i = 0; i < accountcount; ++i)
+            accounts.push_back (createaccount ());
+
+        ledger::pointer lcl = fund (master, accounts, 1000 * xrp);
+
+        {
+            // every payment between two accounts no other payment touches
+            std::vector<testaccount> from (accounts);
+            std::vector<sttx::pointer> txns;
+            for (int i = 0; i < paymentcount; ++i)
+                txns.push_back (payment (from[(2 * i) % accountcount],
+                    from[(2 * i + 1) % accountcount], 1 * xrp));
+
+            flood ("pairs", lcl, makeset (lcl, txns));
+        }
+
+        {
+            // a few senders paying many accounts
+            std::vector<testaccount> from (accounts);
+            std::vector<sttx::pointer> txns;
+            for (int i = 0; i < paymentcount; ++i)
+                txns.push_back (payment (from[i % 64],
+                    from[64 + i % (accountcount - 64)], 1 * xrp));
+
+            flood ("fan out", lcl, makeset (lcl, txns));
+        }
+
+        {
+            // senders paying random accounts, which joins most of them
+            std::vector<testaccount> from (accounts);
+            std::vector<sttx::pointer> txns;
+            std::uint32_t r = 1;
+            for (int i = 0; i < paymentcount; ++i)
+            {
+                r = r * 1103515245 + 12345;
+                txns.push_back (payment (from[i % accountcount],
+                    from[(r >> 8) % accountcount], 1 * xrp));
+            }
+
+            flood ("random", lcl, makeset (lcl, txns));
+        }
+    }
+};
+
+beast_define_testsuite(speculativeapply,app,ripple);
+beast_define_testsuite_manual(speculativeapply_timing,app,ripple);
+
+} // ripple
@@ -20,14 +20,18 @@
 #include <beastconfig.h>
 #include <ripple/app/tx/transactionengine.h>
 #include <ripple/app/transactors/transactor.h>
+#include <ripple/app/misc/dividendmaster.h>
 #include <ripple/basics/log.h>
 #include <ripple/json/to_string.h>
 #include <ripple/protocol/indexes.h>
 #include <boost/foreach.hpp>
+#include <algorithm>
 #include <cassert>
 
 namespace ripple {
 
+ter transact_dividendapply (sttx const& txn, transactionengineparams params, transactionengine* engine);
+
 //
 // xxx make sure all fields are recognized in transactions.
 //
@@ -35,8 +39,8 @@ namespace ripple {
 void transactionengine::txnwrite ()
 {
     // write back the account states
-    typedef std::map<uint256, ledgerentrysetentry>::value_type u256_les_pair;
-    boost_foreach (u256_les_pair & it, mnodes)
+    typedef ledgerentryset::entrymap::value_type u256_les_pair;
+    boost_foreach (u256_les_pair const& it, mnodes)
     {
         sle::ref    sleentry    = it.second.mentry;
 
@@ -47,7 +51,7 @@ void transactionengine::txnwrite ()
             break;
 
         case taacached:
-            break;
+            continue;
 
         case taacreate:
         {
@@ -76,19 +80,17 @@ void transactionengine::txnwrite ()
         }
         break;
         }
+
+        if (mwritten)
+            mwritten->insert (it.first);
     }
 }
 
-ter transactionengine::applytransaction (
+ter transactionengine::runtransactor (
     sttx const& txn,
-    transactionengineparams params,
-    bool& didapply)
+    transactionengineparams params)
 {
-    writelog (lstrace, transactionengine) << "applytransaction>";
-    didapply = false;
-    assert (mledger);
     uint256 const& txid = txn.gettransactionid ();
-    mnodes.init (mledger, txid, mledger->getledgerseq (), params);
 
 #ifdef beast_debug
     if (1)
@@ -138,6 +140,105 @@ ter transactionengine::applytransaction (
             " : " << strhuman;
     }
 
+    return terresult;
+}
+
+ter transactionengine::applytransaction (
+    sttx const& txn,
+    transactionengineparams params,
+    bool& didapply)
+{
+    writelog (lstrace, transactionengine) << "applytransaction>";
+    didapply = false;
+    assert (mledger);
+    mnodes.init (mledger, txn.gettransactionid (), mledger->getledgerseq (), params);
+
+    ter terresult = runtransactor (txn, params);
+
+    if ((terresult == teminvalid && !txn.gettransactionid ()) ||
+        (terresult == temunknown))
+        return terresult;
+
+    return finishtransaction (txn, params, terresult, didapply);
+}
+
+ter transactionengine::preapply (
+    sttx const& txn,
+    transactionengineparams params,
+    ledgerentryset& nodes)
+{
+    assert (mledger);
+    assert (params & tapretry);
+    mnodes.init (mledger, txn.gettransactionid (), mledger->getledgerseq (), params);
+
+    ter terresult = runtransactor (txn, params);
+
+    if (istessuccess (terresult))
+        txnwrite ();
+
+    mtxnaccount.reset ();
+    mnodes.swapwith (nodes);
+    mnodes.clear ();
+
+    return terresult;
+}
+
+ter transactionengine::commitpreapplied (
+    sttx const& txn,
+    transactionengineparams params,
+    ter result,
+    ledgerentryset& nodes,
+    bool& didapply)
+{
+    didapply = false;
+    assert (mledger);
+    mnodes.swapwith (nodes);
+    mnodes.getledger () = mledger;
+
+    // the view was written back without metadata, so the entries carry the
+    // threading of the view. take it from this ledger instead.
+    for (auto const& it : mnodes)
+    {
+        if ((it.second.maction != taamodify) && (it.second.maction != taadelete))
+            continue;
+
+        sle::pointer orignode = mledger->getslei (it.first);
+
+        if (orignode && orignode->isthreadedtype () &&
+            it.second.mentry->isthreadedtype ())
+        {
+            it.second.mentry->setfieldh256 (sfprevioustxnid,
+                orignode->getfieldh256 (sfprevioustxnid));
+            it.second.mentry->setfieldu32 (sfprevioustxnlgrseq,
+                orignode->getfieldu32 (sfprevioustxnlgrseq));
+        }
+    }
+
+    hash_set<uint256>* const written = mwritten;
+    mwritten = nullptr;
+
+    try
+    {
+        result = finishtransaction (txn, params, result, didapply);
+    }
+    catch (...)
+    {
+        mwritten = written;
+        throw;
+    }
+
+    mwritten = written;
+    return result;
+}
+
+ter transactionengine::finishtransaction (
+    sttx const& txn,
+    transactionengineparams params,
+    ter terresult,
+    bool& didapply)
+{
+    uint256 const& txid = txn.gettransactionid ();
+
     if (istessuccess (terresult))
         didapply = true;
     else if (istecclaim (terresult) && !(params & tapretry))
@@ -256,4 +357,188 @@ ter transactionengine::applytransaction (
     return terresult;
 }
 
+std::size_t transactionengine::applydividends (
+    std::vector<sttx::pointer> const& txns,
+    transactionengineparams params)
+{
+    assert (mledger);
+
+    if (params & tapopen_ledger)
+        return 0;
+
+    std::uint64_t const totalcoins = mledger->gettotalcoins ();
+    std::uint64_t const totalcoinsvbc = mledger->gettotalcoinsvbc ();
+
+    // the changes of each transaction and the coins it created, in run order
+    std::vector<ledgerentryset> nodes (txns.size ());
+    std::vector<serializer> metas (txns.size ());
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> created (txns.size ());
+
+    // every transaction is worked out against the ledger as it stands.
+    // no two of them touch the same entry, so each sees what it would have
+    // seen in turn. nothing but the coin totals changes until all of them
+    // succeeded.
+    try
+    {
+        // the ledger checks the dividend transactor makes for every transaction
+        sle::pointer dividendobject = mledger->getdividendobject ();
+
+        if (!dividendobject || dividendobject->getfieldindex (sfdividendledger) == -1)
+            return 0;
+
+        std::uint32_t const dividendledger = dividendobject->getfieldu32 (sfdividendledger);
+
+        // the transactor also caches the root of the zero source account, which
+        // would then show up in the metadata
+        if (mledger->peekaccountstatemap ()->hasitem (getaccountrootindex (account ())))
+            return 0;
+
+        // account root index, position in the run
+        std::vector<std::pair<uint256, std::size_t>> order;
+        order.reserve (txns.size ());
+
+        for (std::size_t i = 0; i < txns.size (); ++i)
+        {
+            sttx const& txn = *txns[i];
+
+            if ((txn.gettxntype () != ttdividend) ||
+                !txn.gettransactionid () ||
+                (txn.getsequence () != 0) ||
+                txn.isfieldpresent (sfprevioustxnid) ||
+                (txn.gettransactionfee () != stamount ()) ||
+                !txn.isfieldpresent (sfdividendtype) ||
+                (txn.getfieldu8 (sfdividendtype) != dividendmaster::divtype_apply) ||
+                !txn.isfieldpresent (sfdividendledger) ||
+                (txn.getfieldu32 (sfdividendledger) != dividendledger) ||
+                !txn.isfieldpresent (sfdividendcoins) ||
+                !txn.isfieldpresent (sfdividendcoinsvbc) ||
+                !txn.isfieldpresent (sfdividendvrank) ||
+                !txn.isfieldpresent (sfdividendvsprd) ||
+                !txn.isfieldpresent (sfdestination) ||
+                !txn.isfieldpresent (sfdividendcoinsvbcrank) ||
+                !txn.isfieldpresent (sfdividendcoinsvbcsprd) ||
+                !txn.isfieldpresent (sfdividendtsprd))
+            {
+                return 0;
+            }
+
+            order.emplace_back (
+                getaccountrootindex (txn.getfieldaccount160 (sfdestination)), i);
+        }
+
+        std::sort (order.begin (), order.end ());
+
+        // the credits only commute if every account is credited once
+        auto const sameaccount = [] (std::pair<uint256, std::size_t> const& a,
+            std::pair<uint256, std::size_t> const& b)
+        {
+            return a.first == b.first;
+        };
+
+        if (std::adjacent_find (order.begin (), order.end (), sameaccount) != order.end ())
+            return 0;
+
+        // touch the account roots and the refer objects an apply may create,
+        // in key order, so a missing node surfaces here and the writes below
+        // find every node they need in memory
+        for (auto const& it : order)
+        {
+            mledger->peekaccountstatemap ()->hasitem (it.first);
+            mledger->peekaccountstatemap ()->hasitem (getaccountreferindex (
+                txns[it.second]->getfieldaccount160 (sfdestination)));
+        }
+
+        for (auto const& it : order)
+        {
+            sttx const& txn = *txns[it.second];
+
+            mnodes.init (mledger, txn.gettransactionid (),
+                mledger->getledgerseq (), params);
+
+            std::uint64_t const coins = mledger->gettotalcoins ();
+            std::uint64_t const coinsvbc = mledger->gettotalcoinsvbc ();
+
+            ter terresult = transact_dividendapply (txn, params, this);
+
+            created[it.second] = std::make_pair (
+                mledger->gettotalcoins () - coins,
+                mledger->gettotalcoinsvbc () - coinsvbc);
+
+            if ((terresult != tessuccess) ||
+                !checkinvariants (terresult, txn, params))
+            {
+                writelog (lswarning, transactionengine) <<
+                    "applydividends: " << transtoken (terresult) <<
+                    ", applying one at a time";
+                mnodes.clear ();
+                mledger->settotalcoins (totalcoins);
+                mledger->settotalcoinsvbc (totalcoinsvbc);
+                return 0;
+            }
+
+            mnodes.calcrawmeta (metas[it.second], terresult,
+                mtxnseq + it.second);
+            mnodes.swapwith (nodes[it.second]);
+            mnodes.clear ();
+        }
+    }
+    catch (...)
+    {
+        writelog (lswarning, transactionengine) <<
+            "applydividends: throws, applying one at a time";
+        mnodes.clear ();
+        mledger->settotalcoins (totalcoins);
+        mledger->settotalcoinsvbc (totalcoinsvbc);
+        return 0;
+    }
+
+    // write in run order, so a transaction that throws here leaves the
+    // ledger as applytransaction would have: the ones before it written,
+    // its own index used up, and the rest still to apply
+    std::size_t const first = mtxnseq;
+
+    for (std::size_t i = 0; i < txns.size (); ++i)
+    {
+        sttx const& txn = *txns[i];
+        mtxnseq = first + i + 1;
+
+        try
+        {
+            mnodes.swapwith (nodes[i]);
+            txnwrite ();
+
+            serializer s;
+            txn.add (s);
+
+            if (!mledger->addtransaction (txn.gettransactionid (), s, metas[i]))
+            {
+                writelog (lsfatal, transactionengine) <<
+                    "tried to add transaction to ledger that already had it";
+                assert (false);
+                throw std::runtime_error ("duplicate transaction applied to closed ledger");
+            }
+
+            mnodes.clear ();
+        }
+        catch (...)
+        {
+            writelog (lswarning, transactionengine) <<
+                "applydividends: write throws, applying the rest one at a time";
+            mnodes.clear ();
+
+            // the rest create their coins again when they are applied
+            for (std::size_t j = i + 1; j < txns.size (); ++j)
+            {
+                mledger->destroycoins (created[j].first);
+                mledger->settotalcoinsvbc (
+                    mledger->gettotalcoinsvbc () - created[j].second);
+            }
+
+            return i + 1;
+        }
+    }
+
+    return txns.size ();
+}
+
 } // ripple
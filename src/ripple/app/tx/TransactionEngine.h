@@ -22,6 +22,7 @@
 
 #include <ripple/app/ledger/ledger.h>
 #include <ripple/app/ledger/ledgerentryset.h>
+#include <ripple/basics/unorderedcontainers.h>
 
 namespace ripple {
 
@@ -39,9 +40,14 @@ public:
 private:
     ledgerentryset      mnodes;
 
+    hash_set<uint256>*  mwritten;
+
     ter setauthorized (const sttx & txn, bool bmustsetgenerator);
     ter checksig (const sttx & txn);
 
+    ter runtransactor (const sttx&, transactionengineparams);
+    ter finishtransaction (const sttx&, transactionengineparams, ter, bool & didapply);
+
 protected:
     ledger::pointer     mledger;
     int                 mtxnseq;
@@ -54,11 +60,12 @@ protected:
 public:
     typedef std::shared_ptr<transactionengine> pointer;
 
-    transactionengine () : mtxnseq (0)
+    transactionengine () : mwritten (nullptr), mtxnseq (0)
     {
         ;
     }
-    transactionengine (ledger::ref ledger) : mledger (ledger), mtxnseq (0)
+    transactionengine (ledger::ref ledger)
+        : mwritten (nullptr), mledger (ledger), mtxnseq (0)
     {
         assert (mledger);
     }
@@ -99,6 +106,35 @@ public:
     }
 
     ter applytransaction (const sttx&, transactionengineparams, bool & didapply);
+
+    // apply a transaction to this engine's ledger, which is a private view
+    // of another ledger, writing back the entries it changed but no
+    // metadata. the entries it touched are handed back in nodes for
+    // commitpreapplied. retries must be allowed.
+    ter preapply (const sttx&, transactionengineparams, ledgerentryset& nodes);
+
+    // finish a transaction preapplied to a view of this engine's ledger as
+    // applytransaction would have. the caller makes sure none of the entries
+    // in nodes changed here since the view was taken, other than by earlier
+    // transactions preapplied to the same view and committed here. the
+    // entries written are not recorded by setwritten.
+    ter commitpreapplied (const sttx&, transactionengineparams, ter result,
+        ledgerentryset& nodes, bool & didapply);
+
+    // record the index of every entry written back to the ledger from now on,
+    // or stop recording if written is null
+    void setwritten (hash_set<uint256>* written)
+    {
+        mwritten = written;
+    }
+
+    // apply a run of dividend apply transactions to a closed ledger with the
+    // same state and metadata as applying them one at a time in this order.
+    // the checks are made once for the run and the account roots are read
+    // in key order. returns how many transactions from the front of the run
+    // were dealt with, the rest must go through applytransaction. that is
+    // all of them, with nothing changed, if the run can not be batched.
+    std::size_t applydividends (std::vector<sttx::pointer> const& txns, transactionengineparams);
     bool checkinvariants (ter result, const sttx & txn, transactionengineparams params);
 };
 
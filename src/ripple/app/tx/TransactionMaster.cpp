@@ -121,7 +121,7 @@ void transactionmaster::sweep (void)
     mcache.sweep ();
 }
 
-taggedcache <uint256, transaction>& transactionmaster::getcache()
+shardedtaggedcache <uint256, transaction>& transactionmaster::getcache()
 {
     return mcache;
 }
@@ -21,6 +21,7 @@
 #define __transactionmaster__
 
 #include <ripple/app/tx/transaction.h>
+#include <ripple/basics/shardedtaggedcache.h>
 #include <ripple/shamap/shamapitem.h>
 #include <ripple/shamap/shamaptreenode.h>
 
@@ -41,10 +42,10 @@ public:
     bool inledger (uint256 const& hash, std::uint32_t ledger);
     bool canonicalize (transaction::pointer* ptransaction);
     void sweep (void);
-    taggedcache <uint256, transaction>& getcache();
+    shardedtaggedcache <uint256, transaction>& getcache();
 
 private:
-    taggedcache <uint256, transaction> mcache;
+    shardedtaggedcache <uint256, transaction> mcache;
 };
 
 } // ripple
@@ -151,7 +151,8 @@ public:
             m_serverhandler.send (ptr, jvobj, broadcast);
     }
 
-    void send (json::value const& jvobj, std::string const& sobj, bool broadcast)
+    void send (json::value const& jvobj, serializedptr const& sobj,
+        bool broadcast)
     {
         connection_ptr ptr = m_connection.lock ();
 
@@ -65,6 +65,10 @@ public:
         crtooslow   = 4000,     // client is too slow.
     };
 
+    // a client that lets more than this many bytes of broadcast messages
+    // queue up is disconnected rather than buffered without bound.
+    static std::uint64_t const maxqueuedbytes = 16 * 1024 * 1024;
+
 private:
     std::shared_ptr<http::port> port_;
     resource::manager& m_resourcemanager;
@@ -121,6 +125,21 @@ public:
     {
         try
         {
+            if (broadcast && cpclient->buffered_amount () > maxqueuedbytes)
+            {
+                if (cpclient->get_state () ==
+                        websocketpp_02::session::state::open)
+                {
+                    writelog (lswarning, wsserverhandlerlog)
+                        << "ws:: dropping client with "
+                        << cpclient->buffered_amount () << " bytes queued";
+                    cpclient->close (
+                        websocketpp_02::close::status::value (crtooslow),
+                        std::string ("client is too slow."));
+                }
+                return;
+            }
+
             writelog (broadcast ? lstrace : lsinfo, wsserverhandlerlog)
                     << "ws:: sending '" << strmessage << "'";
 
@@ -150,6 +169,22 @@ public:
                 broadcast));
     }
 
+    static void ssends (connection_ptr cpclient,
+        infosub::serializedptr const& message, bool broadcast)
+    {
+        ssendb (cpclient, *message, broadcast);
+    }
+
+    // the message is shared with every other client it is sent to
+    void send (connection_ptr cpclient, infosub::serializedptr const& message,
+               bool broadcast)
+    {
+        cpclient->get_strand ().post (
+            std::bind (
+                &wsserverhandler<endpoint_type>::ssends, cpclient, message,
+                broadcast));
+    }
+
     void send (connection_ptr cpclient, json::value const& jvobj, bool broadcast)
     {
         send (cpclient, to_string (jvobj), broadcast);
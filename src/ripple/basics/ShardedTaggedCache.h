@@ -0,0 +1,274 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#ifndef ripple_basics_shardedtaggedcache_h_included
+#define ripple_basics_shardedtaggedcache_h_included
+
+#include <ripple/basics/taggedcache.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace ripple {
+
+/** a taggedcache split into independently locked partitions.
+
+    each key belongs to the partition picked by its hash, so threads working
+    on different keys rarely wait for each other. every partition is a
+    complete taggedcache with its share of the target size, which keeps the
+    strong and weak semantics of the single cache. a sweep walks the
+    partitions one at a time, holding only that partition's lock.
+
+    there is no cache wide mutex, so this cannot stand in for a taggedcache
+    whose callers lock peekmutex() around several operations.
+*/
+template <
+    class key,
+    class t,
+    class hash = hardened_hash <>,
+    class keyequal = std::equal_to <key>,
+    class mutex = std::recursive_mutex,
+    std::size_t partitions = 16
+>
+class shardedtaggedcache
+{
+public:
+    typedef taggedcache <key, t, hash, keyequal, mutex> partition_type;
+    typedef key key_type;
+    typedef t mapped_type;
+    typedef typename partition_type::weak_mapped_ptr weak_mapped_ptr;
+    typedef typename partition_type::mapped_ptr mapped_ptr;
+    typedef typename partition_type::clock_type clock_type;
+
+    static_assert (partitions > 0, "a cache needs at least one partition");
+
+public:
+    shardedtaggedcache (std::string const& name, int size,
+        typename clock_type::rep expiration_seconds, clock_type& clock, beast::journal journal,
+            beast::insight::collector::ptr const& collector = beast::insight::nullcollector::new ())
+        : m_clock (clock)
+        , m_target_size (size)
+        , m_partitions (makepartitions (name, size, expiration_seconds, clock, journal))
+        , m_stats (name,
+            std::bind (&shardedtaggedcache::collect_metrics, this),
+                collector)
+    {
+    }
+
+public:
+    /** return the clock associated with the cache. */
+    clock_type& clock ()
+    {
+        return m_clock;
+    }
+
+    int gettargetsize () const
+    {
+        return m_target_size;
+    }
+
+    void settargetsize (int s)
+    {
+        m_target_size = s;
+        for (auto const& p : m_partitions)
+            p->settargetsize (partitionsize (s));
+    }
+
+    typename clock_type::rep gettargetage () const
+    {
+        return m_partitions.front ()->gettargetage ();
+    }
+
+    void settargetage (typename clock_type::rep s)
+    {
+        for (auto const& p : m_partitions)
+            p->settargetage (s);
+    }
+
+    int getcachesize ()
+    {
+        int size = 0;
+        for (auto const& p : m_partitions)
+            size += p->getcachesize ();
+        return size;
+    }
+
+    int gettracksize ()
+    {
+        int size = 0;
+        for (auto const& p : m_partitions)
+            size += p->gettracksize ();
+        return size;
+    }
+
+    float gethitrate ()
+    {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        gethitsandmisses (hits, misses);
+        auto const total = static_cast<float> (hits + misses);
+        return hits * (100.0f / std::max (1.0f, total));
+    }
+
+    void clearstats ()
+    {
+        for (auto const& p : m_partitions)
+            p->clearstats ();
+    }
+
+    void clear ()
+    {
+        for (auto const& p : m_partitions)
+            p->clear ();
+    }
+
+    void sweep ()
+    {
+        for (auto const& p : m_partitions)
+            p->sweep ();
+    }
+
+    bool del (const key_type& key, bool valid)
+    {
+        return partition (key).del (key, valid);
+    }
+
+    bool canonicalize (const key_type& key, std::shared_ptr<t>& data, bool replace = false)
+    {
+        return partition (key).canonicalize (key, data, replace);
+    }
+
+    std::shared_ptr<t> fetch (const key_type& key)
+    {
+        return partition (key).fetch (key);
+    }
+
+    bool insert (key_type const& key, t const& value)
+    {
+        return partition (key).insert (key, value);
+    }
+
+    bool retrieve (const key_type& key, t& data)
+    {
+        return partition (key).retrieve (key, data);
+    }
+
+    bool refreshifpresent (const key_type& key)
+    {
+        return partition (key).refreshifpresent (key);
+    }
+
+    std::vector <key_type> getkeys ()
+    {
+        std::vector <key_type> v;
+
+        for (auto const& p : m_partitions)
+        {
+            std::vector <key_type> const keys (p->getkeys ());
+            v.insert (v.end (), keys.begin (), keys.end ());
+        }
+
+        return v;
+    }
+
+private:
+    typedef std::vector <std::unique_ptr <partition_type>> partitions_type;
+
+    static partitions_type makepartitions (std::string const& name, int size,
+        typename clock_type::rep expiration_seconds, clock_type& clock,
+            beast::journal journal)
+    {
+        partitions_type v;
+        v.reserve (partitions);
+        for (std::size_t i = 0; i < partitions; ++i)
+            v.emplace_back (new partition_type (name,
+                partitionsize (size), expiration_seconds, clock, journal));
+        return v;
+    }
+
+    static int partitionsize (int size)
+    {
+        // round up so a small target still leaves room in every partition
+        return (size + static_cast<int> (partitions) - 1) / static_cast<int> (partitions);
+    }
+
+    partition_type& partition (key_type const& key)
+    {
+        return *m_partitions[m_hash (key) % partitions];
+    }
+
+    void gethitsandmisses (std::uint64_t& hits, std::uint64_t& misses)
+    {
+        for (auto const& p : m_partitions)
+        {
+            auto const counts (p->gethitsandmisses ());
+            hits += counts.first;
+            misses += counts.second;
+        }
+    }
+
+    void collect_metrics ()
+    {
+        m_stats.size.set (getcachesize ());
+
+        {
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            gethitsandmisses (hits, misses);
+
+            beast::insight::gauge::value_type hit_rate (0);
+            auto const total (hits + misses);
+            if (total != 0)
+                hit_rate = (hits * 100) / total;
+            m_stats.hit_rate.set (hit_rate);
+        }
+    }
+
+private:
+    struct stats
+    {
+        template <class handler>
+        stats (std::string const& prefix, handler const& handler,
+            beast::insight::collector::ptr const& collector)
+            : hook (collector->make_hook (handler))
+            , size (collector->make_gauge (prefix, "size"))
+            , hit_rate (collector->make_gauge (prefix, "hit_rate"))
+            { }
+
+        beast::insight::hook hook;
+        beast::insight::gauge size;
+        beast::insight::gauge hit_rate;
+    };
+
+    clock_type& m_clock;
+    hash m_hash;
+
+    // desired number of cache entries across all partitions (0 = ignore)
+    std::atomic <int> m_target_size;
+
+    partitions_type m_partitions;
+
+    // last, so the metrics hook never sees a partially built cache
+    stats m_stats;
+};
+
+}
+
+#endif
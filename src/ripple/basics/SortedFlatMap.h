@@ -0,0 +1,380 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#ifndef ripple_basics_sortedflatmap_h_included
+#define ripple_basics_sortedflatmap_h_included
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace ripple {
+
+/** an ordered map kept as a sorted array that copies share until written.
+
+    lookups are binary searches over contiguous entries, and iteration is in
+    key order like std::map. the first insert reserves room for a small
+    number of entries, so short lived maps usually allocate once.
+
+    a copy shares the entries of the map it was copied from. lookups and
+    iteration never write, so like std::set every iterator is const, and a
+    mapped value is written through modify. the first insert, erase or
+    modify on a map that shares its entries gives it its own, so a copy that
+    is only read, or swapped back and dropped, costs no more than a pointer.
+
+    inserting or erasing invalidates iterators, and so does modify on a map
+    that shares its entries. moving an entry must not throw.
+*/
+template <class key, class t, class compare = std::less <key>>
+class sortedflatmap
+{
+public:
+    typedef key key_type;
+    typedef t mapped_type;
+    typedef std::pair <key const, t> value_type;
+    typedef std::size_t size_type;
+    typedef value_type const* const_iterator;
+    typedef const_iterator iterator;
+
+    enum
+    {
+        initialcapacity = 16
+    };
+
+    sortedflatmap () = default;
+
+    bool
+    empty () const
+    {
+        return size () == 0;
+    }
+
+    size_type
+    size () const
+    {
+        return entries_ ? entries_->size () : 0;
+    }
+
+    /** returns true if this map shares its entries with a copy. */
+    bool
+    shared () const
+    {
+        return entries_ && !entries_.unique ();
+    }
+
+    const_iterator
+    begin () const
+    {
+        return entries_ ? entries_->data () : nullptr;
+    }
+
+    const_iterator
+    end () const
+    {
+        return entries_ ? entries_->data () + entries_->size () : nullptr;
+    }
+
+    const_iterator
+    cbegin () const
+    {
+        return begin ();
+    }
+
+    const_iterator
+    cend () const
+    {
+        return end ();
+    }
+
+    const_iterator
+    lower_bound (key_type const& k) const
+    {
+        return std::lower_bound (begin (), end (), k, entryless ());
+    }
+
+    const_iterator
+    upper_bound (key_type const& k) const
+    {
+        return std::upper_bound (begin (), end (), k, entryless ());
+    }
+
+    const_iterator
+    find (key_type const& k) const
+    {
+        auto const iter = lower_bound (k);
+        if (iter == end () || compare () (k, iter->first))
+            return end ();
+        return iter;
+    }
+
+    /** returns the mapped value of an entry of this map, to be written. */
+    mapped_type&
+    modify (const_iterator pos)
+    {
+        assert (pos != end ());
+        std::size_t const offset = pos - begin ();
+        detach ();
+        return entries_->data ()[offset].second;
+    }
+
+    /** inserts the value unless its key is present.
+        returns the entry of the key and whether it was inserted.
+    */
+    std::pair <iterator, bool>
+    insert (value_type const& value)
+    {
+        return emplace (value);
+    }
+
+    std::pair <iterator, bool>
+    insert (value_type&& value)
+    {
+        return emplace (std::move (value));
+    }
+
+    template <class... args>
+    std::pair <iterator, bool>
+    emplace (args&&... a)
+    {
+        value_type value (std::forward <args> (a)...);
+        const_iterator const iter = lower_bound (value.first);
+
+        if (iter != end () && !compare () (value.first, iter->first))
+            return std::make_pair (iter, false);
+
+        std::size_t const offset = iter - begin ();
+
+        if (!entries_)
+        {
+            entries_ = std::make_shared <storage> ();
+            entries_->reserve (initialcapacity);
+        }
+        else
+        {
+            detach ();
+        }
+
+        return std::make_pair (
+            entries_->insert (offset, std::move (value)), true);
+    }
+
+    /** erases the entry at an iterator of this map. */
+    iterator
+    erase (const_iterator pos)
+    {
+        assert (pos != end ());
+        std::size_t const offset = pos - begin ();
+        detach ();
+        entries_->erase (offset);
+        return begin () + offset;
+    }
+
+    size_type
+    erase (key_type const& k)
+    {
+        const_iterator const iter = find (k);
+        if (iter == end ())
+            return 0;
+        erase (iter);
+        return 1;
+    }
+
+    /** removes every entry. unshared entries keep their room for reuse. */
+    void
+    clear ()
+    {
+        if (shared ())
+            entries_.reset ();
+        else if (entries_)
+            entries_->clear ();
+    }
+
+    void
+    swap (sortedflatmap& other)
+    {
+        entries_.swap (other.entries_);
+    }
+
+private:
+    // the entries, in a buffer of their own because the const keys keep a
+    // std::vector from moving them along on insert and erase. an entry is
+    // moved by destroying the one in its way and constructing it there.
+    class storage
+    {
+    public:
+        storage ()
+            : data_ (nullptr)
+            , size_ (0)
+            , capacity_ (0)
+        {
+        }
+
+        storage (storage const& other, std::size_t capacity)
+            : storage ()
+        {
+            reserve (std::max (capacity, other.size_));
+            for (; size_ < other.size_; ++size_)
+                ::new (data_ + size_) value_type (other.data_[size_]);
+        }
+
+        storage (storage const&) = delete;
+        storage& operator= (storage const&) = delete;
+
+        ~storage ()
+        {
+            clear ();
+            if (data_)
+                std::allocator <value_type> ().deallocate (data_, capacity_);
+        }
+
+        value_type*
+        data () const
+        {
+            return data_;
+        }
+
+        std::size_t
+        size () const
+        {
+            return size_;
+        }
+
+        std::size_t
+        capacity () const
+        {
+            return capacity_;
+        }
+
+        void
+        reserve (std::size_t capacity)
+        {
+            if (capacity <= capacity_)
+                return;
+
+            value_type* const data =
+                std::allocator <value_type> ().allocate (capacity);
+
+            for (std::size_t i = 0; i < size_; ++i)
+            {
+                ::new (data + i) value_type (std::move (data_[i]));
+                data_[i].~value_type ();
+            }
+
+            if (data_)
+                std::allocator <value_type> ().deallocate (data_, capacity_);
+
+            data_ = data;
+            capacity_ = capacity;
+        }
+
+        value_type*
+        insert (std::size_t offset, value_type&& value)
+        {
+            assert (offset <= size_);
+
+            if (size_ == capacity_)
+                reserve (std::max <std::size_t> (
+                    2 * capacity_, initialcapacity));
+
+            for (std::size_t i = size_; i > offset; --i)
+            {
+                ::new (data_ + i) value_type (std::move (data_[i - 1]));
+                data_[i - 1].~value_type ();
+            }
+
+            ::new (data_ + offset) value_type (std::move (value));
+            ++size_;
+            return data_ + offset;
+        }
+
+        void
+        erase (std::size_t offset)
+        {
+            assert (offset < size_);
+
+            data_[offset].~value_type ();
+
+            for (std::size_t i = offset + 1; i < size_; ++i)
+            {
+                ::new (data_ + i - 1) value_type (std::move (data_[i]));
+                data_[i].~value_type ();
+            }
+
+            --size_;
+        }
+
+        void
+        clear ()
+        {
+            for (std::size_t i = 0; i < size_; ++i)
+                data_[i].~value_type ();
+            size_ = 0;
+        }
+
+    private:
+        value_type* data_;
+        std::size_t size_;
+        std::size_t capacity_;
+    };
+
+    struct entryless
+    {
+        bool
+        operator() (value_type const& lhs, key_type const& rhs) const
+        {
+            return compare () (lhs.first, rhs);
+        }
+
+        bool
+        operator() (key_type const& lhs, value_type const& rhs) const
+        {
+            return compare () (lhs, rhs.first);
+        }
+    };
+
+    // give this map entries of its own before they are written
+    void
+    detach ()
+    {
+        if (shared ())
+        {
+            entries_ = std::make_shared <storage> (*entries_,
+                std::max <std::size_t> (entries_->capacity (),
+                    initialcapacity));
+        }
+    }
+
+    std::shared_ptr <storage> entries_;
+};
+
+template <class key, class t, class compare>
+inline
+void
+swap (sortedflatmap <key, t, compare>& lhs, sortedflatmap <key, t, compare>& rhs)
+{
+    lhs.swap (rhs);
+}
+
+} // ripple
+
+#endif
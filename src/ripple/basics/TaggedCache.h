@@ -27,6 +27,7 @@
 #include <beast/insight.h>
 #include <functional>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 namespace ripple {
@@ -153,6 +154,13 @@ public:
         m_misses = 0;
     }
 
+    /** the hits and misses counted since the stats were cleared. */
+    std::pair <std::uint64_t, std::uint64_t> gethitsandmisses ()
+    {
+        lock_guard lock (m_mutex);
+        return std::make_pair (m_hits, m_misses);
+    }
+
     void clear ()
     {
         lock_guard lock (m_mutex);
@@ -0,0 +1,187 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#include <beastconfig.h>
+#include <ripple/basics/sortedflatmap.h>
+#include <beast/random/xor_shift_engine.h>
+#include <beast/unit_test/suite.h>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ripple {
+
+class sortedflatmap_test : public beast::unit_test::suite
+{
+public:
+    typedef sortedflatmap <int, int> map_type;
+
+    static_assert (std::is_same <map_type::value_type,
+        std::map <int, int>::value_type>::value, "keys must be const");
+
+    template <class map>
+    static std::vector <std::pair <int, int>>
+    contents (map const& m)
+    {
+        return std::vector <std::pair <int, int>> (m.begin (), m.end ());
+    }
+
+    void testordered ()
+    {
+        testcase ("ordered");
+
+        beast::xor_shift_engine g (1);
+        map_type m;
+        std::map <int, int> expected;
+
+        for (int i = 0; i < 5000; ++i)
+        {
+            int const k = g () % 1000;
+
+            switch (g () % 4)
+            {
+            case 0:
+                expect (m.erase (k) == expected.erase (k), "bad erase");
+                break;
+
+            case 1:
+            {
+                auto const found = m.find (k);
+                auto const want = expected.find (k);
+                expect ((found == m.end ()) == (want == expected.end ()),
+                    "bad find");
+                if (found != m.end () && want != expected.end ())
+                    m.modify (found) = want->second = i;
+                break;
+            }
+
+            default:
+            {
+                auto const inserted = m.insert (std::make_pair (k, i));
+                auto const want = expected.insert (std::make_pair (k, i));
+                expect (inserted.second == want.second, "bad insert");
+                expect (inserted.first->second == want.first->second,
+                    "bad insert");
+                break;
+            }
+            }
+        }
+
+        expect (m.size () == expected.size (), "bad size");
+        expect (contents (m) == contents (expected), "bad order");
+
+        for (int k = -1; k <= 1000; k += 7)
+        {
+            map_type const& cm = m;
+            auto const upper = cm.upper_bound (k);
+            auto const want = expected.upper_bound (k);
+            expect ((upper == cm.end ()) == (want == expected.end ()),
+                "bad upper bound");
+            if (upper != cm.end () && want != expected.end ())
+                expect (upper->first == want->first, "bad upper bound");
+        }
+    }
+
+    // entries that own memory, moved along as others are inserted and erased
+    void testowning ()
+    {
+        testcase ("owning entries");
+
+        beast::xor_shift_engine g (2);
+        sortedflatmap <int, std::string> m;
+        std::map <int, std::string> expected;
+
+        for (int i = 0; i < 2000; ++i)
+        {
+            int const k = g () % 200;
+            std::string const value (40, 'a' + (i % 26));
+
+            if (g () % 3 == 0)
+            {
+                expect (m.erase (k) == expected.erase (k), "bad erase");
+            }
+            else
+            {
+                // write a checkpoint, then keep it or drop it
+                sortedflatmap <int, std::string> checkpoint (m);
+                checkpoint.modify (checkpoint.insert (
+                    std::make_pair (k, std::string ())).first) = value;
+
+                if (g () % 2 == 0)
+                {
+                    m.swap (checkpoint);
+                    expected[k] = value;
+                }
+            }
+        }
+
+        typedef std::vector <std::pair <int, std::string>> contents_type;
+        expect (contents_type (m.begin (), m.end ()) ==
+            contents_type (expected.begin (), expected.end ()),
+                "bad contents");
+    }
+
+    void testcopyonwrite ()
+    {
+        testcase ("copy on write");
+
+        map_type m;
+        for (int i = 0; i < 10; ++i)
+            m.insert (std::make_pair (i, i));
+
+        map_type copy (m);
+        expect (m.shared () && copy.shared (), "copy not shared");
+
+        expect (m.find (3) != m.end (), "missing entry");
+        expect (m.upper_bound (3) != m.end (), "missing entry");
+        for (auto const& entry : m)
+            expect (entry.first == entry.second, "bad entry");
+        expect (m.shared (), "read detached the map");
+
+        copy.modify (copy.find (3)) = 30;
+        copy.erase (4);
+        expect (!m.shared () && !copy.shared (), "write did not detach");
+        expect (m.find (3)->second == 3, "write seen through copy");
+        expect (m.find (4) != m.end (), "erase seen through copy");
+        expect (copy.size () == 9, "bad size");
+
+        map_type checkpoint (m);
+        checkpoint.insert (std::make_pair (20, 20));
+        m.swap (checkpoint);
+        expect (m.size () == 11 && checkpoint.size () == 10, "bad swap");
+
+        map_type shared (m);
+        m.clear ();
+        expect (m.empty () && shared.size () == 11, "clear seen through copy");
+        m.insert (std::make_pair (1, 1));
+        expect (shared.find (1)->second == 1 && m.size () == 1, "bad clear");
+    }
+
+    void run ()
+    {
+        testordered ();
+        testowning ();
+        testcopyonwrite ();
+    }
+};
+
+beast_define_testsuite(sortedflatmap,ripple_basics,ripple);
+
+} // ripple
@@ -19,8 +19,16 @@
 
 #include <beastconfig.h>
 #include <ripple/basics/taggedcache.h>
+#include <ripple/basics/shardedtaggedcache.h>
 #include <beast/unit_test/suite.h>
 #include <beast/chrono/manual_clock.h>
+#include <beast/random/xor_shift_engine.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <vector>
 
 namespace ripple {
 
@@ -37,16 +45,15 @@ original object.
 class taggedcache_test : public beast::unit_test::suite
 {
 public:
-    void run ()
+    template <class cache>
+    void testcache ()
     {
         beast::journal const j;
 
         beast::manual_clock <std::chrono::steady_clock> clock;
         clock.set (0);
 
-        typedef int key;
         typedef std::string value;
-        typedef taggedcache <key, value> cache;
 
         cache c ("test", 1, 1, clock, j);
 
@@ -144,8 +151,91 @@ public:
             expect (c.gettracksize() == 0);
         }
     }
+
+    void run ()
+    {
+        testcase ("taggedcache");
+        testcache <taggedcache <int, std::string>> ();
+
+        testcase ("shardedtaggedcache");
+        testcache <shardedtaggedcache <int, std::string>> ();
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// measures fetch and canonicalize throughput with many threads sharing a cache
+class taggedcache_timing_test : public beast::unit_test::suite
+{
+public:
+    typedef std::chrono::high_resolution_clock clock_type;
+
+    enum
+    {
+        keys = 1 << 16,
+        opsperthread = 1000000
+    };
+
+    template <class cache>
+    void
+    test (std::string const& what, std::size_t threads)
+    {
+        beast::journal const j;
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        cache c ("timing", keys, 60, clock, j);
+
+        for (int i = 0; i < keys; ++i)
+            c.insert (i, i);
+
+        auto const start = clock_type::now ();
+
+        std::vector <std::thread> workers;
+        for (std::size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back ([&c, t] ()
+            {
+                beast::xor_shift_engine g (t + 1);
+                std::uniform_int_distribution <int> d (0, keys - 1);
+                for (int n = 0; n < opsperthread; ++n)
+                {
+                    int const key = d (g);
+                    // mostly lookups, as in a shamap descend
+                    if (n % 8)
+                    {
+                        c.fetch (key);
+                    }
+                    else
+                    {
+                        auto p = std::make_shared <int> (key);
+                        c.canonicalize (key, p);
+                    }
+                }
+            });
+        }
+        for (auto& w : workers)
+            w.join ();
+
+        auto const elapsed = clock_type::now () - start;
+        log << std::setw (20) << what << " threads=" << threads << " " <<
+            std::chrono::duration_cast <std::chrono::milliseconds> (
+                elapsed).count () << "ms";
+    }
+
+    void
+    run ()
+    {
+        std::size_t const cores = std::max (2u, std::thread::hardware_concurrency ());
+
+        for (std::size_t threads = 1; threads <= cores; threads *= 2)
+        {
+            test <taggedcache <int, int>> ("taggedcache", threads);
+            test <shardedtaggedcache <int, int>> ("shardedtaggedcache", threads);
+        }
+        pass ();
+    }
 };
 
 beast_define_testsuite(taggedcache,common,ripple);
+beast_define_testsuite_manual(taggedcache_timing,common,ripple);
 
 }
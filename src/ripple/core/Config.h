@@ -314,6 +314,16 @@ public:
     std::uint32_t                      fetch_depth;
     int                         node_size;
 
+    // dividend inputs, from a walk of the base ledger or from the index
+    // kept up to date by published ledgers, optionally checked by a walk.
+    enum dividendindexmode
+    {
+        dividendindexoff,
+        dividendindexon,
+        dividendindexverify
+    };
+    dividendindexmode           dividend_index;
+
     // client behavior
     int                         account_probe_max;      // how far to scan for accounts.
 
@@ -36,6 +36,7 @@ struct configsection
 #define section_cluster_nodes           "cluster_nodes"
 #define section_database_path           "database_path"
 #define section_debug_logfile           "debug_logfile"
+#define section_dividend_index          "dividend_index"
 #define section_elb_support             "elb_support"
 #define section_fee_default             "fee_default"
 #define section_fee_offer               "fee_offer"
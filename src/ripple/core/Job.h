@@ -37,7 +37,9 @@ enum jobtype
     // earlier jobs having lower priority than later jobs. if you wish to
     // insert a job at a specific priority, simply add it at the right location.
 
+    jtnodecopy,      // copy part of a state map during online delete
     jtpack,          // make a fetch pack for a peer
+    jtparallel,      // a share of background work split across threads
     jtpuboldledger,  // an old ledger has been accepted
     jtvalidation_ut, // a validation from an untrusted source
     jtproofwork,     // a proof of work demand from another server
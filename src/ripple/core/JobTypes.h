@@ -39,10 +39,18 @@ public:
     {
         int maxlimit = std::numeric_limits <int>::max ();
 
+        // copy part of a state map during online delete
+        add (jtnodecopy,      "nodecopy",
+            maxlimit, false,  false, 0,     0);
+
         // make a fetch pack for a peer
         add (jtpack,          "makefetchpack",
             1,        true,   false, 0,     0);
 
+        // a share of background work split across worker threads
+        add (jtparallel,      "parallelwork",
+            maxlimit, false,  false, 0,     0);
+
         // an old ledger has been accepted
         add (jtpuboldledger,  "publishacqledger",
             2,        true,   false, 10000, 15000);
@@ -122,7 +130,7 @@ public:
         // a proposal from a trusted source
         add (jtproposal_t,    "trustedproposal",
             maxlimit, false,  false, 100,   500);
-        
+
         // process dividend
         add (jtdividend,      "dividend",
             1,        false,  false, 0,     0);
@@ -0,0 +1,51 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#ifndef ripple_core_paralleljobs_h_included
+#define ripple_core_paralleljobs_h_included
+
+#include <ripple/core/jobqueue.h>
+#include <functional>
+#include <string>
+
+namespace ripple {
+
+/** run work (0) through work (count - 1) on the job queue and wait for them.
+
+    `workers` counts the calling thread, so up to `workers` - 1 jobs of the
+    given type are queued; each one, and the calling thread, repeatedly claims
+    the next unclaimed index until none are left. because the caller takes
+    part it never blocks on a job that has not started, so this is safe to
+    call from inside another job even when every worker thread is busy.
+
+    the shares run at the priority of their type: work a ledger close waits
+    for is queued as jtaccept, background work as jtparallel, which yields
+    to everything but fetch packs and online delete's copy of a state map.
+
+    the first exception thrown by any piece of work is rethrown to the caller
+    once all claimed work has finished.
+*/
+void
+runparalleljobs (jobqueue& jobqueue, jobtype type, std::string const& name,
+    std::size_t count, std::size_t workers,
+        std::function <void (std::size_t)> const& work);
+
+} // ripple
+
+#endif
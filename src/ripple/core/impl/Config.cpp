@@ -279,6 +279,8 @@ config::config ()
 
     account_probe_max       = 10;
 
+    dividend_index          = dividendindexon;
+
     validators_site         = "";
 
     ssl_verify              = true;
@@ -627,6 +629,18 @@ void config::load ()
                     fetch_depth = 10;
             }
 
+            if (getsinglesection (secconfig, section_dividend_index, strtemp))
+            {
+                boost::to_lower (strtemp);
+
+                if (strtemp == "off")
+                    dividend_index = dividendindexoff;
+                else if (strtemp == "verify")
+                    dividend_index = dividendindexverify;
+                else
+                    dividend_index = dividendindexon;
+            }
+
             if (getsinglesection (secconfig, section_path_search_old, strtemp))
                 path_search_old     = beast::lexicalcastthrow <int> (strtemp);
             if (getsinglesection (secconfig, section_path_search, strtemp))
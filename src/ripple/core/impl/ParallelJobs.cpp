@@ -0,0 +1,106 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#include <beastconfig.h>
+#include <ripple/core/paralleljobs.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+namespace ripple {
+
+namespace {
+
+// shared between the caller and the queued jobs. jobs that start after
+// the caller has returned only touch this, never the caller's stack.
+struct parallelstate
+{
+    parallelstate (std::size_t count_,
+            std::function <void (std::size_t)> const& work_)
+        : work (work_)
+        , count (count_)
+        , next (0)
+        , done (0)
+    {
+    }
+
+    std::function <void (std::size_t)> work;
+    std::size_t const count;
+    std::atomic <std::size_t> next;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::size_t done;
+    std::exception_ptr error;
+
+    void drain ()
+    {
+        for (std::size_t i = next++; i < count; i = next++)
+        {
+            std::exception_ptr failed;
+            try
+            {
+                work (i);
+            }
+            catch (...)
+            {
+                failed = std::current_exception ();
+            }
+
+            std::lock_guard <std::mutex> lock (mutex);
+            if (failed && !error)
+                error = failed;
+            if (++done == count)
+                cond.notify_all ();
+        }
+    }
+};
+
+}
+
+void
+runparalleljobs (jobqueue& jobqueue, jobtype type, std::string const& name,
+    std::size_t count, std::size_t workers,
+        std::function <void (std::size_t)> const& work)
+{
+    if (count == 0)
+        return;
+
+    auto state = std::make_shared <parallelstate> (count, work);
+
+    // the calling thread is one of the workers
+    for (std::size_t i = 1; i < std::min (workers, count); ++i)
+    {
+        jobqueue.addjob (type, name,
+            [state] (job&) { state->drain (); });
+    }
+
+    state->drain ();
+
+    std::unique_lock <std::mutex> lock (state->mutex);
+    state->cond.wait (lock, [&state] { return state->done == state->count; });
+
+    if (state->error)
+        std::rethrow_exception (state->error);
+}
+
+} // ripple
@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#ifndef ripple_crypto_ecdsakeycache_h_included
+#define ripple_crypto_ecdsakeycache_h_included
+
+#include <ripple/crypto/ec_key.h>
+#include <ripple/basics/blob.h>
+#include <ripple/basics/unorderedcontainers.h>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+
+namespace ripple {
+
+/** a cache of parsed ecdsa public keys, least recently used go first.
+
+    parsing a compressed public key recovers the point on the curve, which
+    costs a good fraction of a signature check. the same accounts and
+    validators sign message after message, so their parsed keys are kept
+    and shared by every thread that verifies with them.
+*/
+class ecdsakeycache
+{
+public:
+    typedef std::shared_ptr <openssl::ec_key const> key_ptr;
+
+    explicit
+    ecdsakeycache (std::size_t capacity);
+
+    ecdsakeycache (ecdsakeycache const&) = delete;
+    ecdsakeycache& operator= (ecdsakeycache const&) = delete;
+
+    /** returns the parsed key, or nullptr if serialized is not a key.
+        keys that do not parse are not kept.
+    */
+    key_ptr
+    get (blob const& serialized);
+
+    std::size_t
+    size () const;
+
+    std::uint64_t
+    hits () const;
+
+    std::uint64_t
+    misses () const;
+
+private:
+    typedef std::list <std::pair <blob, key_ptr>> list_type;
+
+    std::size_t const capacity_;
+    std::mutex mutable mutex_;
+
+    // most recently used first
+    list_type list_;
+    hardened_hash_map <blob, list_type::iterator> map_;
+    std::uint64_t hits_ = 0;
+    std::uint64_t misses_ = 0;
+};
+
+}
+
+#endif
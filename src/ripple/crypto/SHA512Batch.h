@@ -0,0 +1,65 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#ifndef ripple_crypto_sha512batch_h_included
+#define ripple_crypto_sha512batch_h_included
+
+#include <cstddef>
+
+namespace ripple {
+
+/** one message of a batch hashed by sha512half. */
+struct sha512halfjob
+{
+    void const* data;
+    std::size_t size;
+
+    /** receives the first 32 bytes of the sha-512 digest of the message. */
+    unsigned char* digest;
+};
+
+/** computes the sha-512-half of several independent messages.
+
+    on processors with avx2 the messages are hashed four at a time, one per
+    64-bit lane, which is how small messages such as shamap node preimages
+    keep the vector units busy. elsewhere, and for a message left over,
+    each is hashed on its own.
+
+    @param jobs the messages and where their digests go.
+    @param count the number of jobs.
+*/
+void sha512half (sha512halfjob const* jobs, std::size_t count);
+
+namespace detail {
+
+/** hashes every job on its own. */
+void sha512half_scalar (sha512halfjob const* jobs, std::size_t count);
+
+/** returns true if sha512half_avx2 can run on this processor. */
+bool sha512half_hasavx2 ();
+
+/** hashes up to four jobs together, the processor must support avx2. */
+void sha512half_avx2 (sha512halfjob const* jobs, std::size_t count);
+
+}
+
+}
+
+#endif
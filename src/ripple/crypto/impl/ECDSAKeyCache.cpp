@@ -0,0 +1,103 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#include <beastconfig.h>
+#include <ripple/crypto/ecdsakeycache.h>
+#include <ripple/crypto/ecdsa.h>
+#include <cassert>
+
+namespace ripple {
+
+ecdsakeycache::ecdsakeycache (std::size_t capacity)
+    : capacity_ (capacity)
+{
+    assert (capacity_ > 0);
+}
+
+ecdsakeycache::key_ptr
+ecdsakeycache::get (blob const& serialized)
+{
+    {
+        std::lock_guard <std::mutex> lock (mutex_);
+
+        auto const iter = map_.find (serialized);
+        if (iter != map_.end ())
+        {
+            ++hits_;
+            list_.splice (list_.begin (), list_, iter->second);
+            return iter->second->second;
+        }
+
+        ++misses_;
+    }
+
+    if (serialized.empty ())
+        return nullptr;
+
+    // parsed without the lock, two threads may parse the same key
+    openssl::ec_key parsed (ecdsapublickey (serialized));
+
+    if (!parsed.valid ())
+        return nullptr;
+
+    // copying an ec_key duplicates it, so the parsed key changes hands
+    key_ptr key (new openssl::ec_key (
+        openssl::ec_key::acquire (parsed.release ())));
+
+    std::lock_guard <std::mutex> lock (mutex_);
+
+    auto const iter = map_.find (serialized);
+    if (iter != map_.end ())
+        return iter->second->second;
+
+    list_.emplace_front (serialized, key);
+    map_.emplace (serialized, list_.begin ());
+
+    if (list_.size () > capacity_)
+    {
+        map_.erase (list_.back ().first);
+        list_.pop_back ();
+    }
+
+    return key;
+}
+
+std::size_t
+ecdsakeycache::size () const
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    return list_.size ();
+}
+
+std::uint64_t
+ecdsakeycache::hits () const
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    return hits_;
+}
+
+std::uint64_t
+ecdsakeycache::misses () const
+{
+    std::lock_guard <std::mutex> lock (mutex_);
+    return misses_;
+}
+
+}
@@ -0,0 +1,327 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#include <beastconfig.h>
+#include <ripple/crypto/sha512batch.h>
+#include <beast/module/core/system/systemstats.h>
+#include <openssl/sha.h>
+#include <cstdint>
+#include <cstring>
+
+#ifdef use_sha512_asm
+#include <beast/crypto/sha512asm.h>
+#endif
+
+#if defined (__gnuc__) && (defined (__x86_64__) || defined (__i386__))
+#define ripple_sha512_avx2 1
+#include <immintrin.h>
+#else
+#define ripple_sha512_avx2 0
+#endif
+
+namespace ripple {
+
+namespace detail {
+
+void sha512half_scalar (sha512halfjob const* jobs, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        unsigned char digest[64];
+#ifndef use_sha512_asm
+        sha512 (static_cast<unsigned char const*> (jobs[i].data),
+            jobs[i].size, digest);
+#else
+        sha512asm (static_cast<unsigned char const*> (jobs[i].data),
+            jobs[i].size, digest);
+#endif
+        std::memcpy (jobs[i].digest, digest, 32);
+    }
+}
+
+#if ripple_sha512_avx2
+
+namespace {
+
+std::uint64_t const k512[80] =
+{
+    0x428a2f98d728ae22ull, 0x7137449123ef65cdull,
+    0xb5c0fbcfec4d3b2full, 0xe9b5dba58189dbbcull,
+    0x3956c25bf348b538ull, 0x59f111f1b605d019ull,
+    0x923f82a4af194f9bull, 0xab1c5ed5da6d8118ull,
+    0xd807aa98a3030242ull, 0x12835b0145706fbeull,
+    0x243185be4ee4b28cull, 0x550c7dc3d5ffb4e2ull,
+    0x72be5d74f27b896full, 0x80deb1fe3b1696b1ull,
+    0x9bdc06a725c71235ull, 0xc19bf174cf692694ull,
+    0xe49b69c19ef14ad2ull, 0xefbe4786384f25e3ull,
+    0x0fc19dc68b8cd5b5ull, 0x240ca1cc77ac9c65ull,
+    0x2de92c6f592b0275ull, 0x4a7484aa6ea6e483ull,
+    0x5cb0a9dcbd41fbd4ull, 0x76f988da831153b5ull,
+    0x983e5152ee66dfabull, 0xa831c66d2db43210ull,
+    0xb00327c898fb213full, 0xbf597fc7beef0ee4ull,
+    0xc6e00bf33da88fc2ull, 0xd5a79147930aa725ull,
+    0x06ca6351e003826full, 0x142929670a0e6e70ull,
+    0x27b70a8546d22ffcull, 0x2e1b21385c26c926ull,
+    0x4d2c6dfc5ac42aedull, 0x53380d139d95b3dfull,
+    0x650a73548baf63deull, 0x766a0abb3c77b2a8ull,
+    0x81c2c92e47edaee6ull, 0x92722c851482353bull,
+    0xa2bfe8a14cf10364ull, 0xa81a664bbc423001ull,
+    0xc24b8b70d0f89791ull, 0xc76c51a30654be30ull,
+    0xd192e819d6ef5218ull, 0xd69906245565a910ull,
+    0xf40e35855771202aull, 0x106aa07032bbd1b8ull,
+    0x19a4c116b8d2d0c8ull, 0x1e376c085141ab53ull,
+    0x2748774cdf8eeb99ull, 0x34b0bcb5e19b48a8ull,
+    0x391c0cb3c5c95a63ull, 0x4ed8aa4ae3418acbull,
+    0x5b9cca4f7763e373ull, 0x682e6ff3d6b2b8a3ull,
+    0x748f82ee5defb2fcull, 0x78a5636f43172f60ull,
+    0x84c87814a1f0ab72ull, 0x8cc702081a6439ecull,
+    0x90befffa23631e28ull, 0xa4506cebde82bde9ull,
+    0xbef9a3f7b2c67915ull, 0xc67178f2e372532bull,
+    0xca273eceea26619cull, 0xd186b8c721c0c207ull,
+    0xeada7dd6cde0eb1eull, 0xf57d4f7fee6ed178ull,
+    0x06f067aa72176fbaull, 0x0a637dc5a2c898a6ull,
+    0x113f9804bef90daeull, 0x1b710b35131c471bull,
+    0x28db77f523047d84ull, 0x32caab7b40c72493ull,
+    0x3c9ebe0a15c9bebcull, 0x431d67c49c100d4cull,
+    0x4cc5d4becb3e42b6ull, 0x597f299cfc657e2aull,
+    0x5fcb6fab3ad6faecull, 0x6c44198c4a475817ull
+};
+
+std::uint64_t const initial512[8] =
+{
+    0x6a09e667f3bcc908ull, 0xbb67ae8584caa73bull,
+    0x3c6ef372fe94f82bull, 0xa54ff53a5f1d36f1ull,
+    0x510e527fade682d1ull, 0x9b05688c2b3e6c1full,
+    0x1f83d9abfb41bd6bull, 0x5be0cd19137e2179ull
+};
+
+std::size_t const lanes = 4;
+std::size_t const blockbytes = 128;
+
+inline std::uint64_t load64 (unsigned char const* p)
+{
+    return (std::uint64_t (p[0]) << 56) | (std::uint64_t (p[1]) << 48) |
+        (std::uint64_t (p[2]) << 40) | (std::uint64_t (p[3]) << 32) |
+        (std::uint64_t (p[4]) << 24) | (std::uint64_t (p[5]) << 16) |
+        (std::uint64_t (p[6]) << 8) | std::uint64_t (p[7]);
+}
+
+inline void store64 (unsigned char* p, std::uint64_t v)
+{
+    for (int i = 7; i >= 0; --i, v >>= 8)
+        p[i] = static_cast<unsigned char> (v);
+}
+
+// the blocks of one message: those read in place from the message, then
+// one or two from a buffer holding its last bytes and the padding
+struct lane
+{
+    unsigned char const* data = nullptr;
+    std::size_t direct = 0;
+    std::size_t blocks = 0;
+    unsigned char tail[2 * blockbytes];
+
+    void setup (void const* message, std::size_t size)
+    {
+        data = static_cast<unsigned char const*> (message);
+        direct = size / blockbytes;
+
+        std::size_t const left = size % blockbytes;
+        std::size_t const tailblocks = (left + 17 > blockbytes) ? 2 : 1;
+        std::memset (tail, 0, sizeof (tail));
+        if (left != 0)
+            std::memcpy (tail, data + direct * blockbytes, left);
+        tail[left] = 0x80;
+        store64 (tail + tailblocks * blockbytes - 8, std::uint64_t (size) << 3);
+        blocks = direct + tailblocks;
+    }
+
+    unsigned char const* block (std::size_t i) const
+    {
+        if (i < direct)
+            return data + i * blockbytes;
+        if (i < blocks)
+            return tail + (i - direct) * blockbytes;
+        return tail;
+    }
+};
+
+}
+
+#define ripple_rotr(x, n) \
+    _mm256_or_si256 (_mm256_srli_epi64 ((x), (n)), \
+        _mm256_slli_epi64 ((x), 64 - (n)))
+
+#define ripple_s0(x) _mm256_xor_si256 (_mm256_xor_si256 ( \
+    ripple_rotr ((x), 28), ripple_rotr ((x), 34)), ripple_rotr ((x), 39))
+#define ripple_s1(x) _mm256_xor_si256 (_mm256_xor_si256 ( \
+    ripple_rotr ((x), 14), ripple_rotr ((x), 18)), ripple_rotr ((x), 41))
+#define ripple_g0(x) _mm256_xor_si256 (_mm256_xor_si256 ( \
+    ripple_rotr ((x), 1), ripple_rotr ((x), 8)), _mm256_srli_epi64 ((x), 7))
+#define ripple_g1(x) _mm256_xor_si256 (_mm256_xor_si256 ( \
+    ripple_rotr ((x), 19), ripple_rotr ((x), 61)), _mm256_srli_epi64 ((x), 6))
+#define ripple_ch(x, y, z) _mm256_xor_si256 ( \
+    _mm256_and_si256 ((x), (y)), _mm256_andnot_si256 ((x), (z)))
+#define ripple_maj(x, y, z) _mm256_xor_si256 (_mm256_xor_si256 ( \
+    _mm256_and_si256 ((x), (y)), _mm256_and_si256 ((x), (z))), \
+        _mm256_and_si256 ((y), (z)))
+
+__attribute__ ((target ("avx2")))
+void sha512half_avx2 (sha512halfjob const* jobs, std::size_t count)
+{
+    std::size_t const used = (count < lanes) ? count : lanes;
+    if (used == 0)
+        return;
+
+    lane l[lanes];
+    std::size_t blocks = 0;
+    for (std::size_t i = 0; i < used; ++i)
+    {
+        l[i].setup (jobs[i].data, jobs[i].size);
+        if (l[i].blocks > blocks)
+            blocks = l[i].blocks;
+    }
+
+    __m256i state[8];
+    for (int i = 0; i < 8; ++i)
+        state[i] = _mm256_set1_epi64x (initial512[i]);
+
+    for (std::size_t b = 0; b < blocks; ++b)
+    {
+        unsigned char const* p[lanes];
+        std::uint64_t done[lanes];
+        for (std::size_t i = 0; i < lanes; ++i)
+        {
+            // an unused lane follows the first and its result is dropped
+            p[i] = l[(i < used) ? i : 0].block (b);
+            done[i] = (i < used && b < l[i].blocks) ? 0 : ~std::uint64_t (0);
+        }
+
+        __m256i w[16];
+        for (int t = 0; t < 16; ++t)
+        {
+            w[t] = _mm256_set_epi64x (load64 (p[3] + 8 * t),
+                load64 (p[2] + 8 * t), load64 (p[1] + 8 * t),
+                    load64 (p[0] + 8 * t));
+        }
+
+        __m256i a = state[0], b_ = state[1], c = state[2], d = state[3];
+        __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int t = 0; t < 80; ++t)
+        {
+            if (t >= 16)
+            {
+                w[t & 15] = _mm256_add_epi64 (_mm256_add_epi64 (
+                    ripple_g1 (w[(t - 2) & 15]), w[(t - 7) & 15]),
+                        _mm256_add_epi64 (ripple_g0 (w[(t - 15) & 15]),
+                            w[t & 15]));
+            }
+
+            __m256i const t1 = _mm256_add_epi64 (_mm256_add_epi64 (
+                _mm256_add_epi64 (h, ripple_s1 (e)), ripple_ch (e, f, g)),
+                    _mm256_add_epi64 (_mm256_set1_epi64x (k512[t]),
+                        w[t & 15]));
+            __m256i const t2 = _mm256_add_epi64 (
+                ripple_s0 (a), ripple_maj (a, b_, c));
+
+            h = g;
+            g = f;
+            f = e;
+            e = _mm256_add_epi64 (d, t1);
+            d = c;
+            c = b_;
+            b_ = a;
+            a = _mm256_add_epi64 (t1, t2);
+        }
+
+        // lanes whose message has ended keep their state
+        __m256i const keep = _mm256_set_epi64x (
+            done[3], done[2], done[1], done[0]);
+        __m256i const v[8] = { a, b_, c, d, e, f, g, h };
+        for (int i = 0; i < 8; ++i)
+        {
+            state[i] = _mm256_blendv_epi8 (
+                _mm256_add_epi64 (state[i], v[i]), state[i], keep);
+        }
+    }
+
+    std::uint64_t words[4][lanes];
+    for (int i = 0; i < 4; ++i)
+        _mm256_storeu_si256 (reinterpret_cast<__m256i*> (words[i]), state[i]);
+
+    for (std::size_t i = 0; i < used; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+            store64 (jobs[i].digest + 8 * j, words[j][i]);
+    }
+}
+
+#undef ripple_rotr
+#undef ripple_s0
+#undef ripple_s1
+#undef ripple_g0
+#undef ripple_g1
+#undef ripple_ch
+#undef ripple_maj
+
+bool sha512half_hasavx2 ()
+{
+    static bool const hasavx2 = beast::systemstats::hasavx2 ();
+    return hasavx2;
+}
+
+#else
+
+void sha512half_avx2 (sha512halfjob const* jobs, std::size_t count)
+{
+    sha512half_scalar (jobs, count);
+}
+
+bool sha512half_hasavx2 ()
+{
+    return false;
+}
+
+#endif
+
+}
+
+void sha512half (sha512halfjob const* jobs, std::size_t count)
+{
+    if (count < 2 || !detail::sha512half_hasavx2 ())
+    {
+        detail::sha512half_scalar (jobs, count);
+        return;
+    }
+
+    // a single message left over is cheaper hashed on its own
+    while (count >= 2)
+    {
+        std::size_t const n = (count < 4) ? count : 4;
+        detail::sha512half_avx2 (jobs, n);
+        jobs += n;
+        count -= n;
+    }
+
+    detail::sha512half_scalar (jobs, count);
+}
+
+}
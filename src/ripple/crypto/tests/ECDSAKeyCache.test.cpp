@@ -0,0 +1,96 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#include <beastconfig.h>
+#include <ripple/crypto/ecdsakeycache.h>
+#include <ripple/crypto/ecdsa.h>
+#include <beast/unit_test/suite.h>
+
+namespace ripple {
+
+class ecdsakeycache_test : public beast::unit_test::suite
+{
+public:
+    static blob
+    publickey (openssl::ec_key const& key)
+    {
+        blob result (33);
+        key.get_public_key (&result[0]);
+        return result;
+    }
+
+    void
+    run ()
+    {
+        std::vector <blob> keys;
+        uint256 hash;
+        for (int i = 1; i <= 3; ++i)
+        {
+            uint256 secret;
+            secret = i;
+            keys.push_back (publickey (ecdsaprivatekey (secret)));
+        }
+
+        testcase ("verify");
+        {
+            uint256 secret;
+            secret = 1;
+            hash = 42;
+            blob const sig = ecdsasign (hash, ecdsaprivatekey (secret));
+
+            ecdsakeycache cache (2);
+            auto const key = cache.get (keys[0]);
+            expect (key && ecdsaverify (hash, sig, *key), "bad verify");
+            expect (cache.get (keys[0]) == key, "key not kept");
+            expect (cache.hits () == 1 && cache.misses () == 1, "bad counts");
+        }
+
+        testcase ("invalid");
+        {
+            ecdsakeycache cache (2);
+            blob bad (keys[0]);
+            bad[0] = 0x05;
+            expect (!cache.get (bad), "invalid key parsed");
+            expect (!cache.get (blob ()), "empty key parsed");
+            expect (cache.size () == 0, "invalid key kept");
+        }
+
+        testcase ("eviction");
+        {
+            ecdsakeycache cache (2);
+            auto const first = cache.get (keys[0]);
+            cache.get (keys[1]);
+            cache.get (keys[0]);
+            cache.get (keys[2]);
+            expect (cache.size () == 2, "bad size");
+
+            // the second key was used least recently
+            std::uint64_t const misses = cache.misses ();
+            expect (cache.get (keys[0]) == first, "recent key evicted");
+            expect (cache.misses () == misses, "recent key evicted");
+            cache.get (keys[1]);
+            expect (cache.misses () == misses + 1, "old key kept");
+        }
+    }
+};
+
+beast_define_testsuite(ecdsakeycache,crypto,ripple);
+
+}
@@ -0,0 +1,178 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+
+#include <beastconfig.h>
+#include <ripple/crypto/sha512batch.h>
+#include <ripple/basics/strhex.h>
+#include <beast/random/rngfill.h>
+#include <beast/random/xor_shift_engine.h>
+#include <beast/unit_test/suite.h>
+#include <boost/algorithm/string/predicate.hpp>
+#include <chrono>
+#include <iomanip>
+#include <vector>
+
+namespace ripple {
+
+class sha512batch_test : public beast::unit_test::suite
+{
+public:
+    typedef std::vector <unsigned char> bytes;
+
+    // hashes every message with the given function, returns the digests
+    template <class hasher>
+    static std::vector <bytes>
+    hashall (std::vector <bytes> const& messages, hasher&& h)
+    {
+        std::vector <bytes> digests (messages.size (), bytes (32));
+        std::vector <sha512halfjob> jobs;
+        for (std::size_t i = 0; i < messages.size (); ++i)
+        {
+            sha512halfjob job;
+            job.data = messages[i].data ();
+            job.size = messages[i].size ();
+            job.digest = digests[i].data ();
+            jobs.push_back (job);
+        }
+        h (jobs.data (), jobs.size ());
+        return digests;
+    }
+
+    void
+    testvector ()
+    {
+        testcase ("vector");
+
+        std::vector <bytes> const messages (5, bytes {'a', 'b', 'c'});
+        for (auto const& digest : hashall (messages, sha512half))
+        {
+            expect (boost::iequals (strhex (digest.begin (), 32),
+                "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea2"
+                "0a9eeee64b55d39a"), "wrong digest");
+        }
+    }
+
+    void
+    testsizes ()
+    {
+        testcase ("sizes");
+
+        // sizes on either side of where the padding needs another block
+        std::size_t const sizes[] =
+            { 0, 1, 111, 112, 127, 128, 129, 239, 240, 256, 516, 1000 };
+
+        beast::xor_shift_engine g (1);
+        std::vector <bytes> messages;
+        for (auto size : sizes)
+        {
+            messages.emplace_back (size);
+            beast::rngfill (messages.back ().data (), size, g);
+        }
+
+        auto const expected = hashall (messages, detail::sha512half_scalar);
+
+        // every batch length, so full and partial groups of lanes are used
+        for (std::size_t n = 0; n <= messages.size (); ++n)
+        {
+            std::vector <bytes> const batch (
+                messages.begin (), messages.begin () + n);
+            expect (hashall (batch, sha512half) == std::vector <bytes> (
+                expected.begin (), expected.begin () + n), "wrong digest");
+        }
+
+        if (detail::sha512half_hasavx2 ())
+        {
+            for (std::size_t i = 0; i + 4 <= messages.size (); ++i)
+            {
+                std::vector <bytes> const batch (
+                    messages.begin () + i, messages.begin () + i + 4);
+                expect (hashall (batch, detail::sha512half_avx2) ==
+                    std::vector <bytes> (expected.begin () + i,
+                        expected.begin () + i + 4), "wrong avx2 digest");
+            }
+        }
+    }
+
+    void
+    run ()
+    {
+        testvector ();
+        testsizes ();
+    }
+};
+
+// hashes messages the size of shamap inner node preimages one at a time
+// and in batches.
+class sha512batch_timing_test : public beast::unit_test::suite
+{
+public:
+    typedef std::chrono::high_resolution_clock clock_type;
+
+    enum
+    {
+        messages = 65536,
+        messagesize = 4 + 16 * 32,
+        rounds = 10
+    };
+
+    template <class hasher>
+    double
+    time (std::vector <sha512halfjob> const& jobs, hasher&& h)
+    {
+        auto const start = clock_type::now ();
+        for (int i = 0; i < rounds; ++i)
+            h (jobs.data (), jobs.size ());
+        return std::chrono::duration_cast <std::chrono::duration <double>> (
+            clock_type::now () - start).count ();
+    }
+
+    void
+    run ()
+    {
+        testcase ("inner nodes");
+
+        beast::xor_shift_engine g (1);
+        std::vector <unsigned char> data (messages * messagesize);
+        beast::rngfill (data.data (), data.size (), g);
+        std::vector <unsigned char> digests (messages * 32);
+
+        std::vector <sha512halfjob> jobs (messages);
+        for (std::size_t i = 0; i < jobs.size (); ++i)
+        {
+            jobs[i].data = &data[i * messagesize];
+            jobs[i].size = messagesize;
+            jobs[i].digest = &digests[i * 32];
+        }
+
+        double const scalar = time (jobs, detail::sha512half_scalar);
+        double const batch = time (jobs, sha512half);
+
+        log << std::fixed << std::setprecision (3) <<
+            "scalar " << scalar << "s, batch " << batch << "s (" <<
+            (detail::sha512half_hasavx2 () ? "avx2" : "no avx2") << "), " <<
+            std::setprecision (2) << (scalar / batch) << "x";
+        pass ();
+    }
+};
+
+beast_define_testsuite(sha512batch,crypto,ripple);
+beast_define_testsuite_manual(sha512batch_timing,crypto,ripple);
+
+}
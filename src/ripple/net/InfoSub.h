@@ -26,7 +26,9 @@
 #include <ripple/resource/consumer.h>
 #include <ripple/protocol/book.h>
 #include <beast/threads/stoppable.h>
+#include <memory>
 #include <mutex>
+#include <string>
 
 namespace ripple {
 
@@ -52,6 +54,9 @@ public:
 
     typedef resource::consumer consumer;
 
+    /** a message serialized once and shared by every subscriber it goes to. */
+    typedef std::shared_ptr<std::string const> serializedptr;
+
 public:
     /** abstracts the source of subscription data.
     */
@@ -106,7 +111,7 @@ public:
 
     // vfalco note why is this virtual?
     virtual void send (
-        json::value const& jvobj, std::string const& sobj, bool broadcast);
+        json::value const& jvobj, serializedptr const& sobj, bool broadcast);
 
     std::uint64_t getseq ();
 
@@ -67,7 +67,7 @@ resource::consumer& infosub::getconsumer()
 }
 
 void infosub::send (
-    json::value const& jvobj, std::string const& sobj, bool broadcast)
+    json::value const& jvobj, serializedptr const& sobj, bool broadcast)
 {
     send (jvobj, broadcast);
 }
@@ -65,6 +65,18 @@ public:
     */
     virtual status fetch (void const* key, nodeobject::ptr* pobject) = 0;
 
+    /** fetch a group of objects.
+        backends that can read several keys at once, or read them in a
+        better order, should do so here. the result for each key is as
+        for @ref fetch.
+        @note this will be called concurrently.
+        @param keys pointers to the key data.
+        @param pobjects [out] the created objects, one per key.
+        @return the result of the operation for each key.
+    */
+    virtual std::vector <status> fetchbatch (std::vector <void const*> const& keys,
+        std::vector <nodeobject::ptr>* pobjects) = 0;
+
     /** store a single object.
         depending on the implementation this may happen immediately
         or deferred using a scheduled task.
@@ -74,8 +86,10 @@ public:
     virtual void store (nodeobject::ptr const& object) = 0;
 
     /** store a group of objects.
-        @note this function will not be called concurrently with
-              itself or @ref store.
+        @note this will be called concurrently with itself and with
+              @ref store, a shamap flush writes each subtree below the
+              root as its own batch. backends must make a batch safe to
+              write alongside others, see each backend's storebatch.
     */
     virtual void storebatch (batch const& batch) = 0;
 
@@ -71,6 +71,17 @@ public:
     */
     virtual nodeobject::pointer fetch (uint256 const& hash) = 0;
 
+    /** fetch a group of objects.
+        the objects that are not in the cache are read from the backend
+        in a single batch.
+
+        @note this can be called concurrently.
+        @param hashes the keys of the objects to retrieve.
+        @return one object per key, or nullptr where it couldn't be retrieved.
+    */
+    virtual std::vector <nodeobject::pointer> fetchbatch (
+        std::vector <uint256> const& hashes) = 0;
+
     /** fetch an object without waiting.
         if i/o is required to determine whether or not the object is present,
         `false` is returned. otherwise, `true` is returned and `object` is set
@@ -109,6 +120,16 @@ public:
                         blob&& data,
                         uint256 const& hash) = 0;
 
+    /** store a batch of objects.
+
+        the objects are cached like those passed to store and handed to the
+        backend in a single write.
+
+        @note this can be called concurrently.
+        @param batch the objects to store.
+    */
+    virtual void storebatch (batch const& batch) = 0;
+
     /** visit every object in the database
         this is usually called during import.
 
@@ -21,6 +21,7 @@
 #define ripple_nodestore_databaserotating_h_included
 
 #include <ripple/nodestore/database.h>
+#include <ripple/basics/shardedtaggedcache.h>
 
 namespace ripple {
 namespace nodestore {
@@ -35,7 +36,7 @@ class databaserotating
 public:
     virtual ~databaserotating() = default;
 
-    virtual taggedcache <uint256, nodeobject>& getpositivecache() = 0;
+    virtual shardedtaggedcache <uint256, nodeobject>& getpositivecache() = 0;
 
     virtual std::mutex& peekmutex() const = 0;
 
@@ -48,6 +49,15 @@ public:
 
     /** ensure that node is in writablebackend */
     virtual nodeobject::ptr fetchnode (uint256 const& hash) = 0;
+
+    /** ensure that nodes are in writablebackend.
+        the nodes are read and written in batches, bypassing the caches.
+        objects is set to the node read for each hash, from either backend,
+        or null if neither has it.
+        returns the number of nodes copied from archivebackend.
+    */
+    virtual std::size_t copynodes (std::vector <uint256> const& hashes,
+        std::vector <nodeobject::ptr>& objects) = 0;
 };
 
 }
@@ -32,7 +32,12 @@ enum
     // this is only used to pre-allocate the array for
     // batch objects and does not affect the amount written.
     //
-    batchwritepreallocationsize = 128
+    batchwritepreallocationsize = 128,
+
+    // the most objects the async read threads fetch from the
+    // backend in one batch.
+    //
+    batchreadsize = 64
 };
 
 /** return codes from backend operations. */
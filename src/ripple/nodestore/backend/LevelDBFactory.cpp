@@ -30,6 +30,8 @@
 #include <ripple/nodestore/impl/decodedblob.h>
 #include <ripple/nodestore/impl/encodedblob.h>
 #include <beast/cxx14/memory.h> // <memory>
+#include <algorithm>
+#include <cstring>
 
 namespace ripple {
 namespace nodestore {
@@ -44,6 +46,7 @@ private:
 public:
     beast::journal m_journal;
     size_t const m_keybytes;
+    valueformat const m_format;
     scheduler& m_scheduler;
     batchwriter m_batch;
     std::string m_name;
@@ -55,6 +58,7 @@ public:
         : m_deletepath (false)
         , m_journal (journal)
         , m_keybytes (keybytes)
+        , m_format (parsevalueformat (keyvalues))
         , m_scheduler (scheduler)
         , m_batch (*this, scheduler)
         , m_name (keyvalues ["path"].tostdstring ())
@@ -135,12 +139,47 @@ public:
 
     status
     fetch (void const* key, nodeobject::ptr* pobject)
+    {
+        return fetchwith (leveldb::readoptions (), key, pobject);
+    }
+
+    std::vector <status>
+    fetchbatch (std::vector <void const*> const& keys,
+        std::vector <nodeobject::ptr>* pobjects)
+    {
+        std::vector <status> results (keys.size ());
+        pobjects->resize (keys.size ());
+
+        // read the keys in order from one snapshot, so each table
+        // block is visited once for the whole batch
+        std::vector <std::size_t> order (keys.size ());
+        for (std::size_t i = 0; i < order.size (); ++i)
+            order[i] = i;
+        std::sort (order.begin (), order.end (),
+            [this, &keys] (std::size_t lhs, std::size_t rhs)
+            {
+                return std::memcmp (keys[lhs], keys[rhs], m_keybytes) < 0;
+            });
+
+        leveldb::readoptions options;
+        options.snapshot = m_db->getsnapshot ();
+
+        for (auto i : order)
+            results[i] = fetchwith (options, keys[i], &(*pobjects)[i]);
+
+        m_db->releasesnapshot (options.snapshot);
+
+        return results;
+    }
+
+    status
+    fetchwith (leveldb::readoptions const& options,
+        void const* key, nodeobject::ptr* pobject)
     {
         pobject->reset ();
 
         status status (ok);
 
-        leveldb::readoptions const options;
         leveldb::slice const slice (static_cast <char const*> (key), m_keybytes);
         std::string string;
 
@@ -189,13 +228,14 @@ public:
     void
     storebatch (batch const& batch)
     {
+        // leveldb serializes concurrent writes itself
         leveldb::writebatch wb;
 
         encodedblob encoded;
 
         for (auto const& e : batch)
         {
-            encoded.prepare (e);
+            encoded.prepare (e, m_format);
 
             wb.put (
                 leveldb::slice (reinterpret_cast <char const*> (
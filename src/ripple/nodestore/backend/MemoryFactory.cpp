@@ -128,6 +128,28 @@ public:
         return ok;
     }
 
+    std::vector <status>
+    fetchbatch (std::vector <void const*> const& keys,
+        std::vector <nodeobject::ptr>* pobjects)
+    {
+        std::vector <status> results (keys.size (), notfound);
+        pobjects->assign (keys.size (), nullptr);
+
+        std::lock_guard<std::mutex> _(db_->mutex);
+
+        for (std::size_t i = 0; i < keys.size (); ++i)
+        {
+            map::iterator iter = db_->table.find (uint256::fromvoid (keys[i]));
+            if (iter != db_->table.end())
+            {
+                (*pobjects)[i] = iter->second;
+                results[i] = ok;
+            }
+        }
+
+        return results;
+    }
+
     void
     store (nodeobject::ref object)
     {
@@ -138,6 +160,7 @@ public:
     void
     storebatch (batch const& batch)
     {
+        // each store takes the database mutex
         for (auto const& e : batch)
             store (e);
     }
@@ -34,8 +34,10 @@
 #include <chrono>
 #include <cstdio>
 #include <cstdint>
+#include <cstring>
 #include <exception>
 #include <memory>
+#include <vector>
 
 namespace ripple {
 namespace nodestore {
@@ -46,9 +48,12 @@ class nudbbackend
 public:
     enum
     {
-        // this needs to be tuned for the
-        // distribution of data sizes.
-        arena_alloc_size = 16 * 1024 * 1024,
+        // the default arena size, [node_db] arena_mb
+        // tunes it for the distribution of data sizes.
+        default_arena_alloc_size = 16 * 1024 * 1024,
+
+        // bytes of an encoded object before its data
+        encoded_prefix_size = 9,
 
         currenttype = 1
     };
@@ -59,6 +64,7 @@ public:
     beast::journal journal_;
     size_t const keybytes_;
     std::string const name_;
+    std::size_t const arena_alloc_size_;
     api::store db_;
     std::atomic <bool> deletepath_;
     scheduler& scheduler_;
@@ -68,6 +74,7 @@ public:
         : journal_ (journal)
         , keybytes_ (keybytes)
         , name_ (keyvalues ["path"].tostdstring ())
+        , arena_alloc_size_ (arenasize (keyvalues))
         , deletepath_(false)
         , scheduler_ (scheduler)
     {
@@ -79,15 +86,31 @@ public:
         auto const dp = (folder / "nudb.dat").string();
         auto const kp = (folder / "nudb.key").string ();
         auto const lp = (folder / "nudb.log").string ();
+
+        // the block size and load factor only take
+        // effect when the database is created.
+        std::size_t blocksize = beast::nudb::block_size(kp);
+        if (! keyvalues ["block_size"].isempty ())
+            blocksize = keyvalues ["block_size"].getintvalue ();
+        float loadfactor = 0.50f;
+        if (! keyvalues ["load_factor"].isempty ())
+            loadfactor = keyvalues ["load_factor"].getfloatvalue ();
+        if (blocksize < 256 || blocksize > 32768 ||
+                (blocksize & (blocksize - 1)) != 0)
+            throw std::runtime_error (
+                "nodestore: bad block_size in nudb backend");
+        if (loadfactor <= 0.f || loadfactor >= 1.f)
+            throw std::runtime_error (
+                "nodestore: bad load_factor in nudb backend");
+
         using beast::nudb::make_salt;
         api::create (dp, kp, lp,
             currenttype, make_salt(), keybytes,
-                beast::nudb::block_size(kp),
-            0.50);
+                blocksize, loadfactor);
         try
         {
             if (! db_.open (dp, kp, lp,
-                    arena_alloc_size))
+                    arena_alloc_size_))
                 throw std::runtime_error(
                     "nodestore: open failed");
             if (db_.appnum() != currenttype)
@@ -102,6 +125,19 @@ public:
         }
     }
 
+    static
+    std::size_t
+    arenasize (parameters const& keyvalues)
+    {
+        if (keyvalues ["arena_mb"].isempty ())
+            return default_arena_alloc_size;
+        int const mb = keyvalues ["arena_mb"].getintvalue ();
+        if (mb <= 0)
+            throw std::runtime_error (
+                "nodestore: bad arena_mb in nudb backend");
+        return mb * 1024ul * 1024ul;
+    }
+
     ~nudbbackend ()
     {
         close();
@@ -158,6 +194,32 @@ public:
             e.getdata(), e.getsize());
     }
 
+    std::vector <status>
+    fetchbatch (std::vector <void const*> const& keys,
+        std::vector <nodeobject::ptr>* pobjects) override
+    {
+        // the store reads the key file in bucket order and reads
+        // each bucket once for all the keys that fall in it.
+        std::vector <status> results (keys.size (), notfound);
+        pobjects->assign (keys.size (), nullptr);
+
+        db_.fetch_batch (keys,
+            [&keys, pobjects, &results](std::size_t i,
+                void const* data, std::size_t size)
+            {
+                decodedblob decoded (keys[i], data, size);
+                if (! decoded.wasok ())
+                {
+                    results[i] = datacorrupt;
+                    return;
+                }
+                (*pobjects)[i] = decoded.createobject();
+                results[i] = ok;
+            });
+
+        return results;
+    }
+
     void
     store (std::shared_ptr <nodeobject> const& no) override
     {
@@ -172,16 +234,47 @@ public:
         scheduler_.onbatchwrite (report);
     }
 
+    // encodes every object of the batch into one buffer, laid
+    // out as encodedblob lays out a single object, and inserts
+    // them together. the store serializes concurrent inserts, so
+    // batches from several threads may be written at once.
+    void
+    do_insert_batch (batch const& batch)
+    {
+        std::size_t bytes = 0;
+        for (auto const& no : batch)
+            bytes += encoded_prefix_size + no->getdata ().size ();
+
+        std::vector <std::uint8_t> buffer (bytes);
+        std::vector <api::store::insert_item> items;
+        items.reserve (batch.size ());
+
+        std::uint8_t* out = buffer.data ();
+        for (auto const& no : batch)
+        {
+            auto const& data = no->getdata ();
+            // the first 8 bytes are unused
+            std::memset (out, 0, 8);
+            out[8] = static_cast <std::uint8_t> (no->gettype ());
+            if (! data.empty ())
+                std::memcpy (out + encoded_prefix_size,
+                    data.data (), data.size ());
+            items.push_back ({ no->gethash ().begin (), out,
+                encoded_prefix_size + data.size () });
+            out += encoded_prefix_size + data.size ();
+        }
+
+        db_.insert_batch (items);
+    }
+
     void
     storebatch (batch const& batch) override
     {
         batchwritereport report;
-        encodedblob encoded;
         report.writecount = batch.size();
         auto const start =
             std::chrono::steady_clock::now();
-        for (auto const& e : batch)
-            do_insert (e);
+        do_insert_batch (batch);
         report.elapsed = std::chrono::duration_cast <
             std::chrono::milliseconds>(
                 std::chrono::steady_clock::now() - start);
@@ -208,7 +301,7 @@ public:
                 return true;
             });
         db_.open (dp, kp, lp,
-            arena_alloc_size);
+            arena_alloc_size_);
     }
 
     int
@@ -232,7 +325,7 @@ public:
         db_.close();
         api::verify (dp, kp);
         db_.open (dp, kp, lp,
-            arena_alloc_size);
+            arena_alloc_size_);
     }
 };
 
@@ -53,6 +53,14 @@ public:
         return notfound;
     }
 
+    std::vector <status>
+    fetchbatch (std::vector <void const*> const& keys,
+        std::vector <nodeobject::ptr>* pobjects)
+    {
+        pobjects->assign (keys.size (), nullptr);
+        return std::vector <status> (keys.size (), notfound);
+    }
+
     void
     store (nodeobject::ref object)
     {
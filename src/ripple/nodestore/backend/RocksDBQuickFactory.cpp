@@ -92,6 +92,7 @@ private:
 public:
     beast::journal m_journal;
     size_t const m_keybytes;
+    valueformat const m_format;
     std::string m_name;
     std::unique_ptr <rocksdb::db> m_db;
 
@@ -100,6 +101,7 @@ public:
         : m_deletepath (false)
         , m_journal (journal)
         , m_keybytes (keybytes)
+        , m_format (parsevalueformat (keyvalues))
         , m_name (keyvalues ["path"].tostdstring ())
     {
         if (m_name.empty())
@@ -217,8 +219,6 @@ public:
     {
         pobject->reset ();
 
-        status status (ok);
-
         rocksdb::readoptions const options;
         rocksdb::slice const slice (static_cast <char const*> (key), m_keybytes);
 
@@ -226,6 +226,39 @@ public:
 
         rocksdb::status getstatus = m_db->get (options, slice, &string);
 
+        return decode (key, getstatus, string, pobject);
+    }
+
+    std::vector <status>
+    fetchbatch (std::vector <void const*> const& keys,
+        std::vector <nodeobject::ptr>* pobjects)
+    {
+        std::vector <status> results (keys.size ());
+        pobjects->assign (keys.size (), nullptr);
+
+        rocksdb::readoptions const options;
+        std::vector <rocksdb::slice> slices;
+        slices.reserve (keys.size ());
+        for (auto key : keys)
+            slices.emplace_back (static_cast <char const*> (key), m_keybytes);
+
+        std::vector <std::string> strings;
+
+        std::vector <rocksdb::status> getstatus =
+            m_db->multiget (options, slices, &strings);
+
+        for (std::size_t i = 0; i < keys.size (); ++i)
+            results[i] = decode (keys[i], getstatus[i], strings[i], &(*pobjects)[i]);
+
+        return results;
+    }
+
+    status
+    decode (void const* key, rocksdb::status const& getstatus,
+        std::string const& string, nodeobject::ptr* pobject)
+    {
+        status status (ok);
+
         if (getstatus.ok ())
         {
             decodedblob decoded (key, string.data (), string.size ());
@@ -271,13 +304,14 @@ public:
     void
     storebatch (batch const& batch)
     {
+        // rocksdb serializes concurrent writes itself
         rocksdb::writebatch wb;
  
         encodedblob encoded;
 
         for (auto const& e : batch)
         {
-            encoded.prepare (e);
+            encoded.prepare (e, m_format);
 
             wb.put(
                 rocksdb::slice(reinterpret_cast<char const*>(encoded.getkey()),
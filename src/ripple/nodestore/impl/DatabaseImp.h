@@ -23,7 +23,7 @@
 #include <ripple/nodestore/database.h>
 #include <ripple/nodestore/scheduler.h>
 #include <ripple/nodestore/impl/tuning.h>
-#include <ripple/basics/taggedcache.h>
+#include <ripple/basics/shardedtaggedcache.h>
 #include <ripple/basics/keycache.h>
 #include <ripple/basics/log.h>
 #include <ripple/basics/seconds_clock.h>
@@ -49,7 +49,7 @@ public:
     std::unique_ptr <backend> m_fastbackend;
 
     // positive cache
-    taggedcache <uint256, nodeobject> m_cache;
+    shardedtaggedcache <uint256, nodeobject> m_cache;
 
     // negative cache
     keycache <uint256> m_negcache;
@@ -170,6 +170,12 @@ public:
         return dotimedfetch (hash, false);
     }
 
+    std::vector <nodeobject::ptr> fetchbatch (
+        std::vector <uint256> const& hashes) override
+    {
+        return dotimedfetchbatch (hashes, false);
+    }
+
     /** perform a fetch and report the time it took */
     nodeobject::ptr dotimedfetch (uint256 const& hash, bool isasync)
     {
@@ -266,11 +272,88 @@ public:
         return obj;
     }
 
+    /** perform a batch fetch and report the time it took */
+    std::vector <nodeobject::ptr> dotimedfetchbatch (
+        std::vector <uint256> const& hashes, bool isasync)
+    {
+        std::vector <nodeobject::ptr> objects (hashes.size ());
+
+        // the hashes that have to go to the backend, and where they go
+        std::vector <uint256> reads;
+        std::vector <std::size_t> slots;
+
+        for (std::size_t i = 0; i < hashes.size (); ++i)
+        {
+            objects[i] = m_cache.fetch (hashes[i]);
+
+            if (!objects[i] && !m_negcache.touch_if_exists (hashes[i]))
+            {
+                reads.push_back (hashes[i]);
+                slots.push_back (i);
+            }
+        }
+
+        if (reads.empty ())
+            return objects;
+
+        if (m_fastbackend != nullptr)
+        {
+            // the fast backend is checked and filled one object at a time
+            for (std::size_t i = 0; i < reads.size (); ++i)
+                objects[slots[i]] = dotimedfetch (reads[i], isasync);
+
+            return objects;
+        }
+
+        auto const before = std::chrono::steady_clock::now();
+        std::vector <nodeobject::ptr> found (fetchbatchfrom (reads));
+        m_fetchtotalcount += reads.size ();
+
+        // each object is reported with its share of the batch time
+        fetchreport report;
+        report.isasync = isasync;
+        report.wenttodisk = true;
+        report.elapsed = std::chrono::duration_cast <std::chrono::milliseconds>
+            ((std::chrono::steady_clock::now() - before) / reads.size ());
+
+        for (std::size_t i = 0; i < reads.size (); ++i)
+        {
+            nodeobject::ptr& obj = found[i];
+
+            if (obj != nullptr)
+            {
+                // ensure all threads get the same object
+                m_cache.canonicalize (reads[i], obj);
+            }
+            else
+            {
+                // just in case a write occurred
+                obj = m_cache.fetch (reads[i]);
+
+                if (obj == nullptr)
+                    m_negcache.insert (reads[i]);
+            }
+
+            report.wasfound = (obj != nullptr);
+            m_scheduler.onfetch (report);
+
+            objects[slots[i]] = std::move (obj);
+        }
+
+        return objects;
+    }
+
     virtual nodeobject::ptr fetchfrom (uint256 const& hash)
     {
         return fetchinternal (*m_backend, hash);
     }
 
+    virtual std::vector <nodeobject::ptr> fetchbatchfrom (
+        std::vector <uint256> const& hashes)
+    {
+        return fetchbatchinternal (*m_backend, hashes);
+    }
+
     nodeobject::ptr fetchinternal (backend& backend,
         uint256 const& hash)
     {
@@ -278,6 +361,32 @@ public:
 
         status const status = backend.fetch (hash.begin (), &object);
 
+        onfetchresult (status, hash, object);
+
+        return object;
+    }
+
+    std::vector <nodeobject::ptr> fetchbatchinternal (backend& backend,
+        std::vector <uint256> const& hashes)
+    {
+        std::vector <void const*> keys;
+        keys.reserve (hashes.size ());
+        for (auto const& hash : hashes)
+            keys.push_back (hash.begin ());
+
+        std::vector <nodeobject::ptr> objects;
+
+        std::vector <status> const results = backend.fetchbatch (keys, &objects);
+
+        for (std::size_t i = 0; i < hashes.size (); ++i)
+            onfetchresult (results[i], hashes[i], objects[i]);
+
+        return objects;
+    }
+
+    void onfetchresult (status status, uint256 const& hash,
+        nodeobject::ptr const& object)
+    {
         switch (status)
         {
         case ok:
@@ -299,8 +408,6 @@ public:
                 "unknown status=" << status;
             break;
         }
-
-        return object;
     }
 
     //------------------------------------------------------------------------------
@@ -312,6 +419,11 @@ public:
         storeinternal (type, std::move(data), hash, *m_backend.get());
     }
 
+    void storebatch (batch const& batch) override
+    {
+        storebatchinternal (batch, *m_backend.get());
+    }
+
     void storeinternal (nodeobjecttype type,
                         blob&& data,
                         uint256 const& hash,
@@ -342,6 +454,30 @@ public:
         }
     }
 
+    void storebatchinternal (batch const& batch, backend& backend)
+    {
+        std::uint32_t size = 0;
+
+        for (auto const& e : batch)
+        {
+            nodeobject::ptr object = e;
+            m_cache.canonicalize (object->gethash (), object, true);
+            m_negcache.erase (object->gethash ());
+            size += object->getdata().size();
+        }
+
+        backend.storebatch (batch);
+        m_storecount += batch.size ();
+        m_storesize += size;
+
+        if (m_fastbackend)
+        {
+            m_fastbackend->storebatch (batch);
+            m_storecount += batch.size ();
+            m_storesize += size;
+        }
+    }
+
     //------------------------------------------------------------------------------
 
     float getcachehitrate ()
@@ -376,7 +512,7 @@ public:
         beast::thread::setcurrentthreadname ("prefetch");
         while (1)
         {
-            uint256 hash;
+            std::vector <uint256> hashes;
 
             {
                 std::unique_lock <std::mutex> lock (m_readlock);
@@ -402,13 +538,18 @@ public:
                     m_readgencondvar.notify_all ();
                 }
 
-                hash = *it;
-                m_readset.erase (it);
-                m_readlast = hash;
+                while ((it != m_readset.end ()) &&
+                    (hashes.size () < batchreadsize))
+                {
+                    hashes.push_back (*it);
+                    it = m_readset.erase (it);
+                }
+
+                m_readlast = hashes.back ();
             }
 
-            // perform the read
-            dotimedfetch (hash, true);
+            // perform the reads
+            dotimedfetchbatch (hashes, true);
          }
      }
 
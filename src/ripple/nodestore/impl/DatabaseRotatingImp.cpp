@@ -50,6 +50,93 @@ nodeobject::ptr databaserotatingimp::fetchfrom (uint256 const& hash)
 
     return object;
 }
+
+std::vector <nodeobject::ptr>
+databaserotatingimp::fetchbatchfrom (std::vector <uint256> const& hashes)
+{
+    backends b = getbackends();
+    std::vector <nodeobject::ptr> objects (
+        fetchbatchinternal (*b.writablebackend, hashes));
+
+    std::vector <uint256> missing;
+    std::vector <std::size_t> slots;
+
+    for (std::size_t i = 0; i < hashes.size (); ++i)
+    {
+        if (!objects[i])
+        {
+            missing.push_back (hashes[i]);
+            slots.push_back (i);
+        }
+    }
+
+    if (!missing.empty ())
+    {
+        std::vector <nodeobject::ptr> archived (
+            fetchbatchinternal (*b.archivebackend, missing));
+
+        for (std::size_t i = 0; i < missing.size (); ++i)
+        {
+            if (archived[i])
+            {
+                getwritablebackend()->store (archived[i]);
+                m_negcache.erase (missing[i]);
+                objects[slots[i]] = std::move (archived[i]);
+            }
+        }
+    }
+
+    return objects;
+}
+
+std::size_t
+databaserotatingimp::copynodes (std::vector <uint256> const& hashes,
+    std::vector <nodeobject::ptr>& objects)
+{
+    backends b = getbackends();
+    objects = fetchbatchinternal (*b.writablebackend, hashes);
+
+    std::vector <uint256> missing;
+    std::vector <std::size_t> slots;
+    for (std::size_t i = 0; i < hashes.size (); ++i)
+    {
+        if (!objects[i])
+        {
+            missing.push_back (hashes[i]);
+            slots.push_back (i);
+        }
+    }
+
+    if (missing.empty ())
+        return 0;
+
+    batch copied;
+    copied.reserve (missing.size ());
+    std::uint32_t size = 0;
+
+    std::vector <nodeobject::ptr> archived (
+        fetchbatchinternal (*b.archivebackend, missing));
+
+    for (std::size_t i = 0; i < missing.size (); ++i)
+    {
+        if (archived[i])
+        {
+            size += archived[i]->getdata ().size ();
+            m_negcache.erase (missing[i]);
+            objects[slots[i]] = archived[i];
+            copied.push_back (std::move (archived[i]));
+        }
+    }
+
+    if (!copied.empty ())
+    {
+        b.writablebackend->storebatch (copied);
+        m_storecount += copied.size ();
+        m_storesize += size;
+    }
+
+    return copied.size ();
+}
 }
 
 }
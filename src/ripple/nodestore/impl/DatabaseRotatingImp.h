@@ -117,13 +117,23 @@ public:
                 *getwritablebackend());
     }
 
+    void storebatch (batch const& batch) override
+    {
+        storebatchinternal (batch, *getwritablebackend());
+    }
+
     nodeobject::ptr fetchnode (uint256 const& hash) override
     {
         return fetchfrom (hash);
     }
 
+    std::size_t copynodes (std::vector <uint256> const& hashes,
+        std::vector <nodeobject::ptr>& objects) override;
+
     nodeobject::ptr fetchfrom (uint256 const& hash) override;
-    taggedcache <uint256, nodeobject>& getpositivecache() override
+    std::vector <nodeobject::ptr> fetchbatchfrom (
+        std::vector <uint256> const& hashes) override;
+    shardedtaggedcache <uint256, nodeobject>& getpositivecache() override
     {
         return m_cache;
     }
@@ -19,8 +19,12 @@
 
 #include <beastconfig.h>
 #include <ripple/nodestore/impl/decodedblob.h>
+#include <ripple/nodestore/impl/codec.h>
+#include <ripple/nodestore/impl/encodedblob.h>
+#include <ripple/protocol/hashprefix.h>
 #include <beast/byteorder.h>
 #include <algorithm>
+#include <cstring>
 
 namespace ripple {
 namespace nodestore {
@@ -35,6 +39,9 @@ decodedblob::decodedblob (void const* key, void const* value, int valuebytes)
         4...7       unused?         an unused copy of the ledgerindex
         8           char            one of nodeobjecttype
         9...end                     the body of the object data
+
+        values whose first byte has the high bit set use the versioned
+        layout described in encodedblob.h instead.
     */
 
     m_success = false;
@@ -44,6 +51,14 @@ decodedblob::decodedblob (void const* key, void const* value, int valuebytes)
     m_objectdata = nullptr;
     m_databytes = std::max (0, valuebytes - 9);
 
+    if (valuebytes > 0 && (static_cast <unsigned char const*> (
+        value)[0] & valueversionbit) != 0)
+    {
+        decodeversioned (static_cast <unsigned char const*> (value),
+            valuebytes);
+        return;
+    }
+
     // vfalco note what about bytes 4 through 7 inclusive?
 
     if (valuebytes > 8)
@@ -72,6 +87,102 @@ decodedblob::decodedblob (void const* key, void const* value, int valuebytes)
     }
 }
 
+void decodedblob::decodeversioned (unsigned char const* value, int valuebytes)
+{
+    m_databytes = 0;
+
+    if (valuebytes < valueheaderbytes ||
+            (value [0] & ~valueversionbit) != valueversion)
+        return;
+
+    m_objecttype = static_cast <nodeobjecttype> (value [1]);
+
+    switch (m_objecttype)
+    {
+    case hotunknown:
+    case hotledger:
+    case hottransaction:
+    case hotaccount_node:
+    case hottransaction_node:
+        break;
+
+    default:
+        return;
+    }
+
+    unsigned char const* const in = value + valueheaderbytes;
+    std::size_t const insize = valuebytes - valueheaderbytes;
+
+    switch (value [2])
+    {
+    case encodingraw:
+        m_objectdata = in;
+        m_databytes = insize;
+        break;
+
+    case encodinglz4:
+        try
+        {
+            auto const result = detail::lz4_decompress (in, insize,
+                [this] (std::size_t n)
+                {
+                    m_buffer.resize (n);
+                    return m_buffer.data ();
+                });
+            m_objectdata = m_buffer.data ();
+            m_databytes = result.second;
+        }
+        catch (beast::nudb::codec_error const&)
+        {
+            return;
+        }
+        break;
+
+    case encodinginner:
+    {
+        std::size_t const hashbytes = 32;
+
+        if (insize < 2)
+            return;
+
+        std::uint16_t const mask = (std::uint16_t (in [0]) << 8) | in [1];
+        std::size_t hashes = 0;
+        for (std::uint16_t bit = mask; bit != 0; bit &= bit - 1)
+            ++hashes;
+
+        if (insize != 2 + hashes * hashbytes)
+            return;
+
+        // the prefix, then a hash or zeroes for each branch
+        m_buffer.assign (4 + 16 * hashbytes, 0);
+        std::uint32_t const prefix = hashprefix::innernode;
+        m_buffer [0] = static_cast <unsigned char> (prefix >> 24);
+        m_buffer [1] = static_cast <unsigned char> (prefix >> 16);
+        m_buffer [2] = static_cast <unsigned char> (prefix >> 8);
+        m_buffer [3] = static_cast <unsigned char> (prefix);
+
+        unsigned char const* hash = in + 2;
+        for (int i = 0; i < 16; ++i)
+        {
+            if (mask & (0x8000 >> i))
+            {
+                std::memcpy (&m_buffer [4 + i * hashbytes], hash, hashbytes);
+                hash += hashbytes;
+            }
+        }
+
+        m_objectdata = m_buffer.data ();
+        m_databytes = m_buffer.size ();
+        break;
+    }
+
+    default:
+        return;
+    }
+
+    m_success = m_databytes > 0;
+}
+
 nodeobject::ptr decodedblob::createobject ()
 {
     bassert (m_success);
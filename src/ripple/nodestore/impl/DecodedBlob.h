@@ -21,6 +21,7 @@
 #define ripple_nodestore_decodedblob_h_included
 
 #include <ripple/nodestore/nodeobject.h>
+#include <ripple/basics/blob.h>
 
 namespace ripple {
 namespace nodestore {
@@ -33,6 +34,9 @@ namespace nodestore {
     all forms of corruption are detected so further analysis will be needed
     to eliminate false negatives.
 
+    both the legacy layout and the versioned layouts written by encodedblob
+    are understood.
+
     @note this defines the database format of a nodeobject!
 */
 class decodedblob
@@ -48,12 +52,17 @@ public:
     nodeobject::ptr createobject ();
 
 private:
+    void decodeversioned (unsigned char const* value, int valuebytes);
+
     bool m_success;
 
     void const* m_key;
     nodeobjecttype m_objecttype;
     unsigned char const* m_objectdata;
     int m_databytes;
+
+    // holds the object data when the value was compressed
+    blob m_buffer;
 };
 
 }
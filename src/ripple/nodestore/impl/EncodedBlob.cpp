@@ -19,16 +19,56 @@
 
 #include <beastconfig.h>
 #include <ripple/nodestore/impl/encodedblob.h>
+#include <ripple/nodestore/impl/codec.h>
+#include <ripple/protocol/hashprefix.h>
 #include <beast/byteorder.h>
-    
+#include <cstring>
+#include <stdexcept>
+
 namespace ripple {
 namespace nodestore {
 
+valueformat
+parsevalueformat (parameters const& keyvalues)
+{
+    std::string const format (keyvalues ["format"].tostdstring ());
+
+    if (format.empty () || format == "legacy")
+        return formatlegacy;
+
+    if (format == "compact")
+        return formatcompact;
+
+    if (format == "lz4")
+        return formatlz4;
+
+    throw std::runtime_error ("unknown nodestore format '" + format + "'");
+}
+
 void
-encodedblob::prepare (nodeobject::ptr const& object)
+encodedblob::prepare (nodeobject::ptr const& object, valueformat format)
 {
     m_key = object->gethash().begin ();
 
+    switch (format)
+    {
+    case formatcompact:
+        prepareversioned (object, false);
+        break;
+
+    case formatlz4:
+        prepareversioned (object, true);
+        break;
+
+    default:
+        preparelegacy (object);
+        break;
+    }
+}
+
+void
+encodedblob::preparelegacy (nodeobject::ptr const& object)
+{
     // this is how many bytes we need in the flat data
     m_size = object->getdata ().size () + 9;
 
@@ -51,5 +91,76 @@ encodedblob::prepare (nodeobject::ptr const& object)
     }
 }
 
+void
+encodedblob::prepareversioned (nodeobject::ptr const& object, bool lz4)
+{
+    blob const& data (object->getdata ());
+    std::size_t const hashbytes = 32;
+    std::size_t const prefixbytes = 4;
+
+    // an inner node is its prefix and the hashes of its sixteen branches
+    bool const inner = data.size () == prefixbytes + 16 * hashbytes &&
+        ((std::uint32_t (data[0]) << 24) | (std::uint32_t (data[1]) << 16) |
+            (std::uint32_t (data[2]) << 8) | std::uint32_t (data[3])) ==
+                hashprefix::innernode;
+
+    m_size = valueheaderbytes + data.size ();
+    m_data.ensuresize (m_size);
+
+    unsigned char* buf = static_cast <unsigned char*> (m_data.getdata ());
+    buf [0] = valueversionbit | valueversion;
+    buf [1] = static_cast <unsigned char> (object->gettype ());
+    buf [2] = encodingraw;
+
+    if (inner)
+    {
+        unsigned char* out = buf + valueheaderbytes + 2;
+        std::uint16_t mask = 0;
+
+        for (int i = 0; i < 16; ++i)
+        {
+            unsigned char const* const hash =
+                &data[prefixbytes + i * hashbytes];
+
+            if (std::memcmp (hash, detail::zero32 (), hashbytes) != 0)
+            {
+                mask |= 0x8000 >> i;
+                std::memcpy (out, hash, hashbytes);
+                out += hashbytes;
+            }
+        }
+
+        buf [2] = encodinginner;
+        buf [3] = static_cast <unsigned char> (mask >> 8);
+        buf [4] = static_cast <unsigned char> (mask & 0xff);
+        m_size = out - buf;
+        return;
+    }
+
+    if (lz4 && ! data.empty ())
+    {
+        // the bound on the output may exceed the raw size
+        auto const result = detail::lz4_compress (data.data (), data.size (),
+            [this] (std::size_t n)
+            {
+                m_data.ensuresize (valueheaderbytes + n);
+                return static_cast <unsigned char*> (
+                    m_data.getdata ()) + valueheaderbytes;
+            });
+
+        buf = static_cast <unsigned char*> (m_data.getdata ());
+
+        // objects that don't shrink are stored as they are
+        if (result.second < data.size ())
+        {
+            buf [2] = encodinglz4;
+            m_size = valueheaderbytes + result.second;
+            return;
+        }
+    }
+
+    std::memcpy (buf + valueheaderbytes, data.data (), data.size ());
+}
+
 }
 }
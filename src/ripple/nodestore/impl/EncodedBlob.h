@@ -21,6 +21,7 @@
 #define ripple_nodestore_encodedblob_h_included
 
 #include <ripple/nodestore/nodeobject.h>
+#include <ripple/nodestore/types.h>
 #include <beast/module/core/memory/memoryblock.h>
 #include <beast/utility/noexcept.h>
 #include <cstddef>
@@ -28,6 +29,63 @@
 namespace ripple {
 namespace nodestore {
 
+/** the layouts a backend can store its values in.
+
+    every layout is read back by decodedblob, so the format of a database
+    can be changed without converting what it already holds.
+*/
+enum valueformat
+{
+    /** eight unused bytes, the type, then the object data. */
+    formatlegacy,
+
+    /** versioned, inner nodes without their empty branches. */
+    formatcompact,
+
+    /** as formatcompact, with other objects lz4 compressed. */
+    formatlz4
+};
+
+/*  versioned value layout:
+
+    bytes
+
+    0           char            valueversion with the high bit set
+    1           char            one of nodeobjecttype
+    2           char            one of the value encodings
+    3...end                     the encoded object data
+
+    a legacy value starts with the high byte of a ledger index, or zero,
+    so its high bit is always clear.
+*/
+enum
+{
+    valueversionbit = 0x80,
+    valueversion = 1,
+    valueheaderbytes = 3
+};
+
+/** how the object data of a versioned value is encoded. */
+enum valueencoding
+{
+    /** the object data as it is. */
+    encodingraw = 0,
+
+    /** a varint of the data size, then the lz4 compressed data. */
+    encodinglz4 = 1,
+
+    /** a 16-bit big endian mask of the branches that are not empty, then
+        their hashes. the inner node prefix is implied.
+    */
+    encodinginner = 2
+};
+
+/** returns the value format chosen by the 'format' key of a backend.
+    the legacy format is used when the key is absent.
+    @throws std::runtime_error if the format is unknown.
+*/
+valueformat parsevalueformat (parameters const& keyvalues);
+
 /** utility for producing flattened node objects.
     @note this defines the database format of a nodeobject!
 */
@@ -35,12 +93,16 @@ namespace nodestore {
 struct encodedblob
 {
 public:
-    void prepare (nodeobject::ptr const& object);
+    void prepare (nodeobject::ptr const& object,
+        valueformat format = formatlegacy);
     void const* getkey () const noexcept { return m_key; }
     std::size_t getsize () const noexcept { return m_size; }
     void const* getdata () const noexcept { return m_data.getdata (); }
 
 private:
+    void preparelegacy (nodeobject::ptr const& object);
+    void prepareversioned (nodeobject::ptr const& object, bool lz4);
+
     void const* m_key;
     beast::memoryblock m_data;
     std::size_t m_size;
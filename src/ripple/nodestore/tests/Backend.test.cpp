@@ -22,6 +22,7 @@
 #include <ripple/nodestore/dummyscheduler.h>
 #include <ripple/nodestore/manager.h>
 #include <beast/module/core/diagnostic/unittestutilities.h>
+#include <algorithm>
 
 namespace ripple {
 namespace nodestore {
@@ -64,6 +65,19 @@ public:
                 expect (arebatchesequal (batch, copy), "should be equal");
             }
 
+            {
+                // read it back in with a single batch fetch
+                std::vector <void const*> keys;
+                for (auto const& object : batch)
+                    keys.push_back (object->gethash ().begin ());
+
+                batch copy;
+                std::vector <status> const results = backend->fetchbatch (keys, &copy);
+                expect (std::all_of (results.begin (), results.end (),
+                    [](status s) { return s == ok; }), "should be found");
+                expect (arebatchesequal (batch, copy), "should be equal");
+            }
+
             {
                 // reorder and read the copy again
                 batch copy;
@@ -23,6 +23,8 @@
 #include <ripple/nodestore/manager.h>
 #include <ripple/nodestore/impl/decodedblob.h>
 #include <ripple/nodestore/impl/encodedblob.h>
+#include <ripple/protocol/hashprefix.h>
+#include <algorithm>
 
 namespace ripple {
 namespace nodestore {
@@ -60,23 +62,73 @@ public:
         createpredictablebatch (batch, numobjectstotest, seedvalue);
 
         encodedblob encoded;
-        for (int i = 0; i < batch.size (); ++i)
+        for (auto format : { formatlegacy, formatcompact, formatlz4 })
         {
-            encoded.prepare (batch [i]);
+            for (int i = 0; i < batch.size (); ++i)
+            {
+                encoded.prepare (batch [i], format);
 
-            decodedblob decoded (encoded.getkey (), encoded.getdata (), encoded.getsize ());
+                decodedblob decoded (encoded.getkey (), encoded.getdata (), encoded.getsize ());
 
-            expect (decoded.wasok (), "should be ok");
+                expect (decoded.wasok (), "should be ok");
 
-            if (decoded.wasok ())
-            {
-                nodeobject::ptr const object (decoded.createobject ());
+                if (decoded.wasok ())
+                {
+                    nodeobject::ptr const object (decoded.createobject ());
 
-                expect (batch [i]->iscloneof (object), "should be clones");
+                    expect (batch [i]->iscloneof (object), "should be clones");
+                }
             }
         }
     }
 
+    // checks that inner nodes lose their empty branches, and that legacy
+    // values which carry a ledger index are still read
+    void testformats ()
+    {
+        testcase ("formats");
+
+        std::uint32_t const prefix = hashprefix::innernode;
+        blob data (4 + 16 * 32, 0);
+        data [0] = static_cast <unsigned char> (prefix >> 24);
+        data [1] = static_cast <unsigned char> (prefix >> 16);
+        data [2] = static_cast <unsigned char> (prefix >> 8);
+        data [3] = static_cast <unsigned char> (prefix);
+        for (int branch : { 0, 7, 15 })
+            std::fill_n (&data [4 + branch * 32], 32, branch + 1);
+
+        uint256 hash;
+        hash.sethex ("092891fe4ef6cee585fdc6fda0e09eb4d386363158ec3321b8123e5a772c6ca7");
+        nodeobject::ptr const inner (nodeobject::createobject (
+            hotaccount_node, blob (data), hash));
+
+        encodedblob encoded;
+        for (auto format : { formatcompact, formatlz4 })
+        {
+            encoded.prepare (inner, format);
+            expect (encoded.getsize () == 3 + 2 + 3 * 32, "should be compact");
+
+            decodedblob decoded (encoded.getkey (), encoded.getdata (), encoded.getsize ());
+            expect (decoded.wasok (), "should be ok");
+            if (decoded.wasok ())
+                expect (inner->iscloneof (decoded.createobject ()), "should be clones");
+        }
+
+        encoded.prepare (inner, formatlegacy);
+        blob legacy (static_cast <unsigned char const*> (encoded.getdata ()),
+            static_cast <unsigned char const*> (encoded.getdata ()) + encoded.getsize ());
+        legacy [0] = 0x01;
+        legacy [3] = 0x2a;
+        decodedblob decoded (encoded.getkey (), legacy.data (), legacy.size ());
+        expect (decoded.wasok (), "should be ok");
+        if (decoded.wasok ())
+            expect (inner->iscloneof (decoded.createobject ()), "should be clones");
+
+        legacy [0] = valueversionbit | (valueversion + 1);
+        decodedblob unknown (encoded.getkey (), legacy.data (), legacy.size ());
+        expect (! unknown.wasok (), "should not be ok");
+    }
+
     void run ()
     {
         std::int64_t const seedvalue = 50;
@@ -84,6 +136,8 @@ public:
         testbatches (seedvalue);
 
         testblobs (seedvalue);
+
+        testformats ();
     }
 };
 
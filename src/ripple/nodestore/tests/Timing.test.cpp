@@ -142,7 +142,10 @@ public:
     enum
     {
         // percent of fetches for missing nodes
-        missingnodepercent = 20
+        missingnodepercent = 20,
+
+        // objects in each batch of do_mixed_store
+        storebatchsize = 128
     };
 
     std::size_t const default_repeat = 3;
@@ -524,6 +527,237 @@ public:
         backend->close();
     }
 
+    // fetch existing keys, batchreadsize at a time
+    void
+    do_fetch_batch (section const& config, params const& params)
+    {
+        beast::journal journal;
+        dummyscheduler scheduler;
+        auto backend = make_backend (config, scheduler, journal);
+        expect (backend != nullptr);
+
+        class body
+        {
+        private:
+            suite& suite_;
+            backend& backend_;
+            sequence seq1_;
+            beast::xor_shift_engine gen_;
+            std::uniform_int_distribution<std::size_t> dist_;
+
+        public:
+            body (std::size_t id, suite& s,
+                    params const& params, backend& backend)
+                : suite_(s)
+                , backend_ (backend)
+                , seq1_ (1)
+                , gen_ (id + 1)
+                , dist_ (0, params.items - 1)
+            {
+            }
+
+            void
+            operator()(std::size_t i)
+            {
+                try
+                {
+                    std::vector<nodeobject::ptr> objs;
+                    std::vector<void const*> keys;
+                    for (std::size_t n = 0; n < batchreadsize; ++n)
+                    {
+                        objs.push_back (seq1_.obj(dist_(gen_)));
+                        keys.push_back (objs.back()->gethash().data());
+                    }
+                    std::vector<nodeobject::ptr> results;
+                    auto const status = backend_.fetchbatch(keys, &results);
+                    for (std::size_t n = 0; n < objs.size(); ++n)
+                        suite_.expect (status[n] == ok &&
+                            results[n] && results[n]->iscloneof(objs[n]));
+                }
+                catch(std::exception const& e)
+                {
+                    suite_.fail(e.what());
+                }
+            }
+        };
+        try
+        {
+            parallel_for_id<body>(params.items / batchreadsize, params.threads,
+                std::ref(*this), std::ref(params), std::ref(*backend));
+        }
+        catch(...)
+        {
+        #if nodestore_timing_do_verify
+            backend->verify();
+        #endif
+            throw;
+        }
+        backend->close();
+    }
+
+    // fetch batches with present and missing keys
+    void
+    do_mixed_batch (section const& config, params const& params)
+    {
+        beast::journal journal;
+        dummyscheduler scheduler;
+        auto backend = make_backend (config, scheduler, journal);
+        expect (backend != nullptr);
+
+        class body
+        {
+        private:
+            suite& suite_;
+            backend& backend_;
+            sequence seq1_;
+            sequence seq2_;
+            beast::xor_shift_engine gen_;
+            std::uniform_int_distribution<std::uint32_t> rand_;
+            std::uniform_int_distribution<std::size_t> dist_;
+
+        public:
+            body (std::size_t id, suite& s,
+                    params const& params, backend& backend)
+                : suite_ (s)
+                , backend_ (backend)
+                , seq1_ (1)
+                , seq2_ (2)
+                , gen_ (id + 1)
+                , rand_ (0, 99)
+                , dist_ (0, params.items - 1)
+            {
+            }
+
+            void
+            operator()(std::size_t i)
+            {
+                try
+                {
+                    // a null object marks a key that should be missing
+                    std::vector<nodeobject::ptr> objs;
+                    std::vector<uint256> missing;
+                    std::vector<void const*> keys;
+                    missing.reserve (batchreadsize);
+                    for (std::size_t n = 0; n < batchreadsize; ++n)
+                    {
+                        if (rand_(gen_) < missingnodepercent)
+                        {
+                            missing.push_back (seq2_.key(dist_(gen_)));
+                            objs.push_back (nullptr);
+                            keys.push_back (missing.back().data());
+                        }
+                        else
+                        {
+                            objs.push_back (seq1_.obj(dist_(gen_)));
+                            keys.push_back (objs.back()->gethash().data());
+                        }
+                    }
+                    std::vector<nodeobject::ptr> results;
+                    backend_.fetchbatch(keys, &results);
+                    for (std::size_t n = 0; n < objs.size(); ++n)
+                    {
+                        if (objs[n])
+                            suite_.expect (results[n] &&
+                                results[n]->iscloneof(objs[n]));
+                        else
+                            suite_.expect (! results[n]);
+                    }
+                }
+                catch(std::exception const& e)
+                {
+                    suite_.fail(e.what());
+                }
+            }
+        };
+
+        try
+        {
+            parallel_for_id<body>(params.items / batchreadsize, params.threads,
+                std::ref(*this), std::ref(params), std::ref(*backend));
+        }
+        catch(...)
+        {
+        #if nodestore_timing_do_verify
+            backend->verify();
+        #endif
+            throw;
+        }
+        backend->close();
+    }
+
+    // store batches of new keys while fetching existing ones
+    void
+    do_mixed_store (section const& config, params const& params)
+    {
+        beast::journal journal;
+        dummyscheduler scheduler;
+        auto backend = make_backend (config, scheduler, journal);
+        expect (backend != nullptr);
+
+        class body
+        {
+        private:
+            suite& suite_;
+            params const& params_;
+            backend& backend_;
+            sequence seq1_;
+            beast::xor_shift_engine gen_;
+            std::uniform_int_distribution<std::size_t> dist_;
+
+        public:
+            body (std::size_t id, suite& s,
+                    params const& params, backend& backend)
+                : suite_ (s)
+                , params_ (params)
+                , backend_ (backend)
+                , seq1_ (1)
+                , gen_ (id + 1)
+                , dist_ (0, params.items - 1)
+            {
+            }
+
+            void
+            operator()(std::size_t i)
+            {
+                try
+                {
+                    // keys past those do_work inserts
+                    batch b;
+                    seq1_.batch (params_.items * 2 + i * storebatchsize,
+                        b, storebatchsize);
+                    backend_.storebatch (b);
+
+                    for (std::size_t n = 0; n < storebatchsize; ++n)
+                    {
+                        nodeobject::ptr result;
+                        auto const obj = seq1_.obj(dist_(gen_));
+                        backend_.fetch(obj->gethash().data(), &result);
+                        suite_.expect (result && result->iscloneof(obj));
+                    }
+                }
+                catch(std::exception const& e)
+                {
+                    suite_.fail(e.what());
+                }
+            }
+        };
+
+        try
+        {
+            parallel_for_id<body>(params.items / storebatchsize,
+                params.threads, std::ref(*this), std::ref(params),
+                    std::ref(*backend));
+        }
+        catch(...)
+        {
+        #if nodestore_timing_do_verify
+            backend->verify();
+        #endif
+            throw;
+        }
+        backend->close();
+    }
+
     // simulate a rippled workload:
     // each thread randomly:
     //      inserts a new key
@@ -707,6 +941,7 @@ public:
         */
         std::string default_args =
             "type=nudb"
+            ";type=nudb,arena_mb=64,load_factor=0.75,block_size=4096"
         #if ripple_rocksdb_available
             ";type=rocksdb,open_files=2000,filter_bits=12,cache_mb=256,"
                 "file_size_mb=8,file_size_mult=2"
@@ -722,6 +957,9 @@ public:
                 ,{ "fetch",     &timing_test::do_fetch }
                 ,{ "missing",   &timing_test::do_missing }
                 ,{ "mixed",     &timing_test::do_mixed }
+                ,{ "fetch_b",   &timing_test::do_fetch_batch }
+                ,{ "mixed_b",   &timing_test::do_mixed_batch }
+                ,{ "mixed_s",   &timing_test::do_mixed_store }
                 ,{ "work",      &timing_test::do_work }
             };
 
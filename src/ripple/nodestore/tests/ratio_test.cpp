@@ -0,0 +1,147 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#include <beastconfig.h>
+#include <ripple/nodestore/dummyscheduler.h>
+#include <ripple/nodestore/manager.h>
+#include <ripple/nodestore/impl/encodedblob.h>
+#include <ripple/basics/basicconfig.h>
+#include <ripple/protocol/hashprefix.h>
+#include <beast/unit_test/suite.h>
+#include <boost/algorithm/string.hpp>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace ripple {
+namespace nodestore {
+
+// reads every object of an existing database and reports how large its
+// values would be in each value format. the database is not modified.
+//
+//--unittest=ripple.nodestore.ratio --unittest-arg=type=rocksdb,path=/var/db/rocksdb
+class ratio_test : public beast::unit_test::suite
+{
+public:
+    struct totals
+    {
+        std::size_t objects = 0;
+        std::uint64_t legacy = 0;
+        std::uint64_t compact = 0;
+        std::uint64_t lz4 = 0;
+    };
+
+    static
+    bool
+    isinner (nodeobject::ptr const& object)
+    {
+        blob const& data (object->getdata ());
+        return data.size () == 4 + 16 * 32 &&
+            ((std::uint32_t (data[0]) << 24) | (std::uint32_t (data[1]) << 16) |
+                (std::uint32_t (data[2]) << 8) | std::uint32_t (data[3])) ==
+                    hashprefix::innernode;
+    }
+
+    void
+    add (totals& t, nodeobject::ptr const& object)
+    {
+        ++t.objects;
+        encoded_.prepare (object, formatlegacy);
+        t.legacy += encoded_.getsize ();
+        encoded_.prepare (object, formatcompact);
+        t.compact += encoded_.getsize ();
+        encoded_.prepare (object, formatlz4);
+        t.lz4 += encoded_.getsize ();
+    }
+
+    void
+    report (std::string const& name, totals const& t)
+    {
+        if (t.objects == 0)
+            return;
+
+        log << std::left << std::setw (18) << name <<
+            std::right << std::setw (12) << t.objects << " objects, " <<
+            "legacy " << t.legacy << " bytes, " <<
+            std::fixed << std::setprecision (3) <<
+            "compact " << (double (t.compact) / t.legacy) << ", " <<
+            "lz4 " << (double (t.lz4) / t.legacy);
+    }
+
+    void
+    run () override
+    {
+        testcase (abort_on_fail) << arg ();
+        pass ();
+
+        if (arg ().empty ())
+        {
+            log <<
+                "usage:\n" <<
+                "--unittest-arg=type=<type>,path=<path>[,<key>=<value>...]\n" <<
+                "type: backend type of the database, as in [node_db]\n" <<
+                "path: the database to measure";
+            return;
+        }
+
+        section config;
+        std::vector <std::string> v;
+        boost::split (v, arg (), boost::algorithm::is_any_of (","));
+        config.append (v);
+
+        beast::journal journal;
+        dummyscheduler scheduler;
+        auto backend = make_backend (config, scheduler, journal);
+
+        std::vector <totals> bytype (hottransaction_node + 1);
+        totals inner;
+        totals all;
+
+        backend->for_each (
+            [&] (nodeobject::ptr object)
+            {
+                add (all, object);
+                if (object->gettype () < bytype.size ())
+                    add (bytype [object->gettype ()], object);
+                if (isinner (object))
+                    add (inner, object);
+
+                if (all.objects % 1000000 == 0)
+                    log << all.objects << " objects read";
+            });
+
+        backend->close ();
+
+        report ("ledger", bytype [hotledger]);
+        report ("transaction", bytype [hottransaction]);
+        report ("account node", bytype [hotaccount_node]);
+        report ("transaction node", bytype [hottransaction_node]);
+        report ("unknown", bytype [hotunknown]);
+        report ("inner nodes", inner);
+        report ("all", all);
+    }
+
+private:
+    encodedblob encoded_;
+};
+
+beast_define_testsuite_manual(ratio,nodestore,ripple);
+
+}
+}
@@ -25,11 +25,13 @@
 #include <ripple/app/ledger/ledgermaster.h>
 #include <ripple/app/misc/ihashrouter.h>
 #include <ripple/app/misc/networkops.h>
+#include <ripple/app/misc/sigverifier.h>
 #include <ripple/app/peers/clusternodestatus.h>
 #include <ripple/app/peers/uniquenodelist.h>
 #include <ripple/basics/stringutilities.h>
 #include <ripple/basics/uptimetimer.h>
 #include <ripple/core/jobqueue.h>
+#include <ripple/crypto/sha512batch.h>
 #include <ripple/json/json_reader.h>
 #include <ripple/resource/fees.h>
 #include <ripple/server/serverhandler.h>
@@ -1027,15 +1029,28 @@ peerimp::onmessage (std::shared_ptr <protocol::tmtransaction> const& m)
             }
         }
 
-        if (getapp().getjobqueue().getjobcount(jttransaction) > 100)
+        // an expired transaction is dropped before its signature is
+        // checked. checktransaction looks again, since the validated
+        // ledger may move on while it waits.
+        if (dropexpired (*stx))
+            return;
+
+        sigverifier& verifier = getapp().getsigverifier ();
+
+        if (getapp().getjobqueue().getjobcount(jttransaction) > 100 ||
+                verifier.pending () > tuning::maxpendingsignatures)
             p_journal_.info << "transaction queue is full";
         else if (getapp().getledgermaster().getvalidatedledgerage() > 240)
             p_journal_.trace << "no new transactions until synchronized";
-        else
+        else if (flags & sf_siggood)
             getapp().getjobqueue ().addjob (jttransaction,
                 "recvtransaction->checktransaction",
                 std::bind(beast::weak_fn(&peerimp::checktransaction,
                 shared_from_this()), std::placeholders::_1, flags, stx));
+        else
+            verifier.verify (stx,
+                std::bind(beast::weak_fn(&peerimp::checktransaction,
+                shared_from_this()), std::placeholders::_1, flags, stx));
     }
     catch (...)
     {
@@ -1419,6 +1434,10 @@ peerimp::onmessage (std::shared_ptr <protocol::tmgetobjectbyhash> const& m)
         bool pldo = true;
         bool progress = false;
 
+        // the objects wanted, checked against their hashes together
+        std::vector <std::pair <uint256, std::shared_ptr< blob >>> objects;
+        objects.reserve (packet.objects_size ());
+
         for (int i = 0; i < packet.objects_size (); ++i)
         {
             const protocol::tmindexedobject& obj = packet.objects (i);
@@ -1450,15 +1469,34 @@ peerimp::onmessage (std::shared_ptr <protocol::tmgetobjectbyhash> const& m)
                     uint256 hash;
                     memcpy (hash.begin (), obj.hash ().data (), 256 / 8);
 
-                    std::shared_ptr< blob > data (
-                        std::make_shared< blob > (
-                            obj.data ().begin (), obj.data ().end ()));
-
-                    getapp().getops ().addfetchpack (hash, data);
+                    objects.emplace_back (hash, std::make_shared< blob > (
+                        obj.data ().begin (), obj.data ().end ()));
                 }
             }
         }
 
+        std::vector <uint256> hashes (objects.size ());
+        std::vector <sha512halfjob> jobs (objects.size ());
+        for (std::size_t i = 0; i < objects.size (); ++i)
+        {
+            jobs[i].data = objects[i].second->data ();
+            jobs[i].size = objects[i].second->size ();
+            jobs[i].digest = hashes[i].begin ();
+        }
+        sha512half (jobs.data (), jobs.size ());
+
+        for (std::size_t i = 0; i < objects.size (); ++i)
+        {
+            if (hashes[i] != objects[i].first)
+            {
+                p_journal_.warning << "getobj: bad object in fetch pack";
+                continue;
+            }
+
+            getapp().getops ().addfetchpack (
+                objects[i].first, objects[i].second);
+        }
+
         if ((pldo && (plseq != 0)) &&
                p_journal_.active(beast::journal::severity::kdebug))
             p_journal_.debug << "getobj: partial fetch pack for " << plseq;
@@ -1562,6 +1600,21 @@ peerimp::dofetchpack (const std::shared_ptr<protocol::tmgetobjectbyhash>& packet
                 packet, hash, uptimetimer::getinstance ().getelapsedseconds ()));
 }
 
+bool
+peerimp::dropexpired (sttx const& stx)
+{
+    if (stx.isfieldpresent(sflastledgersequence) &&
+        (stx.getfieldu32 (sflastledgersequence) <
+        getapp().getledgermaster().getvalidledgerindex()))
+    {
+        getapp().gethashrouter().setflag(stx.gettransactionid(), sf_bad);
+        charge (resource::feeunwanteddata);
+        return true;
+    }
+
+    return false;
+}
+
 void
 peerimp::checktransaction (job&, int flags,
     sttx::pointer stx)
@@ -1569,14 +1622,8 @@ peerimp::checktransaction (job&, int flags,
     // vfalco todo rewrite to not use exceptions
     try
     {
-        // expired?
-        if (stx->isfieldpresent(sflastledgersequence) &&
-            (stx->getfieldu32 (sflastledgersequence) <
-            getapp().getledgermaster().getvalidledgerindex()))
-        {
-            getapp().gethashrouter().setflag(stx->gettransactionid(), sf_bad);
-            return charge (resource::feeunwanteddata);
-        }
+        if (dropexpired (*stx))
+            return;
 
         auto validate = (flags & sf_siggood) ? validate::no : validate::yes;
         auto tx = std::make_shared<transaction> (stx, validate);
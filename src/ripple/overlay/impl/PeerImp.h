@@ -406,6 +406,12 @@ private:
     void
     dofetchpack (const std::shared_ptr<protocol::tmgetobjectbyhash>& packet);
 
+    /** returns true if the transaction can no longer get into a ledger,
+        after marking it bad and charging for it.
+    */
+    bool
+    dropexpired (sttx const& stx);
+
     void
     checktransaction (job&, int flags, sttx::pointer stx);
 
@@ -28,7 +28,10 @@ namespace tuning
 enum
 {
     /** size of buffer used to read from the socket. */
-    readbufferbytes     = 4096
+    readbufferbytes     = 4096,
+
+    /** transactions waiting for a signature check before more are refused. */
+    maxpendingsignatures = 1000
 };
 
 } // tuning
@@ -21,6 +21,7 @@
 #include <ripple/basics/log.h>
 #include <ripple/basics/stringutilities.h>
 #include <ripple/crypto/ecdsa.h>
+#include <ripple/crypto/ecdsakeycache.h>
 #include <ripple/crypto/ecies.h>
 #include <ripple/crypto/generatedeterministickey.h>
 #include <ripple/crypto/randomnumbers.h>
@@ -66,6 +67,13 @@ static blob getpublickey (openssl::ec_key const& key)
 	return result;
 }
 
+// the parsed keys of the accounts and validators that signed recently
+static ecdsakeycache& getkeycache ()
+{
+	static ecdsakeycache cache (16384);
+	return cache;
+}
+
 static bool verifysignature (blob const& pubkey, uint256 const& hash, blob const& sig, ecdsa fullycanonical)
 {
 	if (! iscanonicalecdsasig (sig, fullycanonical))
@@ -73,9 +81,9 @@ static bool verifysignature (blob const& pubkey, uint256 const& hash, blob const
 		return false;
 	}
 	
-	openssl::ec_key key = ecdsapublickey (pubkey);
+	ecdsakeycache::key_ptr const key = getkeycache ().get (pubkey);
 	
-	return key.valid() && ecdsaverify (hash, sig, key);
+	return key && ecdsaverify (hash, sig, *key);
 }
 
 rippleaddress::rippleaddress ()
@@ -22,6 +22,9 @@
 
 #include <ripple/core/config.h>
 #include <ripple/net/infosub.h>
+#include <ripple/shamap/shamap.h>
+#include <ripple/rpc/output.h>
+#include <ripple/rpc/yield.h>
 #include <ripple/rpc/status.h>
 #include <ripple/rpc/impl/context.h>
 
@@ -37,6 +40,29 @@ status docommand (rpc::context&, json::value&, yieldstrategy const& s = {});
 /** execute an rpc command and store the results in an std::string. */
 void executerpc (rpc::context&, std::string&, yieldstrategy const& s = {});
 
+/** make the checks docommand makes before it runs the handler of the
+    command in the context: load, role, network and ledger conditions.
+    @return rpcsuccess if the command may run.
+*/
+error_code_i checkcommand (rpc::context&);
+
+/** stream the state nodes of a ledger_data request as binary records.
+    nothing is written if the request fails, the error is returned instead.
+    callers make the checks of checkcommand first.
+*/
+json::value streamledgerdata (rpc::context&, output const&);
+
+/** the size field of the record that ends a ledger_data stream. */
+std::uint32_t const stream_end = 0xffffffff;
+
+/** write the nodes of map after resumepoint as ledger_data stream records,
+    at most limit of them, followed by the end record. yields every few
+    records if yield is set.
+    @return the marker to resume from, zero if every node was written.
+*/
+uint256 streamstatenodes (shamap& map, uint256 const& resumepoint,
+    int limit, output const&, yield const&);
+
 /** temporary flag to enable rpcs. */
 auto const streamingrpc = false;
 
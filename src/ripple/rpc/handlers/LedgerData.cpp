@@ -27,6 +27,8 @@ namespace ripple {
 //     limit:        integer, maximum number of entries
 //     marker:       opaque, resume point
 //     binary:       boolean, format
+//     stream:       boolean, over http the nodes are streamed as binary
+//                   records instead, see streamledgerdata
 //   outputs:
 //     ledger_hash:  chosen ledger's hash
 //     ledger_index: chosen ledger's index
@@ -77,11 +79,9 @@ json::value doledgerdata (rpc::context& context)
     json::value& nodes = (jvresult["state"] = json::arrayvalue);
     shamap& map = *(lpledger->peekaccountstatemap ());
 
-    for (;;)
+    for (auto it = map.upper_bound (resumepoint); it != map.end (); ++it)
     {
-       shamapitem::pointer item = map.peeknextitem (resumepoint);
-       if (!item)
-           break;
+       shamapitem::ref item = *it;
        resumepoint = item->gettag();
 
        if (limit-- <= 0)
@@ -109,4 +109,111 @@ json::value doledgerdata (rpc::context& context)
     return jvresult;
 }
 
+namespace rpc {
+
+static void writestreamrecord (output const& output,
+    std::uint32_t size, uint256 const& index)
+{
+    char header[4 + 32];
+    header[0] = static_cast<char> (size >> 24);
+    header[1] = static_cast<char> (size >> 16);
+    header[2] = static_cast<char> (size >> 8);
+    header[3] = static_cast<char> (size);
+    std::copy (index.begin (), index.end (), header + 4);
+    output (boost::string_ref (header, sizeof (header)));
+}
+
+uint256 streamstatenodes (shamap& map, uint256 const& resumepoint,
+    int limit, output const& output, yield const& yield)
+{
+    // records written between yields
+    std::size_t const yield_count = 256;
+
+    countedyield counted (yield ? yield_count : 0, yield);
+    uint256 marker;
+    uint256 last = resumepoint;
+
+    for (auto it = map.upper_bound (resumepoint); it != map.end (); ++it)
+    {
+        shamapitem::ref item = *it;
+
+        if (limit-- <= 0)
+        {
+            marker = last;
+            break;
+        }
+
+        counted.yield ();
+
+        blob const& data = item->peekdata ();
+        writestreamrecord (output,
+            static_cast<std::uint32_t> (data.size ()), item->gettag ());
+        output (boost::string_ref (
+            reinterpret_cast<char const*> (data.data ()), data.size ()));
+        last = item->gettag ();
+    }
+
+    writestreamrecord (output, stream_end, marker);
+    return marker;
+}
+
+// stream state nodes from a ledger, without building any json
+//   inputs:
+//     limit:        integer, maximum number of entries
+//     marker:       opaque, resume point
+//   outputs, one record per state node:
+//     size:         4 bytes, big endian size of the node
+//     index:        32 bytes, the node's index
+//     data:         the node
+//   the first record holds the chosen ledger's index in place of the size
+//   and its hash as the index, without data. the last record has a size
+//   of stream_end and its index is the marker to resume from, or zero if
+//   every node was sent.
+json::value streamledgerdata (rpc::context& context, output const& output)
+{
+    int const guest_page_length = 2048;
+    int const admin_page_length = 65536;
+
+    ledger::pointer lpledger;
+    auto const& params = context.params;
+
+    json::value jvresult = rpc::lookupledger (params, lpledger, context.netops);
+    if (!lpledger)
+        return jvresult;
+
+    uint256 resumepoint;
+    if (params.ismember ("marker"))
+    {
+        json::value const& jmarker = params["marker"];
+        if (!jmarker.isstring ())
+            return rpc::expected_field_error ("marker", "valid");
+        if (!resumepoint.sethex (jmarker.asstring ()))
+            return rpc::expected_field_error ("marker", "valid");
+    }
+
+    bool const isadmin = context.role == role::admin;
+    int limit = isadmin ? admin_page_length : guest_page_length;
+    if (params.ismember ("limit"))
+    {
+        json::value const& jlimit = params["limit"];
+        if (!jlimit.isintegral ())
+            return rpc::expected_field_error ("limit", "integer");
+
+        int const requested = jlimit.asint ();
+
+        // admins may ask for more than a page when the request can yield
+        if ((requested > 0) && ((requested < limit) ||
+                (isadmin && context.yield)))
+            limit = requested;
+    }
+
+    writestreamrecord (output, lpledger->getledgerseq (), lpledger->gethash ());
+
+    streamstatenodes (*(lpledger->peekaccountstatemap ()), resumepoint,
+        limit, output, context.yield);
+
+    return jvresult;
+}
+
+} // rpc
 } // ripple
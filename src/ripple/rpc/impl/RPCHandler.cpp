@@ -207,6 +207,12 @@ void getresult (
 
 } // namespace
 
+error_code_i checkcommand (rpc::context& context)
+{
+    boost::optional <handler const&> handler;
+    return fillhandler (context, handler);
+}
+
 status docommand (
     rpc::context& context, json::value& result, yieldstrategy const&)
 {
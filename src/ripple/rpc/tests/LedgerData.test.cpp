@@ -0,0 +1,186 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#include <beastconfig.h>
+#include <ripple/rpc/rpchandler.h>
+#include <ripple/shamap/fullbelowcache.h>
+#include <ripple/shamap/shamap.h>
+#include <ripple/basics/stringutilities.h>
+#include <ripple/nodestore/dummyscheduler.h>
+#include <ripple/nodestore/manager.h>
+#include <beast/unit_test/suite.h>
+#include <beast/chrono/manual_clock.h>
+#include <beast/random/rngfill.h>
+#include <beast/random/xor_shift_engine.h>
+
+namespace ripple {
+namespace rpc {
+
+class ledgerdata_test : public beast::unit_test::suite
+{
+public:
+    struct handler
+    {
+        void operator()(std::uint32_t refnum) const
+        {
+            throw std::runtime_error("missing node");
+        }
+    };
+
+    struct record
+    {
+        std::uint32_t size;
+        uint256 index;
+        blob data;
+    };
+
+    // split a stream into its records, false if it is malformed
+    static bool
+    parse (std::string const& stream, std::vector <record>& records)
+    {
+        std::size_t pos = 0;
+        while (pos < stream.size ())
+        {
+            if (stream.size () - pos < 4 + 32)
+                return false;
+
+            record r;
+            auto const p = reinterpret_cast <unsigned char const*> (
+                stream.data () + pos);
+            r.size = (std::uint32_t (p[0]) << 24) | (std::uint32_t (p[1]) << 16) |
+                (std::uint32_t (p[2]) << 8) | std::uint32_t (p[3]);
+            std::copy (p + 4, p + 4 + 32, r.index.begin ());
+            pos += 4 + 32;
+
+            if (r.size != stream_end)
+            {
+                if (stream.size () - pos < r.size)
+                    return false;
+                r.data.assign (p + 4 + 32, p + 4 + 32 + r.size);
+                pos += r.size;
+            }
+
+            records.push_back (std::move (r));
+        }
+        return true;
+    }
+
+    void
+    run ()
+    {
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        beast::journal const j;
+
+        fullbelowcache fullbelowcache ("test.full_below", clock);
+        treenodecache treenodecache ("test.tree_node_cache", 65536, 60, clock, j);
+        nodestore::dummyscheduler scheduler;
+        auto db = nodestore::manager::instance().make_database (
+            "test", scheduler, j, 0, parsedelimitedkeyvaluestring(
+                "type=memory|path=ledgerdata_test"));
+
+        shamap map (smtstate, fullbelowcache, treenodecache,
+            *db, handler(), beast::journal());
+
+        beast::xor_shift_engine g (1);
+        std::map <uint256, blob> items;
+        for (int i = 0; i < 1000; ++i)
+        {
+            uint256 tag;
+            beast::rngfill (tag.begin (), tag.size (), g);
+            blob data (1 + i % 100, static_cast <unsigned char> (i));
+            map.additem (shamapitem (tag, data), false, false);
+            items.emplace (tag, std::move (data));
+        }
+
+        testcase ("pages");
+        {
+            std::map <uint256, blob> streamed;
+            uint256 marker;
+            int pages = 0;
+            int yields = 0;
+            auto const yield = [&yields]() { ++yields; };
+
+            do
+            {
+                std::string stream;
+                uint256 const next = streamstatenodes (map, marker, 300,
+                    stringoutput (stream), yield);
+
+                std::vector <record> records;
+                expect (parse (stream, records), "malformed stream");
+                if (records.empty ())
+                    break;
+
+                expect (records.back ().size == stream_end, "no end record");
+                expect (records.back ().index == next, "end record marker");
+                records.pop_back ();
+
+                expect (records.size () == (next.iszero () ? 100 : 300),
+                    "wrong page size");
+                for (auto const& r : records)
+                {
+                    expect (r.index > marker, "record out of order");
+                    expect (streamed.emplace (r.index, r.data).second,
+                        "record sent twice");
+                    marker = r.index;
+                }
+
+                expect (next.iszero () || next == marker, "wrong marker");
+                marker = next;
+                ++pages;
+            }
+            while (marker.isnonzero () && pages < 10);
+
+            expect (pages == 4, "wrong page count");
+            expect (streamed == items, "streamed nodes differ");
+            expect (yields > 0, "never yielded");
+        }
+
+        testcase ("no yield");
+        {
+            // with no yield function the stream runs to its limit
+            std::string stream;
+            uint256 const next = streamstatenodes (map, uint256 (), 2000,
+                stringoutput (stream), rpc::yield ());
+            std::vector <record> records;
+            expect (parse (stream, records), "malformed stream");
+            expect (next.iszero (), "unexpected marker");
+            expect (records.size () == items.size () + 1, "wrong record count");
+        }
+
+        testcase ("marker past the end");
+        {
+            uint256 last;
+            last.sethex ("ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+            std::string stream;
+            uint256 const next = streamstatenodes (map, last, 10,
+                stringoutput (stream), rpc::yield ());
+            std::vector <record> records;
+            expect (parse (stream, records), "malformed stream");
+            expect (next.iszero (), "unexpected marker");
+            expect (records.size () == 1 && records[0].size == stream_end,
+                "expected only the end record");
+        }
+    }
+};
+
+beast_define_testsuite(ledgerdata,rpc,ripple);
+
+} // rpc
+} // ripple
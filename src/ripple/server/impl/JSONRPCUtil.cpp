@@ -115,4 +115,17 @@ void httpreply (int nstatus, std::string const& content, rpc::output output)
     output ("\r\n");
 }
 
+void httpstreamreply (rpc::output output)
+{
+    output ("http/1.1 200 ok\r\n");
+    output (gethttpheadertimestamp ());
+    output ("connection: keep-alive\r\n"
+            "transfer-encoding: chunked\r\n"
+            "content-type: application/octet-stream\r\n");
+    output ("server: " + systemname () + "-json-rpc/");
+    output (buildinfo::getfullversionstring ());
+    output ("\r\n"
+            "\r\n");
+}
+
 } // ripple
@@ -27,6 +27,10 @@ namespace ripple {
 
 void httpreply (int nstatus, std::string const& strmsg, rpc::output);
 
+/** write the headers of a successful reply whose binary body follows
+    with chunked transfer encoding. */
+void httpstreamreply (rpc::output);
+
 } // ripple
 
 #endif
@@ -40,6 +40,7 @@
 #include <boost/optional.hpp>
 #include <boost/regex.hpp>
 #include <algorithm>
+#include <sstream>
 #include <stdexcept>
 
 namespace ripple {
@@ -242,20 +243,20 @@ serverhandlerimp::processsession (
     if (auto byteyieldcount = setup_.yieldstrategy.byteyieldcount)
         output = rpc::chunkedyieldingoutput (output, yield, byteyieldcount);
 
-    processrequest (
+    bool const whole = processrequest (
         session->port(),
         to_string (session->body()),
         session->remoteaddress().at_port (0),
         output,
         yield);
 
-    if (session->request().keep_alive())
+    if (whole && session->request().keep_alive())
         session->complete();
     else
         session->close (true);
 }
 
-void
+bool
 serverhandlerimp::processrequest (
     http::port const& port,
     std::string const& request,
@@ -272,7 +273,7 @@ serverhandlerimp::processrequest (
             ! jsonrpc.isobject ())
         {
             httpreply (400, "unable to parse request", output);
-            return;
+            return true;
         }
     }
 
@@ -297,7 +298,7 @@ serverhandlerimp::processrequest (
     if (usage.disconnect ())
     {
         httpreply (503, "server is overloaded", output);
-        return;
+        return true;
     }
 
     // parse id now so errors from here on will have the id
@@ -310,20 +311,20 @@ serverhandlerimp::processrequest (
     if (method.isnull ())
     {
         httpreply (400, "null method", output);
-        return;
+        return true;
     }
 
     if (! method.isstring ())
     {
         httpreply (400, "method is not string", output);
-        return;
+        return true;
     }
 
     std::string strmethod = method.asstring ();
     if (strmethod.empty())
     {
         httpreply (400, "method is empty", output);
-        return;
+        return true;
     }
 
     // extract request parameters from the request json as `params`.
@@ -340,7 +341,7 @@ serverhandlerimp::processrequest (
     else if (!params.isarray () || params.size() != 1)
     {
         httpreply (400, "params unparseable", output);
-        return;
+        return true;
     }
     else
     {
@@ -348,7 +349,7 @@ serverhandlerimp::processrequest (
         if (!params.isobject())
         {
             httpreply (400, "params unparseable", output);
-            return;
+            return true;
         }
     }
 
@@ -360,7 +361,7 @@ serverhandlerimp::processrequest (
         // fixme needs implementing
         // xxx this needs rate limiting to prevent brute forcing password.
         httpreply (403, "forbidden", output);
-        return;
+        return true;
     }
 
     resource::charge loadtype = resource::feereferencerpc;
@@ -375,7 +376,36 @@ serverhandlerimp::processrequest (
     rpc::context context {params, loadtype, m_networkops, role, nullptr, yield};
     std::string response;
 
-    if (setup_.yieldstrategy.streaming == rpc::yieldstrategy::streaming::yes)
+    if (strmethod == "ledger_data" &&
+        params.ismember ("stream") && params["stream"].asbool ())
+    {
+        json::value result;
+        try
+        {
+            result = processstream (context, output);
+        }
+        catch (std::exception const& e)
+        {
+            // records were sent already, the reply can only be cut short
+            m_journal.warning << "ledger_data stream failed: " << e.what ();
+            usage.charge (resource::feeexceptionrpc);
+            return false;
+        }
+
+        if (! result.ismember ("error"))
+        {
+            usage.charge (loadtype);
+            return true;
+        }
+
+        result[jss::status] = jss::error;
+        result[jss::request] = params;
+
+        json::value reply (json::objectvalue);
+        reply[jss::result] = std::move (result);
+        response = to_string (reply);
+    }
+    else if (setup_.yieldstrategy.streaming == rpc::yieldstrategy::streaming::yes)
     {
         executerpc (context, response, setup_.yieldstrategy);
     }
@@ -416,6 +446,79 @@ serverhandlerimp::processrequest (
     }
 
     httpreply (200, response, output);
+    return true;
+}
+
+// reply to a ledger_data request with the state nodes as binary records,
+// sent in chunks as they are read instead of as one json document. errors
+// before the first chunk is sent are returned, later ones are thrown.
+json::value
+serverhandlerimp::processstream (rpc::context& context, output const& output)
+{
+    json::value result;
+    if (auto error = rpc::checkcommand (context))
+    {
+        inject_error (error, result);
+        return result;
+    }
+
+    std::size_t const chunksize = 64 * 1024;
+
+    bool started = false;
+    std::string chunk;
+    chunk.reserve (chunksize);
+
+    auto flush = [&]()
+    {
+        if (! started)
+        {
+            httpstreamreply (output);
+            started = true;
+        }
+
+        if (chunk.empty ())
+            return;
+
+        std::ostringstream size;
+        size << std::hex << chunk.size () << "\r\n";
+        output (size.str ());
+        output (chunk);
+        output ("\r\n");
+        chunk.clear ();
+    };
+
+    try
+    {
+        auto v = getapp().getjobqueue().getloadeventap (
+            jtgeneric, "cmd:ledger_data");
+        result = rpc::streamledgerdata (context,
+            [&](boost::string_ref const& b)
+            {
+                chunk.append (b.data (), b.size ());
+                if (chunk.size () >= chunksize)
+                    flush ();
+            });
+    }
+    catch (std::exception const& e)
+    {
+        if (started)
+            throw;
+
+        // nothing was sent, so reply as any other failed command does
+        m_journal.info << "caught throw: " << e.what ();
+        if (context.loadtype == resource::feereferencerpc)
+            context.loadtype = resource::feeexceptionrpc;
+        result = json::value (json::objectvalue);
+        inject_error (rpcinternal, result);
+        return result;
+    }
+
+    if (result.ismember ("error"))
+        return result;
+
+    flush ();
+    output ("0\r\n\r\n");
+    return result;
 }
 
 //------------------------------------------------------------------------------
@@ -110,10 +110,15 @@ private:
     void
     processsession (std::shared_ptr<http::session> const&, yield const&);
 
-    void
+    // returns false if the reply was cut short after it started, so the
+    // connection has to close for the client to see it incomplete.
+    bool
     processrequest (http::port const& port, std::string const& request,
         beast::ip::endpoint const& remoteipaddress, output, yield);
 
+    json::value
+    processstream (rpc::context& context, output const& output);
+
     //
     // propertystream
     //
@@ -28,13 +28,18 @@
 #include <ripple/shamap/shamapsyncfilter.h>
 #include <ripple/shamap/shamaptreenode.h>
 #include <ripple/basics/unorderedcontainers.h>
+#include <ripple/core/job.h>
 #include <ripple/nodestore/database.h>
 #include <ripple/nodestore/nodeobject.h>
 #include <beast/utility/journal.h>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/shared_lock_guard.hpp>
 #include <boost/thread/shared_mutex.hpp>
+#include <array>
+#include <iterator>
 #include <stack>
+#include <tuple>
+#include <vector>
 
 namespace std {
 
@@ -64,6 +69,8 @@ struct hash <ripple::shamapnodeid> : std::hash <ripple::shamapnodeid>
 
 namespace ripple {
 
+class jobqueue;
+
 enum shamapstate
 {
     smsmodifying = 0,       // objects can be added and removed (like an open ledger)
@@ -103,7 +110,10 @@ class shamap
 public:
     enum
     {
-        state_map_buckets = 1024
+        state_map_buckets = 1024,
+
+        // reads a prefetching walk issues at each inner node it enters
+        walk_prefetch = 256
     };
 
     static char const* getcountedobjectname () { return "shamap"; }
@@ -166,6 +176,24 @@ public:
     bool updategiveitem (shamapitem::ref, bool istransaction, bool hasmeta);
     bool addgiveitem (shamapitem::ref, bool istransaction, bool hasmeta);
 
+    // hook the subtree below one branch of another map's root into the
+    // same branch of this map's root, which must be empty. the other map
+    // must hold no items below its other branches and share our sequence,
+    // so maps built separately per branch can be joined without rehashing
+    // anything but the root.
+    bool graftbranch (int branch, shamap& source);
+
+    // items split by the root branch they belong to, see addbranchitems
+    typedef std::array<std::vector<shamapitem::pointer>, 16> branchitems;
+
+    // add items that were already split by root branch, each chunk holding
+    // one list per branch. the subtree of every branch is built as its own
+    // job of the given type from that branch's lists only and grafted in,
+    // so this map must be empty below the root. returns false if an item
+    // was already added.
+    bool addbranchitems (std::vector<branchitems> const& chunks,
+        bool istransaction, bool hasmeta, jobqueue& jobqueue, jobtype type);
+
     // save a copy if you only need a temporary
     shamapitem::pointer peekitem (uint256 const& id);
     shamapitem::pointer peekitem (uint256 const& id, uint256 & hash);
@@ -179,8 +207,35 @@ public:
     shamapitem::pointer peeknextitem (uint256 const& , shamaptreenode::tntype & type);
     shamapitem::pointer peekprevitem (uint256 const& );
 
-    void visitnodes (std::function<bool (shamaptreenode&)> const&);
-    void visitleaves(std::function<void (shamapitem::ref)> const&);
+    class const_iterator;
+
+    // iterators over the items in key order. an iterator keeps the path
+    // from the root to its item, so stepping to the next item does not
+    // descend from the root again and a full scan is linear.
+    const_iterator begin () const;
+    const_iterator end () const;
+    const_iterator lower_bound (uint256 const& id) const;  // first item >= id
+    const_iterator upper_bound (uint256 const& id) const;  // first item > id
+
+    // the visit functions walk the map in key order. with a non-zero
+    // prefetch, each inner node the walk enters issues reads for up to
+    // that many of the nodes it reaches next that are not in memory, so
+    // walking a map that is not in memory is not bound by the latency of
+    // one read per node. it is a budget per step, not a bound on the reads
+    // in flight: a read still pending when the next step looks at its node
+    // counts again, but reads issued for nodes further ahead do not.
+    void visitnodes (std::function<bool (shamaptreenode&)> const&,
+        int prefetch = 0);
+    void visitleaves(std::function<void (shamapitem::ref)> const&,
+        int prefetch = 0);
+
+    // visit the leaves, or every node, below one branch of the root, in
+    // key order. different branches share no nodes below the root, so
+    // they may be visited concurrently.
+    void visitbranchleaves (int branch,
+        std::function<void (shamapitem::ref)> const&, int prefetch = 0);
+    void visitbranchnodes (int branch,
+        std::function<bool (shamaptreenode&)> const&, int prefetch = 0);
 
     // comparison/sync functions
     void getmissingnodes (std::vector<shamapnodeid>& nodeids, std::vector<uint256>& hashes, int max,
@@ -196,6 +251,14 @@ public:
     shamapaddnode addknownnode (shamapnodeid const& nodeid, blob const& rawnode,
                                 shamapsyncfilter * filter);
 
+    /** adds several nodes that are not the root, as addknownnode does.
+        the nodes are hashed together, adding stops at the first node
+        that is not good.
+    */
+    shamapaddnode addknownnodes (
+        std::vector<std::pair<shamapnodeid, blob const*>> const& nodes,
+        shamapsyncfilter * filter);
+
     // status functions
     void setimmutable ()
     {
@@ -224,6 +287,13 @@ public:
     bool compare (shamap::ref othermap, delta & differences, int maxcount);
 
     int flushdirty (nodeobjecttype t, std::uint32_t seq);
+
+    // flush the subtrees below the root in parallel as jobs of the given
+    // type, each written to the node store as one batch. the hashes do not
+    // depend on the order the nodes are flushed in.
+    int flushdirty (nodeobjecttype t, std::uint32_t seq, jobqueue& jobqueue,
+        jobtype type);
+
     int unshare ();
 
     void walkmap (std::vector<shamapmissingnode>& missingnodes, int maxmissing);
@@ -263,6 +333,14 @@ private:
 
     shamaptreenode::pointer fetchnode (uint256 const& hash);
 
+    // get several nodes without throwing, the ones that are not
+    // cached are read from the database in one batch
+    std::vector <shamaptreenode::pointer> fetchnodesnt (
+        std::vector <uint256> const& hashes);
+
+    // hook up the children of an inner node that are not linked yet
+    void fetchchildren (shamaptreenode* node);
+
     shamaptreenode::pointer checkfilter (uint256 const& hash, shamapnodeid const& id,
         shamapsyncfilter* filter);
 
@@ -283,9 +361,11 @@ private:
     /** prepare a node to be modified before flushing */
     void preflushnode (shamaptreenode::pointer& node);
 
-    /** write and canonicalize modified node */
+    /** write and canonicalize modified node
+        the node is added to batch instead of stored, if there is one.
+    */
     void writenode (nodeobjecttype t, std::uint32_t seq,
-        shamaptreenode::pointer& node);
+        shamaptreenode::pointer& node, nodestore::batch* batch = nullptr);
 
     shamaptreenode* firstbelow (shamaptreenode*);
     shamaptreenode* lastbelow (shamaptreenode*);
@@ -309,6 +389,11 @@ private:
     // does not hook the returned node to its parent
     shamaptreenode::pointer descendnostore (shamaptreenode::ref, int branch);
 
+    // hooks a received node under its parent, the node is made from
+    // rawnode unless newnode already holds it
+    shamapaddnode addknownnode (shamapnodeid const& nodeid, blob const& rawnode,
+        shamaptreenode::pointer newnode, shamapsyncfilter* filter);
+
     /** if there is only one leaf below this node, get its contents */
     shamapitem::pointer onlybelow (shamaptreenode*);
 
@@ -321,7 +406,31 @@ private:
 
     void visitleavesinternal (std::function<void (shamapitem::ref item)>& function);
 
+    // the inner nodes a walk is below, with the next branch to visit and
+    // whether reads were already issued for the rest of their children
+    using visitstack = std::vector <
+        std::tuple <int, shamaptreenode::pointer, bool>>;
+
+    void visitnodesbelow (shamaptreenode::pointer node,
+        std::function<bool (shamaptreenode&)> const& function, int prefetch);
+
+    // issue reads for the nodes the walk reaches after entering node,
+    // returns whether all of node's were issued
+    bool prefetchahead (shamaptreenode& node, visitstack& stack,
+        int prefetch);
+
+    // issue reads for the children of node from branch first on and for
+    // the children of those already loaded, false if pending, the reads
+    // issued by this step, reached prefetch
+    bool prefetchbelow (shamaptreenode& node, int first,
+        int& pending, int prefetch);
+
+    // get a node without waiting, pending is set if a read was issued
+    shamaptreenode::pointer fetchnodeasync (uint256 const& hash, bool& pending);
+
     int walksubtree (bool dowrite, nodeobjecttype t, std::uint32_t seq);
+    int walksubtree (shamaptreenode::pointer& top, bool dowrite,
+        nodeobjecttype t, std::uint32_t seq, nodestore::batch* batch);
 
 private:
     beast::journal journal_;
@@ -337,6 +446,78 @@ private:
     missingnodehandler m_missing_node_handler;
 };
 
+/** a forward iterator over the items of a shamap, in key order.
+
+    the iterator holds the nodes on the path from the root to its item,
+    so they stay in memory while it points into them. the map must not
+    be modified while it is being iterated; immutable maps and snapshots
+    can be iterated from several threads.
+*/
+class shamap::const_iterator
+{
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef shamapitem::pointer value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef shamapitem const* pointer;
+    typedef shamapitem::ref reference;
+
+    const_iterator () = default;
+
+    reference operator* () const
+    {
+        return leaf_->peekitem ();
+    }
+
+    pointer operator-> () const
+    {
+        return leaf_->peekitem ().get ();
+    }
+
+    // the type of the leaf holding the item
+    shamaptreenode::tntype gettype () const
+    {
+        return leaf_->gettype ();
+    }
+
+    const_iterator& operator++ ();
+    const_iterator operator++ (int);
+
+    // position the iterator on the first item not less than id
+    void seek (uint256 const& id);
+
+    bool operator== (const_iterator const& other) const
+    {
+        return leaf_ == other.leaf_;
+    }
+
+    bool operator!= (const_iterator const& other) const
+    {
+        return leaf_ != other.leaf_;
+    }
+
+private:
+    friend class shamap;
+
+    // reading a backed map may fetch nodes and hook them into the tree,
+    // which goes through the map's non-const read path. the items are
+    // never changed through the iterator.
+    explicit const_iterator (shamap const* map)
+        : map_ (const_cast <shamap*> (map))
+    {
+    }
+
+    // move to the first item below node, or to the next subtree
+    void descendfirst (shamaptreenode::pointer node);
+    // move to the first item after the current subtree
+    void next ();
+
+    shamap* map_ = nullptr;
+    // the inner nodes above the item, with the branch taken at each
+    std::vector <std::pair <shamaptreenode::pointer, int>> stack_;
+    shamaptreenode::pointer leaf_;
+};
+
 }
 
 #endif
@@ -38,6 +38,17 @@ enum shanodeformat
     snfhash     = 3, // just the hash
 };
 
+class shamapinnernode;
+class shamapleafnode;
+
+/** a node of a shamap.
+
+    nodes are either inner nodes, holding the hashes of and pointers to up to
+    16 children, or leaf nodes, holding an item. the two are stored as
+    shamapinnernode and shamapleafnode so a leaf carries no child arrays and
+    an inner node only has room for the branches it uses. both are handled
+    through this type, which forwards to the right layout.
+*/
 class shamaptreenode
     : public countedobject <shamaptreenode>
 {
@@ -60,15 +71,27 @@ public:
     shamaptreenode (const shamaptreenode&) = delete;
     shamaptreenode& operator= (const shamaptreenode&) = delete;
 
-    shamaptreenode (std::uint32_t seq); // empty node
-    shamaptreenode (const shamaptreenode & node, std::uint32_t seq); // copy node from older tree
-    shamaptreenode (shamapitem::ref item, tntype type, std::uint32_t seq);
+    virtual ~shamaptreenode () = default;
+
+    static pointer createinner (std::uint32_t seq); // empty inner node
+    static pointer createleaf (shamapitem::ref item, tntype type, std::uint32_t seq);
 
     // raw node functions
-    shamaptreenode (blob const & data, std::uint32_t seq,
+    static pointer createfromraw (blob const & data, std::uint32_t seq,
                     shanodeformat format, uint256 const& hash, bool hashvalid);
+
+    // a node whose hash is left for updatehashes to compute
+    static pointer createunhashed (blob const& data, std::uint32_t seq,
+                    shanodeformat format);
+
+    // computes the hashes of several nodes at once
+    static void updatehashes (std::vector<pointer> const& nodes);
+
     void addraw (serializer&, shanodeformat format);
 
+    // copy node from older tree
+    pointer clone (std::uint32_t seq) const;
+
     // node functions
     std::uint32_t getseq () const
     {
@@ -122,7 +145,7 @@ public:
     // inner node functions
     bool isinnernode () const
     {
-        return !mitem;
+        return mtype == tninner;
     }
 
     // we are modifying the child hash
@@ -137,33 +160,17 @@ public:
     }
     bool isempty () const;
     int getbranchcount () const;
-    void makeinner ();
-    uint256 const& getchildhash (int m) const
-    {
-        assert ((m >= 0) && (m < 16) && (mtype == tninner));
-        return mhashes[m];
-    }
+    uint256 const& getchildhash (int m) const;
 
     // item node function
     bool hasitem () const
     {
-        return bool(mitem);
-    }
-    shamapitem::ref peekitem ()
-    {
-        // caution: do not modify the item todo(tom): a comment in the code does
-        // nothing - this should return a const reference.
-        return mitem;
+        return isleaf ();
     }
+    shamapitem::ref peekitem ();
     bool setitem (shamapitem::ref i, tntype type);
-    uint256 const& gettag () const
-    {
-        return mitem->gettag ();
-    }
-    blob const& peekdata ()
-    {
-        return mitem->peekdata ();
-    }
+    uint256 const& gettag () const;
+    blob const& peekdata ();
 
     // sync functions
     bool isfullbelow (std::uint32_t generation) const
@@ -183,23 +190,85 @@ public:
     shamaptreenode::pointer getchild (int branch);
     void canonicalizechild (int branch, shamaptreenode::pointer& node);
 
-private:
-
-    // vfalco todo remove the use of friend
-    friend class shamap;
+protected:
+    shamaptreenode (tntype type, std::uint32_t seq);
 
     uint256                 mhash;
-    uint256                 mhashes[16];
-    shamaptreenode::pointer mchildren[16];
-    shamapitem::pointer     mitem;
     std::uint32_t           mseq;
     tntype                  mtype;
     int                     misbranch;
     std::uint32_t           mfullbelowgen;
 
+private:
+
+    // vfalco todo remove the use of friend
+    friend class shamap;
+
+    shamapinnernode& inner ();
+    shamapinnernode const& inner () const;
+    shamapleafnode& leaf ();
+    shamapleafnode const& leaf () const;
+
+    // an inner node from all 16 child hashes, zero for an empty branch
+    static pointer createinner (uint256 const* hashes, std::uint32_t seq);
+
     bool updatehash ();
+};
+
+//------------------------------------------------------------------------------
+
+// the layout of an inner node: one slot for each non-empty branch, in branch
+// order, so the slot of branch m is the number of branches below m.
+class shamapinnernode
+    : public shamaptreenode
+{
+public:
+    // the child of a shared node may be hooked up by any thread reading the
+    // map, so child is only accessed through the std::atomic_ functions.
+    // those are not lock free for shared_ptr: libstdc++ guards them with a
+    // small global pool of mutexes picked by address, so a child load or
+    // store takes a short lock that unrelated nodes may contend for.
+    // hash and the slot layout only change while the node is owned.
+    struct branch
+    {
+        uint256                 hash;
+        shamaptreenode::pointer child;
+    };
+
+    explicit shamapinnernode (std::uint32_t seq);
 
-    static std::mutex       childlock;
+    // copies the slots of a node that may be shared
+    shamapinnernode (shamapinnernode const& node, std::uint32_t seq);
+
+    int getcapacity () const
+    {
+        return mcapacity;
+    }
+
+private:
+    friend class shamaptreenode;
+
+    int getslot (int m) const;
+
+    // make room for branch m, which must be empty
+    branch& insertslot (int m);
+    void eraseslot (int m);
+
+    std::unique_ptr <branch[]>  mbranches;
+    int                         mcapacity;
+};
+
+// the layout of a leaf node
+class shamapleafnode
+    : public shamaptreenode
+{
+public:
+    shamapleafnode (shamapitem::ref item, tntype type, std::uint32_t seq);
+
+private:
+    friend class shamaptreenode;
+
+    shamapitem::pointer     mitem;
 };
 
 } // ripple
@@ -20,13 +20,13 @@
 #ifndef ripple_app_shamap_treenodecache_h_included
 #define ripple_app_shamap_treenodecache_h_included
 
-#include <ripple/basics/taggedcache.h>
+#include <ripple/basics/shardedtaggedcache.h>
 
 namespace ripple {
 
 class shamaptreenode;
 
-using treenodecache = taggedcache <uint256, shamaptreenode>;
+using treenodecache = shardedtaggedcache <uint256, shamaptreenode>;
 
 } // ripple
 
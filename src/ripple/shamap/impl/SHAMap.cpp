@@ -19,6 +19,7 @@
 
 #include <beastconfig.h>
 #include <ripple/shamap/shamap.h>
+#include <ripple/core/paralleljobs.h>
 #include <beast/unit_test/suite.h>
 #include <beast/chrono/manual_clock.h>
 
@@ -44,8 +45,7 @@ shamap::shamap (
 {
     assert (mseq != 0);
 
-    root = std::make_shared<shamaptreenode> (mseq);
-    root->makeinner ();
+    root = shamaptreenode::createinner (mseq);
 }
 
 shamap::shamap (
@@ -66,8 +66,7 @@ shamap::shamap (
     , mtype (t)
     , m_missing_node_handler (missing_node_handler)
 {
-    root = std::make_shared<shamaptreenode> (mseq);
-    root->makeinner ();
+    root = shamaptreenode::createinner (mseq);
 }
 
 shamap::~shamap ()
@@ -198,7 +197,7 @@ shamaptreenode::pointer shamap::fetchnodefromdb (uint256 const& hash)
         {
             try
             {
-                node = std::make_shared <shamaptreenode> (obj->getdata(),
+                node = shamaptreenode::createfromraw (obj->getdata(),
                     0, snfprefix, hash, true);
                 canonicalize (hash, node);
             }
@@ -230,7 +229,7 @@ shamaptreenode::pointer shamap::checkfilter (
 
     if (filter->havenode (id, hash, nodedata))
     {
-        node = std::make_shared <shamaptreenode> (
+        node = shamaptreenode::createfromraw (
             nodedata, 0, snfprefix, hash, true);
 
        filter->gotnode (true, id, hash, nodedata, node->gettype ());
@@ -279,6 +278,90 @@ shamaptreenode::pointer shamap::fetchnodent (uint256 const& hash)
     return node;
 }
 
+std::vector <shamaptreenode::pointer>
+shamap::fetchnodesnt (std::vector <uint256> const& hashes)
+{
+    std::vector <shamaptreenode::pointer> nodes (hashes.size ());
+
+    // the hashes that have to go to the database, and where they go
+    std::vector <uint256> reads;
+    std::vector <std::size_t> slots;
+
+    for (std::size_t i = 0; i < hashes.size (); ++i)
+    {
+        nodes[i] = getcache (hashes[i]);
+
+        if (!nodes[i] && mbacked)
+        {
+            reads.push_back (hashes[i]);
+            slots.push_back (i);
+        }
+    }
+
+    if (reads.empty ())
+        return nodes;
+
+    std::vector <nodeobject::pointer> const objects (db_.fetchbatch (reads));
+    bool missing = false;
+
+    for (std::size_t i = 0; i < reads.size (); ++i)
+    {
+        if (!objects[i])
+        {
+            missing = true;
+            continue;
+        }
+
+        try
+        {
+            shamaptreenode::pointer node = shamaptreenode::createfromraw (
+                objects[i]->getdata(), 0, snfprefix, reads[i], true);
+            canonicalize (reads[i], node);
+            nodes[slots[i]] = std::move (node);
+        }
+        catch (...)
+        {
+            if (journal_.warning) journal_.warning <<
+                "invalid db node " << reads[i];
+        }
+    }
+
+    if (missing && (mledgerseq != 0))
+    {
+        m_missing_node_handler (mledgerseq);
+        mledgerseq = 0;
+    }
+
+    return nodes;
+}
+
+void shamap::fetchchildren (shamaptreenode* node)
+{
+    std::vector <uint256> hashes;
+    std::vector <int> branches;
+
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        if (!node->isemptybranch (branch) && !node->getchildpointer (branch))
+        {
+            hashes.push_back (node->getchildhash (branch));
+            branches.push_back (branch);
+        }
+    }
+
+    // a single child is no better read as a batch
+    if (hashes.size () < 2)
+        return;
+
+    std::vector <shamaptreenode::pointer> children (fetchnodesnt (hashes));
+
+    for (std::size_t i = 0; i < children.size (); ++i)
+    {
+        if (children[i])
+            node->canonicalizechild (branches[i], children[i]);
+    }
+}
+
 // throw if the node is missing
 shamaptreenode::pointer shamap::fetchnode (uint256 const& hash)
 {
@@ -402,7 +485,7 @@ shamaptreenode* shamap::descendasync (shamaptreenode* parent, int branch,
             if (!obj)
                 return nullptr;
 
-            ptr = std::make_shared <shamaptreenode> (obj->getdata(), 0, snfprefix, hash, true);
+            ptr = shamaptreenode::createfromraw (obj->getdata(), 0, snfprefix, hash, true);
 
             if (mbacked)
                 canonicalize (hash, ptr);
@@ -427,7 +510,7 @@ shamap::unsharenode (shamaptreenode::pointer& node, shamapnodeid const& nodeid)
         // have a cow
         assert (mstate != smsimmutable);
 
-        node = std::make_shared<shamaptreenode> (*node, mseq); // here's to the new node, same as the old node
+        node = node->clone (mseq); // here's to the new node, same as the old node
         assert (node->isvalid ());
 
         if (nodeid.isroot ())
@@ -638,6 +721,131 @@ shamapitem::pointer shamap::peekprevitem (uint256 const& id)
     return no_item;
 }
 
+shamap::const_iterator shamap::begin () const
+{
+    const_iterator it (this);
+    it.descendfirst (root);
+    return it;
+}
+
+shamap::const_iterator shamap::end () const
+{
+    return const_iterator (this);
+}
+
+shamap::const_iterator shamap::lower_bound (uint256 const& id) const
+{
+    const_iterator it (this);
+    it.seek (id);
+    return it;
+}
+
+shamap::const_iterator shamap::upper_bound (uint256 const& id) const
+{
+    const_iterator it (this);
+    it.seek (id);
+
+    if (it != end () && it->gettag () == id)
+        ++it;
+
+    return it;
+}
+
+void shamap::const_iterator::descendfirst (shamaptreenode::pointer node)
+{
+    while (node->isinner ())
+    {
+        int branch = 0;
+
+        while ((branch < 16) && node->isemptybranch (branch))
+            ++branch;
+
+        if (branch == 16)
+        {
+            // only the root of an empty map has no children
+            assert (stack_.empty ());
+            leaf_.reset ();
+            return;
+        }
+
+        shamaptreenode::pointer child = map_->descendthrow (node, branch);
+        stack_.emplace_back (std::move (node), branch);
+        node = std::move (child);
+    }
+
+    leaf_ = std::move (node);
+}
+
+void shamap::const_iterator::next ()
+{
+    while (!stack_.empty ())
+    {
+        auto& top = stack_.back ();
+
+        for (int branch = top.second + 1; branch < 16; ++branch)
+        {
+            if (!top.first->isemptybranch (branch))
+            {
+                top.second = branch;
+                descendfirst (map_->descendthrow (top.first, branch));
+                return;
+            }
+        }
+
+        stack_.pop_back ();
+    }
+
+    leaf_.reset ();
+}
+
+shamap::const_iterator& shamap::const_iterator::operator++ ()
+{
+    assert (leaf_);
+    next ();
+    return *this;
+}
+
+shamap::const_iterator shamap::const_iterator::operator++ (int)
+{
+    const_iterator ret (*this);
+    ++(*this);
+    return ret;
+}
+
+void shamap::const_iterator::seek (uint256 const& id)
+{
+    stack_.clear ();
+    leaf_.reset ();
+
+    shamaptreenode::pointer node = map_->root;
+    shamapnodeid nodeid;
+
+    while (node->isinner ())
+    {
+        int const branch = nodeid.selectbranch (id);
+
+        if (node->isemptybranch (branch))
+        {
+            // nothing at id, continue with the branches after it
+            stack_.emplace_back (std::move (node), branch);
+            next ();
+            return;
+        }
+
+        shamaptreenode::pointer child = map_->descendthrow (node, branch);
+        stack_.emplace_back (std::move (node), branch);
+        node = std::move (child);
+        nodeid = nodeid.getchildnodeid (branch);
+    }
+
+    // a leaf is the only item below the branch leading to it, so
+    // everything after it is also after id
+    leaf_ = std::move (node);
+
+    if (leaf_->peekitem ()->gettag () < id)
+        next ();
+}
+
 shamapitem::pointer shamap::peekitem (uint256 const& id)
 {
     shamaptreenode* leaf = walktopointer (id);
@@ -736,18 +944,8 @@ bool shamap::delitem (uint256 const& id)
 
                 if (item)
                 {
-                    for (int i = 0; i < 16; ++i)
-                    {
-                        if (!node->isemptybranch (i))
-                        {
-                            if (! node->setchild (i, uint256(), nullptr))
-                            {
-                                assert (false);
-                            }
-                            break;
-                        }
-                    }
-                    node->setitem (item, type);
+                    // the inner node is replaced by a leaf
+                    node = shamaptreenode::createleaf (item, type, mseq);
                 }
 
                 prevhash = node->getnodehash ();
@@ -788,14 +986,14 @@ bool shamap::addgiveitem (shamapitem::ref item, bool istransaction, bool hasmeta
     if (node->isleaf () && (node->peekitem ()->gettag () == tag))
         return false;
 
-    unsharenode (node, nodeid);
     if (node->isinner ())
     {
         // easy case, we end on an inner node
+        unsharenode (node, nodeid);
         int branch = nodeid.selectbranch (tag);
         assert (node->isemptybranch (branch));
         shamaptreenode::pointer newnode =
-            std::make_shared<shamaptreenode> (item, type, mseq);
+            shamaptreenode::createleaf (item, type, mseq);
         if (! node->setchild (branch, newnode->getnodehash (), newnode))
         {
             assert (false);
@@ -803,11 +1001,11 @@ bool shamap::addgiveitem (shamapitem::ref item, bool istransaction, bool hasmeta
     }
     else
     {
-        // this is a leaf node that has to be made an inner node holding two items
+        // this is a leaf node that has to be replaced by an inner node holding two items
         shamapitem::pointer otheritem = node->peekitem ();
         assert (otheritem && (tag != otheritem->gettag ()));
 
-        node->makeinner ();
+        node = shamaptreenode::createinner (mseq);
 
         int b1, b2;
 
@@ -818,22 +1016,21 @@ bool shamap::addgiveitem (shamapitem::ref item, bool istransaction, bool hasmeta
 
             // we need a new inner node, since both go on same branch at this level
             nodeid = nodeid.getchildnodeid (b1);
-            node = std::make_shared<shamaptreenode> (mseq);
-            node->makeinner ();
+            node = shamaptreenode::createinner (mseq);
         }
 
         // we can add the two leaf nodes here
         assert (node->isinner ());
 
         shamaptreenode::pointer newnode =
-            std::make_shared<shamaptreenode> (item, type, mseq);
+            shamaptreenode::createleaf (item, type, mseq);
         assert (newnode->isvalid () && newnode->isleaf ());
         if (!node->setchild (b1, newnode->getnodehash (), newnode))
         {
             assert (false);
         }
 
-        newnode = std::make_shared<shamaptreenode> (otheritem, type, mseq);
+        newnode = shamaptreenode::createleaf (otheritem, type, mseq);
         assert (newnode->isvalid () && newnode->isleaf ());
         if (!node->setchild (b2, newnode->getnodehash (), newnode))
         {
@@ -886,6 +1083,69 @@ bool shamap::updategiveitem (shamapitem::ref item, bool istransaction, bool hasm
     return true;
 }
 
+bool shamap::graftbranch (int branch, shamap& source)
+{
+    assert ((branch >= 0) && (branch < 16));
+    assert (mstate != smsimmutable);
+    assert (mseq == source.mseq);
+    assert (source.root->isinner ());
+
+    if (!root->isemptybranch (branch))
+        return false;
+
+    if (source.root->isemptybranch (branch))
+        return true;
+
+    shamaptreenode::pointer child = source.descendthrow (source.root, branch);
+
+    unsharenode (root, shamapnodeid ());
+    if (!root->setchild (branch, child->getnodehash (), child))
+    {
+        assert (false);
+        return false;
+    }
+
+    return true;
+}
+
+bool shamap::addbranchitems (std::vector<branchitems> const& chunks,
+    bool istransaction, bool hasmeta, jobqueue& jobqueue, jobtype type)
+{
+    shamap::pointer parts[16];
+    bool added[16];
+
+    runparalleljobs (jobqueue, type, "shamap::addbranchitems", 16, 16,
+        [&] (std::size_t branch)
+        {
+            parts[branch] = std::make_shared<shamap> (mtype, m_fullbelowcache,
+                mtreenodecache, db_, m_missing_node_handler, journal_, mseq);
+            added[branch] = true;
+
+            for (auto const& chunk : chunks)
+            {
+                for (auto const& item : chunk[branch])
+                {
+                    assert (shamapnodeid ().selectbranch (item->gettag ()) ==
+                        static_cast<int> (branch));
+
+                    if (!parts[branch]->addgiveitem (item, istransaction, hasmeta))
+                    {
+                        added[branch] = false;
+                        return;
+                    }
+                }
+            }
+        });
+
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        if (!added[branch] || !graftbranch (branch, *parts[branch]))
+            return false;
+    }
+
+    return true;
+}
+
 bool shamap::fetchroot (uint256 const& hash, shamapsyncfilter* filter)
 {
     if (hash == root->getnodehash ())
@@ -931,8 +1191,8 @@ bool shamap::fetchroot (uint256 const& hash, shamapsyncfilter* filter)
 //
 // 2) an unshareable node is shared. this happens when you make
 // a mutable snapshot of a mutable shamap.
-void shamap::writenode (
-    nodeobjecttype t, std::uint32_t seq, shamaptreenode::pointer& node)
+void shamap::writenode (nodeobjecttype t, std::uint32_t seq,
+    shamaptreenode::pointer& node, nodestore::batch* batch)
 {
     // node is ours, so we can just make it shareable
     assert (node->getseq() == mseq);
@@ -943,8 +1203,13 @@ void shamap::writenode (
 
     serializer s;
     node->addraw (s, snfprefix);
-    db_.store (t, std::move (s.moddata()),
-        node->getnodehash ());
+
+    if (batch)
+        batch->push_back (nodeobject::createobject (t,
+            std::move (s.moddata()), node->getnodehash ()));
+    else
+        db_.store (t, std::move (s.moddata()),
+            node->getnodehash ());
 }
 
 // we can't modify an inner node someone else might have a
@@ -960,7 +1225,7 @@ void shamap::preflushnode (shamaptreenode::pointer& node)
     {
         // node is not uniquely ours, so unshare it before
         // possibly modifying it
-        node = std::make_shared <shamaptreenode> (*node, mseq);
+        node = node->clone (mseq);
     }
 }
 
@@ -970,7 +1235,8 @@ int shamap::unshare ()
 }
 
 /** convert all modified nodes to shared nodes */
-// if requested, write them to the node store
+// if requested, write them to the node store. nothing is hashed here: every
+// modified node's hash was kept current by dirtyup when it changed
 int shamap::flushdirty (nodeobjecttype t, std::uint32_t seq)
 {
     return walksubtree (true, t, seq);
@@ -978,17 +1244,24 @@ int shamap::flushdirty (nodeobjecttype t, std::uint32_t seq)
 
 int shamap::walksubtree (bool dowrite, nodeobjecttype t, std::uint32_t seq)
 {
-    int flushed = 0;
-    serializer s;
-
     if (!root || (root->getseq() == 0) || root->isempty ())
-        return flushed;
+        return 0;
 
-    if (root->isleaf())
-    { // special case -- root is leaf
-        preflushnode (root);
+    return walksubtree (root, dowrite, t, seq, nullptr);
+}
+
+// flush the modified nodes below top, which must itself be modified, and
+// replace top with its shareable version
+int shamap::walksubtree (shamaptreenode::pointer& top, bool dowrite,
+    nodeobjecttype t, std::uint32_t seq, nodestore::batch* batch)
+{
+    int flushed = 0;
+
+    if (top->isleaf())
+    { // special case -- top is leaf
+        preflushnode (top);
         if (dowrite && mbacked)
-            writenode (t, seq, root);
+            writenode (t, seq, top, batch);
         return 1;
     }
 
@@ -997,7 +1270,7 @@ int shamap::walksubtree (bool dowrite, nodeobjecttype t, std::uint32_t seq)
     using stackentry = std::pair <shamaptreenode::pointer, int>;
     std::stack <stackentry, std::vector<stackentry>> stack;
 
-    shamaptreenode::pointer node = root;
+    shamaptreenode::pointer node = top;
     preflushnode (node);
 
     int pos = 0;
@@ -1042,7 +1315,7 @@ int shamap::walksubtree (bool dowrite, nodeobjecttype t, std::uint32_t seq)
                         assert (node->getseq() == mseq);
 
                         if (dowrite && mbacked)
-                            writenode (t, seq, child);
+                            writenode (t, seq, child, batch);
 
                         node->sharechild (branch, child);
                     }
@@ -1052,7 +1325,7 @@ int shamap::walksubtree (bool dowrite, nodeobjecttype t, std::uint32_t seq)
 
         // this inner node can now be shared
         if (dowrite && mbacked)
-            writenode (t, seq, node);
+            writenode (t, seq, node, batch);
 
         ++flushed;
 
@@ -1072,12 +1345,66 @@ int shamap::walksubtree (bool dowrite, nodeobjecttype t, std::uint32_t seq)
         ++pos;
     }
 
-    // last inner node is the new root
-    root = std::move (node);
+    // last inner node is the new top
+    top = std::move (node);
 
     return flushed;
 }
 
+int shamap::flushdirty (nodeobjecttype t, std::uint32_t seq,
+    jobqueue& jobqueue, jobtype type)
+{
+    if (!root || (root->getseq() == 0) || root->isempty ())
+        return 0;
+
+    if (root->isleaf () || !mbacked)
+        return flushdirty (t, seq);
+
+    preflushnode (root);
+
+    // the subtrees below the root share no modified nodes, so each
+    // can be flushed on its own and hooked back up afterwards
+    shamaptreenode::pointer children[16];
+    int flushed[16] = {};
+
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        if (!root->isemptybranch (branch))
+        {
+            shamaptreenode::pointer child = root->getchild (branch);
+
+            if (child && (child->getseq() != 0))
+                children[branch] = std::move (child);
+        }
+    }
+
+    runparalleljobs (jobqueue, type, "shamap::flushdirty", 16, 16,
+        [&] (std::size_t branch)
+        {
+            if (!children[branch])
+                return;
+
+            nodestore::batch batch;
+            flushed[branch] = walksubtree (children[branch], true, t, seq, &batch);
+            db_.storebatch (batch);
+        });
+
+    int count = 1;
+
+    for (int branch = 0; branch < 16; ++branch)
+    {
+        if (children[branch])
+        {
+            root->sharechild (branch, children[branch]);
+            count += flushed[branch];
+        }
+    }
+
+    writenode (t, seq, root);
+
+    return count;
+}
+
 bool shamap::getpath (uint256 const& index, std::vector< blob >& nodes, shanodeformat format)
 {
     // return the path of nodes to the specified index in the specified format
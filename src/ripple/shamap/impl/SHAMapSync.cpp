@@ -21,6 +21,7 @@
 #include <ripple/shamap/shamap.h>
 #include <ripple/nodestore/database.h>
 #include <beast/unit_test/suite.h>
+#include <exception>
 
 namespace ripple {
 
@@ -39,13 +40,15 @@ static bool visitleaveshelper (
     return false;
 }
 
-void shamap::visitleaves (std::function<void (shamapitem::ref item)> const& leaffunction)
+void shamap::visitleaves (std::function<void (shamapitem::ref item)> const& leaffunction,
+    int prefetch)
 {
     visitnodes (std::bind (visitleaveshelper,
-            std::cref (leaffunction), std::placeholders::_1));
+            std::cref (leaffunction), std::placeholders::_1), prefetch);
 }
 
-void shamap::visitnodes(std::function<bool (shamaptreenode&)> const& function)
+void shamap::visitnodes(std::function<bool (shamaptreenode&)> const& function,
+    int prefetch)
 {
     // visit every node in a shamap
     assert (root->isvalid ());
@@ -58,11 +61,49 @@ void shamap::visitnodes(std::function<bool (shamaptreenode&)> const& function)
     if (!root->isinner ())
         return;
 
-    using stackentry = std::pair <int, shamaptreenode::pointer>;
-    std::stack <stackentry, std::vector <stackentry>> stack;
+    visitnodesbelow (root, function, prefetch);
+}
+
+void shamap::visitbranchleaves (int branch,
+    std::function<void (shamapitem::ref item)> const& leaffunction, int prefetch)
+{
+    visitbranchnodes (branch, std::bind (visitleaveshelper,
+        std::cref (leaffunction), std::placeholders::_1), prefetch);
+}
+
+void shamap::visitbranchnodes (int branch,
+    std::function<bool (shamaptreenode&)> const& function, int prefetch)
+{
+    assert ((branch >= 0) && (branch < 16));
+
+    if (!root || !root->isinner () || root->isemptybranch (branch))
+        return;
+
+    shamaptreenode::pointer child = descendnostore (root, branch);
+
+    if (function (*child) || !child->isinner ())
+        return;
+
+    visitnodesbelow (child, function, prefetch);
+}
+
+void shamap::visitnodesbelow (shamaptreenode::pointer node,
+    std::function<bool (shamaptreenode&)> const& function, int prefetch)
+{
+    // visit every node below an inner node, depth first in key order
+    assert (node->isinner ());
+
+    // a map with no backing store has nothing to read
+    if (!mbacked)
+        prefetch = 0;
+
+    visitstack stack;
 
-    shamaptreenode::pointer node = root;
     int pos = 0;
+    bool prefetched = true;
+
+    if (prefetch > 0)
+        prefetched = prefetchahead (*node, stack, prefetch);
 
     while (1)
     {
@@ -86,12 +127,15 @@ void shamap::visitnodes(std::function<bool (shamaptreenode&)> const& function)
                     if (pos != 15)
                     {
                         // save next position to resume at
-                        stack.push (std::make_pair(pos + 1, std::move (node)));
+                        stack.emplace_back (pos + 1, std::move (node), prefetched);
                     }
 
                     // descend to the child's first position
                     node = child;
                     pos = 0;
+
+                    if (prefetch > 0)
+                        prefetched = prefetchahead (*node, stack, prefetch);
                 }
             }
             else
@@ -103,9 +147,113 @@ void shamap::visitnodes(std::function<bool (shamaptreenode&)> const& function)
         if (stack.empty ())
             break;
 
-        std::tie(pos, node) = stack.top ();
-        stack.pop ();
+        std::tie(pos, node, prefetched) = stack.back ();
+        stack.pop_back ();
+    }
+}
+
+// the walk visits the children of node next and then the remaining children
+// of each node on the stack, so reads are issued in that order, up to
+// prefetch of them for this step. the count starts again at the next inner
+// node, so it bounds the work of a step rather than the reads in flight. a
+// stack entry whose remaining children were all covered is not looked at
+// again, so on a map that is already in memory each node is checked at most
+// twice.
+bool shamap::prefetchahead (shamaptreenode& node, visitstack& stack,
+    int prefetch)
+{
+    int pending = 0;
+
+    if (!prefetchbelow (node, 0, pending, prefetch))
+        return false;
+
+    for (auto it = stack.rbegin (); it != stack.rend (); ++it)
+    {
+        if (std::get<2>(*it))
+            continue;
+
+        if (!prefetchbelow (*std::get<1>(*it), std::get<0>(*it),
+                pending, prefetch))
+            break;
+
+        std::get<2>(*it) = true;
     }
+
+    return true;
+}
+
+bool shamap::prefetchbelow (shamaptreenode& node, int first,
+    int& pending, int prefetch)
+{
+    // keeps the loaded children alive while their children are read
+    std::vector <shamaptreenode::pointer> loaded;
+
+    for (int branch = first; branch < 16; ++branch)
+    {
+        if (node.isemptybranch (branch))
+            continue;
+
+        shamaptreenode::pointer child = node.getchild (branch);
+
+        if (!child)
+        {
+            if (pending >= prefetch)
+                return false;
+
+            bool ispending = false;
+            child = fetchnodeasync (node.getchildhash (branch), ispending);
+
+            if (ispending)
+                ++pending;
+        }
+
+        if (child && child->isinner ())
+            loaded.push_back (std::move (child));
+    }
+
+    for (auto const& child : loaded)
+    {
+        for (int branch = 0; branch < 16; ++branch)
+        {
+            if (child->isemptybranch (branch) || child->getchild (branch))
+                continue;
+
+            if (pending >= prefetch)
+                return false;
+
+            bool ispending = false;
+            fetchnodeasync (child->getchildhash (branch), ispending);
+
+            if (ispending)
+                ++pending;
+        }
+    }
+
+    return true;
+}
+
+shamaptreenode::pointer shamap::fetchnodeasync (uint256 const& hash, bool& pending)
+{
+    pending = false;
+
+    shamaptreenode::pointer node = getcache (hash);
+    if (node || !mbacked)
+        return node;
+
+    nodeobject::pointer obj;
+    if (! db_.asyncfetch (hash, obj))
+    {
+        pending = true;
+        return node;
+    }
+
+    if (obj)
+    {
+        node = shamaptreenode::createfromraw (obj->getdata(), 0, snfprefix, hash, true);
+        canonicalize (hash, node);
+    }
+
+    return node;
 }
 
 /** get a list of node ids and hashes for nodes that are part of this shamap
@@ -240,15 +388,28 @@ void shamap::getmissingnodes (std::vector<shamapnodeid>& nodeids, std::vector<ui
 
         db_.waitreads();
 
-        // process all deferred reads
+        // process all deferred reads, the prefetch threads have put them
+        // in the node store cache so one batch picks them all up
+        std::vector <uint256> deferredhashes;
+        deferredhashes.reserve (deferredreads.size ());
         for (auto const& node : deferredreads)
+            deferredhashes.push_back (std::get<0>(node)->getchildhash (std::get<1>(node)));
+
+        std::vector <shamaptreenode::pointer> deferrednodes (
+            fetchnodesnt (deferredhashes));
+
+        for (std::size_t i = 0; i < deferredreads.size (); ++i)
         {
+            auto const& node = deferredreads[i];
             auto parent = std::get<0>(node);
             auto branch = std::get<1>(node);
             auto const& nodeid = std::get<2>(node);
-            auto const& nodehash = parent->getchildhash (branch);
+            auto const& nodehash = deferredhashes[i];
+
+            shamaptreenode::pointer nodeptr = std::move (deferrednodes[i]);
+            if (!nodeptr && filter)
+                nodeptr = checkfilter (nodehash, nodeid, filter);
 
-            shamaptreenode::pointer nodeptr = fetchnodent (nodeid, nodehash, filter);
             if (nodeptr)
             {
                 if (mbacked)
@@ -381,7 +542,7 @@ shamapaddnode shamap::addrootnode (blob const& rootnode,
 
     assert (mseq >= 1);
     shamaptreenode::pointer node =
-        std::make_shared<shamaptreenode> (rootnode, 0,
+        shamaptreenode::createfromraw (rootnode, 0,
                                           format, uzero, false);
 
     if (!node)
@@ -424,7 +585,7 @@ shamapaddnode shamap::addrootnode (uint256 const& hash, blob const& rootnode, sh
 
     assert (mseq >= 1);
     shamaptreenode::pointer node =
-        std::make_shared<shamaptreenode> (rootnode, 0,
+        shamaptreenode::createfromraw (rootnode, 0,
                                           format, uzero, false);
 
     if (!node || node->getnodehash () != hash)
@@ -452,6 +613,64 @@ shamapaddnode shamap::addrootnode (uint256 const& hash, blob const& rootnode, sh
 shamapaddnode
 shamap::addknownnode (const shamapnodeid& node, blob const& rawnode,
                       shamapsyncfilter* filter)
+{
+    return addknownnode (node, rawnode, nullptr, filter);
+}
+
+shamapaddnode
+shamap::addknownnodes (
+    std::vector<std::pair<shamapnodeid, blob const*>> const& nodes,
+    shamapsyncfilter* filter)
+{
+    shamapaddnode san;
+
+    if (nodes.empty ())
+        return san;
+
+    if (!issynching ())
+    {
+        if (journal_.trace) journal_.trace <<
+            "addknownnodes while not synching";
+        return shamapaddnode::duplicate ();
+    }
+
+    // a node that cannot be parsed ends the batch, as it would end a
+    // sequence of addknownnode calls, once the nodes before it are added
+    std::vector<shamaptreenode::pointer> newnodes;
+    std::exception_ptr error;
+    newnodes.reserve (nodes.size ());
+
+    try
+    {
+        for (auto const& node : nodes)
+            newnodes.push_back (shamaptreenode::createunhashed (
+                *node.second, 0, snfwire));
+    }
+    catch (...)
+    {
+        error = std::current_exception ();
+    }
+
+    shamaptreenode::updatehashes (newnodes);
+
+    for (std::size_t i = 0; i < newnodes.size (); ++i)
+    {
+        san += addknownnode (nodes[i].first, *nodes[i].second,
+            newnodes[i], filter);
+
+        if (!san.isgood ())
+            return san;
+    }
+
+    if (error)
+        std::rethrow_exception (error);
+
+    return san;
+}
+
+shamapaddnode
+shamap::addknownnode (const shamapnodeid& node, blob const& rawnode,
+                      shamaptreenode::pointer newnode, shamapsyncfilter* filter)
 {
     // return value: true=okay, false=error
     assert (!node.isroot ());
@@ -502,9 +721,9 @@ shamap::addknownnode (const shamapnodeid& node, blob const& rawnode,
                 return shamapaddnode::invalid ();
             }
 
-            shamaptreenode::pointer newnode =
-                std::make_shared<shamaptreenode> (rawnode, 0, snfwire,
-                                                  uzero, false);
+            if (!newnode)
+                newnode = shamaptreenode::createfromraw (rawnode, 0, snfwire,
+                                                            uzero, false);
 
             if (!newnode->isinbounds (inodeid))
             {
@@ -715,6 +934,8 @@ void shamap::getfetchpack (shamap* have, bool includeleaves, int max,
         --max;
 
         // 2) push non-matching child inner nodes
+        fetchchildren (node);
+
         for (int i = 0; i < 16; ++i)
         {
             if (!node->isemptybranch (i))
@@ -21,62 +21,220 @@
 #include <ripple/shamap/shamaptreenode.h>
 #include <ripple/basics/log.h>
 #include <ripple/basics/stringutilities.h>
+#include <ripple/crypto/sha512batch.h>
 #include <ripple/protocol/hashprefix.h>
 #include <beast/module/core/text/lexicalcast.h>
-#include <mutex>
+#include <algorithm>
+#include <memory>
 
 namespace ripple {
 
-std::mutex shamaptreenode::childlock;
+// the number of set bits in a branch mask
+static inline int branchcount (int mask)
+{
+    mask = mask - ((mask >> 1) & 0x5555);
+    mask = (mask & 0x3333) + ((mask >> 2) & 0x3333);
+    mask = (mask + (mask >> 4)) & 0x0f0f;
+    return (mask + (mask >> 8)) & 0x1f;
+}
 
-shamaptreenode::shamaptreenode (std::uint32_t seq)
+shamaptreenode::shamaptreenode (tntype type, std::uint32_t seq)
     : mseq (seq)
-    , mtype (tnerror)
+    , mtype (type)
     , misbranch (0)
     , mfullbelowgen (0)
 {
 }
 
-shamaptreenode::shamaptreenode (const shamaptreenode& node, std::uint32_t seq)
-    : mhash (node.mhash)
-    , mseq (seq)
-    , mtype (node.mtype)
-    , misbranch (node.misbranch)
-    , mfullbelowgen (0)
+shamapinnernode::shamapinnernode (std::uint32_t seq)
+    : shamaptreenode (tninner, seq)
+    , mcapacity (0)
 {
-    if (node.mitem)
-        mitem = node.mitem;
-    else
+}
+
+shamapinnernode::shamapinnernode (shamapinnernode const& node, std::uint32_t seq)
+    : shamaptreenode (tninner, seq)
+    , mcapacity (branchcount (node.misbranch))
+{
+    mhash = node.mhash;
+    misbranch = node.misbranch;
+
+    if (mcapacity != 0)
     {
-        memcpy (mhashes, node.mhashes, sizeof (mhashes));
+        mbranches.reset (new branch[mcapacity]);
+
+        for (int i = 0; i < mcapacity; ++i)
+        {
+            mbranches[i].hash = node.mbranches[i].hash;
+            mbranches[i].child = std::atomic_load (&node.mbranches[i].child);
+        }
+    }
+}
+
+int shamapinnernode::getslot (int m) const
+{
+    return branchcount (misbranch & ((1 << m) - 1));
+}
 
-        std::unique_lock <std::mutex> lock (childlock);
+shamapinnernode::branch& shamapinnernode::insertslot (int m)
+{
+    assert (isemptybranch (m));
 
-        for (int i = 0; i < 16; ++i)
-            mchildren[i] = node.mchildren[i];
+    int const count = branchcount (misbranch);
+    int const slot = getslot (m);
+
+    if (count == mcapacity)
+    {
+        // grow, most inner nodes never get more than a few branches
+        int const capacity = std::min (16, std::max (2, mcapacity * 2));
+        std::unique_ptr <branch[]> branches (new branch[capacity]);
+
+        for (int i = 0; i < slot; ++i)
+            branches[i] = std::move (mbranches[i]);
+        for (int i = slot; i < count; ++i)
+            branches[i + 1] = std::move (mbranches[i]);
+
+        mbranches = std::move (branches);
+        mcapacity = capacity;
+    }
+    else
+    {
+        for (int i = count; i > slot; --i)
+            mbranches[i] = std::move (mbranches[i - 1]);
     }
+
+    misbranch |= (1 << m);
+    return mbranches[slot];
+}
+
+void shamapinnernode::eraseslot (int m)
+{
+    assert (!isemptybranch (m));
+
+    int const count = branchcount (misbranch);
+
+    for (int i = getslot (m); i < (count - 1); ++i)
+        mbranches[i] = std::move (mbranches[i + 1]);
+
+    mbranches[count - 1] = branch ();
+    misbranch &= ~ (1 << m);
 }
 
-shamaptreenode::shamaptreenode (shamapitem::ref item,
+shamapleafnode::shamapleafnode (shamapitem::ref item,
+                                tntype type, std::uint32_t seq)
+    : shamaptreenode (type, seq)
+    , mitem (item)
+{
+    assert (isleaf ());
+}
+
+shamapinnernode& shamaptreenode::inner ()
+{
+    assert (isinner ());
+    return static_cast <shamapinnernode&> (*this);
+}
+
+shamapinnernode const& shamaptreenode::inner () const
+{
+    assert (isinner ());
+    return static_cast <shamapinnernode const&> (*this);
+}
+
+shamapleafnode& shamaptreenode::leaf ()
+{
+    assert (isleaf ());
+    return static_cast <shamapleafnode&> (*this);
+}
+
+shamapleafnode const& shamaptreenode::leaf () const
+{
+    assert (isleaf ());
+    return static_cast <shamapleafnode const&> (*this);
+}
+
+shamaptreenode::pointer shamaptreenode::createinner (std::uint32_t seq)
+{
+    return std::make_shared <shamapinnernode> (seq);
+}
+
+shamaptreenode::pointer shamaptreenode::createleaf (shamapitem::ref item,
                                 tntype type, std::uint32_t seq)
-    : mitem (item)
-    , mseq (seq)
-    , mtype (type)
-    , misbranch (0)
-    , mfullbelowgen (0)
 {
     assert (item->peekdata ().size () >= 12);
-    updatehash ();
+    auto node = std::make_shared <shamapleafnode> (item, type, seq);
+    node->updatehash ();
+    return node;
+}
+
+shamaptreenode::pointer shamaptreenode::clone (std::uint32_t seq) const
+{
+    shamaptreenode::pointer node;
+
+    if (isleaf ())
+    {
+        node = std::make_shared <shamapleafnode> (leaf ().mitem, mtype, seq);
+        node->mhash = mhash;
+    }
+    else
+    {
+        node = std::make_shared <shamapinnernode> (inner (), seq);
+    }
+
+    return node;
+}
+
+shamaptreenode::pointer shamaptreenode::createinner (uint256 const* hashes,
+                                std::uint32_t seq)
+{
+    auto node = std::make_shared <shamapinnernode> (seq);
+
+    for (int i = 0; i < 16; ++i)
+    {
+        if (hashes[i].isnonzero ())
+            node->misbranch |= (1 << i);
+    }
+
+    node->mcapacity = branchcount (node->misbranch);
+
+    if (node->mcapacity != 0)
+    {
+        node->mbranches.reset (new shamapinnernode::branch[node->mcapacity]);
+
+        for (int i = 0, slot = 0; i < 16; ++i)
+        {
+            if (hashes[i].isnonzero ())
+                node->mbranches[slot++].hash = hashes[i];
+        }
+    }
+
+    return node;
 }
 
-shamaptreenode::shamaptreenode (blob const& rawnode,
+shamaptreenode::pointer shamaptreenode::createfromraw (blob const& rawnode,
                                 std::uint32_t seq, shanodeformat format,
                                 uint256 const& hash, bool hashvalid)
-    : mseq (seq)
-    , mtype (tnerror)
-    , misbranch (0)
-    , mfullbelowgen (0)
 {
+    shamaptreenode::pointer node = createunhashed (rawnode, seq, format);
+
+    if (hashvalid)
+    {
+        node->mhash = hash;
+#if ripple_verify_nodeobject_keys
+        node->updatehash ();
+        assert (node->mhash == hash);
+#endif
+    }
+    else
+        node->updatehash ();
+
+    return node;
+}
+
+shamaptreenode::pointer shamaptreenode::createunhashed (blob const& rawnode,
+                                std::uint32_t seq, shanodeformat format)
+{
+    shamaptreenode::pointer node;
+
     if (format == snfwire)
     {
         serializer s (rawnode);
@@ -96,8 +254,9 @@ shamaptreenode::shamaptreenode (blob const& rawnode,
         if (type == 0)
         {
             // transaction
-            mitem = std::make_shared<shamapitem> (s.getprefixhash (hashprefix::transactionid), s.peekdata ());
-            mtype = tntransaction_nm;
+            node = std::make_shared<shamapleafnode> (
+                std::make_shared<shamapitem> (s.getprefixhash (hashprefix::transactionid), s.peekdata ()),
+                    tntransaction_nm, seq);
         }
         else if (type == 1)
         {
@@ -111,8 +270,8 @@ shamaptreenode::shamaptreenode (blob const& rawnode,
 
             if (u.iszero ()) throw std::runtime_error ("invalid as node");
 
-            mitem = std::make_shared<shamapitem> (u, s.peekdata ());
-            mtype = tnaccount_state;
+            node = std::make_shared<shamapleafnode> (
+                std::make_shared<shamapitem> (u, s.peekdata ()), tnaccount_state, seq);
         }
         else if (type == 2)
         {
@@ -120,19 +279,18 @@ shamaptreenode::shamaptreenode (blob const& rawnode,
             if (len != 512)
                 throw std::runtime_error ("invalid fi node");
 
-            for (int i = 0; i < 16; ++i)
-            {
-                s.get256 (mhashes[i], i * 32);
+            uint256 hashes[16];
 
-                if (mhashes[i].isnonzero ())
-                    misbranch |= (1 << i);
-            }
+            for (int i = 0; i < 16; ++i)
+                s.get256 (hashes[i], i * 32);
 
-            mtype = tninner;
+            node = createinner (hashes, seq);
         }
         else if (type == 3)
         {
             // compressed inner
+            uint256 hashes[16];
+
             for (int i = 0; i < (len / 33); ++i)
             {
                 int pos;
@@ -140,13 +298,10 @@ shamaptreenode::shamaptreenode (blob const& rawnode,
 
                 if ((pos < 0) || (pos >= 16)) throw std::runtime_error ("invalid ci node");
 
-                s.get256 (mhashes[pos], i * 33);
-
-                if (mhashes[pos].isnonzero ())
-                    misbranch |= (1 << pos);
+                s.get256 (hashes[pos], i * 33);
             }
 
-            mtype = tninner;
+            node = createinner (hashes, seq);
         }
         else if (type == 4)
         {
@@ -161,8 +316,8 @@ shamaptreenode::shamaptreenode (blob const& rawnode,
             if (u.iszero ())
                 throw std::runtime_error ("invalid tm node");
 
-            mitem = std::make_shared<shamapitem> (u, s.peekdata ());
-            mtype = tntransaction_md;
+            node = std::make_shared<shamapleafnode> (
+                std::make_shared<shamapitem> (u, s.peekdata ()), tntransaction_md, seq);
         }
     }
 
@@ -185,8 +340,9 @@ shamaptreenode::shamaptreenode (blob const& rawnode,
 
         if (prefix == hashprefix::transactionid)
         {
-            mitem = std::make_shared<shamapitem> (serializer::getsha512half (rawnode), s.peekdata ());
-            mtype = tntransaction_nm;
+            node = std::make_shared<shamapleafnode> (
+                std::make_shared<shamapitem> (serializer::getsha512half (rawnode), s.peekdata ()),
+                    tntransaction_nm, seq);
         }
         else if (prefix == hashprefix::leafnode)
         {
@@ -203,23 +359,20 @@ shamaptreenode::shamaptreenode (blob const& rawnode,
                 throw std::runtime_error ("invalid pln node");
             }
 
-            mitem = std::make_shared<shamapitem> (u, s.peekdata ());
-            mtype = tnaccount_state;
+            node = std::make_shared<shamapleafnode> (
+                std::make_shared<shamapitem> (u, s.peekdata ()), tnaccount_state, seq);
         }
         else if (prefix == hashprefix::innernode)
         {
             if (s.getlength () != 512)
                 throw std::runtime_error ("invalid pin node");
 
-            for (int i = 0; i < 16; ++i)
-            {
-                s.get256 (mhashes[i], i * 32);
+            uint256 hashes[16];
 
-                if (mhashes[i].isnonzero ())
-                    misbranch |= (1 << i);
-            }
+            for (int i = 0; i < 16; ++i)
+                s.get256 (hashes[i], i * 32);
 
-            mtype = tninner;
+            node = createinner (hashes, seq);
         }
         else if (prefix == hashprefix::txnode)
         {
@@ -230,8 +383,8 @@ shamaptreenode::shamaptreenode (blob const& rawnode,
             uint256 txid;
             s.get256 (txid, s.getlength () - 32);
             s.chop (32);
-            mitem = std::make_shared<shamapitem> (txid, s.peekdata ());
-            mtype = tntransaction_md;
+            node = std::make_shared<shamapleafnode> (
+                std::make_shared<shamapitem> (txid, s.peekdata ()), tntransaction_md, seq);
         }
         else
         {
@@ -246,18 +399,42 @@ shamaptreenode::shamaptreenode (blob const& rawnode,
         throw std::runtime_error ("unknown format");
     }
 
-    if (hashvalid)
+    return node;
+}
+
+void shamaptreenode::updatehashes (std::vector<pointer> const& nodes)
+{
+    // every node hashes to the hash of its prefix form, which is hashed for
+    // all of them in one batch
+    std::vector<serializer> preimages (nodes.size ());
+    std::vector<sha512halfjob> jobs;
+    jobs.reserve (nodes.size ());
+
+    for (std::size_t i = 0; i < nodes.size (); ++i)
     {
-        mhash = hash;
-#if ripple_verify_nodeobject_keys
-        updatehash ();
-        assert (mhash == hash);
-#endif
+        shamaptreenode& node = *nodes[i];
+
+        if (node.isinner () && (node.misbranch == 0))
+        {
+            node.mhash.zero ();
+            continue;
+        }
+
+        node.addraw (preimages[i], snfprefix);
+
+        sha512halfjob job;
+        job.data = preimages[i].getdataptr ();
+        job.size = preimages[i].getdatalength ();
+        job.digest = node.mhash.begin ();
+        jobs.push_back (job);
     }
-    else
-        updatehash ();
+
+    sha512half (jobs.data (), jobs.size ());
 }
 
+// this is not batched with updatehashes: it runs from setchild as dirtyup
+// walks a single modified path to the root, one node per level, and each
+// parent's preimage needs the digest just computed for its child
 bool shamaptreenode::updatehash ()
 {
     uint256 nh;
@@ -266,13 +443,21 @@ bool shamaptreenode::updatehash ()
     {
         if (misbranch != 0)
         {
-            nh = serializer::getprefixhash (hashprefix::innernode, reinterpret_cast<unsigned char*> (mhashes), sizeof (mhashes));
+            uint256 hashes[16];
+
+            for (int i = 0; i < 16; ++i)
+            {
+                if (!isemptybranch (i))
+                    hashes[i] = inner ().mbranches[inner ().getslot (i)].hash;
+            }
+
+            nh = serializer::getprefixhash (hashprefix::innernode, reinterpret_cast<unsigned char*> (hashes), sizeof (hashes));
 #if ripple_verify_nodeobject_keys
             serializer s;
             s.add32 (hashprefix::innernode);
 
             for (int i = 0; i < 16; ++i)
-                s.add256 (mhashes[i]);
+                s.add256 (hashes[i]);
 
             assert (nh == s.getsha512half ());
 #endif
@@ -282,22 +467,24 @@ bool shamaptreenode::updatehash ()
     }
     else if (mtype == tntransaction_nm)
     {
-        nh = serializer::getprefixhash (hashprefix::transactionid, mitem->peekdata ());
+        nh = serializer::getprefixhash (hashprefix::transactionid, leaf ().mitem->peekdata ());
     }
     else if (mtype == tnaccount_state)
     {
-        serializer s (mitem->peekserializer ().getdatalength () + (256 + 32) / 8);
+        shamapitem::ref item = leaf ().mitem;
+        serializer s (item->peekserializer ().getdatalength () + (256 + 32) / 8);
         s.add32 (hashprefix::leafnode);
-        s.addraw (mitem->peekdata ());
-        s.add256 (mitem->gettag ());
+        s.addraw (item->peekdata ());
+        s.add256 (item->gettag ());
         nh = s.getsha512half ();
     }
     else if (mtype == tntransaction_md)
     {
-        serializer s (mitem->peekserializer ().getdatalength () + (256 + 32) / 8);
+        shamapitem::ref item = leaf ().mitem;
+        serializer s (item->peekserializer ().getdatalength () + (256 + 32) / 8);
         s.add32 (hashprefix::txnode);
-        s.addraw (mitem->peekdata ());
-        s.add256 (mitem->gettag ());
+        s.addraw (item->peekdata ());
+        s.add256 (item->gettag ());
         nh = s.getsha512half ();
     }
     else
@@ -330,7 +517,7 @@ void shamaptreenode::addraw (serializer& s, shanodeformat format)
             s.add32 (hashprefix::innernode);
 
             for (int i = 0; i < 16; ++i)
-                s.add256 (mhashes[i]);
+                s.add256 (getchildhash (i));
         }
         else
         {
@@ -340,7 +527,7 @@ void shamaptreenode::addraw (serializer& s, shanodeformat format)
                 for (int i = 0; i < 16; ++i)
                     if (!isemptybranch (i))
                     {
-                        s.add256 (mhashes[i]);
+                        s.add256 (getchildhash (i));
                         s.add8 (i);
                     }
 
@@ -349,7 +536,7 @@ void shamaptreenode::addraw (serializer& s, shanodeformat format)
             else
             {
                 for (int i = 0; i < 16; ++i)
-                    s.add256 (mhashes[i]);
+                    s.add256 (getchildhash (i));
 
                 s.add8 (2);
             }
@@ -357,44 +544,50 @@ void shamaptreenode::addraw (serializer& s, shanodeformat format)
     }
     else if (mtype == tnaccount_state)
     {
+        shamapitem::ref item = leaf ().mitem;
+
         if (format == snfprefix)
         {
             s.add32 (hashprefix::leafnode);
-            s.addraw (mitem->peekdata ());
-            s.add256 (mitem->gettag ());
+            s.addraw (item->peekdata ());
+            s.add256 (item->gettag ());
         }
         else
         {
-            s.addraw (mitem->peekdata ());
-            s.add256 (mitem->gettag ());
+            s.addraw (item->peekdata ());
+            s.add256 (item->gettag ());
             s.add8 (1);
         }
     }
     else if (mtype == tntransaction_nm)
     {
+        shamapitem::ref item = leaf ().mitem;
+
         if (format == snfprefix)
         {
             s.add32 (hashprefix::transactionid);
-            s.addraw (mitem->peekdata ());
+            s.addraw (item->peekdata ());
         }
         else
         {
-            s.addraw (mitem->peekdata ());
+            s.addraw (item->peekdata ());
             s.add8 (0);
         }
     }
     else if (mtype == tntransaction_md)
     {
+        shamapitem::ref item = leaf ().mitem;
+
         if (format == snfprefix)
         {
             s.add32 (hashprefix::txnode);
-            s.addraw (mitem->peekdata ());
-            s.add256 (mitem->gettag ());
+            s.addraw (item->peekdata ());
+            s.add256 (item->gettag ());
         }
         else
         {
-            s.addraw (mitem->peekdata ());
-            s.add256 (mitem->gettag ());
+            s.addraw (item->peekdata ());
+            s.add256 (item->gettag ());
             s.add8 (4);
         }
     }
@@ -402,15 +595,39 @@ void shamaptreenode::addraw (serializer& s, shanodeformat format)
         assert (false);
 }
 
+shamapitem::ref shamaptreenode::peekitem ()
+{
+    // caution: do not modify the item todo(tom): a comment in the code does
+    // nothing - this should return a const reference.
+    static shamapitem::pointer const noitem;
+
+    if (!isleaf ())
+        return noitem;
+
+    return leaf ().mitem;
+}
+
 bool shamaptreenode::setitem (shamapitem::ref i, tntype type)
 {
+    // a leaf stays a leaf, shamap replaces nodes that change kind
+    assert (isleaf ());
     mtype = type;
-    mitem = i;
+    leaf ().mitem = i;
     assert (isleaf ());
     assert (mseq != 0);
     return updatehash ();
 }
 
+uint256 const& shamaptreenode::gettag () const
+{
+    return leaf ().mitem->gettag ();
+}
+
+blob const& shamaptreenode::peekdata ()
+{
+    return leaf ().mitem->peekdata ();
+}
+
 bool shamaptreenode::isempty () const
 {
     return misbranch == 0;
@@ -419,22 +636,18 @@ bool shamaptreenode::isempty () const
 int shamaptreenode::getbranchcount () const
 {
     assert (isinner ());
-    int count = 0;
-
-    for (int i = 0; i < 16; ++i)
-        if (!isemptybranch (i))
-            ++count;
-
-    return count;
+    return branchcount (misbranch);
 }
 
-void shamaptreenode::makeinner ()
+uint256 const& shamaptreenode::getchildhash (int m) const
 {
-    mitem.reset ();
-    misbranch = 0;
-    memset (mhashes, 0, sizeof (mhashes));
-    mtype = tninner;
-    mhash.zero ();
+    assert ((m >= 0) && (m < 16) && (mtype == tninner));
+    static uint256 const nohash;
+
+    if (isemptybranch (m))
+        return nohash;
+
+    return inner ().mbranches[inner ().getslot (m)].hash;
 }
 
 void shamaptreenode::dump (const shamapnodeid & id, beast::journal journal)
@@ -459,7 +672,7 @@ std::string shamaptreenode::getstring (const shamapnodeid & id) const
                 ret += "\nb";
                 ret += beast::lexicalcastthrow <std::string> (i);
                 ret += " = ";
-                ret += to_string (mhashes[i]);
+                ret += to_string (getchildhash (i));
             }
     }
 
@@ -479,7 +692,7 @@ std::string shamaptreenode::getstring (const shamapnodeid & id) const
         ret += "\n  hash=";
         ret += to_string (mhash);
         ret += "/";
-        ret += beast::lexicalcast <std::string> (mitem->peekserializer ().getdatalength ());
+        ret += beast::lexicalcast <std::string> (leaf ().mitem->peekserializer ().getdatalength ());
     }
 
     return ret;
@@ -493,24 +706,27 @@ bool shamaptreenode::setchild (int m, uint256 const& hash, shamaptreenode::ref c
     assert (mseq != 0);
     assert (child.get() != this);
 
-    if (mhashes[m] == hash)
+    if (getchildhash (m) == hash)
         return false;
 
-    mhashes[m] = hash;
+    shamapinnernode& node = inner ();
 
     if (hash.isnonzero ())
     {
         assert (child && (child->getnodehash() == hash));
-        misbranch |= (1 << m);
+
+        shamapinnernode::branch& b = isemptybranch (m)
+            ? node.insertslot (m)
+            : node.mbranches[node.getslot (m)];
+        b.hash = hash;
+        b.child = child;
     }
     else
     {
         assert (!child);
-        misbranch &= ~ (1 << m);
+        node.eraseslot (m);
     }
 
-    mchildren[m] = child;
-
     return updatehash ();
 }
 
@@ -522,9 +738,9 @@ void shamaptreenode::sharechild (int m, shamaptreenode::ref child)
     assert (mseq != 0);
     assert (child);
     assert (child.get() != this);
-    assert (child->getnodehash() == mhashes[m]);
+    assert (child->getnodehash() == getchildhash (m));
 
-    mchildren[m] = child;
+    std::atomic_store (&inner ().mbranches[inner ().getslot (m)].child, child);
 }
 
 shamaptreenode* shamaptreenode::getchildpointer (int branch)
@@ -532,8 +748,12 @@ shamaptreenode* shamaptreenode::getchildpointer (int branch)
     assert (branch >= 0 && branch < 16);
     assert (isinnernode ());
 
-    std::unique_lock <std::mutex> lock (childlock);
-    return mchildren[branch].get ();
+    if (isemptybranch (branch))
+        return nullptr;
+
+    // the parent keeps the child alive, only the load has to be atomic
+    return std::atomic_load (
+        &inner ().mbranches[inner ().getslot (branch)].child).get ();
 }
 
 shamaptreenode::pointer shamaptreenode::getchild (int branch)
@@ -541,9 +761,13 @@ shamaptreenode::pointer shamaptreenode::getchild (int branch)
     assert (branch >= 0 && branch < 16);
     assert (isinnernode ());
 
-    std::unique_lock <std::mutex> lock (childlock);
-    assert (!mchildren[branch] || (mhashes[branch] == mchildren[branch]->getnodehash()));
-    return mchildren[branch];
+    if (isemptybranch (branch))
+        return shamaptreenode::pointer ();
+
+    shamapinnernode::branch const& b = inner ().mbranches[inner ().getslot (branch)];
+    shamaptreenode::pointer child = std::atomic_load (&b.child);
+    assert (!child || (b.hash == child->getnodehash()));
+    return child;
 }
 
 void shamaptreenode::canonicalizechild (int branch, shamaptreenode::pointer& node)
@@ -551,19 +775,15 @@ void shamaptreenode::canonicalizechild (int branch, shamaptreenode::pointer& nod
     assert (branch >= 0 && branch < 16);
     assert (isinnernode ());
     assert (node);
-    assert (node->getnodehash() == mhashes[branch]);
+    assert (node->getnodehash() == getchildhash (branch));
 
-    std::unique_lock <std::mutex> lock (childlock);
-    if (mchildren[branch])
-    {
-        // there is already a node hooked up, return it
-        node = mchildren[branch];
-    }
-    else
-    {
-        // hook this node up
-        mchildren[branch] = node;
-    }
+    shamapinnernode::branch& b = inner ().mbranches[inner ().getslot (branch)];
+    shamaptreenode::pointer expected;
+
+    // hook this node up unless another thread got there first, in which
+    // case expected holds the node already hooked up and we return it
+    if (!std::atomic_compare_exchange_strong (&b.child, &expected, node))
+        node = expected;
 }
 
 
@@ -24,9 +24,14 @@
 #include <ripple/basics/stringutilities.h>
 #include <ripple/nodestore/dummyscheduler.h>
 #include <ripple/nodestore/manager.h>
+#include <ripple/core/jobqueue.h>
 #include <beast/unit_test/suite.h>
 #include <beast/utility/journal.h>
 #include <beast/chrono/manual_clock.h>
+#include <beast/insight/nullcollector.h>
+#include <beast/random/rngfill.h>
+#include <beast/random/xor_shift_engine.h>
+#include <beast/threads/stoppable.h>
 
 namespace ripple {
 
@@ -97,6 +102,165 @@ public:
         i = smap.peeknextitem (i->gettag ());
         unexpected (i, "bad traverse");
 
+        testcase ("branch visit");
+        std::vector<uint256> leaves, branchleaves;
+        smap.visitleaves ([&leaves] (shamapitem::ref item) {
+            leaves.push_back (item->gettag ());
+        });
+        for (int branch = 0; branch < 16; ++branch)
+        {
+            std::size_t const before = branchleaves.size ();
+            smap.visitbranchleaves (branch, [&branchleaves] (shamapitem::ref item) {
+                branchleaves.push_back (item->gettag ());
+            });
+            if (branch == 0)
+                unexpected (branchleaves.size () - before != 1, "bad branch visit");
+            else if (branch == 0xb)
+                unexpected (branchleaves.size () - before != 2, "bad branch visit");
+            else
+                unexpected (branchleaves.size () != before, "bad branch visit");
+        }
+        unexpected (leaves != branchleaves, "bad branch visit order");
+
+        std::vector<uint256> nodes, branchnodes;
+        smap.visitnodes ([&nodes] (shamaptreenode& node) {
+            nodes.push_back (node.getnodehash ());
+            return false;
+        });
+        branchnodes.push_back (nodes.front ());
+        for (int branch = 0; branch < 16; ++branch)
+        {
+            smap.visitbranchnodes (branch, [&branchnodes] (shamaptreenode& node) {
+                branchnodes.push_back (node.getnodehash ());
+                return false;
+            });
+        }
+        unexpected (nodes != branchnodes, "bad branch node visit");
+
+        testcase ("prefetch visit");
+        std::vector<uint256> prefetched;
+        smap.visitleaves ([&prefetched] (shamapitem::ref item) {
+            prefetched.push_back (item->gettag ());
+        }, shamap::walk_prefetch);
+        unexpected (leaves != prefetched, "bad prefetch visit order");
+
+        testcase ("prefetch visit from the node store");
+        {
+            auto backed = nodestore::manager::instance().make_database (
+                "test", scheduler, j, 2, parsedelimitedkeyvaluestring(
+                    "type=memory|path=shamap_prefetch_test"));
+
+            beast::xor_shift_engine g (2);
+            shamap source (smtstate, fullbelowcache, treenodecache,
+                *backed, handler(), beast::journal());
+            for (int i = 0; i < 5000; ++i)
+            {
+                uint256 tag;
+                beast::rngfill (tag.begin (), tag.size (), g);
+                source.additem (shamapitem (tag, inttovuc (i)), false, false);
+            }
+            source.flushdirty (hotaccount_node, 1);
+
+            std::vector<uint256> sourceleaves;
+            source.visitleaves ([&sourceleaves] (shamapitem::ref item) {
+                sourceleaves.push_back (item->gettag ());
+            });
+
+            // a fresh node cache, so the walk has to read the nodes back
+            treenodecache coldcache ("test.cold_tree_node_cache", 65536, 60,
+                clock, j);
+            shamap loaded (smtstate, source.gethash (), fullbelowcache,
+                coldcache, *backed, handler(), beast::journal());
+            unexpected (!loaded.fetchroot (source.gethash (), nullptr),
+                "no root");
+            loaded.setimmutable ();
+
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                // the second pass walks the map once it is in memory
+                std::vector<uint256> loadedleaves;
+                loaded.visitleaves ([&loadedleaves] (shamapitem::ref item) {
+                    loadedleaves.push_back (item->gettag ());
+                }, shamap::walk_prefetch);
+                unexpected (loadedleaves != sourceleaves,
+                    "bad prefetch visit from the node store");
+            }
+        }
+
+        testcase ("iterate");
+        std::vector<uint256> iterated;
+        shamap const& csmap = smap;
+        for (auto const& item : csmap)
+            iterated.push_back (item->gettag ());
+        unexpected (leaves != iterated, "bad iteration order");
+        auto it = smap.upper_bound (h1);
+        unexpected (it == smap.end () || (*it)->gettag () != h3, "bad upper bound");
+        unexpected (smap.lower_bound (h1) != smap.begin (), "bad lower bound");
+        it = smap.lower_bound (h5);
+        unexpected (it == smap.end () || it->gettag () != h3, "bad seek");
+        ++it;
+        unexpected (it == smap.end () || it->gettag () != h4, "bad seek");
+        unexpected (++it != smap.end (), "bad seek");
+        unexpected (smap.upper_bound (h4) != smap.end (), "bad upper bound");
+        it.seek (h2);
+        unexpected (it == smap.end () || it->gettag () != h3, "bad seek");
+
+        testcase ("graft");
+        shamap grafted (smtfree, fullbelowcache, treenodecache,
+            *db, handler(), beast::journal());
+        for (int branch = 0; branch < 16; ++branch)
+        {
+            shamap part (smtfree, fullbelowcache, treenodecache,
+                *db, handler(), beast::journal());
+            smap.visitbranchleaves (branch, [&part] (shamapitem::ref item) {
+                part.additem (*item, true, false);
+            });
+            unexpected (!grafted.graftbranch (branch, part), "no graft");
+        }
+        unexpected (grafted.gethash () != smap.gethash (), "bad graft");
+        unexpected (grafted.graftbranch (0, smap), "graft over branch");
+
+        testcase ("branch items");
+        {
+            beast::rootstoppable stoppable ("shamap_test");
+            auto jobqueue = make_jobqueue (beast::insight::nullcollector::new (),
+                stoppable, j);
+            jobqueue->setthreadcount (0, false);
+
+            beast::xor_shift_engine g (1);
+            shamap serial (smtfree, fullbelowcache, treenodecache,
+                *db, handler(), beast::journal());
+            std::vector<shamap::branchitems> chunks (6);
+            for (int i = 0; i < 3000; ++i)
+            {
+                uint256 tag;
+                beast::rngfill (tag.begin (), tag.size (), g);
+                auto item = std::make_shared<shamapitem> (tag, inttovuc (i));
+                serial.additem (*item, true, false);
+                chunks[i % chunks.size ()][tag.begin ()[0] >> 4].push_back (item);
+            }
+
+            shamap parallel (smtfree, fullbelowcache, treenodecache,
+                *db, handler(), beast::journal());
+            unexpected (!parallel.addbranchitems (chunks, true, false, *jobqueue, jtparallel),
+                "no branch items");
+            unexpected (parallel.gethash () != serial.gethash (),
+                "branch items differ from serial adds");
+
+            for (auto& items : chunks.front ())
+            {
+                if (!items.empty ())
+                {
+                    items.push_back (items.front ());
+                    break;
+                }
+            }
+            shamap duplicate (smtfree, fullbelowcache, treenodecache,
+                *db, handler(), beast::journal());
+            unexpected (duplicate.addbranchitems (chunks, true, false, *jobqueue, jtparallel),
+                "duplicate branch item added");
+        }
+
         testcase ("snapshot");
         uint256 maphash = smap.gethash ();
         shamap::pointer map2 = smap.snapshot (false);
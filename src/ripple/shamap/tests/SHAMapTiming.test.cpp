@@ -0,0 +1,321 @@
+//------------------------------------------------------------------------------
+/*
+    this file is part of rippled: https://github.com/ripple/rippled
+    copyright (c) 2012, 2013 ripple labs inc.
+
+    permission to use, copy, modify, and/or distribute this software for any
+    purpose  with  or without fee is hereby granted, provided that the above
+    copyright notice and this permission notice appear in all copies.
+
+    the  software is provided "as is" and the author disclaims all warranties
+    with  regard  to  this  software  including  all  implied  warranties  of
+    merchantability  and  fitness. in no event shall the author be liable for
+    any  special ,  direct, indirect, or consequential damages or any damages
+    whatsoever  resulting  from  loss  of use, data or profits, whether in an
+    action  of  contract, negligence or other tortious action, arising out of
+    or in connection with the use or performance of this software.
+*/
+//==============================================================================
+
+#include <beastconfig.h>
+#include <ripple/shamap/fullbelowcache.h>
+#include <ripple/shamap/shamap.h>
+#include <ripple/basics/stringutilities.h>
+#include <ripple/nodestore/dummyscheduler.h>
+#include <ripple/nodestore/manager.h>
+#include <ripple/core/jobqueue.h>
+#include <beast/chrono/manual_clock.h>
+#include <beast/insight/nullcollector.h>
+#include <beast/random/rngfill.h>
+#include <beast/random/xor_shift_engine.h>
+#include <beast/threads/stoppable.h>
+#include <beast/unit_test/suite.h>
+#include <beast/utility/journal.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+namespace ripple {
+
+// measures the memory and speed of a state map holding a synthetic ledger
+class shamap_timing_test : public beast::unit_test::suite
+{
+public:
+    typedef std::chrono::high_resolution_clock clock_type;
+
+    enum
+    {
+        // accounts in the synthetic ledger
+        accounts = 1000000,
+
+        // roughly the size of a serialized account root
+        itemsize = 96
+    };
+
+    struct handler
+    {
+        void operator()(std::uint32_t refnum) const
+        {
+            throw std::runtime_error("missing node");
+        }
+    };
+
+    template <class duration>
+    static double
+    seconds (duration const& d)
+    {
+        return std::chrono::duration_cast <
+            std::chrono::duration <double>> (d).count ();
+    }
+
+    static std::vector <shamapitem::pointer>
+    makeitems (std::size_t count)
+    {
+        beast::xor_shift_engine g (1);
+        std::vector <shamapitem::pointer> items;
+        items.reserve (count);
+        uint256 tag;
+        blob data (itemsize);
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            beast::rngfill (tag.begin (), tag.size (), g);
+            beast::rngfill (data.data (), data.size (), g);
+            items.push_back (std::make_shared <shamapitem> (tag, data));
+        }
+
+        return items;
+    }
+
+    void
+    testmemory (shamap& map, std::vector <shamapitem::pointer> const& items)
+    {
+        testcase ("memory");
+
+        auto start = clock_type::now ();
+        for (auto const& item : items)
+            map.addgiveitem (item, false, false);
+        log << "insert " << items.size () << " accounts " <<
+            std::setprecision (3) << seconds (clock_type::now () - start) << "s";
+
+        std::size_t inner = 0;
+        std::size_t leaves = 0;
+        std::size_t slots = 0;
+        map.visitnodes ([&] (shamaptreenode& node)
+        {
+            if (node.isinner ())
+            {
+                ++inner;
+                slots += static_cast <shamapinnernode&> (node).getcapacity ();
+            }
+            else
+            {
+                ++leaves;
+            }
+            return true;
+        });
+
+        std::size_t const innerbytes = inner * sizeof (shamapinnernode) +
+            slots * sizeof (shamapinnernode::branch);
+        std::size_t const leafbytes = leaves * sizeof (shamapleafnode);
+
+        log << "inner nodes " << inner << " with " << slots << " slots, " <<
+            (innerbytes >> 20) << " mb";
+        log << "leaf nodes " << leaves << ", " << (leafbytes >> 20) << " mb";
+        log << "bytes per account " << (innerbytes + leafbytes) / leaves <<
+            " (leaf " << sizeof (shamapleafnode) << ", inner " <<
+                sizeof (shamapinnernode) << ", slot " <<
+                    sizeof (shamapinnernode::branch) << ")";
+
+        expect (leaves == items.size (), "wrong leaf count");
+    }
+
+    void
+    testlookup (shamap& map, std::vector <shamapitem::pointer> const& items)
+    {
+        testcase ("lookup");
+
+        std::vector <uint256> keys;
+        keys.reserve (items.size ());
+        for (auto const& item : items)
+            keys.push_back (item->gettag ());
+        std::shuffle (keys.begin (), keys.end (), beast::xor_shift_engine (2));
+
+        std::size_t found = 0;
+        auto start = clock_type::now ();
+        for (auto const& key : keys)
+        {
+            if (map.peekitem (key))
+                ++found;
+        }
+        auto const elapsed = seconds (clock_type::now () - start);
+        log << "lookup " << keys.size () << " accounts " <<
+            std::setprecision (3) << elapsed << "s, " <<
+                static_cast <std::size_t> (keys.size () / elapsed) << "/s";
+        expect (found == keys.size (), "missing accounts");
+
+        start = clock_type::now ();
+        std::size_t visited = 0;
+        map.visitleaves ([&visited] (shamapitem::ref) { ++visited; });
+        log << "walk " << visited << " accounts " <<
+            std::setprecision (3) << seconds (clock_type::now () - start) << "s";
+
+        start = clock_type::now ();
+        std::size_t stepped = 0;
+        for (auto item = map.peekfirstitem (); item;
+             item = map.peeknextitem (item->gettag ()))
+            ++stepped;
+        log << "peeknextitem scan " << stepped << " accounts " <<
+            std::setprecision (3) << seconds (clock_type::now () - start) << "s";
+
+        start = clock_type::now ();
+        std::size_t iterated = 0;
+        for (auto const& item : map)
+            iterated += item ? 1 : 0;
+        log << "iterator scan " << iterated << " accounts " <<
+            std::setprecision (3) << seconds (clock_type::now () - start) << "s";
+        expect (stepped == visited && iterated == visited, "wrong scan count");
+    }
+
+    // look up every account from a growing number of threads in a map
+    // freshly loaded from the node store, so the readers race to hook up
+    // the children they fetch.
+    void
+    testconcurrentreads (shamap& map, std::vector <shamapitem::pointer> const& items,
+        fullbelowcache& fullbelowcache, treenodecache& treenodecache,
+        nodestore::database& db)
+    {
+        testcase ("concurrent reads");
+
+        map.flushdirty (hotaccount_node, 1);
+
+        std::vector <uint256> keys;
+        keys.reserve (items.size ());
+        for (auto const& item : items)
+            keys.push_back (item->gettag ());
+        std::shuffle (keys.begin (), keys.end (), beast::xor_shift_engine (3));
+
+        double base = 0;
+
+        for (std::size_t threads = 1; threads <= 8; threads *= 2)
+        {
+            shamap loaded (smtstate, map.gethash (), fullbelowcache,
+                treenodecache, db, handler(), beast::journal());
+            expect (loaded.fetchroot (map.gethash (), nullptr), "no root");
+            loaded.setimmutable ();
+
+            std::atomic <std::size_t> found (0);
+            std::vector <std::thread> readers;
+            auto start = clock_type::now ();
+
+            for (std::size_t t = 0; t < threads; ++t)
+            {
+                readers.emplace_back ([&, t]
+                {
+                    std::size_t n = 0;
+                    for (std::size_t i = t; i < keys.size (); i += threads)
+                    {
+                        if (loaded.peekitem (keys[i]))
+                            ++n;
+                    }
+                    found += n;
+                });
+            }
+
+            for (auto& reader : readers)
+                reader.join ();
+
+            auto const elapsed = seconds (clock_type::now () - start);
+            auto const rate = keys.size () / elapsed;
+            if (threads == 1)
+                base = rate;
+
+            log << threads << " threads " << std::setprecision (3) <<
+                elapsed << "s, " << static_cast <std::size_t> (rate) <<
+                    "/s, scaling " << rate / base;
+            expect (found == keys.size (), "missing accounts");
+        }
+    }
+
+    // the close of a ledger changing some of the accounts, flushed on one
+    // thread and then across the root subtrees on the job queue
+    void
+    testflush (shamap& map, std::vector <shamapitem::pointer> const& items,
+        jobqueue& jobqueue)
+    {
+        testcase ("flush");
+
+        beast::xor_shift_engine g (4);
+        blob data (itemsize);
+
+        for (std::size_t changes = 1000; changes <= 100000; changes *= 10)
+        {
+            std::vector <shamapitem::pointer> changed;
+            changed.reserve (changes);
+            for (std::size_t i = 0; i < changes; ++i)
+            {
+                beast::rngfill (data.data (), data.size (), g);
+                changed.push_back (std::make_shared <shamapitem> (
+                    items[g () % items.size ()]->gettag (), data));
+            }
+
+            uint256 hashes[2];
+            double elapsed[2];
+
+            for (int parallel = 0; parallel < 2; ++parallel)
+            {
+                shamap::pointer next = map.snapshot (true);
+                for (auto const& item : changed)
+                    next->updategiveitem (item, false, false);
+
+                auto start = clock_type::now ();
+                if (parallel)
+                    next->flushdirty (hotaccount_node, 2, jobqueue, jtparallel);
+                else
+                    next->flushdirty (hotaccount_node, 2);
+                elapsed[parallel] = seconds (clock_type::now () - start);
+                hashes[parallel] = next->gethash ();
+            }
+
+            log << changes << " changes flushed " << std::setprecision (3) <<
+                elapsed[0] * 1000 << "ms serial, " << elapsed[1] * 1000 <<
+                    "ms parallel";
+            expect (hashes[0] == hashes[1], "parallel flush changed the hash");
+        }
+    }
+
+    void
+    run ()
+    {
+        beast::manual_clock <std::chrono::steady_clock> clock;
+        beast::journal const j;
+
+        fullbelowcache fullbelowcache ("test.full_below", clock);
+        treenodecache treenodecache ("test.tree_node_cache", 65536, 60, clock, j);
+        nodestore::dummyscheduler scheduler;
+        auto db = nodestore::manager::instance().make_database (
+            "test", scheduler, j, 0, parsedelimitedkeyvaluestring("type=memory|path=shamap_timing"));
+
+        std::vector <shamapitem::pointer> const items (makeitems (accounts));
+
+        shamap map (smtfree, fullbelowcache, treenodecache,
+            *db, handler(), beast::journal());
+
+        testmemory (map, items);
+        testlookup (map, items);
+        testconcurrentreads (map, items, fullbelowcache, treenodecache, *db);
+
+        beast::rootstoppable stoppable ("shamap_timing");
+        auto jobqueue = make_jobqueue (beast::insight::nullcollector::new (),
+            stoppable, j);
+        jobqueue->setthreadcount (0, false);
+
+        testflush (map, items, *jobqueue);
+    }
+};
+
+beast_define_testsuite_manual(shamap_timing,shamap,ripple);
+
+} // ripple
@@ -20,6 +20,7 @@
 #include <beastconfig.h>
 
 #include <ripple/app/consensus/ledgerconsensus.cpp>
+#include <ripple/app/consensus/openledgerrebuild.test.cpp>
 #include <ripple/app/peers/peerset.cpp>
 #include <ripple/app/ledger/ledgercleaner.cpp>
 #include <ripple/app/ledger/ledgermaster.cpp>
@@ -21,6 +21,10 @@
 
 #include <ripple/app/book/tests/offerstream.test.cpp>
 #include <ripple/app/book/tests/quality.test.cpp>
+#include <ripple/app/misc/tests/accountsubindex.test.cpp>
+#include <ripple/app/misc/tests/dividendinputs.test.cpp>
+#include <ripple/app/misc/tests/dividendscan.test.cpp>
+#include <ripple/app/misc/tests/dividendindex.test.cpp>
 #include <ripple/app/ledger/inboundledger.cpp>
 #include <ripple/app/paths/ripplestate.cpp>
 #include <ripple/app/peers/uniquenodelist.cpp>
@@ -30,3 +34,6 @@
 #include <ripple/app/tx/transaction.cpp>
 #include <ripple/app/tx/transactionengine.cpp>
 #include <ripple/app/tx/transactionmeta.cpp>
+#include <ripple/app/tx/speculativeapply.cpp>
+#include <ripple/app/tx/speculativeapply.test.cpp>
+#include <ripple/app/tx/dividendapply.test.cpp>
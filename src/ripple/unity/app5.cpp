@@ -26,3 +26,4 @@
 #include <ripple/app/misc/feevoteimpl.cpp>
 #include <ripple/app/misc/dividendvoteimpl.cpp>
 #include <ripple/app/misc/dividendmasterimpl.cpp>
+#include <ripple/app/misc/dividendindeximpl.cpp>
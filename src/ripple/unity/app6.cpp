@@ -20,11 +20,16 @@
 #include <beastconfig.h>
 
 #include <ripple/app/ledger/ledgerentryset.cpp>
+#include <ripple/app/ledger/ledgerentryset.test.cpp>
 #include <ripple/app/ledger/acceptedledger.cpp>
+#include <ripple/app/ledger/txnwriter.cpp>
+#include <ripple/app/ledger/txnwriter.test.cpp>
 #include <ripple/app/ledger/directoryentryiterator.cpp>
 #include <ripple/app/ledger/orderbookiterator.cpp>
 #include <ripple/app/consensus/disputedtx.cpp>
 #include <ripple/app/misc/hashrouter.cpp>
+#include <ripple/app/misc/sigverifier.cpp>
+#include <ripple/app/misc/tests/sigverifier.test.cpp>
 #include <ripple/app/paths/accountcurrencies.cpp>
 #include <ripple/app/paths/credit.cpp>
 #include <ripple/app/paths/findpaths.cpp>
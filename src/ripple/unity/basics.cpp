@@ -38,6 +38,7 @@
 #include <ripple/basics/tests/hardened_hash_test.cpp>
 #include <ripple/basics/tests/keycache.test.cpp>
 #include <ripple/basics/tests/rangeset.test.cpp>
+#include <ripple/basics/tests/sortedflatmap.test.cpp>
 #include <ripple/basics/tests/stringutilities.test.cpp>
 #include <ripple/basics/tests/taggedcache.test.cpp>
 
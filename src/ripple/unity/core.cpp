@@ -25,5 +25,6 @@
 #include <ripple/core/impl/loadmonitor.cpp>
 #include <ripple/core/impl/job.cpp>
 #include <ripple/core/impl/jobqueue.cpp>
+#include <ripple/core/impl/paralleljobs.cpp>
 
 #include <ripple/core/tests/loadfeetrack.test.cpp>
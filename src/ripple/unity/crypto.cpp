@@ -26,13 +26,17 @@
 #include <ripple/crypto/impl/ec_key.cpp>
 #include <ripple/crypto/impl/ecdsa.cpp>
 #include <ripple/crypto/impl/ecdsacanonical.cpp>
+#include <ripple/crypto/impl/ecdsakeycache.cpp>
 #include <ripple/crypto/impl/ecies.cpp>
 #include <ripple/crypto/impl/generatedeterministickey.cpp>
 #include <ripple/crypto/impl/randomnumbers.cpp>
 #include <ripple/crypto/impl/rfc1751.cpp>
+#include <ripple/crypto/impl/sha512batch.cpp>
 
 #include <ripple/crypto/tests/ckey.test.cpp>
 #include <ripple/crypto/tests/ecdsacanonical.test.cpp>
+#include <ripple/crypto/tests/ecdsakeycache.test.cpp>
+#include <ripple/crypto/tests/sha512batch.test.cpp>
 
 #if doxygen
 #include <ripple/crypto/readme.md>
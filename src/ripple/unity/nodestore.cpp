@@ -42,5 +42,6 @@
 #include <ripple/nodestore/tests/basics.test.cpp>
 #include <ripple/nodestore/tests/database.test.cpp>
 #include <ripple/nodestore/tests/import_test.cpp>
+#include <ripple/nodestore/tests/ratio_test.cpp>
 #include <ripple/nodestore/tests/timing.test.cpp>
 
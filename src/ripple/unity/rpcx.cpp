@@ -113,6 +113,7 @@
 #include <ripple/rpc/tests/jsonobject.test.cpp>
 #include <ripple/rpc/tests/jsonrpc.test.cpp>
 #include <ripple/rpc/tests/jsonwriter.test.cpp>
+#include <ripple/rpc/tests/ledgerdata.test.cpp>
 #include <ripple/rpc/tests/status.test.cpp>
 #include <ripple/rpc/tests/writejson.test.cpp>
 #include <ripple/rpc/tests/yield.test.cpp>
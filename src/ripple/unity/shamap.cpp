@@ -28,3 +28,4 @@
 #include <ripple/shamap/tests/fetchpack.test.cpp>
 #include <ripple/shamap/tests/shamap.test.cpp>
 #include <ripple/shamap/tests/shamapsync.test.cpp>
+#include <ripple/shamap/tests/shamaptiming.test.cpp>